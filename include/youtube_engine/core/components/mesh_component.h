@@ -6,6 +6,7 @@
 #include <youtube_engine/resources/types/mesh.h>
 
 #include <memory>
+#include <string>
 
 namespace OZZ {
     class MeshComponent {
@@ -18,8 +19,18 @@ namespace OZZ {
         std::weak_ptr<Mesh> GetMesh();
         std::weak_ptr<Mesh> SetMesh(std::shared_ptr<Mesh>&& mesh);
 
+        // Groups this mesh's draws under a named scope in the GPU profiler. Empty means no scope.
+        [[nodiscard]] const std::string& GetProfileScope() const { return _profileScope; }
+        void SetProfileScope(std::string scope) { _profileScope = std::move(scope); }
+
+        // Marks a mesh that rarely moves or changes material, so the renderer can reuse its recorded draws
+        [[nodiscard]] bool IsStatic() const { return _static; }
+        void SetStatic(bool isStatic) { _static = isStatic; }
+
     private:
         std::shared_ptr<Mesh> _mesh { nullptr };
+        std::string _profileScope {};
+        bool _static { false };
 
     };
 }
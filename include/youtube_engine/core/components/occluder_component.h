@@ -0,0 +1,30 @@
+#pragma once
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+namespace OZZ {
+    /*
+     * Marks an entity as something that hides what's behind it from the CPU occlusion culler. The geometry is drawn
+     * into a low resolution depth buffer, so it should be a handful of triangles that sit entirely inside the visible
+     * mesh -- anything poking out can hide objects that are actually in view.
+     */
+    class OccluderComponent {
+    public:
+        OccluderComponent() = default;
+        OccluderComponent(std::vector<glm::vec3>&& vertices, std::vector<uint32_t>&& indices);
+
+        // A box in model space, the usual occluder for walls and buildings
+        OccluderComponent(const glm::vec3& min, const glm::vec3& max);
+
+        ~OccluderComponent() = default;
+
+        [[nodiscard]] const std::vector<glm::vec3>& GetVertices() const { return _vertices; }
+        [[nodiscard]] const std::vector<uint32_t>& GetIndices() const { return _indices; }
+
+    private:
+        std::vector<glm::vec3> _vertices {};
+        std::vector<uint32_t> _indices {};
+    };
+}
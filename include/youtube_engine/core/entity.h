@@ -10,6 +10,7 @@
 #include <youtube_engine/core/components/transform_component.h>
 #include <youtube_engine/core/components/mesh_component.h>
 #include <youtube_engine/core/components/camera_component.h>
+#include <youtube_engine/core/components/occluder_component.h>
 
 namespace OZZ {
     class Entity {
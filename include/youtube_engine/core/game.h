@@ -6,7 +6,10 @@
 #pragma once
 #include <string>
 #include <youtube_engine/core/scene.h>
+#include <youtube_engine/rendering/render_thread.h>
+#include <youtube_engine/rendering/renderer.h>
 #include <chrono>
+#include <optional>
 
 namespace OZZ {
     class Game {
@@ -29,7 +32,11 @@ namespace OZZ {
         virtual void Update(float deltaTime) {};
         virtual void OnExit() {};
 
-        virtual void ResetRenderer();
+        // Requests add up until the reset runs at the end of the frame, so the most thorough one wins
+        virtual void ResetRenderer(RendererResetCause cause = RendererResetCause::DeviceLost);
+
+        // Takes effect with the end of frame reset, which only rebuilds what the changed settings need
+        void ApplyRendererSettings(const RendererSettings& settings);
     private:
         void initializeServices();
 
@@ -41,9 +48,14 @@ namespace OZZ {
         std::string _title {"Default Ozz Game"};
         bool _running;
         bool _rendererResetRequested { false };
+        RendererResetCause _rendererResetCause { RendererResetCause::PresentModeChange };
+        std::optional<RendererSettings> _pendingRendererSettings {};
 
         std::unique_ptr<Scene> _currentScene {};
 
+        // Only while drawing off the game thread
+        std::unique_ptr<RenderThread> _renderThread {};
+
         std::chrono::time_point<std::chrono::high_resolution_clock> _lastFrameTime {};
     };
 
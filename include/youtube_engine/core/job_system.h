@@ -0,0 +1,39 @@
+#pragma once
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+namespace OZZ {
+    class JobSystem {
+    public:
+        using Job = std::function<void()>;
+        using RangeJob = std::function<void(uint32_t begin, uint32_t end)>;
+
+        // A thread count of 0 uses one worker per hardware thread, minus the calling thread
+        explicit JobSystem(uint32_t threadCount = 0);
+        ~JobSystem();
+
+        std::future<void> Submit(Job job);
+
+        // Splits [0, count) into batches and runs them across the workers. The calling thread takes batches too, so
+        // this is safe to call from inside a job.
+        void ParallelFor(uint32_t count, uint32_t batchSize, const RangeJob& job);
+
+        [[nodiscard]] uint32_t GetWorkerCount() const { return static_cast<uint32_t>(_workers.size()); }
+
+    private:
+        void workerLoop();
+
+    private:
+        std::vector<std::thread> _workers {};
+        std::queue<std::packaged_task<void()>> _jobs {};
+
+        std::mutex _mutex;
+        std::condition_variable _condition;
+        bool _running { true };
+    };
+}
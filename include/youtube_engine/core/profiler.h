@@ -0,0 +1,64 @@
+#pragma once
+
+/*
+ * CPU profiling zones. Everything here compiles away unless the engine is built with OZZ_ENABLE_PROFILING.
+ *
+ * OZZ_PROFILE_SCOPE("Name") times the rest of the enclosing block, OZZ_PROFILE_FUNCTION() uses the function's name.
+ * Names must outlive the trace, so stick to string literals.
+ */
+#ifdef OZZ_ENABLE_PROFILING
+
+#include <youtube_engine/platform/filesystem.h>
+
+#include <chrono>
+#include <cstdint>
+
+namespace OZZ {
+    class Profiler {
+    public:
+        // Zones kept per thread; the oldest get overwritten once it wraps
+        static constexpr uint64_t RING_SIZE = 1 << 16;
+
+        static uint64_t Now() {
+            return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now().time_since_epoch()).count());
+        }
+
+        // Appends to the calling thread's ring buffer. Never locks once the thread has recorded its first zone.
+        static void Record(const char* name, uint64_t start, uint64_t end);
+
+        static void SetThreadName(const char* name);
+
+        // Writes the zones still in every thread's ring buffer as Chrome trace JSON, which Perfetto also opens. Other
+        // threads can keep recording meanwhile; zones they overwrite while it copies are left out.
+        static bool ExportChromeTrace(const Path& path);
+    };
+
+    class ProfileZone {
+    public:
+        explicit ProfileZone(const char* name) : _name(name), _start(Profiler::Now()) {}
+        ~ProfileZone() { Profiler::Record(_name, _start, Profiler::Now()); }
+
+        ProfileZone(const ProfileZone&) = delete;
+        ProfileZone& operator=(const ProfileZone&) = delete;
+
+    private:
+        const char* _name;
+        uint64_t _start;
+    };
+}
+
+#define OZZ_PROFILE_CONCAT_INNER(a, b) a##b
+#define OZZ_PROFILE_CONCAT(a, b) OZZ_PROFILE_CONCAT_INNER(a, b)
+
+#define OZZ_PROFILE_SCOPE(name) ::OZZ::ProfileZone OZZ_PROFILE_CONCAT(ozzProfileZone, __LINE__) { name }
+#define OZZ_PROFILE_FUNCTION() OZZ_PROFILE_SCOPE(__func__)
+#define OZZ_PROFILE_THREAD(name) ::OZZ::Profiler::SetThreadName(name)
+
+#else
+
+#define OZZ_PROFILE_SCOPE(name)
+#define OZZ_PROFILE_FUNCTION()
+#define OZZ_PROFILE_THREAD(name)
+
+#endif
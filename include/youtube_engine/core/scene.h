@@ -4,10 +4,23 @@
 
 #pragma once
 #include <youtube_engine/core/entity.h>
+#include <youtube_engine/rendering/occlusion_buffer.h>
+#include <youtube_engine/rendering/texture_streaming.h>
+#include <chrono>
 #include <vector>
 #include <memory>
 
 namespace OZZ {
+    struct RenderableObject;
+    struct FramePacket;
+
+    struct SceneCullingStats {
+        uint32_t Occluders { 0 };
+        uint32_t OccluderTriangles { 0 };
+        uint32_t Tested { 0 };
+        uint32_t Culled { 0 };
+    };
+
     class Scene {
         friend class Game;
 
@@ -18,11 +31,29 @@ namespace OZZ {
         Entity* CreateEntity();
         void RemoveEntity(Entity *entity);
 
+        // Drops meshes hidden behind OccluderComponents on the CPU, before the renderer ever sees them
+        void SetOcclusionCulling(bool enabled) { _occlusionCulling = enabled; }
+        [[nodiscard]] bool IsOcclusionCullingEnabled() const { return _occlusionCulling; }
+
+        // From the last Draw
+        [[nodiscard]] const SceneCullingStats& GetCullingStats() const { return _cullingStats; }
+
     private:
 
-        void Draw();
+        // The input time is when the game polled the input this frame reacts to, for latency stats
+        void Draw(std::chrono::steady_clock::time_point inputTime);
+
+        // False if there's nothing to draw this frame
+        bool buildFramePacket(FramePacket& packet, std::chrono::steady_clock::time_point inputTime);
+        void cullOccluded(const glm::mat4& viewProjection, std::vector<RenderableObject>& objects);
+        void requestTextureMips(const TextureStreamingView& view, const std::vector<RenderableObject>& objects,
+                                std::vector<TextureMipRequest>& requests);
 
         entt::registry _registry{};
         std::vector<std::unique_ptr<Entity>> _entities;
+
+        bool _occlusionCulling { false };
+        OcclusionBuffer _occlusionBuffer {};
+        SceneCullingStats _cullingStats {};
     };
 }
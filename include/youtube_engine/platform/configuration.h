@@ -28,6 +28,18 @@ namespace OZZ {
 
         bool VR { false };
         RendererAPI Renderer {RendererAPI::Vulkan };
+        uint32_t TextureBudgetMB { 0 };
+        bool DepthPrepass { false };
+        bool OcclusionCulling { false };
+        bool GpuDriven { false };
+        bool BindlessTextures { false };
+        bool ThreadedRendering { false };
+        uint32_t FramesInFlight { 2 };
+        PresentMode Present { PresentMode::Fifo };
+
+        // Runs the game's scene for this many frames with a fixed timestep, then quits and writes the aggregated frame
+        // stats to benchmark.json in the user data directory. 0 plays normally.
+        uint32_t BenchmarkFrames { 0 };
 
         nlohmann::json ToJson() override {
             nlohmann::json json;
@@ -37,6 +49,15 @@ namespace OZZ {
             json["resY"] = ResY;
             json["vr"] = VR;
             json["rendererAPI"] = static_cast<int>(Renderer);
+            json["textureBudgetMB"] = TextureBudgetMB;
+            json["depthPrepass"] = DepthPrepass;
+            json["occlusionCulling"] = OcclusionCulling;
+            json["gpuDriven"] = GpuDriven;
+            json["bindlessTextures"] = BindlessTextures;
+            json["threadedRendering"] = ThreadedRendering;
+            json["framesInFlight"] = FramesInFlight;
+            json["presentMode"] = static_cast<int>(Present);
+            json["benchmarkFrames"] = BenchmarkFrames;
             return json;
         }
 
@@ -47,6 +68,15 @@ namespace OZZ {
             ResY = inJson["resY"];
             VR = inJson["vr"];
             Renderer = inJson["rendererAPI"];
+            TextureBudgetMB = inJson.value("textureBudgetMB", TextureBudgetMB);
+            DepthPrepass = inJson.value("depthPrepass", DepthPrepass);
+            OcclusionCulling = inJson.value("occlusionCulling", OcclusionCulling);
+            GpuDriven = inJson.value("gpuDriven", GpuDriven);
+            BindlessTextures = inJson.value("bindlessTextures", BindlessTextures);
+            ThreadedRendering = inJson.value("threadedRendering", ThreadedRendering);
+            FramesInFlight = inJson.value("framesInFlight", FramesInFlight);
+            Present = static_cast<PresentMode>(inJson.value("presentMode", static_cast<int>(Present)));
+            BenchmarkFrames = inJson.value("benchmarkFrames", BenchmarkFrames);
         }
     };
 
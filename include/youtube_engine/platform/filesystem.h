@@ -63,7 +63,7 @@ namespace OZZ {
 
             const char *homedir = pw->pw_dir;
 
-            homeDir = {homeDir};
+            homeDir = {homedir};
 #endif
             return homeDir / GameTitle;
         }
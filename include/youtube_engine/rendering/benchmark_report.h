@@ -0,0 +1,33 @@
+#pragma once
+#include <youtube_engine/platform/filesystem.h>
+#include <youtube_engine/rendering/renderer.h>
+
+#include <nlohmann/json.hpp>
+#include <vector>
+
+namespace OZZ {
+    /*
+     * Collects the frame stats of a benchmark run and sums them up as averages, maxima and frame time percentiles. Each
+     * renderer frame counts once, however many times the game sampled it.
+     */
+    class BenchmarkReport {
+    public:
+        // frameMs is the game loop's time for the frame the stats were sampled in
+        void AddFrame(const FrameStats& stats, float frameMs);
+
+        [[nodiscard]] size_t GetFrameCount() const { return _frames.size(); }
+
+        [[nodiscard]] nlohmann::json ToJson() const;
+        bool Write(const Path& path) const;
+
+    private:
+        struct Sample {
+            FrameStats Stats;
+            float FrameMs;
+        };
+
+        std::vector<Sample> _frames {};
+        bool _hasFrames { false };
+        uint64_t _lastFrameNumber { 0 };
+    };
+}
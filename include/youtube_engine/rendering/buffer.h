@@ -18,6 +18,9 @@ namespace OZZ {
         virtual void Bind(void*) = 0;
         virtual void UploadData(const std::vector<Vertex>&) = 0;
 
+        // Tightly packed positions only, for passes that don't need the rest of the vertex
+        virtual void UploadPositions(const std::vector<glm::vec3>&) = 0;
+
         virtual uint64_t GetCount() = 0;
     };
 
@@ -0,0 +1,43 @@
+#pragma once
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace OZZ {
+    struct GpuProfilingSettings {
+        bool Enabled { false };
+
+        // Adds a scope around every run of draws sharing a material. Costs two timestamps per run.
+        bool MaterialScopes { false };
+
+        // Vertex, primitive and fragment counts for each pass, where the device supports it
+        bool PipelineStatistics { false };
+    };
+
+    struct GpuPipelineStatistics {
+        uint64_t InputAssemblyVertices { 0 };
+        uint64_t InputAssemblyPrimitives { 0 };
+        uint64_t VertexShaderInvocations { 0 };
+        uint64_t ClippingInvocations { 0 };
+        uint64_t ClippingPrimitives { 0 };
+        uint64_t FragmentShaderInvocations { 0 };
+    };
+
+    struct GpuScopeTiming {
+        std::string Name;
+
+        // 0 for passes, nested scopes count up from there
+        uint32_t Depth { 0 };
+        double Milliseconds { 0.0 };
+
+        std::optional<GpuPipelineStatistics> Statistics {};
+    };
+
+    struct GpuFrameTimings {
+        uint64_t FrameNumber { 0 };
+
+        // In the order the scopes were opened
+        std::vector<GpuScopeTiming> Scopes {};
+    };
+}
@@ -11,11 +11,24 @@
 #include <glm/glm.hpp>
 
 namespace OZZ {
+    struct ImageMipLevel {
+        uint32_t Width { 0 };
+        uint32_t Height { 0 };
+        uint32_t Offset { 0 };  // into GetData()
+        uint32_t Size { 0 };
+    };
+
     class ImageData {
     public:
+        // KTX2 files are uploaded as-is, with their own mips and (block compressed) format. Flipping doesn't apply to
+        // them; they're expected to have been cooked in the orientation the engine wants.
         explicit ImageData(const Path& filePath, bool flipVertical = false);
         ImageData(char* fileData, uint32_t fileLength, bool flipVertical = false);
         explicit ImageData(uint32_t width, uint32_t height, glm::vec4 color);
+        ImageData(uint32_t width, uint32_t height, ColorType colorType, std::vector<unsigned char>&& data, std::vector<ImageMipLevel>&& mipLevels);
+
+        ImageData(const ImageData&) = default;
+        ImageData(ImageData&&) = default;
 
         ~ImageData();
 
@@ -26,8 +39,16 @@ namespace OZZ {
         [[nodiscard]] uint32_t GetDataSize() const;
         [[nodiscard]] const unsigned char* GetData() const;
 
+        // Always has at least the base level once the image is valid
+        [[nodiscard]] inline const std::vector<ImageMipLevel>& GetMipLevels() const { return _mipLevels; }
+        [[nodiscard]] inline bool IsCompressed() const { return IsBlockCompressed(_colorType); }
+
+        [[nodiscard]] static bool IsKTX2(const unsigned char* fileData, size_t fileLength);
+
     private:
         void updateColorType();
+        void setSingleMipLevel();
+        bool loadKTX2(const unsigned char* fileData, size_t fileLength);
     private:
         bool _valid { false };
 
@@ -37,5 +58,6 @@ namespace OZZ {
 
         ColorType _colorType { ColorType::UNSIGNED_CHAR4 };
         std::vector<unsigned char> _data;
+        std::vector<ImageMipLevel> _mipLevels {};
     };
 }
\ No newline at end of file
@@ -0,0 +1,85 @@
+#pragma once
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+namespace OZZ {
+    class JobSystem;
+
+    /*
+     * Low resolution software depth buffer for occlusion culling on the CPU, in the style of masked occlusion culling.
+     * Instead of per pixel depth every 8x4 pixel tile keeps a coverage mask and two conservative depths:
+     *
+     *  - a reference depth that every pixel in the tile is known to be in front of
+     *  - a working depth for the pixels in the mask, folded into the reference once the mask fills the tile
+     *
+     * Depth follows the renderer: smaller is nearer. Occluders only ever pull the reference depth closer, so a query
+     * can wrongly say "visible" but never wrongly say "occluded".
+     *
+     * Rasterization is split into bands of tile rows that run in parallel; each tile is only ever touched by one band,
+     * in occluder order, so the result is the same regardless of how many threads take part.
+     */
+    class OcclusionBuffer {
+    public:
+        static constexpr uint32_t TILE_WIDTH = 8;
+        static constexpr uint32_t TILE_HEIGHT = 4;
+
+        // Rounded up to whole tiles
+        explicit OcclusionBuffer(uint32_t width = 256, uint32_t height = 128);
+
+        // Clears the depth and drops any queued occluders
+        void Begin(const glm::mat4& viewProjection);
+
+        // Queues an indexed triangle list in model space. Winding doesn't matter.
+        void AddOccluder(const std::vector<glm::vec3>& vertices, const std::vector<uint32_t>& indices, const glm::mat4& model);
+
+        // Draws every queued occluder. With a job system the bands run on its workers.
+        void Rasterize(JobSystem* jobSystem = nullptr);
+
+        // True if a world space box is behind the occluders. Safe to call from many threads once rasterized.
+        [[nodiscard]] bool IsOccluded(const glm::vec3& boundsMin, const glm::vec3& boundsMax) const;
+
+        [[nodiscard]] uint32_t GetWidth() const { return _width; }
+        [[nodiscard]] uint32_t GetHeight() const { return _height; }
+        [[nodiscard]] uint32_t GetTriangleCount() const { return static_cast<uint32_t>(_triangles.size()); }
+
+        // The reference depth of a tile, mostly for debugging
+        [[nodiscard]] float GetTileDepth(uint32_t tileX, uint32_t tileY) const;
+
+    private:
+        struct Tile {
+            float ReferenceDepth { 1.f };
+            float WorkingDepth { 0.f };
+            uint32_t Mask { 0 };
+        };
+
+        // Edge functions are positive inside. Depth is a plane over screen space.
+        struct Triangle {
+            glm::vec3 Edges[3];
+            glm::vec3 DepthPlane;
+            float MinDepth;
+            float MaxDepth;
+
+            uint32_t MinTileX, MaxTileX;
+            uint32_t MinTileY, MaxTileY;
+        };
+
+        void addTriangle(const glm::vec4& a, const glm::vec4& b, const glm::vec4& c);
+        void addScreenTriangle(const glm::vec3& a, const glm::vec3& b, const glm::vec3& c);
+        void rasterizeRows(uint32_t beginRow, uint32_t endRow);
+
+        static void updateTile(Tile& tile, uint32_t coverage, float depth);
+
+    private:
+        uint32_t _width;
+        uint32_t _height;
+        uint32_t _tilesX;
+        uint32_t _tilesY;
+
+        glm::mat4 _viewProjection { 1.f };
+
+        std::vector<Tile> _tiles {};
+        std::vector<Triangle> _triangles {};
+    };
+}
@@ -0,0 +1,59 @@
+#pragma once
+#include <youtube_engine/rendering/renderables.h>
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace OZZ {
+    class Renderer;
+
+    /*
+     * Draws frame packets on a thread of its own so the game can simulate the next frame while the renderer records
+     * and submits this one, and a wait on the GPU no longer stalls gameplay.
+     *
+     * Packets sit in a small ring. The game blocks in Submit only once it's a whole ring ahead of the render thread,
+     * which bounds the added latency to the ring size.
+     *
+     * Buffer and texture uploads and shader loads stay safe from the game thread; the renderer serialises them with
+     * its own work. Anything else that reaches into the renderer (reset, shutdown) or changes what a queued packet
+     * draws with (Submesh::SetTexture, Submesh::SetMaterial) has to Flush first.
+     */
+    class RenderThread {
+    public:
+        // 2 for double buffered packets, 3 for triple
+        explicit RenderThread(uint32_t packetCount = 2);
+        ~RenderThread();
+
+        void Start(Renderer* renderer);
+
+        // Draws whatever is still queued, then joins the thread
+        void Stop();
+
+        [[nodiscard]] bool IsRunning() const { return _thread.joinable(); }
+
+        void Submit(FramePacket packet);
+
+        // Blocks until every submitted packet has been drawn
+        void Flush();
+
+    private:
+        void renderLoop();
+
+    private:
+        Renderer* _renderer { nullptr };
+        std::thread _thread {};
+
+        std::vector<FramePacket> _packets;
+
+        // Packets handed over and packets drawn, ever. The next slot is the count modulo the ring size.
+        uint64_t _submitted { 0 };
+        uint64_t _rendered { 0 };
+
+        std::mutex _mutex;
+        std::condition_variable _packetReady;
+        std::condition_variable _packetDone;
+        bool _running { false };
+    };
+}
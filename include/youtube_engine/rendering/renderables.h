@@ -3,7 +3,12 @@
 //
 
 #pragma once
+#include <chrono>
 #include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
 
 #include <youtube_engine/resources/types/mesh.h>
 #include <youtube_engine/resources/types/material.h>
@@ -15,6 +20,13 @@ namespace OZZ {
         std::weak_ptr<Mesh> Mesh;
         std::weak_ptr<UniformBuffer> ModelBuffer;
         glm::mat4 Transform;
+
+        // Consecutive objects with the same scope are timed together by the GPU profiler
+        std::string_view ProfileScope {};
+
+        // Expected to keep its mesh, materials and transform from one frame to the next, so its draws can be replayed
+        // from an earlier recording. Changes are still picked up, they just cost a fresh recording.
+        bool Static { false };
     };
 
     struct ModelObject {
@@ -26,9 +38,34 @@ namespace OZZ {
         glm::mat4 Projection;
     };
 
+    // The finest mip a streamed texture needs for this frame's view, 0 being full size
+    struct TextureMipRequest {
+        std::weak_ptr<OZZ::Texture> Texture;
+        uint32_t Mip { 0 };
+    };
+
     struct SceneParams {
         CameraObject Camera;
         glm::vec3 EyePosition;
         glm::quat EyeRotation;
+
+        // When the game sampled the input this frame reacts to. Left empty, nothing is measured.
+        std::chrono::steady_clock::time_point InputTime {};
+
+        // One per streamed texture the frame draws with
+        std::vector<TextureMipRequest> TextureMipRequests {};
+    };
+
+    /*
+     * Everything one frame draws, captured on the game thread. The packet itself doesn't change once it's handed to the
+     * renderer, so it can be drawn on another thread while the game moves on. The meshes it points at are still shared
+     * with the game though: swapping a submesh's textures or material has to wait for a RenderThread::Flush.
+     */
+    struct FramePacket {
+        SceneParams Params {};
+        std::vector<RenderableObject> Objects {};
+
+        // The objects' profile scopes point in here rather than at components the game might remove meanwhile
+        std::unordered_set<std::string> ProfileScopes {};
     };
 }
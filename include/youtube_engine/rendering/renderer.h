@@ -7,6 +7,7 @@
 #include <youtube_engine/rendering/shader.h>
 #include <youtube_engine/rendering/buffer.h>
 #include <youtube_engine/rendering/texture.h>
+#include <youtube_engine/rendering/gpu_profiling.h>
 #include <youtube_engine/rendering/renderables.h>
 
 #include <string>
@@ -17,9 +18,106 @@ namespace OZZ {
         Vulkan,
     };
 
+    enum class PresentMode {
+        // Waits for vblank and never tears. Always available, so the others fall back to it.
+        Fifo,
+        // Waits for vblank but replaces a queued image instead of blocking, for lower latency without tearing
+        Mailbox,
+        // Presents straight away. Lowest latency, but tears.
+        Immediate
+    };
+
+    // Why the renderer is being reset, so only what that invalidated gets rebuilt. Ordered from least to most work.
+    // Window resizes aren't resets, the renderer picks those up itself.
+    enum class RendererResetCause {
+        // The swapchain is rebuilt with the current RendererSettings::Present
+        PresentModeChange,
+        // The depth pre-pass, occlusion culling, GPU driven rendering, bindless textures or frames in flight changed. The
+        // render pass, pipelines and per-frame resources are rebuilt; meshes, textures and shaders stay on the device.
+        SettingsChange,
+        // VR brings its own instance and device, so everything on the device is rebuilt
+        VRToggle,
+        // Everything on the device is rebuilt and resources are uploaded again from their CPU copies
+        DeviceLost
+    };
+
     struct RendererSettings {
         std::string ApplicationName;
         bool VR { false };
+
+        // VRAM for streamed textures. 0 turns streaming off and keeps every texture fully resident.
+        uint32_t TextureBudgetMB { 0 };
+
+        // Lay down depth for all opaque geometry first so the material pass only shades visible fragments. Window only.
+        bool DepthPrepass { false };
+
+        // Test draws against a depth pyramid built from the previous frame on the GPU. Window only.
+        bool OcclusionCulling { false };
+
+        // Upload every transform once and draw instanced batches from indirect commands that a compute pass culls and
+        // compacts. Only materials with an instanced vertex shader take part. Window only.
+        bool GpuDrivenRendering { false };
+
+        // Keep every loaded texture in one descriptor array and have draws index into it instead of binding their own.
+        // Only materials with bindless shader variants take part. Needs descriptor indexing. Window only.
+        bool BindlessTextures { false };
+
+        // Frames the CPU may record ahead of the GPU, 1 to 3. Fewer cuts latency, more keeps the GPU fed. Window only.
+        uint32_t FramesInFlight { 2 };
+        PresentMode Present { PresentMode::Fifo };
+
+        bool operator==(const RendererSettings& other) const = default;
+    };
+
+    /*
+     * Counters for one frame, covering everything from the end of the previous RenderFrame to the end of this one. That
+     * way uploads made during the game's update land in the frame that first draws them.
+     */
+    struct FrameStats {
+        uint64_t FrameNumber { 0 };
+
+        uint32_t DrawCalls { 0 };
+        uint64_t Triangles { 0 };
+        uint32_t PipelineBinds { 0 };
+
+        // Binds, dynamic state and push constants dropped for matching what the command buffer already had
+        uint32_t CommandsElided { 0 };
+        uint32_t DescriptorSetsAllocated { 0 };
+        uint32_t DescriptorWrites { 0 };
+
+        // Static draws replayed from an earlier recording instead of recorded again, and how many times that recording
+        // had to be redone because something it drew with changed
+        uint32_t StaticDrawsReused { 0 };
+        uint32_t StaticRecordings { 0 };
+
+        // Per frame descriptor pools held by the renderer, how many sets each is made with, and the most sets any one
+        // frame has needed. Pools grow towards the high-water mark.
+        uint32_t DescriptorPools { 0 };
+        uint32_t DescriptorSetsPerPool { 0 };
+        uint32_t DescriptorSetsHighWater { 0 };
+
+        uint64_t BufferUploadBytes { 0 };
+        uint64_t TextureUploadBytes { 0 };
+
+        uint32_t QueueSubmits { 0 };
+
+        // Any time the CPU blocked on the GPU: frame waits and immediate uploads waiting to finish
+        uint32_t FenceWaits { 0 };
+        uint32_t SwapchainRecreations { 0 };
+
+        // Occlusion culling results are read back once the GPU is done with them, so they describe a frame from
+        // frames in flight ago
+        uint32_t OcclusionCandidates { 0 };
+        uint32_t OcclusionCulled { 0 };
+
+        // From the game sampling input to the GPU finishing the frame drawn with it, so the image is ready to present.
+        // Completion is only checked once a frame, so it can overshoot by up to a frame, and the wait for vblank after it
+        // isn't included. Describes a frame from frames in flight ago, and stays 0 for VR.
+        float InputToPresentMs { 0.f };
+
+        [[nodiscard]] float GetOcclusionCulledPercent() const {
+            return OcclusionCandidates > 0 ? 100.f * static_cast<float>(OcclusionCulled) / static_cast<float>(OcclusionCandidates) : 0.f;
+        }
     };
 
     class Renderer {
@@ -41,8 +139,25 @@ namespace OZZ {
         virtual std::shared_ptr<UniformBuffer> CreateUniformBuffer() = 0;
         virtual std::shared_ptr<Texture> CreateTexture() = 0;
 
+        // The last completed frame. A copy, since frames may complete on another thread.
+        [[nodiscard]] virtual FrameStats GetFrameStats() const = 0;
+
+        virtual void SetGpuProfilingSettings(const GpuProfilingSettings& settings) = 0;
+
+        // Timings of the most recent frame the GPU has finished, so they lag a frame or two behind
+        [[nodiscard]] virtual GpuFrameTimings GetGpuFrameTimings() const = 0;
+
+        // Scenes only work out which mips their textures need when something will act on it
+        [[nodiscard]] virtual bool IsTextureStreamingEnabled() const = 0;
+
+        // The settings of the last reset. Change a copy and hand it to Game::ApplyRendererSettings.
+        [[nodiscard]] virtual const RendererSettings& GetSettings() const = 0;
+
     private:
-        virtual void Reset() = 0;
-        virtual void Reset(RendererSettings) = 0;
+        virtual void Reset(RendererResetCause cause) = 0;
+
+        // Works out the cause from what changed and resets with that, or with the given cause if it does more. The
+        // application name and texture budget live on the device, so changing those is treated as a lost device.
+        virtual void Reset(RendererSettings settings, RendererResetCause cause) = 0;
     };
 }
\ No newline at end of file
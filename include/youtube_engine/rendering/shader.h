@@ -69,12 +69,13 @@ namespace OZZ {
     class Shader {
         friend struct Material;
     public:
-        virtual void Bind(void*) = 0;
+        // Pipelines are bound by the renderer while it records, so shaders only load and describe them
         virtual void Load(const std::string&& vertexShader, const std::string&& fragmentShader) = 0;
 
         virtual ~Shader() = default;
 
-        const ShaderData& GetShaderData() { return _data; }
+        // Backends that reflect asynchronously may only fill this in later
+        virtual const ShaderData& GetShaderData() { return _data; }
 
     private:
         virtual void FreeResources() = 0;
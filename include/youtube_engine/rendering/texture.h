@@ -4,18 +4,63 @@
 
 #pragma once
 #include <youtube_engine/rendering/images.h>
+#include <memory>
 #include <tuple>
 namespace OZZ {
+    enum class TextureFilter {
+        Nearest,
+        Linear
+    };
+
+    enum class TextureAddressMode {
+        Repeat,
+        MirroredRepeat,
+        ClampToEdge,
+        ClampToBorder
+    };
+
+    struct SamplerSettings {
+        TextureFilter MagFilter { TextureFilter::Linear };
+        TextureFilter MinFilter { TextureFilter::Linear };
+        TextureFilter MipmapFilter { TextureFilter::Linear };
+        TextureAddressMode AddressMode { TextureAddressMode::Repeat };
+
+        // 1 disables anisotropic filtering. Clamped to what the device supports.
+        float MaxAnisotropy { 16.f };
+
+        // Positive values pick smaller mips (blurrier, cheaper), negative values sharper ones
+        float MipLodBias { 0.f };
+
+        bool operator==(const SamplerSettings& other) const = default;
+    };
+
     class Texture {
     public:
         virtual ~Texture() = default;
 
+        void SetSamplerSettings(const SamplerSettings& settings) {
+            _samplerSettings = settings;
+            BindSamplerSettings();
+        }
+
+        [[nodiscard]] const SamplerSettings& GetSamplerSettings() const { return _samplerSettings; }
+
+        // Applies the current sampler settings to the backend's sampler
         virtual void BindSamplerSettings() = 0;
 
         virtual void UploadData(const ImageData &data) = 0;
 
+        // For callers that keep the data around anyway, so a backend that needs it later can share it instead of copying
+        virtual void UploadData(const std::shared_ptr<const ImageData>& data) { UploadData(*data); }
+
+        // Streamed textures only keep some of their mips on the GPU and load the rest as the scene asks for them
+        [[nodiscard]] virtual bool IsStreamed() const { return false; }
+
         [[nodiscard]] virtual std::pair<uint32_t, uint32_t> GetSize() const = 0;
 
         [[nodiscard]] virtual int *GetHandle() const = 0;
+
+    protected:
+        SamplerSettings _samplerSettings {};
     };
 }
@@ -0,0 +1,35 @@
+#pragma once
+#include <youtube_engine/rendering/images.h>
+#include <youtube_engine/rendering/types.h>
+
+#include <vector>
+
+namespace OZZ {
+    struct TextureCookSettings {
+        // BC1 for opaque color, BC3 for color with alpha, BC5 for normal maps. BC7 has no CPU encoder yet.
+        ColorType Format { ColorType::BC1_SRGB };
+        bool GenerateMipmaps { true };
+
+        // Matches what Image does when loading source files at runtime
+        bool FlipVertical { true };
+    };
+
+    /*
+     * Offline conversion of source images (anything stb_image reads: PNG, JPEG, ...) into block compressed KTX2 files
+     * with a full mip chain, ready to be uploaded without any work at load time.
+     */
+    class TextureCooker {
+    public:
+        static bool Cook(const Path& source, const Path& destination, const TextureCookSettings& settings = {});
+
+        // Builds the mip chain and encodes every level. Returns an invalid ImageData if the format can't be encoded.
+        static ImageData Encode(const ImageData& source, const TextureCookSettings& settings);
+
+        static bool WriteKTX2(const ImageData& image, const Path& destination);
+
+        // Encodes tightly packed RGBA8 texels into 4x4 blocks of the given format
+        static std::vector<unsigned char> EncodeBlocks(const unsigned char* rgba, uint32_t width, uint32_t height, ColorType format);
+
+        [[nodiscard]] static bool CanEncode(ColorType format);
+    };
+}
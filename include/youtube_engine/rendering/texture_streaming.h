@@ -0,0 +1,22 @@
+#pragma once
+#include <youtube_engine/resources/types/mesh.h>
+
+#include <glm/glm.hpp>
+#include <cstdint>
+
+namespace OZZ {
+    // What texture streaming needs to know about the camera to turn object bounds into on-screen texel density
+    struct TextureStreamingView {
+        glm::vec3 CameraPosition { 0.f };
+
+        // Pixels covered by one world unit at a distance of one unit
+        float ProjectionScale { 1.f };
+
+        [[nodiscard]] static TextureStreamingView FromCamera(const glm::mat4& view, const glm::mat4& projection, float viewportHeight);
+    };
+
+    // The mip a texture this many texels across needs to cover the bounds on screen, 0 being full size. Not clamped to
+    // the levels the texture actually has.
+    [[nodiscard]] uint32_t ComputeDesiredMip(uint32_t textureSize, const SubmeshBounds& bounds, const glm::mat4& transform,
+                                             const TextureStreamingView& view);
+}
@@ -4,6 +4,7 @@
 
 #pragma once
 
+#include <cstdint>
 #include <glm/glm.hpp>
 
 namespace OZZ {
@@ -18,12 +19,57 @@ namespace OZZ {
         FLOAT,
         UNSIGNED_CHAR3,
         UNSIGNED_CHAR4,
+
+        // Block compressed, 4x4 texel blocks
+        BC1_UNORM,
+        BC1_SRGB,
+        BC3_UNORM,
+        BC3_SRGB,
+        BC5_UNORM,
+        BC7_UNORM,
+        BC7_SRGB,
     };
 
+    inline bool IsBlockCompressed(ColorType colorType) {
+        switch (colorType) {
+            case ColorType::BC1_UNORM:
+            case ColorType::BC1_SRGB:
+            case ColorType::BC3_UNORM:
+            case ColorType::BC3_SRGB:
+            case ColorType::BC5_UNORM:
+            case ColorType::BC7_UNORM:
+            case ColorType::BC7_SRGB:
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    // Bytes per 4x4 block for compressed types, bytes per texel otherwise
+    inline uint32_t GetColorTypeBlockSize(ColorType colorType) {
+        switch (colorType) {
+            case ColorType::FLOAT:
+                return 12;
+            case ColorType::UNSIGNED_CHAR3:
+                return 3;
+            case ColorType::UNSIGNED_CHAR4:
+                return 4;
+            case ColorType::BC1_UNORM:
+            case ColorType::BC1_SRGB:
+                return 8;
+            default:
+                return 16;
+        }
+    }
+
     enum class ResourceName {
         Unknown,
         CameraData,
         ModelData,
+        ObjectData,
+        VisibleInstances,
+        BindlessTextures,
+        MaterialData,
         Diffuse0,
         Diffuse1,
         EndTextures
@@ -33,6 +79,7 @@ namespace OZZ {
         Unknown,
         PushConstant,
         Uniform,
+        StorageBuffer,
         Sampler
     };
 
@@ -76,6 +123,22 @@ namespace OZZ {
             return ResourceName::ModelData;
         }
 
+        if (str == "ObjectData") {
+            return ResourceName::ObjectData;
+        }
+
+        if (str == "VisibleInstances") {
+            return ResourceName::VisibleInstances;
+        }
+
+        if (str == "BindlessTextures") {
+            return ResourceName::BindlessTextures;
+        }
+
+        if (str == "MaterialData") {
+            return ResourceName::MaterialData;
+        }
+
         if (str == "Diffuse0") {
             return ResourceName::Diffuse0;
         }
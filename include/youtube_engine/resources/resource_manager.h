@@ -39,6 +39,9 @@ namespace OZZ {
 
         void ClearGPUResourcesForReset();
         void RecreateGPUResourcesAfterReset();
+
+        // Shaders build pipelines against the render pass, the renderer calls this after replacing it
+        void ReloadShaders();
         std::unordered_map<Resource::GUID, std::weak_ptr<Resource>> _resources;
     };
 }
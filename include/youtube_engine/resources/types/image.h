@@ -27,7 +27,10 @@ namespace OZZ {
     private:
         Path _path;
         std::shared_ptr<Texture> _texture { nullptr };
-        std::unique_ptr<ImageData> _image { nullptr };
+
+        // Images made from data keep it to upload again after a reset. Images loaded from disk only keep it while their
+        // texture streams, shared with the texture rather than both holding a copy.
+        std::shared_ptr<const ImageData> _image { nullptr };
     };
 
 }
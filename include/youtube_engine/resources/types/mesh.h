@@ -20,27 +20,46 @@ struct aiNode;
 struct aiMesh;
 
 namespace OZZ {
+    struct SubmeshBounds {
+        glm::vec3 Min { 0.f };
+        glm::vec3 Max { 0.f };
+
+        // Average world space size of one unit of UV space, used to estimate on-screen texel density
+        float WorldUnitsPerUV { 1.f };
+    };
+
     struct Submesh {
         friend struct Mesh;
         Submesh(std::vector<Vertex>&& vertices, std::vector<uint32_t>&& indices);
         ~Submesh();
 
+        // The render thread reads these while it draws, so with one running call them only after a RenderThread::Flush
         std::weak_ptr<Image> SetTexture(ResourceName textureSlot, std::shared_ptr<Image>&& image);
-        std::weak_ptr<Image> GetTexture(ResourceName textureSlot);
-
         std::weak_ptr<Material> SetMaterial(std::shared_ptr<Material>&& material);
+
+        // Empty if nothing is in the slot. Never adds to the map, so any number of threads can read at once.
+        [[nodiscard]] std::weak_ptr<Image> GetTexture(ResourceName textureSlot) const;
         [[nodiscard]] std::weak_ptr<Material> GetMaterial() const;
 
+        [[nodiscard]] const SubmeshBounds& GetBounds() const { return _bounds; }
+
+        // Positions only, a quarter of the vertex size. Used by the depth pre-pass, which makes it the first time it
+        // draws the submesh so renderers without one never pay for it. Only call it from the thread doing the drawing.
+        const std::shared_ptr<VertexBuffer>& GetPositionBuffer();
+
         std::shared_ptr<IndexBuffer> _indexBuffer { nullptr };
         std::shared_ptr<VertexBuffer> _vertexBuffer { nullptr };
     private:
         void createResources();
         void freeResources();
+        void computeBounds();
     private:
         std::vector<uint32_t> _indices;
         std::vector<Vertex> _vertices;
         std::unordered_map<ResourceName, std::shared_ptr<Image>> _textures;
         std::shared_ptr<Material> _material { nullptr };
+        SubmeshBounds _bounds {};
+        std::shared_ptr<VertexBuffer> _positionBuffer { nullptr };
     };
 
     struct Mesh : public Resource {
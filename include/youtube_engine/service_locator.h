@@ -7,6 +7,7 @@
 #include <youtube_engine/resources/resource_manager.h>
 #include <youtube_engine/platform/configuration.h>
 #include <youtube_engine/vr/vr_subsystem.h>
+#include <youtube_engine/core/job_system.h>
 
 namespace OZZ {
     class ServiceLocator {
@@ -17,6 +18,7 @@ namespace OZZ {
         static inline ResourceManager* GetResourceManager() { return _resourceManager.get(); }
         static inline Configuration* GetConfiguration() { return _configuration.get(); }
         static inline VirtualRealitySubsystem* GetVRSubsystem() { return _vrSubsystem.get(); }
+        static inline JobSystem* GetJobSystem() { return _jobSystem.get(); }
 
         static inline void Provide(Window *window) {
             if (_window != nullptr) return;
@@ -34,7 +36,8 @@ namespace OZZ {
             if (_renderer != nullptr) return;
 
             _renderer = std::unique_ptr<Renderer>(renderer);
-            _renderer->Reset(std::move(settings));
+            // Nothing is up yet, so this brings up the whole device
+            _renderer->Reset(std::move(settings), RendererResetCause::DeviceLost);
         }
 
         static inline void Provide(InputManager* inputManager) {
@@ -47,6 +50,11 @@ namespace OZZ {
             _resourceManager = std::unique_ptr<ResourceManager>(resourceManager);
         }
 
+        static inline void Provide(JobSystem* jobSystem) {
+            if (_jobSystem != nullptr) return;
+            _jobSystem = std::unique_ptr<JobSystem>(jobSystem);
+        }
+
         static inline void Provide(Configuration* configurationManager) {
             if (_configuration != nullptr) return;
 
@@ -61,6 +69,7 @@ namespace OZZ {
             shutdownInputManager();
             shutdownVRSubsystem();
             shutdownRenderer();
+            shutdownJobSystem();
             shutdownWindow();
             shutdownConfiguration();
         }
@@ -73,6 +82,7 @@ namespace OZZ {
         static inline std::unique_ptr<ResourceManager> _resourceManager = nullptr;
         static inline std::unique_ptr<VirtualRealitySubsystem> _vrSubsystem = nullptr;
         static inline std::unique_ptr<Configuration> _configuration = nullptr;
+        static inline std::unique_ptr<JobSystem> _jobSystem = nullptr;
 
         static inline void shutdownWindow() {
             _window.reset();
@@ -108,6 +118,11 @@ namespace OZZ {
             _resourceManager.reset();
         }
 
+        static inline void shutdownJobSystem() {
+            if (!_jobSystem) return;
+            _jobSystem.reset();
+        }
+
         static inline void shutdownConfiguration() {
             if (!_configuration) return;
             _configuration.reset();
@@ -17,6 +17,9 @@ layout(set = 0, binding = 0) uniform CameraData {
     mat4 proj;
 } camera;
 
+// See depth_prepass.vert
+invariant gl_Position;
+
 void main() {
     gl_Position = camera.proj * camera.view * mod.model * vec4(vPosition, 1.0f);
 
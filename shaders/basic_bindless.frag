@@ -0,0 +1,30 @@
+#version 450
+#extension GL_EXT_nonuniform_qualifier : require
+
+layout (location = 0) in vec4 inColour;
+layout (location = 1) in vec2 texCoord;
+layout (location = 2) flat in uint materialIndex;
+
+layout (location = 0) out vec4 outFragColour;
+
+layout (set = 1, binding = 0) uniform sampler2D BindlessTextures[];
+
+// Indices into BindlessTextures, one per Diffuse slot
+layout (std430, set = 1, binding = 1) readonly buffer MaterialData {
+    uvec4 textures[];
+} materials;
+
+const uint INVALID_TEXTURE = 0xFFFFFFFFu;
+
+void main() {
+    uint diffuse0 = materials.textures[materialIndex].x;
+
+    // Not uploaded yet, same placeholder the descriptor path uses
+    if (diffuse0 == INVALID_TEXTURE) {
+        outFragColour = vec4(1.0, 0.0, 1.0, 1.0);
+        return;
+    }
+
+    vec3 color = texture(BindlessTextures[nonuniformEXT(diffuse0)], texCoord).xyz;
+    outFragColour = vec4(color, 1.0);
+}
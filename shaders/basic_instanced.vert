@@ -0,0 +1,41 @@
+#version 450
+
+// basic.vert for GPU driven batches. Transforms come from the object buffer, picked through the list of instances that
+// survived culling; firstInstance points each batch at its own stretch of that list.
+
+layout (location = 0) in vec3 vPosition;
+layout (location = 1) in vec4 vColour;
+layout (location = 2) in vec2 vTexCoord;
+layout (location = 3) in vec3 vNormal;
+
+layout (location = 0) out vec4 outColour;
+layout (location = 1) out vec2 texCoord;
+
+layout(set = 0, binding = 0) uniform CameraData {
+    mat4 view;
+    mat4 proj;
+} camera;
+
+struct ObjectInstance {
+    mat4 model;
+    uint batch;
+    uint pad0;
+    uint pad1;
+    uint pad2;
+};
+
+layout (std430, set = 2, binding = 0) readonly buffer ObjectData {
+    ObjectInstance objects[];
+};
+
+layout (std430, set = 2, binding = 1) readonly buffer VisibleInstances {
+    uint visible[];
+};
+
+void main() {
+    mat4 model = objects[visible[gl_InstanceIndex]].model;
+    gl_Position = camera.proj * camera.view * model * vec4(vPosition, 1.0f);
+
+    outColour = vColour;
+    texCoord = vTexCoord;
+}
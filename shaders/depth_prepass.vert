@@ -0,0 +1,20 @@
+#version 450
+
+layout (location = 0) in vec3 vPosition;
+
+layout(push_constant) uniform ModelData {
+    mat4 model;
+} mod;
+
+layout(set = 0, binding = 0) uniform CameraData {
+    mat4 view;
+    mat4 proj;
+} camera;
+
+// The material pass tests against this depth with EQUAL, so every vertex shader drawn after it must declare this too
+// and compute gl_Position exactly as below
+invariant gl_Position;
+
+void main() {
+    gl_Position = camera.proj * camera.view * mod.model * vec4(vPosition, 1.0f);
+}
\ No newline at end of file
@@ -0,0 +1,26 @@
+#version 450
+
+// Drawn in place of a material whose own pipeline is still compiling
+
+layout (location = 0) in vec3 vPosition;
+layout (location = 1) in vec4 vColour;
+
+layout (location = 0) out vec4 outColour;
+
+layout(push_constant) uniform ModelData {
+    mat4 model;
+} mod;
+
+layout(set = 0, binding = 0) uniform CameraData {
+    mat4 view;
+    mat4 proj;
+} camera;
+
+// See depth_prepass.vert
+invariant gl_Position;
+
+void main() {
+    gl_Position = camera.proj * camera.view * mod.model * vec4(vPosition, 1.0f);
+
+    outColour = vColour;
+}
@@ -0,0 +1,22 @@
+#include <youtube_engine/core/components/occluder_component.h>
+
+namespace OZZ {
+    OccluderComponent::OccluderComponent(std::vector<glm::vec3>&& vertices, std::vector<uint32_t>&& indices) :
+        _vertices { std::move(vertices) }, _indices { std::move(indices) } {}
+
+    OccluderComponent::OccluderComponent(const glm::vec3& min, const glm::vec3& max) {
+        for (int i = 0; i < 8; i++) {
+            _vertices.emplace_back((i & 1) ? max.x : min.x, (i & 2) ? max.y : min.y, (i & 4) ? max.z : min.z);
+        }
+
+        // Two triangles per face, winding doesn't matter to the rasterizer
+        _indices = {
+                0, 1, 3, 0, 3, 2,   // -z
+                4, 6, 7, 4, 7, 5,   // +z
+                0, 4, 5, 0, 5, 1,   // -y
+                2, 3, 7, 2, 7, 6,   // +y
+                0, 2, 6, 0, 6, 4,   // -x
+                1, 5, 7, 1, 7, 3    // +x
+        };
+    }
+}
@@ -4,8 +4,10 @@
 //
 
 #include <youtube_engine/core/game.h>
+#include <youtube_engine/core/profiler.h>
 #include <youtube_engine/service_locator.h>
 #include <youtube_engine/platform/filesystem.h>
+#include <youtube_engine/rendering/benchmark_report.h>
 
 #include <platform/multiplatform_window.h>
 #include <platform/sdl_window.h>
@@ -14,13 +16,18 @@
 #include "youtube_engine/vr/vr_subsystem.h"
 #include "vr/openxr/open_xr_subsystem.h"
 
+#include <algorithm>
 
 namespace OZZ {
+    constexpr uint32_t BENCHMARK_WARMUP_FRAMES = 60;
+    constexpr float BENCHMARK_TIMESTEP = 1.f / 60.f;
+
     Game::Game() : Game("New Youtube Engine Game") {}
 
     Game::Game(std::string windowTitle) : _title(std::move(windowTitle)), _running(false) {}
 
     Game::~Game() {
+        _renderThread.reset();
         _currentScene.reset();
         shutdownServices();
     }
@@ -29,6 +36,8 @@ namespace OZZ {
         // Set up configuration
         // Set the home folder path
         Filesystem::GameTitle = _title;
+        OZZ_PROFILE_THREAD("Main Thread");
+
         std::cout << "User app directory: " << Filesystem::GetAppUserDataDirectory() << std::endl;
 
         initializeServices();
@@ -42,8 +51,21 @@ namespace OZZ {
 
         Init();
 
+        // OpenXR paces frames from the game thread, so VR always draws inline
+        if (engineConfiguration.ThreadedRendering && !engineConfiguration.VR) {
+            _renderThread = std::make_unique<RenderThread>();
+            _renderThread->Start(ServiceLocator::GetRenderer());
+        }
+
+        // Benchmarks step the game by a fixed amount so every run draws the same frames
+        uint32_t benchmarkFrames = engineConfiguration.BenchmarkFrames;
+        uint32_t benchmarkFrame { 0 };
+        BenchmarkReport benchmark {};
+
         // run the application
         while (_running) {
+            OZZ_PROFILE_SCOPE("Frame");
+
             // Update the window
             if (ServiceLocator::GetWindow()->Update()) {
                 _running = false;
@@ -62,6 +84,9 @@ namespace OZZ {
                 ServiceLocator::GetInputManager()->processInput();
             }
 
+            // Everything this frame reacts to has been polled by now
+            auto inputTime = std::chrono::steady_clock::now();
+
             // calculate deltaTime
             auto currentFrameTime { std::chrono::high_resolution_clock::now() };
 
@@ -69,25 +94,85 @@ namespace OZZ {
             auto deltaTime = std::chrono::duration<float, std::milli > { durDeltaTime }.count() / 1000.f;
             _lastFrameTime = currentFrameTime;
 
+            if (benchmarkFrames > 0) {
+                if (benchmarkFrame == BENCHMARK_WARMUP_FRAMES + benchmarkFrames) {
+                    _running = false;
+                    continue;
+                }
+
+                // Startup and pipeline compiles would swamp the numbers, so the first frames aren't counted
+                if (benchmarkFrame >= BENCHMARK_WARMUP_FRAMES) {
+                    benchmark.AddFrame(ServiceLocator::GetRenderer()->GetFrameStats(), deltaTime * 1000.f);
+                }
+
+                benchmarkFrame++;
+                deltaTime = BENCHMARK_TIMESTEP;
+            }
+
             // Update game state
-            Update(deltaTime);
+            {
+                OZZ_PROFILE_SCOPE("Game::Update");
+                Update(deltaTime);
+            }
 
             if (!_rendererResetRequested) {
                 // Update physics
-                _currentScene->Draw();
+                if (_renderThread) {
+                    FramePacket packet {};
+                    if (_currentScene->buildFramePacket(packet, inputTime)) {
+                        _renderThread->Submit(std::move(packet));
+                    }
+                } else {
+                    _currentScene->Draw(inputTime);
+                }
             } else {
+                // The render thread has to be idle while the renderer tears down and comes back up
+                if (_renderThread) {
+                    _renderThread->Flush();
+                }
+
                 std::cout << "Renderer resetting!" << std::endl;
-                if (ServiceLocator::GetVRSubsystem()) {
+                auto resetStart = std::chrono::steady_clock::now();
+                auto* renderer = ServiceLocator::GetRenderer();
+
+                if (_pendingRendererSettings && _pendingRendererSettings->VR != renderer->GetSettings().VR) {
+                    _rendererResetCause = std::max(_rendererResetCause, RendererResetCause::VRToggle);
+                }
+
+                // The VR session lives on the renderer's device, so it only goes down when the device does
+                if (ServiceLocator::GetVRSubsystem() && _rendererResetCause >= RendererResetCause::VRToggle) {
                     ServiceLocator::GetVRSubsystem()->Reset();
                 }
-                ServiceLocator::GetRenderer()->Reset();
-                std::cout << "Renderer Has Reset" << std::endl;
+
+                if (_pendingRendererSettings) {
+                    renderer->Reset(std::move(*_pendingRendererSettings), _rendererResetCause);
+                } else {
+                    renderer->Reset(_rendererResetCause);
+                }
+
+                auto resetMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - resetStart).count();
+                std::cout << "Renderer Has Reset in " << resetMs << "ms" << std::endl;
                 _rendererResetRequested = false;
+                _rendererResetCause = RendererResetCause::PresentModeChange;
+                _pendingRendererSettings.reset();
             }
         }
 
+        if (_renderThread) {
+            _renderThread->Stop();
+            _renderThread.reset();
+        }
+
         ServiceLocator::GetRenderer()->WaitForIdle();
         OnExit();
+
+        if (benchmarkFrames > 0) {
+            benchmark.Write(Filesystem::GetAppUserDataDirectory() / "benchmark.json");
+        }
+
+#ifdef OZZ_ENABLE_PROFILING
+        Profiler::ExportChromeTrace(Filesystem::GetAppUserDataDirectory() / "trace.json");
+#endif
     }
 
     void Game::initializeServices() {
@@ -127,6 +212,9 @@ namespace OZZ {
         // provide input manager
         ServiceLocator::Provide(new InputManager());
 
+        // worker threads for pipeline compilation and other background work
+        ServiceLocator::Provide(new JobSystem());
+
         // Provide a window
         switch (engineConfiguration.WinType) {
             case WindowType::SDL:
@@ -160,7 +248,14 @@ namespace OZZ {
                 // initialize the renderer
                 RendererSettings settings {
                         .ApplicationName = _title,
-                        .VR = engineConfiguration.VR
+                        .VR = engineConfiguration.VR,
+                        .TextureBudgetMB = engineConfiguration.TextureBudgetMB,
+                        .DepthPrepass = engineConfiguration.DepthPrepass,
+                        .OcclusionCulling = engineConfiguration.OcclusionCulling,
+                        .GpuDrivenRendering = engineConfiguration.GpuDriven,
+                        .BindlessTextures = engineConfiguration.BindlessTextures,
+                        .FramesInFlight = engineConfiguration.FramesInFlight,
+                        .Present = engineConfiguration.Present
                 };
 
                 ServiceLocator::Provide(new VulkanRenderer(), settings);
@@ -174,8 +269,19 @@ namespace OZZ {
         ServiceLocator::ShutdownServices();
     }
 
-    void Game::ResetRenderer() {
+    void Game::ResetRenderer(RendererResetCause cause) {
+        if (!_rendererResetRequested || cause > _rendererResetCause)
+            _rendererResetCause = cause;
+
+        _rendererResetRequested = true;
+    }
+
+    void Game::ApplyRendererSettings(const RendererSettings& settings) {
+        // The renderer works out from the settings how much has to go
         if (!_rendererResetRequested)
-            _rendererResetRequested = true;
+            _rendererResetCause = RendererResetCause::PresentModeChange;
+
+        _pendingRendererSettings = settings;
+        _rendererResetRequested = true;
     }
 }
\ No newline at end of file
@@ -0,0 +1,113 @@
+#include <youtube_engine/core/job_system.h>
+#include <youtube_engine/core/profiler.h>
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+
+namespace OZZ {
+    JobSystem::JobSystem(uint32_t threadCount) {
+        if (threadCount == 0) {
+            auto hardwareThreads = std::thread::hardware_concurrency();
+            threadCount = hardwareThreads > 1 ? hardwareThreads - 1 : 1;
+        }
+
+        for (uint32_t i = 0; i < threadCount; i++) {
+            _workers.emplace_back([this]() { workerLoop(); });
+        }
+    }
+
+    JobSystem::~JobSystem() {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _running = false;
+        }
+
+        _condition.notify_all();
+
+        for (auto& worker : _workers) {
+            worker.join();
+        }
+    }
+
+    std::future<void> JobSystem::Submit(Job job) {
+        std::packaged_task<void()> task(std::move(job));
+        auto future = task.get_future();
+
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _jobs.push(std::move(task));
+        }
+
+        _condition.notify_one();
+        return future;
+    }
+
+    void JobSystem::ParallelFor(uint32_t count, uint32_t batchSize, const RangeJob& job) {
+        if (count == 0) return;
+        batchSize = std::max(batchSize, 1u);
+
+        struct ParallelForState {
+            RangeJob Job;
+            uint32_t Count;
+            uint32_t BatchSize;
+            std::atomic<uint32_t> NextBatch { 0 };
+            std::atomic<uint32_t> CompletedBatches { 0 };
+            uint32_t BatchCount;
+
+            std::mutex Mutex;
+            std::condition_variable Done;
+        };
+
+        auto state = std::make_shared<ParallelForState>();
+        state->Job = job;
+        state->Count = count;
+        state->BatchSize = batchSize;
+        state->BatchCount = (count + batchSize - 1) / batchSize;
+
+        // Helpers and the caller all pull batches from the same counter. Helpers that start late find nothing left.
+        auto runBatches = [](const std::shared_ptr<ParallelForState>& batchState) {
+            uint32_t batch;
+            while ((batch = batchState->NextBatch.fetch_add(1)) < batchState->BatchCount) {
+                auto begin = batch * batchState->BatchSize;
+                auto end = std::min(begin + batchState->BatchSize, batchState->Count);
+                batchState->Job(begin, end);
+
+                if (batchState->CompletedBatches.fetch_add(1) + 1 == batchState->BatchCount) {
+                    std::lock_guard<std::mutex> lock(batchState->Mutex);
+                    batchState->Done.notify_all();
+                }
+            }
+        };
+
+        auto helpers = std::min(GetWorkerCount(), state->BatchCount - 1);
+        for (uint32_t i = 0; i < helpers; i++) {
+            Submit([state, runBatches]() { runBatches(state); });
+        }
+
+        runBatches(state);
+
+        std::unique_lock<std::mutex> lock(state->Mutex);
+        state->Done.wait(lock, [&state]() { return state->CompletedBatches == state->BatchCount; });
+    }
+
+    void JobSystem::workerLoop() {
+        OZZ_PROFILE_THREAD("Job Worker");
+
+        while (true) {
+            std::packaged_task<void()> task;
+
+            {
+                std::unique_lock<std::mutex> lock(_mutex);
+                _condition.wait(lock, [this]() { return !_running || !_jobs.empty(); });
+
+                if (!_running && _jobs.empty()) return;
+
+                task = std::move(_jobs.front());
+                _jobs.pop();
+            }
+
+            task();
+        }
+    }
+}
@@ -0,0 +1,159 @@
+#include <youtube_engine/core/profiler.h>
+
+#ifdef OZZ_ENABLE_PROFILING
+
+#include <nlohmann/json.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace OZZ {
+    namespace {
+        struct Zone {
+            const char* Name;
+            uint64_t Start;
+            uint64_t End;
+        };
+
+        // Exports read records the owner may be rewriting at the same time, so the fields are atomic. Relaxed
+        // accesses compile to plain moves; the head tells the export which of its reads it can trust.
+        struct ZoneRecord {
+            std::atomic<const char*> Name { nullptr };
+            std::atomic<uint64_t> Start { 0 };
+            std::atomic<uint64_t> End { 0 };
+        };
+
+        struct ThreadBuffer {
+            uint32_t ThreadId { 0 };
+            std::string Name {};
+
+            // Only the owning thread writes. Head counts every zone ever written, the slot is Head % Profiler::RING_SIZE.
+            std::atomic<uint64_t> Head { 0 };
+            ZoneRecord Zones[Profiler::RING_SIZE] {};
+        };
+
+        struct ProfilerRegistry {
+            std::mutex Mutex;
+
+            // Buffers outlive their threads so zones from finished jobs still make it into the trace
+            std::vector<std::unique_ptr<ThreadBuffer>> Buffers {};
+            uint64_t Epoch { Profiler::Now() };
+        };
+
+        ProfilerRegistry& getRegistry() {
+            static ProfilerRegistry registry;
+            return registry;
+        }
+
+        thread_local ThreadBuffer* t_threadBuffer { nullptr };
+
+        ThreadBuffer* getThreadBuffer() {
+            if (t_threadBuffer) return t_threadBuffer;
+
+            auto& registry = getRegistry();
+            std::lock_guard<std::mutex> lock(registry.Mutex);
+
+            auto buffer = std::make_unique<ThreadBuffer>();
+            buffer->ThreadId = static_cast<uint32_t>(registry.Buffers.size());
+            buffer->Name = "Thread " + std::to_string(buffer->ThreadId);
+
+            t_threadBuffer = buffer.get();
+            registry.Buffers.push_back(std::move(buffer));
+
+            return t_threadBuffer;
+        }
+    }
+
+    void Profiler::Record(const char* name, uint64_t start, uint64_t end) {
+        auto* buffer = getThreadBuffer();
+
+        auto head = buffer->Head.load(std::memory_order_relaxed);
+        auto& record = buffer->Zones[head % Profiler::RING_SIZE];
+
+        // An export that reads any of the new fields is then guaranteed to see a head of at least this one's index,
+        // which tells it the slot's old zone is gone
+        std::atomic_thread_fence(std::memory_order_release);
+
+        record.Name.store(name, std::memory_order_relaxed);
+        record.Start.store(start, std::memory_order_relaxed);
+        record.End.store(end, std::memory_order_relaxed);
+        buffer->Head.store(head + 1, std::memory_order_release);
+    }
+
+    void Profiler::SetThreadName(const char* name) {
+        auto* buffer = getThreadBuffer();
+
+        std::lock_guard<std::mutex> lock(getRegistry().Mutex);
+        buffer->Name = name;
+    }
+
+    bool Profiler::ExportChromeTrace(const Path& path) {
+        auto& registry = getRegistry();
+        std::lock_guard<std::mutex> lock(registry.Mutex);
+
+        nlohmann::json events = nlohmann::json::array();
+
+        for (auto& buffer : registry.Buffers) {
+            events.push_back({
+                { "name", "thread_name" },
+                { "ph", "M" },
+                { "pid", 1 },
+                { "tid", buffer->ThreadId },
+                { "args", { { "name", buffer->Name } } }
+            });
+
+            auto head = buffer->Head.load(std::memory_order_acquire);
+            auto first = head > Profiler::RING_SIZE ? head - Profiler::RING_SIZE : 0;
+
+            std::vector<Zone> zones {};
+            zones.reserve(head - first);
+            for (auto index = first; index < head; index++) {
+                const auto& record = buffer->Zones[index % Profiler::RING_SIZE];
+                zones.push_back({
+                    record.Name.load(std::memory_order_relaxed),
+                    record.Start.load(std::memory_order_relaxed),
+                    record.End.load(std::memory_order_relaxed)
+                });
+            }
+
+            // The owner kept writing while we copied. The zone at newHead may already be half written over the slot
+            // of newHead - Profiler::RING_SIZE, so everything up to and including that one is dropped.
+            std::atomic_thread_fence(std::memory_order_acquire);
+            auto newHead = buffer->Head.load(std::memory_order_relaxed);
+            auto overwritten = newHead >= Profiler::RING_SIZE ? newHead - Profiler::RING_SIZE + 1 : 0;
+            auto skip = static_cast<size_t>(std::min(overwritten > first ? overwritten - first : 0, head - first));
+
+            for (auto zone = zones.begin() + static_cast<std::ptrdiff_t>(skip); zone != zones.end(); zone++) {
+                // Zones from before the registry existed (static init) would land at negative times
+                if (zone->Start < registry.Epoch) continue;
+
+                events.push_back({
+                    { "name", zone->Name },
+                    { "ph", "X" },
+                    { "pid", 1 },
+                    { "tid", buffer->ThreadId },
+                    { "ts", static_cast<double>(zone->Start - registry.Epoch) / 1000.0 },
+                    { "dur", static_cast<double>(zone->End - zone->Start) / 1000.0 }
+                });
+            }
+        }
+
+        std::ofstream file(path, std::ios::out | std::ios::trunc);
+        if (!file) {
+            std::cout << "Failed to write trace to " << path.string() << std::endl;
+            return false;
+        }
+
+        file << nlohmann::json { { "traceEvents", std::move(events) }, { "displayTimeUnit", "ms" } }.dump();
+        std::cout << "Wrote trace to " << path.string() << std::endl;
+        return true;
+    }
+}
+
+#endif
@@ -3,10 +3,14 @@
 //
 
 #include <youtube_engine/core/scene.h>
+#include <youtube_engine/core/profiler.h>
 #include <youtube_engine/service_locator.h>
 #include <youtube_engine/rendering/renderables.h>
 
 #include <glm/glm.hpp>
+#include <algorithm>
+#include <limits>
+#include <unordered_map>
 namespace OZZ {
     Scene::Scene() {
 
@@ -28,12 +32,23 @@ namespace OZZ {
         }), _entities.end());
     }
 
-    void Scene::Draw() {
+    void Scene::Draw(std::chrono::steady_clock::time_point inputTime) {
+        OZZ_PROFILE_SCOPE("Scene::Draw");
+
+        FramePacket packet {};
+        if (!buildFramePacket(packet, inputTime)) return;
+
+        ServiceLocator::GetRenderer()->RenderFrame(packet.Params, packet.Objects);
+    }
+
+    bool Scene::buildFramePacket(FramePacket& packet, std::chrono::steady_clock::time_point inputTime) {
+        OZZ_PROFILE_FUNCTION();
+
         auto [width, height] = ServiceLocator::GetWindow()->GetWindowExtents();
 
-        if (width == 0 || height == 0) return;
+        if (width == 0 || height == 0) return false;
 
-        std::vector<RenderableObject> ros {};
+        auto& ros = packet.Objects;
 
         auto cameraObjects = _registry.view<TransformComponent, CameraComponent>();
 
@@ -61,30 +76,161 @@ namespace OZZ {
 
         if (!foundCamera) {
             std::cerr << "No Camera in Scene, cannot draw!" << std::endl;
-            return;
+            return false;
         }
 
         // Loop through all renderable objects
         auto renderableObjects = _registry.view<TransformComponent, MeshComponent>();
 
         for (auto entity : renderableObjects) {
+            auto& meshComponent = renderableObjects.get<MeshComponent>(entity);
+
+            std::string_view profileScope {};
+            if (!meshComponent.GetProfileScope().empty()) {
+                profileScope = *packet.ProfileScopes.emplace(meshComponent.GetProfileScope()).first;
+            }
+
             RenderableObject ro {
-                .Mesh = renderableObjects.get<MeshComponent>(entity).GetMesh(),
+                .Mesh = meshComponent.GetMesh(),
 //                .ModelBuffer = renderableObjects.get<MeshComponent>(entity).GetModelBuffer(),
-                .Transform = renderableObjects.get<TransformComponent>(entity).GetTransform()
+                .Transform = renderableObjects.get<TransformComponent>(entity).GetTransform(),
+                .ProfileScope = profileScope,
+                .Static = meshComponent.IsStatic()
             };
 
             ros.push_back(ro);
         }
 
-        SceneParams sceneParams {
+        // The scene camera doesn't match the eyes in VR, so only cull for the window
+        auto* vr = ServiceLocator::GetVRSubsystem();
+        if (_occlusionCulling && !(vr && vr->IsInitialized())) {
+            cullOccluded(projection * viewMatrix, ros);
+        }
+
+        packet.Params = {
             .Camera = {
                 .View = viewMatrix,
                 .Projection = projection
             },
             .EyePosition = eyeposition,
-            .EyeRotation = eyerotation
+            .EyeRotation = eyerotation,
+            .InputTime = inputTime
         };
-        ServiceLocator::GetRenderer()->RenderFrame(sceneParams, ros);
+
+        // Only what survived culling, so hidden objects don't pull in detail nobody sees
+        if (ServiceLocator::GetRenderer()->IsTextureStreamingEnabled()) {
+            requestTextureMips(TextureStreamingView::FromCamera(viewMatrix, projection, static_cast<float>(height)), ros,
+                               packet.Params.TextureMipRequests);
+        }
+
+        return true;
+    }
+
+    void Scene::cullOccluded(const glm::mat4& viewProjection, std::vector<RenderableObject>& objects) {
+        OZZ_PROFILE_FUNCTION();
+
+        _cullingStats = { .Tested = static_cast<uint32_t>(objects.size()) };
+        _occlusionBuffer.Begin(viewProjection);
+
+        auto occluders = _registry.view<TransformComponent, OccluderComponent>();
+        for (auto entity : occluders) {
+            auto& occluder = occluders.get<OccluderComponent>(entity);
+            _occlusionBuffer.AddOccluder(occluder.GetVertices(), occluder.GetIndices(), occluders.get<TransformComponent>(entity).GetTransform());
+            _cullingStats.Occluders++;
+        }
+
+        _cullingStats.OccluderTriangles = _occlusionBuffer.GetTriangleCount();
+        if (_cullingStats.OccluderTriangles == 0) return;
+
+        auto* jobSystem = ServiceLocator::GetJobSystem();
+        _occlusionBuffer.Rasterize(jobSystem);
+
+        std::vector<uint8_t> occluded(objects.size(), 0);
+        auto testObjects = [this, &objects, &occluded](uint32_t begin, uint32_t end) {
+            for (uint32_t i = begin; i < end; i++) {
+                auto mesh = objects[i].Mesh.lock();
+                if (!mesh || mesh->GetSubmeshes().empty()) continue;
+
+                const auto& transform = objects[i].Transform;
+                glm::vec3 boundsMin { std::numeric_limits<float>::max() };
+                glm::vec3 boundsMax { std::numeric_limits<float>::lowest() };
+
+                for (auto& submesh : mesh->GetSubmeshes()) {
+                    const auto& bounds = submesh.GetBounds();
+
+                    glm::vec3 center = glm::vec3(transform * glm::vec4((bounds.Min + bounds.Max) * 0.5f, 1.f));
+                    glm::vec3 extent = (bounds.Max - bounds.Min) * 0.5f;
+
+                    glm::vec3 worldExtent {};
+                    for (int axis = 0; axis < 3; axis++) {
+                        worldExtent[axis] = std::abs(transform[0][axis]) * extent.x +
+                                            std::abs(transform[1][axis]) * extent.y +
+                                            std::abs(transform[2][axis]) * extent.z;
+                    }
+
+                    boundsMin = glm::min(boundsMin, center - worldExtent);
+                    boundsMax = glm::max(boundsMax, center + worldExtent);
+                }
+
+                occluded[i] = _occlusionBuffer.IsOccluded(boundsMin, boundsMax) ? 1 : 0;
+            }
+        };
+
+        if (jobSystem) {
+            jobSystem->ParallelFor(static_cast<uint32_t>(objects.size()), 64, testObjects);
+        } else {
+            testObjects(0, static_cast<uint32_t>(objects.size()));
+        }
+
+        // Keep the submission order, consecutive profiler scopes rely on it
+        size_t kept { 0 };
+        for (size_t i = 0; i < objects.size(); i++) {
+            if (!occluded[i]) {
+                objects[kept++] = objects[i];
+            }
+        }
+
+        _cullingStats.Culled = static_cast<uint32_t>(objects.size() - kept);
+        objects.erase(objects.begin() + static_cast<std::ptrdiff_t>(kept), objects.end());
+    }
+
+    void Scene::requestTextureMips(const TextureStreamingView& view, const std::vector<RenderableObject>& objects,
+                                   std::vector<TextureMipRequest>& requests) {
+        OZZ_PROFILE_FUNCTION();
+
+        // A texture shared by many objects gets one request, for the finest mip any of them needs
+        std::unordered_map<const Texture*, size_t> requestIndices {};
+
+        for (auto& object : objects) {
+            auto mesh = object.Mesh.lock();
+            if (!mesh) continue;
+
+            for (auto& submesh : mesh->GetSubmeshes()) {
+                auto material = submesh.GetMaterial().lock();
+                auto shader = material ? material->GetShader().lock() : nullptr;
+                if (!shader) continue;
+
+                // Textures the material doesn't sample aren't worth the memory
+                const auto& resources = shader->GetShaderData().Resources;
+
+                for (int i = (int)ResourceName::Diffuse0; i < (int)ResourceName::EndTextures; i++) {
+                    if (!resources.contains((ResourceName)i)) continue;
+
+                    auto image = submesh.GetTexture((ResourceName)i).lock();
+                    auto texture = image ? image->GetTexture().lock() : nullptr;
+                    if (!texture || !texture->IsStreamed()) continue;
+
+                    auto [width, height] = texture->GetSize();
+                    auto mip = ComputeDesiredMip(std::max(width, height), submesh.GetBounds(), object.Transform, view);
+
+                    auto [entry, inserted] = requestIndices.try_emplace(texture.get(), requests.size());
+                    if (inserted) {
+                        requests.push_back({ .Texture = texture, .Mip = mip });
+                    } else {
+                        requests[entry->second].Mip = std::min(requests[entry->second].Mip, mip);
+                    }
+                }
+            }
+        }
     }
 }
\ No newline at end of file
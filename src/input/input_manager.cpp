@@ -3,6 +3,7 @@
 //
 
 #include "youtube_engine/input/input_manager.h"
+#include "youtube_engine/core/profiler.h"
 
 #include <iostream>
 
@@ -104,6 +105,8 @@ namespace OZZ {
     }
 
     void InputManager::processInput() {
+        OZZ_PROFILE_SCOPE("InputManager::processInput");
+
         std::vector<ActionEvent> events {};
         for (auto& device : _devices) {
             // get new state for device
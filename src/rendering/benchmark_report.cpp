@@ -0,0 +1,90 @@
+#include <youtube_engine/rendering/benchmark_report.h>
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+
+namespace OZZ {
+    void BenchmarkReport::AddFrame(const FrameStats& stats, float frameMs) {
+        if (_hasFrames && stats.FrameNumber == _lastFrameNumber) return;
+
+        _hasFrames = true;
+        _lastFrameNumber = stats.FrameNumber;
+        _frames.push_back({ stats, frameMs });
+    }
+
+    nlohmann::json BenchmarkReport::ToJson() const {
+        nlohmann::json json;
+        json["frames"] = _frames.size();
+        if (_frames.empty()) return json;
+
+        std::vector<float> frameTimes {};
+        frameTimes.reserve(_frames.size());
+        for (const auto& frame : _frames) {
+            frameTimes.push_back(frame.FrameMs);
+        }
+        std::sort(frameTimes.begin(), frameTimes.end());
+
+        auto percentile = [&frameTimes](double fraction) {
+            auto index = static_cast<size_t>(fraction * static_cast<double>(frameTimes.size() - 1) + 0.5);
+            return frameTimes[index];
+        };
+
+        double totalMs = 0.0;
+        for (auto frameMs : frameTimes) {
+            totalMs += frameMs;
+        }
+
+        json["frameMs"] = {
+            { "average", totalMs / static_cast<double>(frameTimes.size()) },
+            { "min", frameTimes.front() },
+            { "p50", percentile(0.5) },
+            { "p95", percentile(0.95) },
+            { "p99", percentile(0.99) },
+            { "max", frameTimes.back() }
+        };
+
+        auto summarize = [this, &json](const char* name, auto field) {
+            double total = 0.0;
+            double most = 0.0;
+
+            for (const auto& frame : _frames) {
+                auto value = static_cast<double>(field(frame.Stats));
+                total += value;
+                most = std::max(most, value);
+            }
+
+            json[name] = { { "average", total / static_cast<double>(_frames.size()) }, { "max", most } };
+        };
+
+        summarize("drawCalls", [](const FrameStats& stats) { return stats.DrawCalls; });
+        summarize("triangles", [](const FrameStats& stats) { return stats.Triangles; });
+        summarize("pipelineBinds", [](const FrameStats& stats) { return stats.PipelineBinds; });
+        summarize("commandsElided", [](const FrameStats& stats) { return stats.CommandsElided; });
+        summarize("descriptorSetsAllocated", [](const FrameStats& stats) { return stats.DescriptorSetsAllocated; });
+        summarize("descriptorWrites", [](const FrameStats& stats) { return stats.DescriptorWrites; });
+        summarize("staticDrawsReused", [](const FrameStats& stats) { return stats.StaticDrawsReused; });
+        summarize("staticRecordings", [](const FrameStats& stats) { return stats.StaticRecordings; });
+        summarize("bufferUploadBytes", [](const FrameStats& stats) { return stats.BufferUploadBytes; });
+        summarize("textureUploadBytes", [](const FrameStats& stats) { return stats.TextureUploadBytes; });
+        summarize("queueSubmits", [](const FrameStats& stats) { return stats.QueueSubmits; });
+        summarize("fenceWaits", [](const FrameStats& stats) { return stats.FenceWaits; });
+        summarize("swapchainRecreations", [](const FrameStats& stats) { return stats.SwapchainRecreations; });
+        summarize("occlusionCulledPercent", [](const FrameStats& stats) { return stats.GetOcclusionCulledPercent(); });
+        summarize("inputToPresentMs", [](const FrameStats& stats) { return stats.InputToPresentMs; });
+
+        return json;
+    }
+
+    bool BenchmarkReport::Write(const Path& path) const {
+        std::ofstream file(path, std::ios::out | std::ios::trunc);
+        if (!file) {
+            std::cout << "Failed to write benchmark results to " << path.string() << std::endl;
+            return false;
+        }
+
+        file << ToJson().dump(4);
+        std::cout << "Wrote benchmark results for " << _frames.size() << " frames to " << path.string() << std::endl;
+        return true;
+    }
+}
@@ -2,14 +2,37 @@
 // Created by ozzadar on 2022-02-11.
 //
 #include <youtube_engine/rendering/images.h>
+#include "ktx2.h"
 #include <stb_image.h>
 #include <iostream>
+#include <algorithm>
+#include <bit>
+#include <fstream>
 #include <cstring>
 
 namespace OZZ {
 
     ImageData::ImageData(const Path &filePath, bool flipVertical) {
         Path texturePath = Filesystem::GetAssetPath() /= filePath;
+
+        if (texturePath.extension() == ".ktx2") {
+            std::ifstream file(texturePath, std::ios::ate | std::ios::binary);
+
+            std::vector<unsigned char> fileData {};
+            if (file.is_open()) {
+                fileData.resize(static_cast<size_t>(file.tellg()));
+                file.seekg(0);
+                file.read(reinterpret_cast<char*>(fileData.data()), static_cast<std::streamsize>(fileData.size()));
+            }
+
+            _valid = file && loadKTX2(fileData.data(), fileData.size());
+
+            if (!_valid) {
+                std::cout << "Error loading image at: " << texturePath << std::endl;
+            }
+            return;
+        }
+
         stbi_set_flip_vertically_on_load(flipVertical);
 
         auto image = stbi_load(texturePath.string().c_str(), &_width, &_height, &_channels, STBI_rgb_alpha);
@@ -28,10 +51,20 @@ namespace OZZ {
         stbi_image_free(image);
 
         updateColorType();
+        setSingleMipLevel();
         _valid = true;
     }
 
     ImageData::ImageData(char *fileData, uint32_t fileLength, bool flipVertical) {
+        if (IsKTX2(reinterpret_cast<const unsigned char*>(fileData), fileLength)) {
+            _valid = loadKTX2(reinterpret_cast<const unsigned char*>(fileData), fileLength);
+
+            if (!_valid) {
+                std::cout << "Error loading KTX2 image from binary data!" << std::endl;
+            }
+            return;
+        }
+
         stbi_set_flip_vertically_on_load(flipVertical);
 
         auto image = stbi_load_from_memory((const stbi_uc*)fileData, static_cast<int>(fileLength), &_width, &_height, &_channels, STBI_rgb_alpha);
@@ -50,6 +83,7 @@ namespace OZZ {
         stbi_image_free(image);
 
         updateColorType();
+        setSingleMipLevel();
         _valid = true;
     }
 
@@ -65,20 +99,134 @@ namespace OZZ {
             auto colorByte = static_cast<unsigned char>(color[i % 4] * 255.f);
             _data[i] = colorByte;
         }
+
+        setSingleMipLevel();
     }
 
+    ImageData::ImageData(uint32_t width, uint32_t height, ColorType colorType, std::vector<unsigned char>&& data,
+                         std::vector<ImageMipLevel>&& mipLevels) :
+            _valid(!mipLevels.empty()),
+            _width(static_cast<int>(width)),
+            _height(static_cast<int>(height)),
+            _channels(IsBlockCompressed(colorType) ? 0 : static_cast<int>(GetColorTypeBlockSize(colorType))),
+            _colorType(colorType),
+            _data(std::move(data)),
+            _mipLevels(std::move(mipLevels)) {}
+
     ImageData::~ImageData() {
         _data.clear();
     }
 
     uint32_t ImageData::GetDataSize() const {
-        return _width * _height * _channels;
+        return static_cast<uint32_t>(_data.size());
     }
 
     const unsigned char *ImageData::GetData() const {
         return _data.data();
     }
 
+    bool ImageData::IsKTX2(const unsigned char* fileData, size_t fileLength) {
+        return fileLength >= sizeof(KTX2::Identifier) && std::memcmp(fileData, KTX2::Identifier, sizeof(KTX2::Identifier)) == 0;
+    }
+
+    void ImageData::setSingleMipLevel() {
+        _mipLevels = {{
+            .Width = static_cast<uint32_t>(_width),
+            .Height = static_cast<uint32_t>(_height),
+            .Offset = 0,
+            .Size = static_cast<uint32_t>(_data.size())
+        }};
+    }
+
+    bool ImageData::loadKTX2(const unsigned char* fileData, size_t fileLength) {
+        if (!IsKTX2(fileData, fileLength) || fileLength < sizeof(KTX2::Identifier) + sizeof(KTX2::Header)) {
+            return false;
+        }
+
+        KTX2::Header header {};
+        std::memcpy(&header, fileData + sizeof(KTX2::Identifier), sizeof(header));
+
+        auto colorType = KTX2::FormatToColorType(header.VkFormat);
+        if (!colorType) {
+            std::cout << "Unsupported KTX2 format: " << header.VkFormat << std::endl;
+            return false;
+        }
+
+        if (header.SupercompressionScheme != 0 || header.PixelDepth > 1 || header.LayerCount > 1 || header.FaceCount != 1) {
+            std::cout << "Only plain 2D KTX2 textures without supercompression are supported." << std::endl;
+            return false;
+        }
+
+        if (header.PixelWidth == 0 || header.PixelHeight == 0) {
+            std::cout << "KTX2 texture has no pixels." << std::endl;
+            return false;
+        }
+
+        // A level count of 0 asks the loader to generate mips, which the renderer does anyway when it can. More levels
+        // than a full chain would be shifting the size by 32 or more below.
+        auto levelCount = std::max(header.LevelCount, 1u);
+        auto fullChain = static_cast<uint32_t>(std::bit_width(std::max(header.PixelWidth, header.PixelHeight)));
+
+        if (levelCount > fullChain) {
+            std::cout << "KTX2 texture has " << levelCount << " levels, more than its size allows." << std::endl;
+            return false;
+        }
+
+        auto levelIndexOffset = sizeof(KTX2::Identifier) + sizeof(KTX2::Header);
+        if (fileLength < levelIndexOffset + levelCount * sizeof(KTX2::LevelIndex)) {
+            return false;
+        }
+
+        bool compressed = IsBlockCompressed(*colorType);
+        auto blockSize = GetColorTypeBlockSize(*colorType);
+
+        std::vector<ImageMipLevel> mipLevels {};
+        std::vector<unsigned char> data {};
+
+        for (uint32_t level = 0; level < levelCount; level++) {
+            KTX2::LevelIndex levelIndex {};
+            std::memcpy(&levelIndex, fileData + levelIndexOffset + level * sizeof(KTX2::LevelIndex), sizeof(levelIndex));
+
+            auto width = std::max(header.PixelWidth >> level, 1u);
+            auto height = std::max(header.PixelHeight >> level, 1u);
+
+            // 64 bit before rounding up, a width near UINT32_MAX would wrap to 0 blocks otherwise
+            uint64_t expectedSize = compressed
+                    ? ((static_cast<uint64_t>(width) + 3) / 4) * ((static_cast<uint64_t>(height) + 3) / 4) * blockSize
+                    : static_cast<uint64_t>(width) * height * blockSize;
+
+            // Written so neither side can wrap, the offset comes straight from the file
+            if (levelIndex.ByteLength < expectedSize || levelIndex.ByteOffset > fileLength || expectedSize > fileLength - levelIndex.ByteOffset) {
+                std::cout << "KTX2 level " << level << " is truncated." << std::endl;
+                return false;
+            }
+
+            // Mip offsets and sizes are 32 bit
+            if (data.size() + expectedSize > UINT32_MAX) {
+                std::cout << "KTX2 texture is too large." << std::endl;
+                return false;
+            }
+
+            mipLevels.push_back({
+                .Width = width,
+                .Height = height,
+                .Offset = static_cast<uint32_t>(data.size()),
+                .Size = static_cast<uint32_t>(expectedSize)
+            });
+
+            data.insert(data.end(), fileData + levelIndex.ByteOffset, fileData + levelIndex.ByteOffset + expectedSize);
+        }
+
+        _width = static_cast<int>(header.PixelWidth);
+        _height = static_cast<int>(header.PixelHeight);
+        _channels = compressed ? 0 : static_cast<int>(blockSize);
+        _colorType = *colorType;
+        _data = std::move(data);
+        _mipLevels = std::move(mipLevels);
+
+        return true;
+    }
+
     void ImageData::updateColorType() {
         switch(_channels) {
             case 4:
@@ -0,0 +1,105 @@
+#pragma once
+#include <youtube_engine/rendering/types.h>
+
+#include <cstdint>
+#include <optional>
+
+/*
+ * Just enough of the KTX2 container to read and write 2D textures without supercompression.
+ * https://registry.khronos.org/KTX/specs/2.0/ktxspec.v2.html
+ */
+namespace OZZ::KTX2 {
+    constexpr uint8_t Identifier[12] = { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+
+    // The 64 bit offsets in the header are only 4 byte aligned in the file
+#pragma pack(push, 4)
+    struct Header {
+        uint32_t VkFormat;
+        uint32_t TypeSize;
+        uint32_t PixelWidth;
+        uint32_t PixelHeight;
+        uint32_t PixelDepth;
+        uint32_t LayerCount;
+        uint32_t FaceCount;
+        uint32_t LevelCount;
+        uint32_t SupercompressionScheme;
+
+        uint32_t DfdByteOffset;
+        uint32_t DfdByteLength;
+        uint32_t KvdByteOffset;
+        uint32_t KvdByteLength;
+        uint64_t SgdByteOffset;
+        uint64_t SgdByteLength;
+    };
+#pragma pack(pop)
+
+    struct LevelIndex {
+        uint64_t ByteOffset;
+        uint64_t ByteLength;
+        uint64_t UncompressedByteLength;
+    };
+
+    static_assert(sizeof(Header) == 68, "KTX2 header must match the file layout");
+    static_assert(sizeof(LevelIndex) == 24, "KTX2 level index must match the file layout");
+
+    // VkFormat values, spelled out so the container code doesn't depend on the Vulkan headers
+    enum Format : uint32_t {
+        R8G8B8A8_UNORM = 37,
+        R8G8B8A8_SRGB = 43,
+        BC1_RGBA_UNORM_BLOCK = 133,
+        BC1_RGBA_SRGB_BLOCK = 134,
+        BC3_UNORM_BLOCK = 137,
+        BC3_SRGB_BLOCK = 138,
+        BC5_UNORM_BLOCK = 141,
+        BC7_UNORM_BLOCK = 145,
+        BC7_SRGB_BLOCK = 146,
+    };
+
+    inline std::optional<ColorType> FormatToColorType(uint32_t format) {
+        switch (format) {
+            // There's no linear RGBA8 color type yet, it's treated as sRGB just like PNGs are
+            case R8G8B8A8_UNORM:
+            case R8G8B8A8_SRGB:
+                return ColorType::UNSIGNED_CHAR4;
+            case BC1_RGBA_UNORM_BLOCK:
+                return ColorType::BC1_UNORM;
+            case BC1_RGBA_SRGB_BLOCK:
+                return ColorType::BC1_SRGB;
+            case BC3_UNORM_BLOCK:
+                return ColorType::BC3_UNORM;
+            case BC3_SRGB_BLOCK:
+                return ColorType::BC3_SRGB;
+            case BC5_UNORM_BLOCK:
+                return ColorType::BC5_UNORM;
+            case BC7_UNORM_BLOCK:
+                return ColorType::BC7_UNORM;
+            case BC7_SRGB_BLOCK:
+                return ColorType::BC7_SRGB;
+            default:
+                return std::nullopt;
+        }
+    }
+
+    inline std::optional<uint32_t> ColorTypeToFormat(ColorType colorType) {
+        switch (colorType) {
+            case ColorType::UNSIGNED_CHAR4:
+                return R8G8B8A8_SRGB;
+            case ColorType::BC1_UNORM:
+                return BC1_RGBA_UNORM_BLOCK;
+            case ColorType::BC1_SRGB:
+                return BC1_RGBA_SRGB_BLOCK;
+            case ColorType::BC3_UNORM:
+                return BC3_UNORM_BLOCK;
+            case ColorType::BC3_SRGB:
+                return BC3_SRGB_BLOCK;
+            case ColorType::BC5_UNORM:
+                return BC5_UNORM_BLOCK;
+            case ColorType::BC7_UNORM:
+                return BC7_UNORM_BLOCK;
+            case ColorType::BC7_SRGB:
+                return BC7_SRGB_BLOCK;
+            default:
+                return std::nullopt;
+        }
+    }
+}
@@ -0,0 +1,281 @@
+#include <youtube_engine/rendering/occlusion_buffer.h>
+#include <youtube_engine/core/job_system.h>
+#include <youtube_engine/core/profiler.h>
+#include "occlusion_coverage.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+
+namespace OZZ {
+    // Anything closer to the camera plane than this gets clipped away, on top of the near plane itself (z < 0)
+    constexpr float OCCLUSION_NEAR_W = 1e-4f;
+
+    // Clipping a triangle against two planes leaves at most a pentagon
+    constexpr uint32_t OCCLUSION_MAX_CLIPPED = 5;
+
+    // Tile rows per parallel band
+    constexpr uint32_t OCCLUSION_BAND_ROWS = 4;
+
+    constexpr uint32_t FULL_TILE_MASK = 0xFFFFFFFFu;
+
+    static_assert(OcclusionBuffer::TILE_WIDTH * OcclusionBuffer::TILE_HEIGHT == 32, "A tile's coverage has to fit in a 32 bit mask");
+
+    OcclusionBuffer::OcclusionBuffer(uint32_t width, uint32_t height) {
+        _tilesX = std::max((width + TILE_WIDTH - 1) / TILE_WIDTH, 1u);
+        _tilesY = std::max((height + TILE_HEIGHT - 1) / TILE_HEIGHT, 1u);
+        _width = _tilesX * TILE_WIDTH;
+        _height = _tilesY * TILE_HEIGHT;
+
+        _tiles.resize(_tilesX * _tilesY);
+    }
+
+    void OcclusionBuffer::Begin(const glm::mat4& viewProjection) {
+        _viewProjection = viewProjection;
+        std::fill(_tiles.begin(), _tiles.end(), Tile {});
+        _triangles.clear();
+    }
+
+    void OcclusionBuffer::AddOccluder(const std::vector<glm::vec3>& vertices, const std::vector<uint32_t>& indices, const glm::mat4& model) {
+        auto modelViewProjection = _viewProjection * model;
+
+        std::vector<glm::vec4> clipVertices {};
+        clipVertices.reserve(vertices.size());
+        for (auto& vertex : vertices) {
+            clipVertices.push_back(modelViewProjection * glm::vec4(vertex, 1.f));
+        }
+
+        for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+            if (indices[i] >= clipVertices.size() || indices[i + 1] >= clipVertices.size() || indices[i + 2] >= clipVertices.size()) {
+                continue;
+            }
+
+            addTriangle(clipVertices[indices[i]], clipVertices[indices[i + 1]], clipVertices[indices[i + 2]]);
+        }
+    }
+
+    void OcclusionBuffer::Rasterize(JobSystem* jobSystem) {
+        OZZ_PROFILE_FUNCTION();
+
+        if (_triangles.empty()) return;
+
+        if (jobSystem) {
+            jobSystem->ParallelFor(_tilesY, OCCLUSION_BAND_ROWS, [this](uint32_t begin, uint32_t end) {
+                rasterizeRows(begin, end);
+            });
+        } else {
+            rasterizeRows(0, _tilesY);
+        }
+    }
+
+    bool OcclusionBuffer::IsOccluded(const glm::vec3& boundsMin, const glm::vec3& boundsMax) const {
+        glm::vec2 screenMin { std::numeric_limits<float>::max() };
+        glm::vec2 screenMax { std::numeric_limits<float>::lowest() };
+        float nearest { std::numeric_limits<float>::max() };
+
+        for (int i = 0; i < 8; i++) {
+            glm::vec3 corner {
+                    (i & 1) ? boundsMax.x : boundsMin.x,
+                    (i & 2) ? boundsMax.y : boundsMin.y,
+                    (i & 4) ? boundsMax.z : boundsMin.z
+            };
+
+            auto clip = _viewProjection * glm::vec4(corner, 1.f);
+
+            // Reaches past the near plane, there's nothing in front of it to hide it
+            if (clip.w < OCCLUSION_NEAR_W || clip.z < 0.f) return false;
+
+            glm::vec3 ndc = glm::vec3(clip) / clip.w;
+            glm::vec2 screen { (ndc.x * 0.5f + 0.5f) * static_cast<float>(_width), (ndc.y * 0.5f + 0.5f) * static_cast<float>(_height) };
+
+            screenMin = glm::min(screenMin, screen);
+            screenMax = glm::max(screenMax, screen);
+            nearest = std::min(nearest, ndc.z);
+        }
+
+        // Off screen isn't the same as occluded, leave that to frustum culling
+        if (screenMax.x < 0.f || screenMax.y < 0.f || screenMin.x >= static_cast<float>(_width) || screenMin.y >= static_cast<float>(_height)) {
+            return false;
+        }
+
+        auto minTileX = static_cast<uint32_t>(std::clamp(screenMin.x, 0.f, static_cast<float>(_width - 1))) / TILE_WIDTH;
+        auto maxTileX = static_cast<uint32_t>(std::clamp(screenMax.x, 0.f, static_cast<float>(_width - 1))) / TILE_WIDTH;
+        auto minTileY = static_cast<uint32_t>(std::clamp(screenMin.y, 0.f, static_cast<float>(_height - 1))) / TILE_HEIGHT;
+        auto maxTileY = static_cast<uint32_t>(std::clamp(screenMax.y, 0.f, static_cast<float>(_height - 1))) / TILE_HEIGHT;
+
+        for (uint32_t tileY = minTileY; tileY <= maxTileY; tileY++) {
+            for (uint32_t tileX = minTileX; tileX <= maxTileX; tileX++) {
+                if (nearest <= _tiles[tileY * _tilesX + tileX].ReferenceDepth) {
+                    return false;
+                }
+            }
+        }
+
+        return true;
+    }
+
+    float OcclusionBuffer::GetTileDepth(uint32_t tileX, uint32_t tileY) const {
+        if (tileX >= _tilesX || tileY >= _tilesY) return 1.f;
+        return _tiles[tileY * _tilesX + tileX].ReferenceDepth;
+    }
+
+    void OcclusionBuffer::addTriangle(const glm::vec4& a, const glm::vec4& b, const glm::vec4& c) {
+        // Entirely outside one of the side planes
+        if ((a.x > a.w && b.x > b.w && c.x > c.w) || (a.x < -a.w && b.x < -b.w && c.x < -c.w) ||
+            (a.y > a.w && b.y > b.w && c.y > c.w) || (a.y < -a.w && b.y < -b.w && c.y < -c.w)) {
+            return;
+        }
+
+        auto project = [this](const glm::vec4& clip) {
+            return glm::vec3 {
+                    (clip.x / clip.w * 0.5f + 0.5f) * static_cast<float>(_width),
+                    (clip.y / clip.w * 0.5f + 0.5f) * static_cast<float>(_height),
+                    // Points made on the near plane can land a hair under it
+                    std::max(clip.z, 0.f) / clip.w
+            };
+        };
+
+        auto inside = [](const glm::vec4& clip) { return clip.w >= OCCLUSION_NEAR_W && clip.z >= 0.f; };
+
+        if (inside(a) && inside(b) && inside(c)) {
+            addScreenTriangle(project(a), project(b), project(c));
+            return;
+        }
+
+        // Clip against the camera plane, then the near plane. The rasterizer never sees anything in front of the camera
+        // or the near plane, where depth would be negative and pull tiles in front of everything.
+        std::array<glm::vec4, OCCLUSION_MAX_CLIPPED> polygon { a, b, c };
+        uint32_t polygonCount { 3 };
+
+        auto clipPolygon = [&polygon, &polygonCount](auto distance) {
+            std::array<glm::vec4, OCCLUSION_MAX_CLIPPED> clipped {};
+            uint32_t clippedCount { 0 };
+
+            for (uint32_t i = 0; i < polygonCount; i++) {
+                const auto& current = polygon[i];
+                const auto& next = polygon[(i + 1) % polygonCount];
+
+                float currentDistance = distance(current);
+                float nextDistance = distance(next);
+
+                if (currentDistance >= 0.f) {
+                    clipped[clippedCount++] = current;
+                }
+
+                if ((currentDistance >= 0.f) != (nextDistance >= 0.f)) {
+                    float t = currentDistance / (currentDistance - nextDistance);
+                    clipped[clippedCount++] = current + (next - current) * t;
+                }
+            }
+
+            polygon = clipped;
+            polygonCount = clippedCount;
+        };
+
+        clipPolygon([](const glm::vec4& clip) { return clip.w - OCCLUSION_NEAR_W; });
+        clipPolygon([](const glm::vec4& clip) { return clip.z; });
+
+        for (uint32_t i = 1; i + 1 < polygonCount; i++) {
+            addScreenTriangle(project(polygon[0]), project(polygon[i]), project(polygon[i + 1]));
+        }
+    }
+
+    void OcclusionBuffer::addScreenTriangle(const glm::vec3& a, const glm::vec3& inB, const glm::vec3& inC) {
+        float area = (inB.x - a.x) * (inC.y - a.y) - (inB.y - a.y) * (inC.x - a.x);
+        if (std::abs(area) < 1e-6f) return;
+
+        // Wind everything the same way so the edge functions are positive inside
+        auto b = area > 0.f ? inB : inC;
+        auto c = area > 0.f ? inC : inB;
+        area = std::abs(area);
+
+        glm::vec2 boundsMin = glm::min(glm::min(glm::vec2(a), glm::vec2(b)), glm::vec2(c));
+        glm::vec2 boundsMax = glm::max(glm::max(glm::vec2(a), glm::vec2(b)), glm::vec2(c));
+
+        if (boundsMax.x < 0.f || boundsMax.y < 0.f || boundsMin.x >= static_cast<float>(_width) || boundsMin.y >= static_cast<float>(_height)) {
+            return;
+        }
+
+        Triangle triangle {};
+
+        const glm::vec3* points[3] { &a, &b, &c };
+        for (int i = 0; i < 3; i++) {
+            const auto& from = *points[i];
+            const auto& to = *points[(i + 1) % 3];
+
+            float edgeA = from.y - to.y;
+            float edgeB = to.x - from.x;
+            triangle.Edges[i] = { edgeA, edgeB, -(edgeA * from.x + edgeB * from.y) };
+        }
+
+        glm::vec2 edge1 { b.x - a.x, b.y - a.y };
+        glm::vec2 edge2 { c.x - a.x, c.y - a.y };
+        float depthDeltaB = b.z - a.z;
+        float depthDeltaC = c.z - a.z;
+
+        float depthDx = (depthDeltaB * edge2.y - depthDeltaC * edge1.y) / area;
+        float depthDy = (depthDeltaC * edge1.x - depthDeltaB * edge2.x) / area;
+        triangle.DepthPlane = { depthDx, depthDy, a.z - depthDx * a.x - depthDy * a.y };
+
+        triangle.MinDepth = std::min({ a.z, b.z, c.z });
+        triangle.MaxDepth = std::max({ a.z, b.z, c.z });
+
+        triangle.MinTileX = static_cast<uint32_t>(std::clamp(boundsMin.x, 0.f, static_cast<float>(_width - 1))) / TILE_WIDTH;
+        triangle.MaxTileX = static_cast<uint32_t>(std::clamp(boundsMax.x, 0.f, static_cast<float>(_width - 1))) / TILE_WIDTH;
+        triangle.MinTileY = static_cast<uint32_t>(std::clamp(boundsMin.y, 0.f, static_cast<float>(_height - 1))) / TILE_HEIGHT;
+        triangle.MaxTileY = static_cast<uint32_t>(std::clamp(boundsMax.y, 0.f, static_cast<float>(_height - 1))) / TILE_HEIGHT;
+
+        _triangles.push_back(triangle);
+    }
+
+    void OcclusionBuffer::rasterizeRows(uint32_t beginRow, uint32_t endRow) {
+        for (auto& triangle : _triangles) {
+            if (triangle.MaxTileY < beginRow || triangle.MinTileY >= endRow) continue;
+
+            auto firstRow = std::max(triangle.MinTileY, beginRow);
+            auto lastRow = std::min(triangle.MaxTileY, endRow - 1);
+
+            for (uint32_t tileY = firstRow; tileY <= lastRow; tileY++) {
+                for (uint32_t tileX = triangle.MinTileX; tileX <= triangle.MaxTileX; tileX++) {
+                    auto& tile = _tiles[tileY * _tilesX + tileX];
+
+                    // Already known to be in front of all of this triangle
+                    if (triangle.MinDepth >= tile.ReferenceDepth) continue;
+
+                    auto x = static_cast<float>(tileX * TILE_WIDTH);
+                    auto y = static_cast<float>(tileY * TILE_HEIGHT);
+
+                    auto coverage = OcclusionCoverage::Compute(triangle.Edges, x, y);
+                    if (coverage == 0) continue;
+
+                    // The plane is linear, so its farthest point over the tile is at a corner
+                    const auto& plane = triangle.DepthPlane;
+                    float cornerDepth = std::max(
+                            std::max(plane.x * x + plane.y * y, plane.x * (x + TILE_WIDTH) + plane.y * y),
+                            std::max(plane.x * x + plane.y * (y + TILE_HEIGHT), plane.x * (x + TILE_WIDTH) + plane.y * (y + TILE_HEIGHT))) + plane.z;
+
+                    updateTile(tile, coverage, std::clamp(cornerDepth, triangle.MinDepth, triangle.MaxDepth));
+                }
+            }
+        }
+    }
+
+    void OcclusionBuffer::updateTile(Tile& tile, uint32_t coverage, float depth) {
+        // A triangle much nearer than the working layer would drag its depth back; start a fresh one instead
+        if (tile.Mask != 0 && tile.WorkingDepth - depth > tile.ReferenceDepth - tile.WorkingDepth) {
+            tile.Mask = 0;
+            tile.WorkingDepth = 0.f;
+        }
+
+        tile.Mask |= coverage;
+        tile.WorkingDepth = std::max(tile.WorkingDepth, depth);
+
+        // Every pixel is now in front of the working depth
+        if (tile.Mask == FULL_TILE_MASK) {
+            tile.ReferenceDepth = std::min(tile.ReferenceDepth, tile.WorkingDepth);
+            tile.Mask = 0;
+            tile.WorkingDepth = 0.f;
+        }
+    }
+}
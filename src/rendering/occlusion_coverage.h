@@ -0,0 +1,82 @@
+#pragma once
+#include <youtube_engine/rendering/occlusion_buffer.h>
+
+#include <glm/glm.hpp>
+#include <cstdint>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #define OZZ_OCCLUSION_SSE
+    #include <emmintrin.h>
+#endif
+
+/*
+ * Which pixel centres of an 8x4 tile a triangle covers, bit row * 8 + column. Edge functions are a * x + b * y + c and
+ * positive inside. Both versions are kept so they can be checked against each other.
+ */
+namespace OZZ::OcclusionCoverage {
+    constexpr uint32_t TILE_WIDTH = OcclusionBuffer::TILE_WIDTH;
+    constexpr uint32_t TILE_HEIGHT = OcclusionBuffer::TILE_HEIGHT;
+
+    inline uint32_t ComputeScalar(const glm::vec3 (&edges)[3], float tileX, float tileY) {
+        uint32_t coverage { 0 };
+
+        for (uint32_t row = 0; row < TILE_HEIGHT; row++) {
+            float y = tileY + static_cast<float>(row) + 0.5f;
+
+            for (uint32_t column = 0; column < TILE_WIDTH; column++) {
+                float x = tileX + static_cast<float>(column) + 0.5f;
+
+                bool inside = true;
+                for (const auto& edge : edges) {
+                    inside &= edge.x * x + (edge.y * y + edge.z) >= 0.f;
+                }
+
+                if (inside) {
+                    coverage |= 1u << (row * TILE_WIDTH + column);
+                }
+            }
+        }
+
+        return coverage;
+    }
+
+#ifdef OZZ_OCCLUSION_SSE
+    // Same sums in the same order as the scalar version, so the two agree bit for bit
+    inline uint32_t ComputeSSE2(const glm::vec3 (&edges)[3], float tileX, float tileY) {
+        uint32_t coverage { 0 };
+
+        // One row of the tile is two groups of four pixel centres
+        const __m128 zero = _mm_setzero_ps();
+        const __m128 xLow = _mm_add_ps(_mm_set1_ps(tileX), _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f));
+        const __m128 xHigh = _mm_add_ps(_mm_set1_ps(tileX), _mm_setr_ps(4.5f, 5.5f, 6.5f, 7.5f));
+
+        for (uint32_t row = 0; row < TILE_HEIGHT; row++) {
+            float y = tileY + static_cast<float>(row) + 0.5f;
+
+            __m128 insideLow = _mm_castsi128_ps(_mm_set1_epi32(-1));
+            __m128 insideHigh = insideLow;
+
+            for (const auto& edge : edges) {
+                __m128 edgeA = _mm_set1_ps(edge.x);
+                __m128 rowValue = _mm_set1_ps(edge.y * y + edge.z);
+
+                insideLow = _mm_and_ps(insideLow, _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(edgeA, xLow), rowValue), zero));
+                insideHigh = _mm_and_ps(insideHigh, _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(edgeA, xHigh), rowValue), zero));
+            }
+
+            auto rowMask = static_cast<uint32_t>(_mm_movemask_ps(insideLow)) | (static_cast<uint32_t>(_mm_movemask_ps(insideHigh)) << 4);
+            coverage |= rowMask << (row * TILE_WIDTH);
+        }
+
+        return coverage;
+    }
+#endif
+
+    inline uint32_t Compute(const glm::vec3 (&edges)[3], float tileX, float tileY) {
+#ifdef OZZ_OCCLUSION_SSE
+        return ComputeSSE2(edges, tileX, tileY);
+#else
+        return ComputeScalar(edges, tileX, tileY);
+#endif
+    }
+}
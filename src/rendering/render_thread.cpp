@@ -0,0 +1,82 @@
+#include <youtube_engine/rendering/render_thread.h>
+#include <youtube_engine/rendering/renderer.h>
+#include <youtube_engine/core/profiler.h>
+
+#include <algorithm>
+
+namespace OZZ {
+    RenderThread::RenderThread(uint32_t packetCount) : _packets(std::max(packetCount, 1u)) {}
+
+    RenderThread::~RenderThread() {
+        Stop();
+    }
+
+    void RenderThread::Start(Renderer* renderer) {
+        if (IsRunning()) return;
+
+        _renderer = renderer;
+        _running = true;
+        _thread = std::thread([this]() { renderLoop(); });
+    }
+
+    void RenderThread::Stop() {
+        if (!IsRunning()) return;
+
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _running = false;
+        }
+
+        _packetReady.notify_all();
+        _thread.join();
+    }
+
+    void RenderThread::Submit(FramePacket packet) {
+        OZZ_PROFILE_SCOPE("RenderThread::Submit");
+
+        std::unique_lock<std::mutex> lock(_mutex);
+        _packetDone.wait(lock, [this]() { return _submitted - _rendered < _packets.size(); });
+
+        // The render thread never reads a slot past _submitted, so this one is ours until we bump it
+        _packets[_submitted % _packets.size()] = std::move(packet);
+        _submitted++;
+
+        lock.unlock();
+        _packetReady.notify_one();
+    }
+
+    void RenderThread::Flush() {
+        if (!IsRunning()) return;
+
+        std::unique_lock<std::mutex> lock(_mutex);
+        _packetDone.wait(lock, [this]() { return _rendered == _submitted; });
+    }
+
+    void RenderThread::renderLoop() {
+        OZZ_PROFILE_THREAD("Render Thread");
+
+        while (true) {
+            FramePacket* packet { nullptr };
+
+            {
+                std::unique_lock<std::mutex> lock(_mutex);
+                _packetReady.wait(lock, [this]() { return !_running || _rendered < _submitted; });
+
+                if (_rendered == _submitted) return;
+                packet = &_packets[_rendered % _packets.size()];
+            }
+
+            _renderer->RenderFrame(packet->Params, packet->Objects);
+
+            // Release the meshes now rather than whenever the slot is next filled
+            *packet = {};
+
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                _rendered++;
+            }
+
+            _packetDone.notify_all();
+        }
+    }
+}
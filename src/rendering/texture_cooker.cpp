@@ -0,0 +1,495 @@
+#include <youtube_engine/rendering/texture_cooker.h>
+#include "ktx2.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <numeric>
+
+namespace OZZ {
+    namespace {
+        /*
+         * MIP GENERATION
+         */
+        const std::array<float, 256>& srgbToLinearTable() {
+            static const auto table = []() {
+                std::array<float, 256> values {};
+                for (int i = 0; i < 256; i++) {
+                    auto c = static_cast<float>(i) / 255.f;
+                    values[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+                }
+                return values;
+            }();
+
+            return table;
+        }
+
+        unsigned char linearToSrgb(float c) {
+            c = c <= 0.0031308f ? c * 12.92f : 1.055f * std::pow(c, 1.f / 2.4f) - 0.055f;
+            return static_cast<unsigned char>(std::clamp(c, 0.f, 1.f) * 255.f + 0.5f);
+        }
+
+        // 2x2 box filter over RGBA8. Colour is averaged in linear space for sRGB images so mips don't darken.
+        std::vector<unsigned char> downsample(const std::vector<unsigned char>& source, uint32_t width, uint32_t height, bool srgb) {
+            auto nextWidth = std::max(width / 2, 1u);
+            auto nextHeight = std::max(height / 2, 1u);
+
+            const auto& toLinear = srgbToLinearTable();
+            std::vector<unsigned char> result(static_cast<size_t>(nextWidth) * nextHeight * 4);
+
+            for (uint32_t y = 0; y < nextHeight; y++) {
+                for (uint32_t x = 0; x < nextWidth; x++) {
+                    // Odd dimensions fold the last row/column into the one before
+                    uint32_t x0 = std::min(x * 2, width - 1), x1 = std::min(x * 2 + 1, width - 1);
+                    uint32_t y0 = std::min(y * 2, height - 1), y1 = std::min(y * 2 + 1, height - 1);
+
+                    const unsigned char* texels[4] = {
+                        &source[(static_cast<size_t>(y0) * width + x0) * 4],
+                        &source[(static_cast<size_t>(y0) * width + x1) * 4],
+                        &source[(static_cast<size_t>(y1) * width + x0) * 4],
+                        &source[(static_cast<size_t>(y1) * width + x1) * 4],
+                    };
+
+                    auto* out = &result[(static_cast<size_t>(y) * nextWidth + x) * 4];
+
+                    for (int channel = 0; channel < 4; channel++) {
+                        if (srgb && channel < 3) {
+                            float sum = 0.f;
+                            for (auto* texel : texels) sum += toLinear[texel[channel]];
+                            out[channel] = linearToSrgb(sum * 0.25f);
+                        } else {
+                            uint32_t sum = 0;
+                            for (auto* texel : texels) sum += texel[channel];
+                            out[channel] = static_cast<unsigned char>((sum + 2) / 4);
+                        }
+                    }
+                }
+            }
+
+            return result;
+        }
+
+        /*
+         * BLOCK ENCODING
+         * Bounding box endpoints with an inset, after "Real-Time DXT Compression" (van Waveren). Fast and predictable
+         * rather than optimal.
+         */
+        uint16_t toRGB565(const int color[3]) {
+            return static_cast<uint16_t>(((color[0] * 31 + 127) / 255) << 11 |
+                                         ((color[1] * 63 + 127) / 255) << 5 |
+                                         ((color[2] * 31 + 127) / 255));
+        }
+
+        void fromRGB565(uint16_t packed, int color[3]) {
+            int r = (packed >> 11) & 31, g = (packed >> 5) & 63, b = packed & 31;
+            color[0] = (r << 3) | (r >> 2);
+            color[1] = (g << 2) | (g >> 4);
+            color[2] = (b << 3) | (b >> 2);
+        }
+
+        // 16 RGBA8 texels in, 8 bytes out. Transparent texels use BC1's 3 colour mode unless fourColorOnly is set (BC3).
+        void encodeColorBlock(const unsigned char* texels, unsigned char* out, bool fourColorOnly) {
+            bool hasTransparent = false;
+            int minColor[3] = { 255, 255, 255 }, maxColor[3] = { 0, 0, 0 };
+            int opaqueCount = 0;
+
+            for (int i = 0; i < 16; i++) {
+                const auto* texel = &texels[i * 4];
+                if (!fourColorOnly && texel[3] < 128) {
+                    hasTransparent = true;
+                    continue;
+                }
+
+                opaqueCount++;
+                for (int c = 0; c < 3; c++) {
+                    minColor[c] = std::min(minColor[c], static_cast<int>(texel[c]));
+                    maxColor[c] = std::max(maxColor[c], static_cast<int>(texel[c]));
+                }
+            }
+
+            if (opaqueCount == 0) {
+                // Equal endpoints select 3 colour mode, index 3 is transparent black
+                std::memset(out, 0, 4);
+                std::memset(out + 4, 0xFF, 4);
+                return;
+            }
+
+            // Pick the bounding box diagonal that follows the colours' correlation
+            int center[3] = { (minColor[0] + maxColor[0]) / 2, (minColor[1] + maxColor[1]) / 2, (minColor[2] + maxColor[2]) / 2 };
+            int covarianceGreen = 0, covarianceBlue = 0;
+            for (int i = 0; i < 16; i++) {
+                const auto* texel = &texels[i * 4];
+                if (!fourColorOnly && texel[3] < 128) continue;
+
+                covarianceGreen += (texel[0] - center[0]) * (texel[1] - center[1]);
+                covarianceBlue += (texel[0] - center[0]) * (texel[2] - center[2]);
+            }
+
+            if (covarianceGreen < 0) std::swap(minColor[1], maxColor[1]);
+            if (covarianceBlue < 0) std::swap(minColor[2], maxColor[2]);
+
+            // Pull the endpoints in a little; the extremes are rarely the best fit for the interpolated colours
+            for (int c = 0; c < 3; c++) {
+                int inset = (maxColor[c] - minColor[c]) / 16;
+                maxColor[c] = std::clamp(maxColor[c] - inset, 0, 255);
+                minColor[c] = std::clamp(minColor[c] + inset, 0, 255);
+            }
+
+            uint16_t color0 = toRGB565(maxColor);
+            uint16_t color1 = toRGB565(minColor);
+
+            // BC1 decides the mode from the endpoint order: color0 > color1 is 4 colour, otherwise 3 colour + transparent
+            bool threeColorMode = hasTransparent;
+            if (threeColorMode ? color0 > color1 : color0 < color1) {
+                std::swap(color0, color1);
+            }
+
+            int palette[4][3];
+            fromRGB565(color0, palette[0]);
+            fromRGB565(color1, palette[1]);
+
+            for (int c = 0; c < 3; c++) {
+                if (threeColorMode) {
+                    palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+                    palette[3][c] = 0;
+                } else {
+                    palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+                    palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+                }
+            }
+
+            uint32_t indices = 0;
+            int paletteSize = threeColorMode ? 3 : 4;
+
+            for (int i = 0; i < 16; i++) {
+                const auto* texel = &texels[i * 4];
+                uint32_t best = 0;
+
+                if (threeColorMode && texel[3] < 128) {
+                    best = 3;
+                } else if (color0 != color1) {
+                    int bestDistance = INT32_MAX;
+                    for (int p = 0; p < paletteSize; p++) {
+                        int dr = texel[0] - palette[p][0], dg = texel[1] - palette[p][1], db = texel[2] - palette[p][2];
+                        int distance = dr * dr + dg * dg + db * db;
+                        if (distance < bestDistance) {
+                            bestDistance = distance;
+                            best = static_cast<uint32_t>(p);
+                        }
+                    }
+                }
+
+                indices |= best << (i * 2);
+            }
+
+            out[0] = static_cast<unsigned char>(color0 & 0xFF);
+            out[1] = static_cast<unsigned char>(color0 >> 8);
+            out[2] = static_cast<unsigned char>(color1 & 0xFF);
+            out[3] = static_cast<unsigned char>(color1 >> 8);
+            std::memcpy(out + 4, &indices, 4);
+        }
+
+        // One channel of 16 RGBA8 texels in, 8 bytes out. Used for BC3 alpha and both BC5 channels.
+        void encodeChannelBlock(const unsigned char* texels, int channel, unsigned char* out) {
+            int minValue = 255, maxValue = 0;
+            for (int i = 0; i < 16; i++) {
+                minValue = std::min(minValue, static_cast<int>(texels[i * 4 + channel]));
+                maxValue = std::max(maxValue, static_cast<int>(texels[i * 4 + channel]));
+            }
+
+            out[0] = static_cast<unsigned char>(maxValue);
+            out[1] = static_cast<unsigned char>(minValue);
+
+            uint64_t indices = 0;
+
+            if (maxValue != minValue) {
+                // 8 value mode; index 0 is max, 1 is min, 2-7 step from max towards min
+                int range = maxValue - minValue;
+                for (int i = 0; i < 16; i++) {
+                    int step = ((texels[i * 4 + channel] - minValue) * 7 + range / 2) / range;
+                    uint64_t index = step == 7 ? 0 : step == 0 ? 1 : static_cast<uint64_t>(8 - step);
+                    indices |= index << (i * 3);
+                }
+            }
+
+            for (int i = 0; i < 6; i++) {
+                out[2 + i] = static_cast<unsigned char>(indices >> (i * 8));
+            }
+        }
+
+        /*
+         * KTX2 WRITING
+         */
+        template <typename T>
+        void append(std::vector<unsigned char>& buffer, const T& value) {
+            auto* bytes = reinterpret_cast<const unsigned char*>(&value);
+            buffer.insert(buffer.end(), bytes, bytes + sizeof(T));
+        }
+
+        void alignTo(std::vector<unsigned char>& buffer, size_t alignment) {
+            buffer.resize((buffer.size() + alignment - 1) / alignment * alignment, 0);
+        }
+
+        // Khronos Data Format basic descriptor block, which KTX2 requires even though vkFormat already says it all
+        std::vector<unsigned char> buildDataFormatDescriptor(ColorType colorType) {
+            struct Sample {
+                uint32_t BitOffset;
+                uint32_t BitLength;
+                uint32_t Channel;
+                uint32_t Upper;
+            };
+
+            constexpr uint32_t ModelRGBSDA = 1, ModelBC1A = 128, ModelBC3 = 130, ModelBC5 = 132, ModelBC7 = 134;
+            constexpr uint32_t ChannelAlpha = 15, QualifierLinear = 0x10;
+
+            bool srgb = colorType == ColorType::UNSIGNED_CHAR4 || colorType == ColorType::BC1_SRGB ||
+                        colorType == ColorType::BC3_SRGB || colorType == ColorType::BC7_SRGB;
+
+            uint32_t model;
+            std::vector<Sample> samples {};
+
+            switch (colorType) {
+                case ColorType::BC1_UNORM:
+                case ColorType::BC1_SRGB:
+                    model = ModelBC1A;
+                    samples = {{ 0, 64, 1, UINT32_MAX }};
+                    break;
+                case ColorType::BC3_UNORM:
+                case ColorType::BC3_SRGB:
+                    model = ModelBC3;
+                    samples = {{ 0, 64, ChannelAlpha, UINT32_MAX }, { 64, 64, 0, UINT32_MAX }};
+                    break;
+                case ColorType::BC5_UNORM:
+                    model = ModelBC5;
+                    samples = {{ 0, 64, 0, UINT32_MAX }, { 64, 64, 1, UINT32_MAX }};
+                    break;
+                case ColorType::BC7_UNORM:
+                case ColorType::BC7_SRGB:
+                    model = ModelBC7;
+                    samples = {{ 0, 128, 0, UINT32_MAX }};
+                    break;
+                default:
+                    model = ModelRGBSDA;
+                    samples = {{ 0, 8, 0, 255 }, { 8, 8, 1, 255 }, { 16, 8, 2, 255 }, { 24, 8, ChannelAlpha | QualifierLinear, 255 }};
+                    break;
+            }
+
+            bool compressed = IsBlockCompressed(colorType);
+            auto blockSize = static_cast<uint32_t>(24 + 16 * samples.size());
+
+            std::vector<unsigned char> descriptor {};
+            append(descriptor, static_cast<uint32_t>(4 + blockSize));                       // dfdTotalSize
+            append(descriptor, static_cast<uint32_t>(0));                                   // vendor 0 (Khronos), basic descriptor type
+            append(descriptor, static_cast<uint32_t>(2 | (blockSize << 16)));               // version 1.3, block size
+            append(descriptor, static_cast<uint32_t>(model | (1 << 8) | ((srgb ? 2u : 1u) << 16)));  // BT.709 primaries, sRGB/linear transfer
+            append(descriptor, static_cast<uint32_t>(compressed ? 0x0303 : 0));             // texel block dimensions minus one
+            append(descriptor, GetColorTypeBlockSize(colorType));                           // bytes in plane 0
+            append(descriptor, static_cast<uint32_t>(0));                                   // planes 4-7
+
+            for (const auto& sample : samples) {
+                append(descriptor, static_cast<uint32_t>(sample.BitOffset | ((sample.BitLength - 1) << 16) | (sample.Channel << 24)));
+                append(descriptor, static_cast<uint32_t>(0));
+                append(descriptor, static_cast<uint32_t>(0));
+                append(descriptor, sample.Upper);
+            }
+
+            return descriptor;
+        }
+
+        void appendKeyValue(std::vector<unsigned char>& buffer, const std::string& key, const std::string& value) {
+            append(buffer, static_cast<uint32_t>(key.size() + 1 + value.size() + 1));
+            buffer.insert(buffer.end(), key.begin(), key.end());
+            buffer.push_back(0);
+            buffer.insert(buffer.end(), value.begin(), value.end());
+            buffer.push_back(0);
+            alignTo(buffer, 4);
+        }
+    }
+
+    bool TextureCooker::Cook(const Path& source, const Path& destination, const TextureCookSettings& settings) {
+        if (!CanEncode(settings.Format)) {
+            std::cout << "TextureCooker: no encoder for the requested format" << std::endl;
+            return false;
+        }
+
+        ImageData sourceImage(source, settings.FlipVertical);
+        if (!sourceImage.IsValid()) return false;
+
+        if (sourceImage.IsCompressed()) {
+            std::cout << "TextureCooker: " << source << " is already compressed" << std::endl;
+            return false;
+        }
+
+        auto encoded = Encode(sourceImage, settings);
+        if (!encoded.IsValid()) return false;
+
+        return WriteKTX2(encoded, destination);
+    }
+
+    ImageData TextureCooker::Encode(const ImageData& source, const TextureCookSettings& settings) {
+        // stb_image always hands back 4 channels, anything else didn't come from a source image
+        if (!CanEncode(settings.Format) || source.GetColorType() != ColorType::UNSIGNED_CHAR4) {
+            return { 0, 0, settings.Format, {}, {} };
+        }
+
+        auto [width, height] = source.GetSize();
+        bool srgb = settings.Format != ColorType::BC1_UNORM && settings.Format != ColorType::BC3_UNORM &&
+                    settings.Format != ColorType::BC5_UNORM;
+
+        std::vector<unsigned char> level(source.GetData(), source.GetData() + static_cast<size_t>(width) * height * 4);
+        uint32_t levelWidth = width, levelHeight = height;
+
+        std::vector<unsigned char> data {};
+        std::vector<ImageMipLevel> mipLevels {};
+
+        while (true) {
+            auto blocks = settings.Format == ColorType::UNSIGNED_CHAR4 ? level : EncodeBlocks(level.data(), levelWidth, levelHeight, settings.Format);
+
+            mipLevels.push_back({
+                .Width = levelWidth,
+                .Height = levelHeight,
+                .Offset = static_cast<uint32_t>(data.size()),
+                .Size = static_cast<uint32_t>(blocks.size())
+            });
+            data.insert(data.end(), blocks.begin(), blocks.end());
+
+            if (!settings.GenerateMipmaps || (levelWidth == 1 && levelHeight == 1)) break;
+
+            level = downsample(level, levelWidth, levelHeight, srgb);
+            levelWidth = std::max(levelWidth / 2, 1u);
+            levelHeight = std::max(levelHeight / 2, 1u);
+        }
+
+        return { width, height, settings.Format, std::move(data), std::move(mipLevels) };
+    }
+
+    bool TextureCooker::WriteKTX2(const ImageData& image, const Path& destination) {
+        auto format = KTX2::ColorTypeToFormat(image.GetColorType());
+        if (!format || !image.IsValid()) return false;
+
+        const auto& mipLevels = image.GetMipLevels();
+        auto [width, height] = image.GetSize();
+        auto levelCount = static_cast<uint32_t>(mipLevels.size());
+
+        auto dataFormatDescriptor = buildDataFormatDescriptor(image.GetColorType());
+
+        std::vector<unsigned char> keyValueData {};
+        appendKeyValue(keyValueData, "KTXwriter", "youtube_engine TextureCooker");
+
+        auto levelIndexOffset = sizeof(KTX2::Identifier) + sizeof(KTX2::Header);
+        auto dfdOffset = levelIndexOffset + levelCount * sizeof(KTX2::LevelIndex);
+        auto kvdOffset = dfdOffset + dataFormatDescriptor.size();
+
+        KTX2::Header header {
+            .VkFormat = *format,
+            .TypeSize = 1,
+            .PixelWidth = width,
+            .PixelHeight = height,
+            .PixelDepth = 0,
+            .LayerCount = 0,
+            .FaceCount = 1,
+            .LevelCount = levelCount,
+            .SupercompressionScheme = 0,
+            .DfdByteOffset = static_cast<uint32_t>(dfdOffset),
+            .DfdByteLength = static_cast<uint32_t>(dataFormatDescriptor.size()),
+            .KvdByteOffset = static_cast<uint32_t>(kvdOffset),
+            .KvdByteLength = static_cast<uint32_t>(keyValueData.size()),
+            .SgdByteOffset = 0,
+            .SgdByteLength = 0
+        };
+
+        std::vector<unsigned char> file {};
+        file.insert(file.end(), std::begin(KTX2::Identifier), std::end(KTX2::Identifier));
+        append(file, header);
+        file.resize(dfdOffset, 0);  // level index is filled in below
+        file.insert(file.end(), dataFormatDescriptor.begin(), dataFormatDescriptor.end());
+        file.insert(file.end(), keyValueData.begin(), keyValueData.end());
+
+        // Levels go smallest first so a streaming reader gets something to show early
+        auto levelAlignment = std::lcm<size_t>(GetColorTypeBlockSize(image.GetColorType()), 4);
+        std::vector<KTX2::LevelIndex> levelIndices(levelCount);
+
+        for (auto level = static_cast<int>(levelCount) - 1; level >= 0; level--) {
+            alignTo(file, levelAlignment);
+
+            const auto& mip = mipLevels[level];
+            levelIndices[level] = { file.size(), mip.Size, mip.Size };
+            file.insert(file.end(), image.GetData() + mip.Offset, image.GetData() + mip.Offset + mip.Size);
+        }
+
+        std::memcpy(file.data() + levelIndexOffset, levelIndices.data(), levelIndices.size() * sizeof(KTX2::LevelIndex));
+
+        std::ofstream output(destination, std::ios::binary | std::ios::trunc);
+        if (!output.is_open()) {
+            std::cout << "TextureCooker: failed to open " << destination << " for writing" << std::endl;
+            return false;
+        }
+
+        output.write(reinterpret_cast<const char*>(file.data()), static_cast<std::streamsize>(file.size()));
+        return static_cast<bool>(output);
+    }
+
+    std::vector<unsigned char> TextureCooker::EncodeBlocks(const unsigned char* rgba, uint32_t width, uint32_t height, ColorType format) {
+        if (!CanEncode(format) || !IsBlockCompressed(format)) return {};
+
+        uint32_t blocksWide = (width + 3) / 4;
+        uint32_t blocksHigh = (height + 3) / 4;
+        uint32_t blockSize = GetColorTypeBlockSize(format);
+
+        std::vector<unsigned char> result(static_cast<size_t>(blocksWide) * blocksHigh * blockSize);
+        unsigned char texels[16 * 4];
+
+        for (uint32_t blockY = 0; blockY < blocksHigh; blockY++) {
+            for (uint32_t blockX = 0; blockX < blocksWide; blockX++) {
+                // Edge blocks repeat the last row/column
+                for (uint32_t y = 0; y < 4; y++) {
+                    for (uint32_t x = 0; x < 4; x++) {
+                        auto sourceX = std::min(blockX * 4 + x, width - 1);
+                        auto sourceY = std::min(blockY * 4 + y, height - 1);
+                        std::memcpy(&texels[(y * 4 + x) * 4], &rgba[(static_cast<size_t>(sourceY) * width + sourceX) * 4], 4);
+                    }
+                }
+
+                auto* out = &result[(static_cast<size_t>(blockY) * blocksWide + blockX) * blockSize];
+
+                switch (format) {
+                    case ColorType::BC1_UNORM:
+                    case ColorType::BC1_SRGB:
+                        encodeColorBlock(texels, out, false);
+                        break;
+                    case ColorType::BC3_UNORM:
+                    case ColorType::BC3_SRGB:
+                        encodeChannelBlock(texels, 3, out);
+                        encodeColorBlock(texels, out + 8, true);
+                        break;
+                    case ColorType::BC5_UNORM:
+                        encodeChannelBlock(texels, 0, out);
+                        encodeChannelBlock(texels, 1, out + 8);
+                        break;
+                    default:
+                        break;
+                }
+            }
+        }
+
+        return result;
+    }
+
+    bool TextureCooker::CanEncode(ColorType format) {
+        switch (format) {
+            case ColorType::UNSIGNED_CHAR4:
+            case ColorType::BC1_UNORM:
+            case ColorType::BC1_SRGB:
+            case ColorType::BC3_UNORM:
+            case ColorType::BC3_SRGB:
+            case ColorType::BC5_UNORM:
+                return true;
+            default:
+                return false;
+        }
+    }
+}
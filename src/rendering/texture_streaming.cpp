@@ -0,0 +1,31 @@
+#include <youtube_engine/rendering/texture_streaming.h>
+
+#include <algorithm>
+#include <cmath>
+
+namespace OZZ {
+    TextureStreamingView TextureStreamingView::FromCamera(const glm::mat4& view, const glm::mat4& projection, float viewportHeight) {
+        return {
+            .CameraPosition = glm::vec3(glm::inverse(view)[3]),
+            .ProjectionScale = 0.5f * viewportHeight * std::abs(projection[1][1])
+        };
+    }
+
+    uint32_t ComputeDesiredMip(uint32_t textureSize, const SubmeshBounds& bounds, const glm::mat4& transform, const TextureStreamingView& view) {
+        float scale = std::max({ glm::length(glm::vec3(transform[0])), glm::length(glm::vec3(transform[1])), glm::length(glm::vec3(transform[2])) });
+        glm::vec3 center = transform * glm::vec4((bounds.Min + bounds.Max) * 0.5f, 1.f);
+        float radius = glm::length(bounds.Max - bounds.Min) * 0.5f * scale;
+
+        // Nearest point of the bounding sphere; inside it we want full detail
+        float distance = glm::length(center - view.CameraPosition) - radius;
+        if (distance <= 0.f) return 0;
+
+        float pixelsPerWorldUnit = view.ProjectionScale / distance;
+        float texelsPerWorldUnit = static_cast<float>(textureSize) / (bounds.WorldUnitsPerUV * scale);
+        float texelsPerPixel = texelsPerWorldUnit / pixelsPerWorldUnit;
+
+        if (texelsPerPixel <= 1.f) return 0;
+
+        return static_cast<uint32_t>(std::floor(std::log2(texelsPerPixel)));
+    }
+}
@@ -0,0 +1,245 @@
+#include "vulkan_bindless_textures.h"
+#include "vulkan_utilities.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace OZZ {
+    void VulkanBindlessTextures::Init(VkDevice device, VmaAllocator* allocator, uint32_t framesInFlight, uint32_t maxTextures) {
+        _device = device;
+        _allocator = allocator;
+        _maxTextures = std::min(maxTextures, MAX_TEXTURES);
+        _generation++;
+
+        VkDescriptorSetLayoutBinding bindings[] {
+                { 0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, _maxTextures, VK_SHADER_STAGE_FRAGMENT_BIT, nullptr },
+                { 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_FRAGMENT_BIT, nullptr }
+        };
+
+        // Slots nothing samples can be empty or stale, and loads can land while an older frame is still in flight
+        VkDescriptorBindingFlagsEXT bindingFlags[] {
+                VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT_EXT | VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT_EXT,
+                0
+        };
+
+        VkDescriptorSetLayoutBindingFlagsCreateInfoEXT bindingFlagsCreateInfo { VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO_EXT };
+        bindingFlagsCreateInfo.bindingCount = static_cast<uint32_t>(std::size(bindingFlags));
+        bindingFlagsCreateInfo.pBindingFlags = bindingFlags;
+
+        VkDescriptorSetLayoutCreateInfo setLayoutCreateInfo { VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO };
+        setLayoutCreateInfo.pNext = &bindingFlagsCreateInfo;
+        setLayoutCreateInfo.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT_EXT;
+        setLayoutCreateInfo.bindingCount = static_cast<uint32_t>(std::size(bindings));
+        setLayoutCreateInfo.pBindings = bindings;
+        VK_CHECK("VulkanBindlessTextures::Init()::vkCreateDescriptorSetLayout", vkCreateDescriptorSetLayout(_device, &setLayoutCreateInfo, nullptr, &_setLayout));
+
+        VkDescriptorPoolSize poolSizes[] {
+                { VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, _maxTextures * framesInFlight },
+                { VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, framesInFlight }
+        };
+
+        VkDescriptorPoolCreateInfo poolCreateInfo { VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO };
+        poolCreateInfo.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT_EXT;
+        poolCreateInfo.maxSets = framesInFlight;
+        poolCreateInfo.poolSizeCount = static_cast<uint32_t>(std::size(poolSizes));
+        poolCreateInfo.pPoolSizes = poolSizes;
+        VK_CHECK("VulkanBindlessTextures::Init()::vkCreateDescriptorPool", vkCreateDescriptorPool(_device, &poolCreateInfo, nullptr, &_descriptorPool));
+
+        _materialBuffer = std::make_unique<VulkanBuffer>(_allocator, sizeof(MaterialTextures) * MAX_MATERIALS,
+                                                         VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU);
+        VkDescriptorBufferInfo materialInfo { _materialBuffer->Buffer, 0, sizeof(MaterialTextures) * MAX_MATERIALS };
+
+        _frames.resize(framesInFlight);
+        for (auto& frame : _frames) {
+            VkDescriptorSetAllocateInfo allocateInfo { VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO };
+            allocateInfo.descriptorPool = _descriptorPool;
+            allocateInfo.descriptorSetCount = 1;
+            allocateInfo.pSetLayouts = &_setLayout;
+            VK_CHECK("VulkanBindlessTextures::Init()::vkAllocateDescriptorSets", vkAllocateDescriptorSets(_device, &allocateInfo, &frame.DescriptorSet));
+
+            auto materialWrite = VulkanUtilities::WriteDescriptorSetUniformBuffer(frame.DescriptorSet, 1, &materialInfo);
+            materialWrite.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+            vkUpdateDescriptorSets(_device, 1, &materialWrite, 0, nullptr);
+        }
+    }
+
+    void VulkanBindlessTextures::Shutdown() {
+        if (_device == VK_NULL_HANDLE) return;
+
+        std::lock_guard<std::mutex> lock(_mutex);
+
+        _frames.clear();
+        _materials.clear();
+        _textureMaterials.clear();
+        _materialBuffer = nullptr;
+
+        _nextMaterial = 0;
+        _freeMaterials.clear();
+        _retiredMaterials.clear();
+
+        _nextTexture = 0;
+        _freeTextures.clear();
+        _retiredTextures.clear();
+
+        if (_descriptorPool != VK_NULL_HANDLE) {
+            vkDestroyDescriptorPool(_device, _descriptorPool, nullptr);
+            _descriptorPool = VK_NULL_HANDLE;
+        }
+
+        vkDestroyDescriptorSetLayout(_device, _setLayout, nullptr);
+        _setLayout = VK_NULL_HANDLE;
+
+        _device = VK_NULL_HANDLE;
+    }
+
+    uint32_t VulkanBindlessTextures::AddTexture(VkImageView imageView, VkSampler sampler) {
+        if (!IsEnabled()) return INVALID_INDEX;
+
+        std::lock_guard<std::mutex> lock(_mutex);
+
+        uint32_t index { INVALID_INDEX };
+        if (!_freeTextures.empty()) {
+            index = _freeTextures.back();
+            _freeTextures.pop_back();
+        } else if (_nextTexture < _maxTextures) {
+            index = _nextTexture++;
+        } else {
+            return INVALID_INDEX;
+        }
+
+        queueWrite(index, { sampler, imageView, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL });
+        return index;
+    }
+
+    void VulkanBindlessTextures::UpdateTexture(uint32_t index, VkImageView imageView, VkSampler sampler) {
+        if (!IsEnabled() || index == INVALID_INDEX) return;
+
+        std::lock_guard<std::mutex> lock(_mutex);
+        queueWrite(index, { sampler, imageView, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL });
+    }
+
+    void VulkanBindlessTextures::RemoveTexture(uint32_t index) {
+        if (!IsEnabled() || index == INVALID_INDEX) return;
+
+        std::lock_guard<std::mutex> lock(_mutex);
+
+        // Its image is about to go away, so don't write it anywhere it hasn't been written yet
+        for (auto& frame : _frames) {
+            frame.PendingWrites.erase(index);
+        }
+
+        auto framesInFlight = static_cast<uint32_t>(_frames.size());
+        _retiredTextures.push_back({ index, framesInFlight });
+
+        // Entries sampling it would read whatever takes the slot next
+        auto materials = _textureMaterials.find(index);
+        if (materials == _textureMaterials.end()) return;
+
+        for (auto& textures : materials->second) {
+            auto material = _materials.find(textures);
+            if (material == _materials.end()) continue;
+
+            _retiredMaterials.push_back({ material->second, framesInFlight });
+            _materials.erase(material);
+
+            for (auto other : textures) {
+                if (other == index || other == INVALID_INDEX) continue;
+
+                if (auto otherMaterials = _textureMaterials.find(other); otherMaterials != _textureMaterials.end()) {
+                    std::erase(otherMaterials->second, textures);
+                }
+            }
+        }
+
+        _textureMaterials.erase(materials);
+    }
+
+    uint32_t VulkanBindlessTextures::GetMaterial(const MaterialTextures& textures) {
+        if (!IsEnabled()) return INVALID_INDEX;
+
+        std::lock_guard<std::mutex> lock(_mutex);
+
+        if (auto it = _materials.find(textures); it != _materials.end()) {
+            return it->second;
+        }
+
+        uint32_t index { INVALID_INDEX };
+        if (!_freeMaterials.empty()) {
+            index = _freeMaterials.back();
+            _freeMaterials.pop_back();
+        } else if (_nextMaterial < MAX_MATERIALS) {
+            index = _nextMaterial++;
+        } else {
+            return INVALID_INDEX;
+        }
+
+        void* data;
+        vmaMapMemory(*_allocator, _materialBuffer->Allocation, &data);
+        std::memcpy(static_cast<MaterialTextures*>(data) + index, textures.data(), sizeof(MaterialTextures));
+        vmaUnmapMemory(*_allocator, _materialBuffer->Allocation);
+
+        _materials[textures] = index;
+
+        for (auto texture : textures) {
+            if (texture == INVALID_INDEX) continue;
+
+            auto& materials = _textureMaterials[texture];
+            if (std::find(materials.begin(), materials.end(), textures) == materials.end()) {
+                materials.push_back(textures);
+            }
+        }
+
+        return index;
+    }
+
+    void VulkanBindlessTextures::BeginFrame(uint32_t frameIndex) {
+        if (!IsEnabled()) return;
+
+        std::lock_guard<std::mutex> lock(_mutex);
+        _currentFrame = frameIndex;
+
+        releaseRetiredSlots(_freeTextures, _retiredTextures);
+        releaseRetiredSlots(_freeMaterials, _retiredMaterials);
+    }
+
+    void VulkanBindlessTextures::Flush() {
+        if (!IsEnabled()) return;
+
+        std::lock_guard<std::mutex> lock(_mutex);
+
+        auto& frame = _frames[_currentFrame];
+        if (frame.PendingWrites.empty()) return;
+
+        std::vector<VkWriteDescriptorSet> writes {};
+        writes.reserve(frame.PendingWrites.size());
+
+        for (auto& [index, imageInfo] : frame.PendingWrites) {
+            auto write = VulkanUtilities::WriteDescriptorSetTexture(frame.DescriptorSet, 0, &imageInfo);
+            write.dstArrayElement = index;
+            writes.push_back(write);
+        }
+
+        vkUpdateDescriptorSets(_device, static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+        frame.PendingWrites.clear();
+    }
+
+    size_t VulkanBindlessTextures::MaterialTexturesHash::operator()(const MaterialTextures& textures) const {
+        return static_cast<size_t>(VulkanUtilities::HashBytes(textures.data(), sizeof(MaterialTextures)));
+    }
+
+    void VulkanBindlessTextures::releaseRetiredSlots(std::vector<uint32_t>& freeSlots, std::vector<RetiredSlot>& retiredSlots) {
+        // A slot is free once every frame that might still have read it has finished
+        std::erase_if(retiredSlots, [&freeSlots](RetiredSlot& slot) {
+            if (--slot.FramesLeft > 0) return false;
+
+            freeSlots.push_back(slot.Index);
+            return true;
+        });
+    }
+
+    void VulkanBindlessTextures::queueWrite(uint32_t index, VkDescriptorImageInfo imageInfo) {
+        for (auto& frame : _frames) {
+            frame.PendingWrites[index] = imageInfo;
+        }
+    }
+}
@@ -0,0 +1,114 @@
+#pragma once
+#include <glm/glm.hpp>
+
+#include <array>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "vulkan_includes.h"
+#include "vulkan_buffer.h"
+
+namespace OZZ {
+    // Matches the push constants of the bindless vertex shaders
+    struct BindlessDrawConstants {
+        glm::mat4 Model;
+        uint32_t MaterialIndex;
+    };
+
+    /*
+     * Every loaded texture in one partially bound array, plus a material table of texture indices beside it. Textures
+     * claim a slot when they're uploaded and give it back when destroyed, so drawing only has to push a material index
+     * instead of writing a descriptor per draw.
+     *
+     * Each frame in flight has its own copy of the set. Changes are queued for every copy and written into a frame's
+     * copy right before it records, when the GPU is known to be done with it.
+     */
+    class VulkanBindlessTextures {
+    public:
+        static constexpr uint32_t MAX_TEXTURES = 4096;
+        static constexpr uint32_t MAX_MATERIALS = 4096;
+        static constexpr uint32_t TEXTURES_PER_MATERIAL = 4;
+        static constexpr uint32_t INVALID_INDEX = UINT32_MAX;
+
+        using MaterialTextures = std::array<uint32_t, TEXTURES_PER_MATERIAL>;
+
+        // The texture count is clamped to what the device can bind
+        void Init(VkDevice device, VmaAllocator* allocator, uint32_t framesInFlight, uint32_t maxTextures);
+        void Shutdown();
+
+        [[nodiscard]] bool IsEnabled() const { return _setLayout != VK_NULL_HANDLE; }
+
+        // Bumped by every Init, since indices handed out before it aren't in the new array
+        [[nodiscard]] uint32_t GetGeneration() const { return _generation; }
+        [[nodiscard]] VkDescriptorSetLayout GetSetLayout() const { return _setLayout; }
+
+        uint32_t AddTexture(VkImageView imageView, VkSampler sampler);
+        void UpdateTexture(uint32_t index, VkImageView imageView, VkSampler sampler);
+
+        // The slot is only handed out again once every frame in flight has moved past it. Table entries using it go the
+        // same way.
+        void RemoveTexture(uint32_t index);
+
+        // The table entry holding these texture indices, added on first use. INVALID_INDEX once the table is full.
+        uint32_t GetMaterial(const MaterialTextures& textures);
+
+        // Call once the frame has been waited on
+        void BeginFrame(uint32_t frameIndex);
+
+        // Writes queued changes into this frame's set. Call before recording anything that reads it.
+        void Flush();
+
+        [[nodiscard]] VkDescriptorSet GetDescriptorSet() const { return _frames[_currentFrame].DescriptorSet; }
+
+    private:
+        struct FrameResources {
+            VkDescriptorSet DescriptorSet { VK_NULL_HANDLE };
+
+            // Latest image for each slot that changed since this copy was last written
+            std::unordered_map<uint32_t, VkDescriptorImageInfo> PendingWrites {};
+        };
+
+        struct RetiredSlot {
+            uint32_t Index;
+            uint32_t FramesLeft;
+        };
+
+        struct MaterialTexturesHash {
+            size_t operator()(const MaterialTextures& textures) const;
+        };
+
+        void queueWrite(uint32_t index, VkDescriptorImageInfo imageInfo);
+        static void releaseRetiredSlots(std::vector<uint32_t>& freeSlots, std::vector<RetiredSlot>& retiredSlots);
+
+    private:
+        VkDevice _device { VK_NULL_HANDLE };
+        VmaAllocator* _allocator { nullptr };
+        uint32_t _maxTextures { 0 };
+        uint32_t _generation { 0 };
+
+        VkDescriptorSetLayout _setLayout { VK_NULL_HANDLE };
+        VkDescriptorPool _descriptorPool { VK_NULL_HANDLE };
+
+        std::vector<FrameResources> _frames {};
+        uint32_t _currentFrame { 0 };
+
+        std::mutex _mutex;
+
+        uint32_t _nextTexture { 0 };
+        std::vector<uint32_t> _freeTextures {};
+        std::vector<RetiredSlot> _retiredTextures {};
+
+        // Entries are only rewritten once retired past every frame in flight, so those never see one change under them
+        std::unique_ptr<VulkanBuffer> _materialBuffer { nullptr };
+        std::unordered_map<MaterialTextures, uint32_t, MaterialTexturesHash> _materials {};
+
+        // The entries each texture slot is in, so they can be dropped with it
+        std::unordered_map<uint32_t, std::vector<MaterialTextures>> _textureMaterials {};
+
+        uint32_t _nextMaterial { 0 };
+        std::vector<uint32_t> _freeMaterials {};
+        std::vector<RetiredSlot> _retiredMaterials {};
+    };
+}
@@ -3,12 +3,14 @@
 //
 
 #include "vulkan_buffer.h"
+#include "vulkan_command_recorder.h"
 #include "vulkan_renderer.h"
 #include "vulkan_utilities.h"
 #include <cstring>
 
 namespace OZZ {
-    VulkanBuffer::VulkanBuffer(VmaAllocator* allocator, uint64_t bufferSize, VkBufferUsageFlags bufferUsage, VmaMemoryUsage vmaUsage) : _allocator(allocator){
+    VulkanBuffer::VulkanBuffer(VmaAllocator* allocator, uint64_t bufferSize, VkBufferUsageFlags bufferUsage, VmaMemoryUsage vmaUsage,
+                               VulkanDeletionQueue* deletionQueue) : _allocator(allocator), _deletionQueue(deletionQueue) {
         VkBufferCreateInfo bufferCreateInfo { VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO };
         bufferCreateInfo.size = bufferSize;
         bufferCreateInfo.usage = bufferUsage;
@@ -24,6 +26,13 @@ namespace OZZ {
     }
 
     VulkanBuffer::~VulkanBuffer() {
+        if (_deletionQueue) {
+            _deletionQueue->Retire([allocator = *_allocator, buffer = Buffer, allocation = Allocation]() {
+                vmaDestroyBuffer(allocator, buffer, allocation);
+            });
+            return;
+        }
+
         vmaDestroyBuffer(*_allocator, Buffer, Allocation);
     }
 
@@ -35,17 +44,16 @@ namespace OZZ {
         vmaUnmapMemory(*_allocator, Allocation);
     }
 
-    void VulkanBuffer::CopyBuffer(VkDevice* device, VkCommandPool* commandPool, VkQueue* queue,
-                                  VulkanBuffer *srcBuffer, VulkanBuffer *dstBuffer, VkDeviceSize size) {
+    void VulkanBuffer::CopyBuffer(VulkanRenderer* renderer, std::shared_ptr<VulkanBuffer> srcBuffer, VulkanBuffer *dstBuffer, VkDeviceSize size) {
         // Create the command buffer
         VkCommandBufferAllocateInfo allocateInfo { VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO };
         allocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-        allocateInfo.commandPool = *commandPool;
+        allocateInfo.commandPool = renderer->_bufferCommandPool;
 
         allocateInfo.commandBufferCount = 1;
 
         VkCommandBuffer commandBuffer;
-        vkAllocateCommandBuffers(*device, &allocateInfo, &commandBuffer);
+        vkAllocateCommandBuffers(renderer->_device, &allocateInfo, &commandBuffer);
 
         // Record the command buffer
         VkCommandBufferBeginInfo commandBufferBeginInfo { VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO };
@@ -59,17 +67,36 @@ namespace OZZ {
             .size = size
         };
 
+        // Frames submitted earlier may still be reading the old contents
+        VkMemoryBarrier barrier { VK_STRUCTURE_TYPE_MEMORY_BARRIER };
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+                             1, &barrier, 0, nullptr, 0, nullptr);
+
         vkCmdCopyBuffer(commandBuffer, srcBuffer->Buffer, dstBuffer->Buffer, 1, &copyRegion);
+
+        // Nobody waits for the copy, so make it visible to whatever draws with it next
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT;
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, 0,
+                             1, &barrier, 0, nullptr, 0, nullptr);
+
         vkEndCommandBuffer(commandBuffer);
 
         VkSubmitInfo submitInfo { VK_STRUCTURE_TYPE_SUBMIT_INFO };
         submitInfo.commandBufferCount = 1;
         submitInfo.pCommandBuffers = &commandBuffer;
 
-        vkQueueSubmit(*queue, 1, &submitInfo, VK_NULL_HANDLE);
-        vkQueueWaitIdle(*queue);
+        uint64_t copyValue { 0 };
+        VK_CHECK("VulkanBuffer::CopyBuffer()::vkQueueSubmit", renderer->_timeline.Submit(renderer->_graphicsQueue, submitInfo, copyValue));
+
+        renderer->_deletionQueue.Retire(copyValue, [device = renderer->_device, commandPool = renderer->_bufferCommandPool,
+                                                    commandBuffer, srcBuffer = std::move(srcBuffer)]() mutable {
+            vkFreeCommandBuffers(device, commandPool, 1, &commandBuffer);
+            srcBuffer.reset();
+        });
 
-        vkFreeCommandBuffers(*device, *commandPool, 1, &commandBuffer);
+        // Loading lots at once shouldn't hold on to every staging buffer until the next frame
+        renderer->_deletionQueue.Collect();
     }
 
     void VulkanBuffer::CopyBufferToImage(VkCommandBuffer cmd, VkImageLayout dstImageLayout, VulkanBuffer *srcBuffer, VkImage *dstImage, VkExtent3D imageExtent) {
@@ -102,7 +129,17 @@ namespace OZZ {
     }
 
     void VulkanVertexBuffer::UploadData(const vector<Vertex> &vertices) {
-        uint64_t newBufferSize { vertices.size() * sizeof(Vertex) };
+        uploadBytes(vertices.data(), vertices.size() * sizeof(Vertex), vertices.size());
+    }
+
+    void VulkanVertexBuffer::UploadPositions(const vector<glm::vec3> &positions) {
+        uploadBytes(positions.data(), positions.size() * sizeof(glm::vec3), positions.size());
+    }
+
+    void VulkanVertexBuffer::uploadBytes(const void* data, uint64_t size, uint64_t count) {
+        std::lock_guard<std::recursive_mutex> lock(_renderer->_resourceMutex);
+
+        uint64_t newBufferSize { size };
 
         // If the buffer size changed, we need to recreate it
         if (_bufferSize != newBufferSize) {
@@ -110,13 +147,13 @@ namespace OZZ {
             if (_buffer) _buffer.reset();
 
             _bufferSize = newBufferSize;
-            _count = static_cast<uint64_t>(vertices.size());
+            _count = count;
 
 
             _buffer = std::make_shared<VulkanBuffer>(
                     &_renderer->_allocator, _bufferSize,
                     VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
-                    VMA_MEMORY_USAGE_GPU_ONLY);
+                    VMA_MEMORY_USAGE_GPU_ONLY, &_renderer->_deletionQueue);
 
         }
 
@@ -124,10 +161,12 @@ namespace OZZ {
                 &_renderer->_allocator, _bufferSize,
                 VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
                 VMA_MEMORY_USAGE_CPU_ONLY);
-        stagingBuffer->UploadData((int*)vertices.data(), _bufferSize);
+        stagingBuffer->UploadData((int*)data, _bufferSize);
+
+        VulkanBuffer::CopyBuffer(_renderer, std::move(stagingBuffer), _buffer.get(), _bufferSize);
 
-        VulkanBuffer::CopyBuffer(&_renderer->_device, &_renderer->_bufferCommandPool, &_renderer->_graphicsQueue,
-                                 stagingBuffer.get(), _buffer.get(), _bufferSize);
+        _renderer->_frameStats.BufferUploadBytes += _bufferSize;
+        _renderer->_frameStats.QueueSubmits++;
     }
 
     void VulkanVertexBuffer::Bind(void* handle) {
@@ -137,6 +176,12 @@ namespace OZZ {
         }
     }
 
+    void VulkanVertexBuffer::Bind(VulkanCommandRecorder& recorder) {
+        if (_buffer) {
+            recorder.BindVertexBuffer(_buffer->Buffer);
+        }
+    }
+
 
     /*
      *
@@ -158,7 +203,15 @@ namespace OZZ {
         }
     }
 
+    void VulkanIndexBuffer::Bind(VulkanCommandRecorder& recorder) {
+        if (_buffer) {
+            recorder.BindIndexBuffer(_buffer->Buffer, 0, VK_INDEX_TYPE_UINT32);
+        }
+    }
+
     void VulkanIndexBuffer::UploadData(const vector<uint32_t> &indices) {
+        std::lock_guard<std::recursive_mutex> lock(_renderer->_resourceMutex);
+
         uint64_t newBufferSize { indices.size() * sizeof(uint32_t) };
 
         // If the buffer size changed, we need to recreate it
@@ -171,7 +224,7 @@ namespace OZZ {
             _buffer = std::make_shared<VulkanBuffer>(
                     &_renderer->_allocator, _bufferSize,
                     VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
-                    VMA_MEMORY_USAGE_GPU_ONLY);
+                    VMA_MEMORY_USAGE_GPU_ONLY, &_renderer->_deletionQueue);
         }
 
         auto stagingBuffer = std::make_shared<VulkanBuffer>(
@@ -180,8 +233,10 @@ namespace OZZ {
                 VMA_MEMORY_USAGE_CPU_ONLY);
         stagingBuffer->UploadData((int*)indices.data(), _bufferSize);
 
-        VulkanBuffer::CopyBuffer(&_renderer->_device, &_renderer->_bufferCommandPool, &_renderer->_graphicsQueue,
-                                 stagingBuffer.get(), _buffer.get(), _bufferSize);
+        VulkanBuffer::CopyBuffer(_renderer, std::move(stagingBuffer), _buffer.get(), _bufferSize);
+
+        _renderer->_frameStats.BufferUploadBytes += _bufferSize;
+        _renderer->_frameStats.QueueSubmits++;
     }
 
     /*
@@ -200,6 +255,8 @@ namespace OZZ {
     void VulkanUniformBuffer::Bind(void*) {}
 
     void VulkanUniformBuffer::UploadData(int* data, uint32_t size) {
+        std::lock_guard<std::recursive_mutex> lock(_renderer->_resourceMutex);
+
         // TODO: I might want to pad these myself at some point
 
         // If the buffer size changed, we need to recreate it
@@ -211,9 +268,10 @@ namespace OZZ {
             _buffer = std::make_shared<VulkanBuffer>(
                     &_renderer->_allocator, _bufferSize,
                     VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-                    VMA_MEMORY_USAGE_CPU_TO_GPU);
+                    VMA_MEMORY_USAGE_CPU_TO_GPU, &_renderer->_deletionQueue);
         }
 
         _buffer->UploadData(data, _bufferSize);
+        _renderer->_frameStats.BufferUploadBytes += _bufferSize;
     }
 }
@@ -10,9 +10,13 @@
 
 namespace OZZ {
     class VulkanRenderer;
+    class VulkanCommandRecorder;
+    class VulkanDeletionQueue;
 
     struct VulkanBuffer {
-        VulkanBuffer(VmaAllocator* allocator, uint64_t bufferSize, VkBufferUsageFlags bufferUsage, VmaMemoryUsage vmaUsage);
+        // With a deletion queue the buffer is retired instead of destroyed, for buffers frames in flight might still read
+        VulkanBuffer(VmaAllocator* allocator, uint64_t bufferSize, VkBufferUsageFlags bufferUsage, VmaMemoryUsage vmaUsage,
+                     VulkanDeletionQueue* deletionQueue = nullptr);
         ~VulkanBuffer();
 
         void UploadData(int* data, uint64_t bufferSize);
@@ -20,13 +24,15 @@ namespace OZZ {
         VkBuffer Buffer { nullptr };
         VmaAllocation Allocation { nullptr };
 
-        static void CopyBuffer(VkDevice* device, VkCommandPool* commandPool, VkQueue* queue,
-                               VulkanBuffer* srcBuffer, VulkanBuffer *dstBuffer, VkDeviceSize size);
+        // Doesn't wait for the copy. The staging buffer is kept until the GPU is done with it, and anything submitted
+        // afterwards sees the new contents.
+        static void CopyBuffer(VulkanRenderer* renderer, std::shared_ptr<VulkanBuffer> srcBuffer, VulkanBuffer *dstBuffer, VkDeviceSize size);
 
         static void CopyBufferToImage(VkCommandBuffer cmd, VkImageLayout dstImageLayout, VulkanBuffer* srcBuffer,
                                       VkImage* dstImage, VkExtent3D imageExtent);
     private:
         VmaAllocator* _allocator { nullptr };
+        VulkanDeletionQueue* _deletionQueue { nullptr };
     };
 
     class VulkanVertexBuffer : public VertexBuffer {
@@ -36,9 +42,14 @@ namespace OZZ {
 
 
         void UploadData(const std::vector<Vertex>& vertices) override;
+        void UploadPositions(const std::vector<glm::vec3>& positions) override;
         void Bind(void* handle) override;
+        void Bind(VulkanCommandRecorder& recorder);
         uint64_t GetCount() override { return _count; };
 
+    private:
+        void uploadBytes(const void* data, uint64_t size, uint64_t count);
+
     private:
         VulkanRenderer* _renderer;
 
@@ -53,6 +64,7 @@ namespace OZZ {
         explicit VulkanIndexBuffer(VulkanRenderer* renderer);
         ~VulkanIndexBuffer() override;
         void Bind(void* handle) override;
+        void Bind(VulkanCommandRecorder& recorder);
 
         void UploadData(const std::vector<uint32_t> &vector) override;
 
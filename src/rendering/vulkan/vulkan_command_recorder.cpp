@@ -0,0 +1,115 @@
+#include "vulkan_command_recorder.h"
+
+#include <cstring>
+
+namespace OZZ {
+    bool VulkanCommandRecorder::BindPipeline(VkPipeline pipeline) {
+        if (pipeline == _pipeline) {
+            _elided++;
+            return false;
+        }
+
+        vkCmdBindPipeline(_commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+        _pipeline = pipeline;
+        return true;
+    }
+
+    void VulkanCommandRecorder::BindDescriptorSet(VkPipelineLayout layout, uint32_t set, VkDescriptorSet descriptorSet) {
+        if (layout != _setLayout) {
+            _descriptorSets.fill(VK_NULL_HANDLE);
+            _setLayout = layout;
+        }
+
+        if (set < MAX_TRACKED_SETS) {
+            if (_descriptorSets[set] == descriptorSet) {
+                _elided++;
+                return;
+            }
+
+            _descriptorSets[set] = descriptorSet;
+        }
+
+        vkCmdBindDescriptorSets(_commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, layout, set, 1, &descriptorSet, 0, nullptr);
+    }
+
+    void VulkanCommandRecorder::BindVertexBuffer(VkBuffer buffer, VkDeviceSize offset) {
+        if (buffer == _vertexBuffer && offset == _vertexOffset) {
+            _elided++;
+            return;
+        }
+
+        vkCmdBindVertexBuffers(_commandBuffer, 0, 1, &buffer, &offset);
+        _vertexBuffer = buffer;
+        _vertexOffset = offset;
+    }
+
+    void VulkanCommandRecorder::BindIndexBuffer(VkBuffer buffer, VkDeviceSize offset, VkIndexType indexType) {
+        if (buffer == _indexBuffer && offset == _indexOffset && indexType == _indexType) {
+            _elided++;
+            return;
+        }
+
+        vkCmdBindIndexBuffer(_commandBuffer, buffer, offset, indexType);
+        _indexBuffer = buffer;
+        _indexOffset = offset;
+        _indexType = indexType;
+    }
+
+    void VulkanCommandRecorder::SetViewport(const VkViewport& viewport) {
+        if (_hasViewport && std::memcmp(&viewport, &_viewport, sizeof(VkViewport)) == 0) {
+            _elided++;
+            return;
+        }
+
+        vkCmdSetViewport(_commandBuffer, 0, 1, &viewport);
+        _viewport = viewport;
+        _hasViewport = true;
+    }
+
+    void VulkanCommandRecorder::SetScissor(const VkRect2D& scissor) {
+        if (_hasScissor && std::memcmp(&scissor, &_scissor, sizeof(VkRect2D)) == 0) {
+            _elided++;
+            return;
+        }
+
+        vkCmdSetScissor(_commandBuffer, 0, 1, &scissor);
+        _scissor = scissor;
+        _hasScissor = true;
+    }
+
+    void VulkanCommandRecorder::PushConstants(VkPipelineLayout layout, VkShaderStageFlags stages, uint32_t offset, uint32_t size, const void* data) {
+        // Only an exact repeat of the last push is dropped
+        if (layout == _pushConstantLayout && stages == _pushConstantStages && offset == _pushConstantOffset &&
+            size == _pushConstantSize && std::memcmp(data, _pushConstants.data(), size) == 0) {
+            _elided++;
+            return;
+        }
+
+        vkCmdPushConstants(_commandBuffer, layout, stages, offset, size, data);
+
+        if (size <= MAX_PUSH_CONSTANT_BYTES) {
+            _pushConstantLayout = layout;
+            _pushConstantStages = stages;
+            _pushConstantOffset = offset;
+            _pushConstantSize = size;
+            std::memcpy(_pushConstants.data(), data, size);
+        } else {
+            _pushConstantLayout = VK_NULL_HANDLE;
+        }
+    }
+
+    void VulkanCommandRecorder::Invalidate() {
+        _pipeline = VK_NULL_HANDLE;
+
+        _setLayout = VK_NULL_HANDLE;
+        _descriptorSets.fill(VK_NULL_HANDLE);
+
+        _vertexBuffer = VK_NULL_HANDLE;
+        _indexBuffer = VK_NULL_HANDLE;
+
+        _hasViewport = false;
+        _hasScissor = false;
+
+        _pushConstantLayout = VK_NULL_HANDLE;
+    }
+}
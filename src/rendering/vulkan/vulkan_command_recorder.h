@@ -0,0 +1,74 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include "vulkan_includes.h"
+
+namespace OZZ {
+    /*
+     * Wraps a command buffer while drawing and remembers what's bound: the graphics pipeline, descriptor sets, vertex
+     * and index buffers, viewport, scissor and push constants. Calls that would set what's already there are dropped
+     * and counted instead.
+     *
+     * It only knows about what went through it, so start a new one per command buffer, and call Invalidate after
+     * recording anything into the buffer directly that changes this state.
+     */
+    class VulkanCommandRecorder {
+    public:
+        static constexpr uint32_t MAX_TRACKED_SETS = 4;
+
+        explicit VulkanCommandRecorder(VkCommandBuffer commandBuffer) : _commandBuffer(commandBuffer) {}
+
+        [[nodiscard]] VkCommandBuffer GetCommandBuffer() const { return _commandBuffer; }
+
+        // Returns whether it was actually bound
+        bool BindPipeline(VkPipeline pipeline);
+
+        // Sets bound against a different layout are forgotten, even if the layouts are compatible
+        void BindDescriptorSet(VkPipelineLayout layout, uint32_t set, VkDescriptorSet descriptorSet);
+
+        void BindVertexBuffer(VkBuffer buffer, VkDeviceSize offset = 0);
+        void BindIndexBuffer(VkBuffer buffer, VkDeviceSize offset, VkIndexType indexType);
+
+        void SetViewport(const VkViewport& viewport);
+        void SetScissor(const VkRect2D& scissor);
+
+        void PushConstants(VkPipelineLayout layout, VkShaderStageFlags stages, uint32_t offset, uint32_t size, const void* data);
+
+        void Invalidate();
+
+        [[nodiscard]] uint32_t GetElidedCount() const { return _elided; }
+
+    private:
+        // The most any device has to support
+        static constexpr uint32_t MAX_PUSH_CONSTANT_BYTES = 128;
+
+        VkCommandBuffer _commandBuffer { VK_NULL_HANDLE };
+
+        VkPipeline _pipeline { VK_NULL_HANDLE };
+
+        VkPipelineLayout _setLayout { VK_NULL_HANDLE };
+        std::array<VkDescriptorSet, MAX_TRACKED_SETS> _descriptorSets {};
+
+        VkBuffer _vertexBuffer { VK_NULL_HANDLE };
+        VkDeviceSize _vertexOffset { 0 };
+
+        VkBuffer _indexBuffer { VK_NULL_HANDLE };
+        VkDeviceSize _indexOffset { 0 };
+        VkIndexType _indexType { VK_INDEX_TYPE_UINT32 };
+
+        bool _hasViewport { false };
+        VkViewport _viewport {};
+        bool _hasScissor { false };
+        VkRect2D _scissor {};
+
+        VkPipelineLayout _pushConstantLayout { VK_NULL_HANDLE };
+        VkShaderStageFlags _pushConstantStages { 0 };
+        uint32_t _pushConstantOffset { 0 };
+        uint32_t _pushConstantSize { 0 };
+        std::array<std::byte, MAX_PUSH_CONSTANT_BYTES> _pushConstants {};
+
+        uint32_t _elided { 0 };
+    };
+}
@@ -0,0 +1,65 @@
+#include "vulkan_deletion_queue.h"
+
+#include <algorithm>
+#include <vector>
+
+namespace OZZ {
+    void VulkanDeletionQueue::Init(VulkanTimeline* timeline) {
+        _timeline = timeline;
+    }
+
+    void VulkanDeletionQueue::Retire(std::function<void()>&& destroy) {
+        Retire(_timeline->GetSubmittedValue() + 1, std::move(destroy));
+    }
+
+    void VulkanDeletionQueue::Retire(uint64_t timelineValue, std::function<void()>&& destroy) {
+        std::lock_guard<std::mutex> lock(_mutex);
+
+        // A known submission can be older than what's already queued
+        auto position = std::upper_bound(_retired.begin(), _retired.end(), timelineValue, [](uint64_t value, const RetiredResource& resource) {
+            return value < resource.TimelineValue;
+        });
+
+        _retired.insert(position, { .TimelineValue = timelineValue, .Destroy = std::move(destroy) });
+    }
+
+    void VulkanDeletionQueue::Collect() {
+        std::vector<std::function<void()>> ready {};
+
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            if (_retired.empty()) return;
+
+            auto completedValue = _timeline->GetCompletedValue();
+            while (!_retired.empty() && _retired.front().TimelineValue <= completedValue) {
+                ready.push_back(std::move(_retired.front().Destroy));
+                _retired.pop_front();
+            }
+        }
+
+        // Destroyers may retire more, so they run outside of the lock
+        for (auto& destroy : ready) {
+            destroy();
+        }
+    }
+
+    void VulkanDeletionQueue::Flush() {
+        std::unique_lock<std::mutex> lock(_mutex);
+
+        while (!_retired.empty()) {
+            auto retired = std::move(_retired);
+            _retired.clear();
+
+            lock.unlock();
+            for (auto& resource : retired) {
+                resource.Destroy();
+            }
+            lock.lock();
+        }
+    }
+
+    size_t VulkanDeletionQueue::GetPendingCount() const {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return _retired.size();
+    }
+}
@@ -0,0 +1,49 @@
+#pragma once
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+
+#include "vulkan_timeline.h"
+
+namespace OZZ {
+    /*
+     * GPU objects that might still be in use are handed here instead of being destroyed. Each waits for a value on the
+     * renderer's timeline, by default the next submission, so it outlives every frame and upload that could have
+     * recorded it without anyone blocking on the GPU.
+     *
+     * Retiring is safe from any thread. Destroyers can touch externally synchronised objects like command pools, so
+     * Collect runs with the renderer's resource lock held.
+     */
+    class VulkanDeletionQueue {
+    public:
+        void Init(VulkanTimeline* timeline);
+
+        // Waits for the next submission, which is the earliest one that can't be recording a use of it anymore
+        void Retire(std::function<void()>&& destroy);
+
+        // For things only a known submission uses, like an upload's staging buffer
+        void Retire(uint64_t timelineValue, std::function<void()>&& destroy);
+
+        // Destroys whatever the GPU is done with
+        void Collect();
+
+        // Destroys everything. The device has to be idle.
+        void Flush();
+
+        [[nodiscard]] size_t GetPendingCount() const;
+
+    private:
+        struct RetiredResource {
+            uint64_t TimelineValue { 0 };
+            std::function<void()> Destroy {};
+        };
+
+        VulkanTimeline* _timeline { nullptr };
+
+        mutable std::mutex _mutex;
+
+        // Sorted by value, since values are only ever handed out in increasing order
+        std::deque<RetiredResource> _retired {};
+    };
+}
@@ -5,56 +5,81 @@
 #include "vulkan_descriptor_set_manager.h"
 #include "vulkan_utilities.h"
 
-namespace OZZ {
-    VulkanDescriptorSetManager::VulkanDescriptorSetManager(VkDevice* device) :
-            _device{device}, _descriptorCache(MAX_DESCRIPTOR_FRAMES), _descriptorPools(MAX_DESCRIPTOR_FRAMES) {
-
-        for (auto i = 0; i < MAX_DESCRIPTOR_FRAMES; i++) {
-            _descriptorCache.emplace_back();
-
-            VkDescriptorPoolCreateInfo descriptorPoolCreateInfo{VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO};
-            descriptorPoolCreateInfo.flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT;
-            descriptorPoolCreateInfo.maxSets = 2000;
-            descriptorPoolCreateInfo.poolSizeCount = static_cast<uint32_t>(POOL_SIZES.size());
-            descriptorPoolCreateInfo.pPoolSizes = POOL_SIZES.data();
+#include <algorithm>
+#include <bit>
 
-            VK_CHECK("VulkanDescriptorSetManager::Constructor", vkCreateDescriptorPool(*_device, &descriptorPoolCreateInfo, nullptr, &_descriptorPools[i]));
-        }
+namespace OZZ {
+    VulkanDescriptorSetManager::VulkanDescriptorSetManager(VkDevice* device, uint32_t framesInFlight) :
+            _descriptorFrameCount{framesInFlight + 1}, _device{device}, _descriptorFrames(_descriptorFrameCount) {
+        _descriptorFrames[_currentDescriptorFrame].Pools.push_back(acquirePool());
+        updateStats();
     }
 
     VkDescriptorSet VulkanDescriptorSetManager::GetDescriptorSet(VkDescriptorSetLayout layout) {
-        auto frameCache = _descriptorCache[_currentDescriptorFrame];
-        auto pipelineCache = frameCache[layout];
+        auto& frame = _descriptorFrames[_currentDescriptorFrame];
         VkDescriptorSet descriptorSet{VK_NULL_HANDLE};
 
         VkDescriptorSetAllocateInfo allocateInfo{VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO};
-        allocateInfo.descriptorPool = _descriptorPools[_currentDescriptorFrame];
+        allocateInfo.descriptorPool = frame.Pools.back().Handle;
         allocateInfo.descriptorSetCount = 1;
         allocateInfo.pSetLayouts = &layout;
-        VK_CHECK("VulkanDescriptorSetManager::GetDescriptorSet", vkAllocateDescriptorSets(*_device, &allocateInfo, &descriptorSet));
 
-        pipelineCache.push_back(descriptorSet);
+        auto result = vkAllocateDescriptorSets(*_device, &allocateInfo, &descriptorSet);
 
+        // Out of sets or descriptors, chain on another pool. A fresh pool can always fit one set.
+        if (result == VK_ERROR_OUT_OF_POOL_MEMORY || result == VK_ERROR_FRAGMENTED_POOL) {
+            frame.Pools.push_back(acquirePool());
+            allocateInfo.descriptorPool = frame.Pools.back().Handle;
+            result = vkAllocateDescriptorSets(*_device, &allocateInfo, &descriptorSet);
+        }
+
+        VK_CHECK("VulkanDescriptorSetManager::GetDescriptorSet", result);
+
+        frame.SetsAllocated++;
+        _stats.PeakSetsPerFrame = std::max(_stats.PeakSetsPerFrame, frame.SetsAllocated);
+        _stats.PeakPoolsPerFrame = std::max(_stats.PeakPoolsPerFrame, static_cast<uint32_t>(frame.Pools.size()));
 
         return descriptorSet;
     }
 
     void VulkanDescriptorSetManager::NextDescriptorFrame() {
+        // Size new pools so the busiest frame so far would have fit in one
+        if (_stats.PeakSetsPerFrame > _setsPerPool) {
+            _setsPerPool = std::min(std::bit_ceil(_stats.PeakSetsPerFrame), MAX_SETS_PER_POOL);
+        }
+
         _currentDescriptorFrame++;
 
-        if (_currentDescriptorFrame >= MAX_DESCRIPTOR_FRAMES) {
+        if (_currentDescriptorFrame >= _descriptorFrameCount) {
             _currentDescriptorFrame = 0;
         }
 
         auto nextDescriptorFrame = _currentDescriptorFrame + 1;
 
-        if (nextDescriptorFrame >= MAX_DESCRIPTOR_FRAMES) {
+        if (nextDescriptorFrame >= _descriptorFrameCount) {
             nextDescriptorFrame = 0;
         }
 
         // We assume that by the time we get back around the descriptor pools; they won't be in flight anymore.
-        vkResetDescriptorPool(*_device, _descriptorPools[nextDescriptorFrame], 0);
-        _descriptorCache[nextDescriptorFrame].clear();
+        auto& retiringFrame = _descriptorFrames[nextDescriptorFrame];
+        for (auto& pool : retiringFrame.Pools) {
+            recyclePool(pool);
+        }
+        retiringFrame.Pools.clear();
+        retiringFrame.SetsAllocated = 0;
+
+        // Anything left over after a spike beyond one pool per frame isn't worth holding on to
+        while (_freePools.size() > _descriptorFrameCount) {
+            vkDestroyDescriptorPool(*_device, _freePools.back().Handle, nullptr);
+            _freePools.pop_back();
+        }
+
+        auto& frame = _descriptorFrames[_currentDescriptorFrame];
+        if (frame.Pools.empty()) {
+            frame.Pools.push_back(acquirePool());
+        }
+
+        updateStats();
     }
 
     VulkanDescriptorSetManager::~VulkanDescriptorSetManager() {
@@ -62,12 +87,64 @@ namespace OZZ {
     }
 
     void VulkanDescriptorSetManager::Shutdown() {
-        for (auto &descriptorPool : _descriptorPools) {
-            vkResetDescriptorPool(*_device, descriptorPool, 0);
-            vkDestroyDescriptorPool(*_device, descriptorPool, nullptr);
+        for (auto& frame : _descriptorFrames) {
+            for (auto& pool : frame.Pools) {
+                vkDestroyDescriptorPool(*_device, pool.Handle, nullptr);
+            }
+        }
+
+        for (auto& pool : _freePools) {
+            vkDestroyDescriptorPool(*_device, pool.Handle, nullptr);
+        }
+
+        _descriptorFrames.clear();
+        _freePools.clear();
+        _setsPerPool = INITIAL_SETS_PER_POOL;
+        _stats = {};
+    }
+
+    VulkanDescriptorSetManager::DescriptorPool VulkanDescriptorSetManager::acquirePool() {
+        if (!_freePools.empty()) {
+            auto pool = _freePools.back();
+            _freePools.pop_back();
+            return pool;
+        }
+
+        std::array<VkDescriptorPoolSize, POOL_RATIOS.size()> poolSizes {};
+        for (size_t i = 0; i < POOL_RATIOS.size(); i++) {
+            auto [type, ratio] = POOL_RATIOS[i];
+            poolSizes[i] = { type, std::max(static_cast<uint32_t>(static_cast<float>(_setsPerPool) * ratio), 1u) };
+        }
+
+        VkDescriptorPoolCreateInfo descriptorPoolCreateInfo{VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO};
+        descriptorPoolCreateInfo.maxSets = _setsPerPool;
+        descriptorPoolCreateInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+        descriptorPoolCreateInfo.pPoolSizes = poolSizes.data();
+
+        DescriptorPool pool { .MaxSets = _setsPerPool };
+        VK_CHECK("VulkanDescriptorSetManager::acquirePool()::vkCreateDescriptorPool", vkCreateDescriptorPool(*_device, &descriptorPoolCreateInfo, nullptr, &pool.Handle));
+
+        return pool;
+    }
+
+    void VulkanDescriptorSetManager::recyclePool(const DescriptorPool& pool) {
+        // Pools from before the size last grew are replaced as they come back
+        if (pool.MaxSets < _setsPerPool) {
+            vkDestroyDescriptorPool(*_device, pool.Handle, nullptr);
+            return;
+        }
+
+        vkResetDescriptorPool(*_device, pool.Handle, 0);
+        _freePools.push_back(pool);
+    }
+
+    void VulkanDescriptorSetManager::updateStats() {
+        uint32_t pools = static_cast<uint32_t>(_freePools.size());
+        for (auto& frame : _descriptorFrames) {
+            pools += static_cast<uint32_t>(frame.Pools.size());
         }
 
-        _descriptorCache.clear();
-        _descriptorPools.clear();
+        _stats.Pools = pools;
+        _stats.SetsPerPool = _setsPerPool;
     }
-}
\ No newline at end of file
+}
@@ -6,35 +6,78 @@
 
 #include "vulkan_includes.h"
 
-#include <unordered_map>
 #include <vector>
 #include <array>
+#include <utility>
 
 namespace OZZ {
+    /*
+     * Hands out descriptor sets that live for one frame. Each frame allocates from its own chain of pools, and another
+     * pool is chained on whenever one runs out. Once the frame is no longer in flight its pools are reset and go back on
+     * the free list for whichever frame needs them next.
+     *
+     * Pools start small and grow to fit the busiest frame seen so far, so a small scene holds on to little and a large
+     * one settles on a single pool per frame.
+     */
     class VulkanDescriptorSetManager {
     public:
+        struct Stats {
+            // Pools held, whether in use by a frame or free
+            uint32_t Pools { 0 };
+            uint32_t SetsPerPool { 0 };
+
+            // Highest counts any one frame has reached
+            uint32_t PeakSetsPerFrame { 0 };
+            uint32_t PeakPoolsPerFrame { 0 };
+        };
+
         VulkanDescriptorSetManager() = default;
-        explicit VulkanDescriptorSetManager(VkDevice* device);
+        // Keeps one more frame of pools than there are frames in flight, so the pools being reset are never ones the GPU is reading
+        VulkanDescriptorSetManager(VkDevice* device, uint32_t framesInFlight);
 
         ~VulkanDescriptorSetManager();
 
         VkDescriptorSet GetDescriptorSet(VkDescriptorSetLayout layout);
         void NextDescriptorFrame();
 
+        [[nodiscard]] Stats GetStats() const { return _stats; }
+
         void Shutdown();
     private:
-        static constexpr std::array<VkDescriptorPoolSize, 2> POOL_SIZES {
-                VkDescriptorPoolSize{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1000 },
-                VkDescriptorPoolSize{ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1000 }
+        struct DescriptorPool {
+            VkDescriptorPool Handle { VK_NULL_HANDLE };
+            uint32_t MaxSets { 0 };
+        };
+
+        struct DescriptorFrame {
+            // The last one is being allocated from, the others have run out
+            std::vector<DescriptorPool> Pools {};
+            uint32_t SetsAllocated { 0 };
         };
 
-        static constexpr uint8_t MAX_DESCRIPTOR_FRAMES = 3;
+        static constexpr uint32_t INITIAL_SETS_PER_POOL = 128;
+        static constexpr uint32_t MAX_SETS_PER_POOL = 4096;
 
-        uint8_t _currentDescriptorFrame { 0 };
+        // Descriptors of each type per set. Sets that need more than this just move on to the next pool sooner.
+        static constexpr std::array<std::pair<VkDescriptorType, float>, 3> POOL_RATIOS {
+                std::pair{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1.f },
+                std::pair{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 0.5f },
+                std::pair{ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1.f }
+        };
+
+        DescriptorPool acquirePool();
+        void recyclePool(const DescriptorPool& pool);
+        void updateStats();
+
+        uint32_t _descriptorFrameCount { 0 };
+        uint32_t _currentDescriptorFrame { 0 };
         VkDevice* _device { VK_NULL_HANDLE };
-        std::vector<VkDescriptorPool> _descriptorPools;
-        std::vector<std::unordered_map<VkDescriptorSetLayout, std::vector<VkDescriptorSet>>> _descriptorCache;
+
+        uint32_t _setsPerPool { INITIAL_SETS_PER_POOL };
+        std::vector<DescriptorFrame> _descriptorFrames;
+        std::vector<DescriptorPool> _freePools;
+
+        Stats _stats {};
     };
 
 }
-
@@ -0,0 +1,253 @@
+#include "vulkan_gpu_profiler.h"
+#include "vulkan_utilities.h"
+
+#include <iostream>
+
+namespace OZZ {
+    // Two per scope, so 256 scopes a frame
+    constexpr uint32_t PROFILER_MAX_TIMESTAMPS = 512;
+
+    // One per pass
+    constexpr uint32_t PROFILER_MAX_STATISTICS = 16;
+
+    // Must stay in bit order, that's the order the results come back in
+    constexpr VkQueryPipelineStatisticFlags PROFILER_STATISTICS_FLAGS =
+            VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_VERTICES_BIT |
+            VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_PRIMITIVES_BIT |
+            VK_QUERY_PIPELINE_STATISTIC_VERTEX_SHADER_INVOCATIONS_BIT |
+            VK_QUERY_PIPELINE_STATISTIC_CLIPPING_INVOCATIONS_BIT |
+            VK_QUERY_PIPELINE_STATISTIC_CLIPPING_PRIMITIVES_BIT |
+            VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT;
+    constexpr uint32_t PROFILER_STATISTICS_COUNT = 6;
+
+    void VulkanGpuProfiler::Init(VkPhysicalDevice physicalDevice, VkDevice device, uint32_t queueFamily,
+                                 const VkPhysicalDeviceFeatures& enabledFeatures, uint32_t framesInFlight) {
+        _device = device;
+
+        VkPhysicalDeviceProperties properties {};
+        vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+
+        uint32_t queueFamilyCount { 0 };
+        vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, nullptr);
+        std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+        vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, queueFamilies.data());
+
+        auto validBits = queueFamily < queueFamilyCount ? queueFamilies[queueFamily].timestampValidBits : 0;
+
+        _timestampsSupported = validBits > 0 && properties.limits.timestampPeriod > 0.f;
+        _statisticsSupported = enabledFeatures.pipelineStatisticsQuery;
+        _timestampPeriod = properties.limits.timestampPeriod;
+        _timestampMask = validBits >= 64 ? ~0ull : (1ull << validBits) - 1;
+
+        if (!_timestampsSupported) {
+            std::cout << "GPU timestamps aren't supported on the graphics queue, GPU profiling is unavailable." << std::endl;
+            return;
+        }
+
+        // VR frames aren't fenced, so keep one extra frame of queries around
+        _frames.resize(framesInFlight + 1);
+
+        for (auto& frame : _frames) {
+            VkQueryPoolCreateInfo timestampInfo {
+                .sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+                .queryType = VK_QUERY_TYPE_TIMESTAMP,
+                .queryCount = PROFILER_MAX_TIMESTAMPS
+            };
+
+            VK_CHECK("VulkanGpuProfiler::Init::vkCreateQueryPool", vkCreateQueryPool(_device, &timestampInfo, nullptr, &frame.Timestamps));
+
+            if (_statisticsSupported) {
+                VkQueryPoolCreateInfo statisticsInfo {
+                    .sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+                    .queryType = VK_QUERY_TYPE_PIPELINE_STATISTICS,
+                    .queryCount = PROFILER_MAX_STATISTICS,
+                    .pipelineStatistics = PROFILER_STATISTICS_FLAGS
+                };
+
+                VK_CHECK("VulkanGpuProfiler::Init::vkCreateQueryPool", vkCreateQueryPool(_device, &statisticsInfo, nullptr, &frame.Statistics));
+            }
+        }
+
+        _currentFrame = 0;
+    }
+
+    void VulkanGpuProfiler::Shutdown() {
+        for (auto& frame : _frames) {
+            if (frame.Timestamps) {
+                vkDestroyQueryPool(_device, frame.Timestamps, nullptr);
+            }
+
+            if (frame.Statistics) {
+                vkDestroyQueryPool(_device, frame.Statistics, nullptr);
+            }
+        }
+
+        _frames.clear();
+        _frameEnabled = false;
+        _device = VK_NULL_HANDLE;
+    }
+
+    void VulkanGpuProfiler::BeginFrame() {
+        if (_frames.empty()) {
+            _frameEnabled = false;
+            return;
+        }
+
+        auto frameCount = static_cast<uint32_t>(_frames.size());
+
+        // Oldest first, so the latest timings end up being the newest finished frame
+        for (uint32_t i = 1; i <= frameCount; i++) {
+            auto& frame = _frames[(_currentFrame + i) % frameCount];
+
+            if (frame.Pending && collect(frame)) {
+                frame.Pending = false;
+            }
+        }
+
+        _currentFrame = (_currentFrame + 1) % frameCount;
+
+        // If it still hasn't finished, the GPU is far enough behind that this frame's results are dropped
+        auto& frame = getCurrentFrame();
+        frame.Scopes.clear();
+        frame.OpenScopes.clear();
+        frame.TimestampCount = 0;
+        frame.StatisticsCount = 0;
+        frame.StatisticsActive = false;
+        frame.Reset = false;
+
+        _frameEnabled = _settings.Enabled;
+        frame.Pending = _frameEnabled;
+        frame.FrameNumber = _frameNumber++;
+    }
+
+    void VulkanGpuProfiler::ResetQueries(VkCommandBuffer commandBuffer) {
+        if (!_frameEnabled) return;
+
+        auto& frame = getCurrentFrame();
+        if (frame.Reset) return;
+
+        vkCmdResetQueryPool(commandBuffer, frame.Timestamps, 0, PROFILER_MAX_TIMESTAMPS);
+
+        if (frame.Statistics) {
+            vkCmdResetQueryPool(commandBuffer, frame.Statistics, 0, PROFILER_MAX_STATISTICS);
+        }
+
+        frame.Reset = true;
+    }
+
+    void VulkanGpuProfiler::BeginScope(VkCommandBuffer commandBuffer, std::string_view name, bool withStatistics) {
+        if (!_frameEnabled) return;
+
+        auto& frame = getCurrentFrame();
+        if (!frame.Reset) return;
+
+        // Out of queries; still track it so EndScope pairs up
+        if (frame.TimestampCount + 2 > PROFILER_MAX_TIMESTAMPS) {
+            frame.OpenScopes.push_back(UINT32_MAX);
+            return;
+        }
+
+        Scope scope {
+            .Name = std::string(name),
+            .Depth = static_cast<uint32_t>(frame.OpenScopes.size()),
+            .BeginQuery = frame.TimestampCount,
+            .EndQuery = frame.TimestampCount + 1
+        };
+
+        frame.TimestampCount += 2;
+
+        vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, frame.Timestamps, scope.BeginQuery);
+
+        if (withStatistics && _settings.PipelineStatistics && frame.Statistics && !frame.StatisticsActive &&
+            frame.StatisticsCount < PROFILER_MAX_STATISTICS) {
+            scope.StatisticsQuery = frame.StatisticsCount++;
+            vkCmdBeginQuery(commandBuffer, frame.Statistics, scope.StatisticsQuery, 0);
+            frame.StatisticsActive = true;
+        }
+
+        frame.OpenScopes.push_back(static_cast<uint32_t>(frame.Scopes.size()));
+        frame.Scopes.push_back(std::move(scope));
+    }
+
+    void VulkanGpuProfiler::EndScope(VkCommandBuffer commandBuffer) {
+        if (!_frameEnabled) return;
+
+        auto& frame = getCurrentFrame();
+        if (frame.OpenScopes.empty()) return;
+
+        auto scopeIndex = frame.OpenScopes.back();
+        frame.OpenScopes.pop_back();
+
+        if (scopeIndex == UINT32_MAX) return;
+
+        auto& scope = frame.Scopes[scopeIndex];
+
+        if (scope.StatisticsQuery != UINT32_MAX) {
+            vkCmdEndQuery(commandBuffer, frame.Statistics, scope.StatisticsQuery);
+            frame.StatisticsActive = false;
+        }
+
+        vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, frame.Timestamps, scope.EndQuery);
+        scope.Closed = true;
+    }
+
+    bool VulkanGpuProfiler::collect(FrameQueries& frame) {
+        if (frame.TimestampCount == 0) return true;
+
+        // Each result is followed by its availability, so scopes that were never closed don't hold up the rest
+        std::vector<uint64_t> timestamps(frame.TimestampCount * 2);
+        auto result = vkGetQueryPoolResults(_device, frame.Timestamps, 0, frame.TimestampCount,
+                                            timestamps.size() * sizeof(uint64_t), timestamps.data(), 2 * sizeof(uint64_t),
+                                            VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+
+        if (result != VK_SUCCESS && result != VK_NOT_READY) return true;
+
+        constexpr uint32_t statisticsStride = PROFILER_STATISTICS_COUNT + 1;
+        std::vector<uint64_t> statistics(frame.StatisticsCount * statisticsStride);
+
+        if (frame.StatisticsCount > 0) {
+            result = vkGetQueryPoolResults(_device, frame.Statistics, 0, frame.StatisticsCount,
+                                           statistics.size() * sizeof(uint64_t), statistics.data(), statisticsStride * sizeof(uint64_t),
+                                           VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+
+            if (result != VK_SUCCESS && result != VK_NOT_READY) return true;
+        }
+
+        auto timestampAvailable = [&](uint32_t query) { return timestamps[query * 2 + 1] != 0; };
+
+        GpuFrameTimings timings { .FrameNumber = frame.FrameNumber };
+
+        for (auto& scope : frame.Scopes) {
+            if (!scope.Closed) continue;
+
+            if (!timestampAvailable(scope.BeginQuery) || !timestampAvailable(scope.EndQuery)) return false;
+
+            auto ticks = (timestamps[scope.EndQuery * 2] - timestamps[scope.BeginQuery * 2]) & _timestampMask;
+
+            GpuScopeTiming timing {
+                .Name = scope.Name,
+                .Depth = scope.Depth,
+                .Milliseconds = static_cast<double>(ticks) * _timestampPeriod / 1'000'000.0
+            };
+
+            if (scope.StatisticsQuery != UINT32_MAX) {
+                const auto* values = &statistics[scope.StatisticsQuery * statisticsStride];
+                if (values[PROFILER_STATISTICS_COUNT] == 0) return false;
+
+                timing.Statistics = GpuPipelineStatistics {
+                    .InputAssemblyVertices = values[0],
+                    .InputAssemblyPrimitives = values[1],
+                    .VertexShaderInvocations = values[2],
+                    .ClippingInvocations = values[3],
+                    .ClippingPrimitives = values[4],
+                    .FragmentShaderInvocations = values[5]
+                };
+            }
+
+            timings.Scopes.push_back(std::move(timing));
+        }
+
+        _latestTimings = std::move(timings);
+        return true;
+    }
+}
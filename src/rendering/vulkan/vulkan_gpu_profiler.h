@@ -0,0 +1,90 @@
+#pragma once
+#include <youtube_engine/rendering/gpu_profiling.h>
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "vulkan_includes.h"
+
+namespace OZZ {
+    /*
+     * Timestamp and pipeline statistics queries around passes and named scopes. Every frame records into its own pair
+     * of query pools; results are read back without stalling once the GPU has finished with them.
+     *
+     * A frame can span several command buffers (one per eye in VR) as long as they're submitted in recording order
+     * and the first one calls ResetQueries.
+     */
+    class VulkanGpuProfiler {
+    public:
+        void Init(VkPhysicalDevice physicalDevice, VkDevice device, uint32_t queueFamily, const VkPhysicalDeviceFeatures& enabledFeatures,
+                  uint32_t framesInFlight);
+        void Shutdown();
+
+        void SetSettings(const GpuProfilingSettings& settings) { _settings = settings; }
+        [[nodiscard]] const GpuProfilingSettings& GetSettings() const { return _settings; }
+
+        [[nodiscard]] bool IsEnabled() const { return _frameEnabled; }
+        [[nodiscard]] bool IsMaterialScopesEnabled() const { return _frameEnabled && _settings.MaterialScopes; }
+
+        // Collects any finished frames, then starts a new one with the current settings
+        void BeginFrame();
+
+        // Has to be recorded outside of a render pass before the frame's first scope. Later calls in the frame do nothing.
+        void ResetQueries(VkCommandBuffer commandBuffer);
+
+        // Statistics queries can't nest, so only ask for them on passes
+        void BeginScope(VkCommandBuffer commandBuffer, std::string_view name, bool withStatistics = false);
+        void EndScope(VkCommandBuffer commandBuffer);
+
+        [[nodiscard]] const GpuFrameTimings& GetLatestTimings() const { return _latestTimings; }
+
+    private:
+        struct Scope {
+            std::string Name;
+            uint32_t Depth { 0 };
+            uint32_t BeginQuery { 0 };
+            uint32_t EndQuery { UINT32_MAX };
+            uint32_t StatisticsQuery { UINT32_MAX };
+            bool Closed { false };
+        };
+
+        struct FrameQueries {
+            VkQueryPool Timestamps { VK_NULL_HANDLE };
+            VkQueryPool Statistics { VK_NULL_HANDLE };
+
+            uint64_t FrameNumber { 0 };
+            bool Pending { false };
+            bool Reset { false };
+
+            uint32_t TimestampCount { 0 };
+            uint32_t StatisticsCount { 0 };
+
+            std::vector<Scope> Scopes {};
+            std::vector<uint32_t> OpenScopes {};
+            bool StatisticsActive { false };
+        };
+
+        // Returns false if the GPU hasn't finished the frame yet
+        bool collect(FrameQueries& frame);
+
+        FrameQueries& getCurrentFrame() { return _frames[_currentFrame]; }
+
+    private:
+        VkDevice _device { VK_NULL_HANDLE };
+
+        bool _timestampsSupported { false };
+        bool _statisticsSupported { false };
+        float _timestampPeriod { 1.f };
+        uint64_t _timestampMask { ~0ull };
+
+        GpuProfilingSettings _settings {};
+        bool _frameEnabled { false };
+
+        std::vector<FrameQueries> _frames {};
+        uint32_t _currentFrame { 0 };
+        uint64_t _frameNumber { 0 };
+
+        GpuFrameTimings _latestTimings {};
+    };
+}
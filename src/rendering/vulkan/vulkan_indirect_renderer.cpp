@@ -0,0 +1,413 @@
+#include "vulkan_indirect_renderer.h"
+#include "vulkan_shader.h"
+#include "vulkan_utilities.h"
+
+#include <youtube_engine/core/profiler.h>
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <iostream>
+#include <unordered_map>
+
+namespace OZZ {
+    constexpr uint32_t INSTANCE_CULL_GROUP_SIZE = 64;
+    constexpr uint32_t INSTANCE_MIN_CAPACITY = 256;
+    constexpr uint32_t BATCH_MIN_CAPACITY = 32;
+
+    // Marks a submesh that stays on the per object path
+    constexpr uint32_t NOT_BATCHED = ~0u;
+
+    void VulkanIndirectRenderer::Init(VkDevice device, VmaAllocator* allocator, VkPipelineCache pipelineCache, uint32_t framesInFlight) {
+        _device = device;
+        _allocator = allocator;
+
+        _frames.resize(framesInFlight);
+        createPipeline(pipelineCache);
+
+        if (!IsAvailable()) return;
+
+        VkDescriptorPoolSize poolSize { VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 4 * framesInFlight };
+
+        VkDescriptorPoolCreateInfo poolCreateInfo { VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO };
+        poolCreateInfo.maxSets = framesInFlight;
+        poolCreateInfo.poolSizeCount = 1;
+        poolCreateInfo.pPoolSizes = &poolSize;
+
+        VK_CHECK("VulkanIndirectRenderer::Init()::vkCreateDescriptorPool", vkCreateDescriptorPool(_device, &poolCreateInfo, nullptr, &_descriptorPool));
+
+        for (auto& frame : _frames) {
+            VkDescriptorSetAllocateInfo allocateInfo { VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO };
+            allocateInfo.descriptorPool = _descriptorPool;
+            allocateInfo.descriptorSetCount = 1;
+            allocateInfo.pSetLayouts = &_cullSetLayout;
+            VK_CHECK("VulkanIndirectRenderer::Init()::vkAllocateDescriptorSets", vkAllocateDescriptorSets(_device, &allocateInfo, &frame.DescriptorSet));
+
+            // A single frame of pools, reset whenever the batches change
+            frame.DrawDescriptors = std::make_unique<VulkanDescriptorSetManager>(&_device, 0);
+        }
+    }
+
+    void VulkanIndirectRenderer::Shutdown() {
+        if (_device == VK_NULL_HANDLE) return;
+
+        _batches.clear();
+        _batched.clear();
+        _objects.clear();
+        _instanceBatches.clear();
+        _submeshKeys.clear();
+        _frames.clear();
+
+        if (_descriptorPool != VK_NULL_HANDLE) {
+            vkDestroyDescriptorPool(_device, _descriptorPool, nullptr);
+            _descriptorPool = VK_NULL_HANDLE;
+        }
+
+        vkDestroyPipeline(_device, _cullPipeline, nullptr);
+        _cullPipeline = VK_NULL_HANDLE;
+        vkDestroyPipelineLayout(_device, _cullPipelineLayout, nullptr);
+        _cullPipelineLayout = VK_NULL_HANDLE;
+        vkDestroyDescriptorSetLayout(_device, _cullSetLayout, nullptr);
+        _cullSetLayout = VK_NULL_HANDLE;
+
+        _device = VK_NULL_HANDLE;
+    }
+
+    void VulkanIndirectRenderer::BeginFrame(uint32_t frameIndex) {
+        _currentFrame = frameIndex;
+
+        // The batches carry over, but nothing is culled for this frame yet
+        _instanceCount = 0;
+    }
+
+    void VulkanIndirectRenderer::Prepare(VkCommandBuffer commandBuffer, const glm::mat4& viewProjection, const std::vector<RenderableObject>& objects) {
+        if (!IsAvailable()) return;
+
+        _instanceCount = 0;
+
+        if (layoutChanged(objects)) {
+            rebuildLayout(objects);
+        }
+
+        if (_instanceBatches.empty()) return;
+
+        auto& frame = _frames[_currentFrame];
+        auto objectCount = static_cast<uint32_t>(_instanceBatches.size());
+        auto batchCount = static_cast<uint32_t>(_batches.size());
+        ensureCapacity(frame, objectCount, batchCount);
+
+        if (frame.Layout != _layout) {
+            uploadBatches(frame);
+
+            // The frame has been waited on, so none of its old sets are still in use
+            frame.DrawDescriptors->NextDescriptorFrame();
+            for (auto& batch : _batches) {
+                batch.Descriptors[_currentFrame] = {};
+            }
+
+            frame.Layout = _layout;
+        }
+
+        uploadObjects(frame, objects);
+
+        // Every batch starts empty; the cull pass counts its instances up and fills its stretch of the visible list
+        VkBufferCopy drawsCopy { 0, 0, sizeof(VkDrawIndexedIndirectCommand) * batchCount };
+        vkCmdCopyBuffer(commandBuffer, frame.EmptyDraws->Buffer, frame.Draws->Buffer, 1, &drawsCopy);
+
+        VkMemoryBarrier resetBarrier { VK_STRUCTURE_TYPE_MEMORY_BARRIER };
+        resetBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        resetBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0,
+                             1, &resetBarrier, 0, nullptr, 0, nullptr);
+
+        CullParams params {
+                .ViewProjection = viewProjection,
+                .InstanceCount = objectCount
+        };
+
+        vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, _cullPipeline);
+        vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, _cullPipelineLayout, 0, 1, &frame.DescriptorSet, 0, nullptr);
+        vkCmdPushConstants(commandBuffer, _cullPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(CullParams), &params);
+        vkCmdDispatch(commandBuffer, (objectCount + INSTANCE_CULL_GROUP_SIZE - 1) / INSTANCE_CULL_GROUP_SIZE, 1, 1);
+
+        // The draws read the instance counts, the vertex shaders read the visible list
+        VkMemoryBarrier cullBarrier { VK_STRUCTURE_TYPE_MEMORY_BARRIER };
+        cullBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+        cullBarrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                             VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT, 0,
+                             1, &cullBarrier, 0, nullptr, 0, nullptr);
+
+        _instanceCount = objectCount;
+    }
+
+    VkBuffer VulkanIndirectRenderer::GetDrawBuffer() const {
+        if (_instanceCount == 0) return VK_NULL_HANDLE;
+        return _frames[_currentFrame].Draws->Buffer;
+    }
+
+    // Whole buffers, so the sets they're written into only change when the buffers are recreated
+    VkDescriptorBufferInfo VulkanIndirectRenderer::GetObjectBufferInfo() const {
+        if (_instanceCount == 0) return {};
+        return { _frames[_currentFrame].Objects->Buffer, 0, VK_WHOLE_SIZE };
+    }
+
+    VkDescriptorBufferInfo VulkanIndirectRenderer::GetVisibleBufferInfo() const {
+        if (_instanceCount == 0) return {};
+        return { _frames[_currentFrame].Visible->Buffer, 0, VK_WHOLE_SIZE };
+    }
+
+    void VulkanIndirectRenderer::createPipeline(VkPipelineCache pipelineCache) {
+        VkDescriptorSetLayoutBinding bindings[] {
+                { 0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr },
+                { 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr },
+                { 2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr },
+                { 3, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr }
+        };
+
+        VkDescriptorSetLayoutCreateInfo setLayoutCreateInfo { VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO };
+        setLayoutCreateInfo.bindingCount = static_cast<uint32_t>(std::size(bindings));
+        setLayoutCreateInfo.pBindings = bindings;
+        VK_CHECK("VulkanIndirectRenderer::createPipeline()::vkCreateDescriptorSetLayout", vkCreateDescriptorSetLayout(_device, &setLayoutCreateInfo, nullptr, &_cullSetLayout));
+
+        VkPushConstantRange pushConstants { VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(CullParams) };
+
+        VkPipelineLayoutCreateInfo layoutCreateInfo { VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO };
+        layoutCreateInfo.setLayoutCount = 1;
+        layoutCreateInfo.pSetLayouts = &_cullSetLayout;
+        layoutCreateInfo.pushConstantRangeCount = 1;
+        layoutCreateInfo.pPushConstantRanges = &pushConstants;
+        VK_CHECK("VulkanIndirectRenderer::createPipeline()::vkCreatePipelineLayout", vkCreatePipelineLayout(_device, &layoutCreateInfo, nullptr, &_cullPipelineLayout));
+
+        _cullPipeline = VulkanUtilities::CreateComputePipeline(_device, "instance_cull", _cullPipelineLayout, pipelineCache);
+
+        if (_cullPipeline == VK_NULL_HANDLE) {
+            std::cout << "Instance culling shader failed to load, GPU driven rendering is disabled." << std::endl;
+        }
+    }
+
+    void VulkanIndirectRenderer::ensureCapacity(FrameResources& frame, uint32_t objectCount, uint32_t batchCount) {
+        // The frame has been waited on, so nothing on the GPU still reads the old buffers
+        bool recreated { false };
+
+        if (objectCount > frame.ObjectCapacity) {
+            frame.ObjectCapacity = std::max(std::bit_ceil(objectCount), INSTANCE_MIN_CAPACITY);
+            frame.Objects = std::make_unique<VulkanBuffer>(_allocator, sizeof(ObjectInstance) * frame.ObjectCapacity,
+                                                           VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU);
+            frame.Visible = std::make_unique<VulkanBuffer>(_allocator, sizeof(uint32_t) * frame.ObjectCapacity,
+                                                           VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VMA_MEMORY_USAGE_GPU_ONLY);
+
+            // Nothing has been written to the new one
+            frame.Uploaded.clear();
+            recreated = true;
+        }
+
+        if (batchCount > frame.BatchCapacity) {
+            frame.BatchCapacity = std::max(std::bit_ceil(batchCount), BATCH_MIN_CAPACITY);
+            frame.Batches = std::make_unique<VulkanBuffer>(_allocator, sizeof(BatchBounds) * frame.BatchCapacity,
+                                                           VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU);
+            frame.Draws = std::make_unique<VulkanBuffer>(_allocator, sizeof(VkDrawIndexedIndirectCommand) * frame.BatchCapacity,
+                                                         VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                                         VMA_MEMORY_USAGE_GPU_ONLY);
+            frame.EmptyDraws = std::make_unique<VulkanBuffer>(_allocator, sizeof(VkDrawIndexedIndirectCommand) * frame.BatchCapacity,
+                                                              VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU);
+
+            // Have the batches written to the new buffers
+            frame.Layout = 0;
+            recreated = true;
+        }
+
+        if (!recreated) return;
+
+        frame.BufferGeneration++;
+
+        VkDescriptorBufferInfo objectInfo { frame.Objects->Buffer, 0, VK_WHOLE_SIZE };
+        VkDescriptorBufferInfo batchInfo { frame.Batches->Buffer, 0, VK_WHOLE_SIZE };
+        VkDescriptorBufferInfo drawInfo { frame.Draws->Buffer, 0, VK_WHOLE_SIZE };
+        VkDescriptorBufferInfo visibleInfo { frame.Visible->Buffer, 0, VK_WHOLE_SIZE };
+
+        VkWriteDescriptorSet writes[] {
+                VulkanUtilities::WriteDescriptorSetUniformBuffer(frame.DescriptorSet, 0, &objectInfo),
+                VulkanUtilities::WriteDescriptorSetUniformBuffer(frame.DescriptorSet, 1, &batchInfo),
+                VulkanUtilities::WriteDescriptorSetUniformBuffer(frame.DescriptorSet, 2, &drawInfo),
+                VulkanUtilities::WriteDescriptorSetUniformBuffer(frame.DescriptorSet, 3, &visibleInfo)
+        };
+        for (auto& write : writes) {
+            write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        }
+        vkUpdateDescriptorSets(_device, static_cast<uint32_t>(std::size(writes)), writes, 0, nullptr);
+    }
+
+    bool VulkanIndirectRenderer::layoutChanged(const std::vector<RenderableObject>& objects) const {
+        if (objects.size() != _objects.size()) return true;
+
+        for (size_t i = 0; i < objects.size(); i++) {
+            const auto& slots = _objects[i];
+
+            // Compared by owner, so a new mesh can't pass for an old one at the same address
+            if (objects[i].Mesh.owner_before(slots.Source) || slots.Source.owner_before(objects[i].Mesh)) return true;
+
+            auto mesh = objects[i].Mesh.lock();
+            const Submesh* submeshes = mesh ? mesh->GetSubmeshes().data() : nullptr;
+            size_t submeshCount = mesh ? mesh->GetSubmeshes().size() : 0;
+            if (submeshes != slots.Submeshes || submeshCount != slots.SubmeshCount) return true;
+        }
+
+        // Every submesh is still where it was, so a material, shader or buffer swap is all that's left
+        for (const auto& [submesh, key] : _submeshKeys) {
+            if (hashSubmesh(*submesh) != key) return true;
+        }
+
+        return false;
+    }
+
+    void VulkanIndirectRenderer::rebuildLayout(const std::vector<RenderableObject>& objects) {
+        OZZ_PROFILE_FUNCTION();
+
+        _batches.clear();
+        _batched.clear();
+        _objects.clear();
+        _instanceBatches.clear();
+        _submeshKeys.clear();
+        _layout++;
+
+        std::unordered_map<const Submesh*, uint32_t> batchLookup {};
+        _objects.reserve(objects.size());
+
+        for (auto& object : objects) {
+            auto mesh = object.Mesh.lock();
+
+            auto& slots = _objects.emplace_back(ObjectSlots {
+                    .Source = object.Mesh,
+                    .Submeshes = mesh ? mesh->GetSubmeshes().data() : nullptr,
+                    .SubmeshCount = mesh ? mesh->GetSubmeshes().size() : 0,
+                    .FirstInstance = static_cast<uint32_t>(_instanceBatches.size())
+            });
+
+            if (!mesh) continue;
+
+            for (auto& submesh : mesh->GetSubmeshes()) {
+                _batched.push_back(false);
+
+                auto [it, inserted] = batchLookup.try_emplace(&submesh, NOT_BATCHED);
+                if (inserted) {
+                    _submeshKeys.emplace_back(&submesh, hashSubmesh(submesh));
+
+                    auto material = submesh.GetMaterial().lock();
+                    auto shader = material ? material->GetShader().lock() : nullptr;
+
+                    // Materials without an instanced vertex shader stay on the per object path
+                    const auto* vulkanShader = dynamic_cast<VulkanShader *>(shader.get());
+                    const auto* program = vulkanShader ? vulkanShader->GetInstancedProgram().get() : nullptr;
+
+                    if (program && program->IsReady() && submesh._indexBuffer && submesh._vertexBuffer) {
+                        it->second = static_cast<uint32_t>(_batches.size());
+                        _batches.push_back(Batch {
+                                .Owner = mesh,
+                                .Geometry = &submesh,
+                                .MaterialShader = shader,
+                                .Descriptors = std::vector<BatchDescriptors>(_frames.size())
+                        });
+                    }
+                }
+
+                if (it->second == NOT_BATCHED) continue;
+
+                _batches[it->second].InstanceCount++;
+                _instanceBatches.push_back(it->second);
+                _batched.back() = true;
+            }
+
+            slots.InstanceCount = static_cast<uint32_t>(_instanceBatches.size()) - slots.FirstInstance;
+        }
+    }
+
+    void VulkanIndirectRenderer::uploadBatches(FrameResources& frame) {
+        auto batchCount = static_cast<uint32_t>(_batches.size());
+
+        std::vector<BatchBounds> bounds {};
+        std::vector<VkDrawIndexedIndirectCommand> draws {};
+        bounds.reserve(batchCount);
+        draws.reserve(batchCount);
+
+        uint32_t firstInstance { 0 };
+        for (auto& batch : _batches) {
+            const auto& submeshBounds = batch.Geometry->GetBounds();
+            bounds.push_back(BatchBounds {
+                    .BoundsMin = glm::vec4(submeshBounds.Min, 1.f),
+                    .BoundsMax = glm::vec4(submeshBounds.Max, 1.f)
+            });
+
+            draws.push_back(VkDrawIndexedIndirectCommand {
+                    .indexCount = batch.Geometry->_indexBuffer->GetCount(),
+                    .instanceCount = 0,
+                    .firstIndex = 0,
+                    .vertexOffset = 0,
+                    .firstInstance = firstInstance
+            });
+
+            firstInstance += batch.InstanceCount;
+        }
+
+        frame.Batches->UploadData(reinterpret_cast<int*>(bounds.data()), sizeof(BatchBounds) * batchCount);
+        frame.EmptyDraws->UploadData(reinterpret_cast<int*>(draws.data()), sizeof(VkDrawIndexedIndirectCommand) * batchCount);
+
+        // Objects may have moved to other batches
+        frame.Uploaded.clear();
+    }
+
+    void VulkanIndirectRenderer::uploadObjects(FrameResources& frame, const std::vector<RenderableObject>& objects) {
+        OZZ_PROFILE_FUNCTION();
+
+        // Starts out matching nothing, so a fresh buffer is written in full
+        if (frame.Uploaded.size() != _instanceBatches.size()) {
+            frame.Uploaded.assign(_instanceBatches.size(), ObjectInstance { .Model = glm::mat4 { 0.f }, .Batch = NOT_BATCHED });
+        }
+
+        ObjectInstance* mapped { nullptr };
+
+        for (size_t i = 0; i < objects.size(); i++) {
+            const auto& slots = _objects[i];
+            if (slots.InstanceCount == 0) continue;
+
+            // An object's submeshes all share its transform, and only a rebuild can move them between batches
+            auto& first = frame.Uploaded[slots.FirstInstance];
+            if (first.Batch != NOT_BATCHED && std::memcmp(&first.Model, &objects[i].Transform, sizeof(glm::mat4)) == 0) continue;
+
+            if (!mapped) {
+                void* data { nullptr };
+                vmaMapMemory(*_allocator, frame.Objects->Allocation, &data);
+                mapped = static_cast<ObjectInstance*>(data);
+            }
+
+            for (uint32_t slot = slots.FirstInstance; slot < slots.FirstInstance + slots.InstanceCount; slot++) {
+                frame.Uploaded[slot] = ObjectInstance { .Model = objects[i].Transform, .Batch = _instanceBatches[slot] };
+                mapped[slot] = frame.Uploaded[slot];
+            }
+        }
+
+        if (mapped) {
+            vmaUnmapMemory(*_allocator, frame.Objects->Allocation);
+        }
+    }
+
+    uint64_t VulkanIndirectRenderer::hashSubmesh(const Submesh& submesh) {
+        auto material = submesh.GetMaterial().lock();
+        auto shader = material ? material->GetShader().lock() : nullptr;
+        const auto* vulkanShader = dynamic_cast<VulkanShader *>(shader.get());
+        const auto* program = vulkanShader ? vulkanShader->GetInstancedProgram().get() : nullptr;
+
+        uint64_t key = VulkanUtilities::HashCombine(reinterpret_cast<uint64_t>(material.get()), reinterpret_cast<uint64_t>(shader.get()));
+        key = VulkanUtilities::HashCombine(key, reinterpret_cast<uint64_t>(program));
+
+        // Pipelines are swapped when a shader is reloaded or its compile finishes
+        key = VulkanUtilities::HashCombine(key, reinterpret_cast<uint64_t>(program ? program->Pipeline.load() : VK_NULL_HANDLE));
+
+        key = VulkanUtilities::HashCombine(key, reinterpret_cast<uint64_t>(submesh._indexBuffer.get()));
+        key = VulkanUtilities::HashCombine(key, reinterpret_cast<uint64_t>(submesh._vertexBuffer.get()));
+        key = VulkanUtilities::HashCombine(key, submesh._indexBuffer ? submesh._indexBuffer->GetCount() : 0);
+        key = VulkanUtilities::HashCombine(key, VulkanUtilities::HashBytes(&submesh.GetBounds(), sizeof(SubmeshBounds)));
+
+        return key;
+    }
+}
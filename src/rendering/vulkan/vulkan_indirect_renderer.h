@@ -0,0 +1,164 @@
+#pragma once
+#include <youtube_engine/rendering/renderables.h>
+#include <youtube_engine/rendering/shader.h>
+
+#include <map>
+#include <memory>
+#include <vector>
+
+#include "vulkan_includes.h"
+#include "vulkan_buffer.h"
+#include "vulkan_descriptor_set_manager.h"
+
+namespace OZZ {
+    /*
+     * GPU driven drawing for materials that ship an instanced vertex shader. Every object using the same submesh is
+     * folded into one batch: transforms are uploaded once into an object buffer, a compute pass frustum culls them and
+     * compacts the survivors into each batch's stretch of a visible list, and each batch is then a single
+     * vkCmdDrawIndexedIndirect whose instance count was filled in on the GPU. Recording cost follows the number of
+     * distinct submeshes instead of the number of objects.
+     *
+     * Batches and each object's slot in the object buffer are kept from frame to frame and only rebuilt when the list
+     * of objects, their meshes or their materials change. Otherwise a frame just writes the transforms that moved, and
+     * resets the instance counts on the GPU.
+     *
+     * Draws are numbered like VulkanOcclusionCuller numbers them so the per object path can tell what's been batched.
+     */
+    class VulkanIndirectRenderer {
+    public:
+        // A batch's sets for one frame in flight, written again only when the key made from their contents changes
+        struct BatchDescriptors {
+            std::map<int, VkDescriptorSet> Sets {};
+
+            // 0 until written
+            uint64_t Key { 0 };
+        };
+
+        struct Batch {
+            // Keeps the submesh alive for as long as the batch is
+            std::shared_ptr<Mesh> Owner { nullptr };
+            Submesh* Geometry { nullptr };
+            std::shared_ptr<Shader> MaterialShader { nullptr };
+
+            uint32_t InstanceCount { 0 };
+
+            // One per frame in flight
+            std::vector<BatchDescriptors> Descriptors {};
+        };
+
+        void Init(VkDevice device, VmaAllocator* allocator, VkPipelineCache pipelineCache, uint32_t framesInFlight);
+        void Shutdown();
+
+        [[nodiscard]] bool IsAvailable() const { return _cullPipeline != VK_NULL_HANDLE; }
+
+        // Call once the frame has been waited on
+        void BeginFrame(uint32_t frameIndex);
+
+        // Batches the objects, uploads whatever changed and records the cull dispatch. Has to be outside of a render pass.
+        void Prepare(VkCommandBuffer commandBuffer, const glm::mat4& viewProjection, const std::vector<RenderableObject>& objects);
+
+        [[nodiscard]] bool IsBatched(uint32_t drawIndex) const { return _instanceCount > 0 && drawIndex < _batched.size() && _batched[drawIndex]; }
+        [[nodiscard]] const std::vector<Batch>& GetBatches() const { return _batches; }
+
+        // The current frame's sets for a batch, and where to allocate them from. Only reset when the batches change.
+        [[nodiscard]] BatchDescriptors& GetBatchDescriptors(uint32_t batchIndex) { return _batches[batchIndex].Descriptors[_currentFrame]; }
+        [[nodiscard]] VulkanDescriptorSetManager& GetDescriptorSetManager() { return *_frames[_currentFrame].DrawDescriptors; }
+
+        // One VkDrawIndexedIndirectCommand per batch, in batch order
+        [[nodiscard]] VkBuffer GetDrawBuffer() const;
+        [[nodiscard]] VkDescriptorBufferInfo GetObjectBufferInfo() const;
+        [[nodiscard]] VkDescriptorBufferInfo GetVisibleBufferInfo() const;
+
+        // Bumped whenever this frame's buffers are recreated, since a new buffer can come back with an old handle
+        [[nodiscard]] uint64_t GetBufferGeneration() const { return _frames[_currentFrame].BufferGeneration; }
+
+    private:
+        // Matches instance_cull.comp and the instanced vertex shaders
+        struct ObjectInstance {
+            glm::mat4 Model;
+            uint32_t Batch;
+            uint32_t Padding[3];
+        };
+
+        struct BatchBounds {
+            glm::vec4 BoundsMin;
+            glm::vec4 BoundsMax;
+        };
+
+        struct CullParams {
+            glm::mat4 ViewProjection;
+            uint32_t InstanceCount;
+        };
+
+        // Where an object's batched submeshes sit in the object buffer, and what it was batched from
+        struct ObjectSlots {
+            std::weak_ptr<Mesh> Source {};
+            const Submesh* Submeshes { nullptr };
+            size_t SubmeshCount { 0 };
+
+            uint32_t FirstInstance { 0 };
+            uint32_t InstanceCount { 0 };
+        };
+
+        struct FrameResources {
+            std::unique_ptr<VulkanBuffer> Objects { nullptr };
+            std::unique_ptr<VulkanBuffer> Visible { nullptr };
+            uint32_t ObjectCapacity { 0 };
+
+            std::unique_ptr<VulkanBuffer> Batches { nullptr };
+            std::unique_ptr<VulkanBuffer> Draws { nullptr };
+            uint32_t BatchCapacity { 0 };
+
+            // Every batch's draw with no instances, copied over the draws before each cull
+            std::unique_ptr<VulkanBuffer> EmptyDraws { nullptr };
+
+            // What the object buffer holds, so only transforms that moved are written
+            std::vector<ObjectInstance> Uploaded {};
+
+            // The batches last uploaded, 0 for none
+            uint64_t Layout { 0 };
+            uint64_t BufferGeneration { 0 };
+
+            VkDescriptorSet DescriptorSet { VK_NULL_HANDLE };
+            std::unique_ptr<VulkanDescriptorSetManager> DrawDescriptors { nullptr };
+        };
+
+        void createPipeline(VkPipelineCache pipelineCache);
+        void ensureCapacity(FrameResources& frame, uint32_t objectCount, uint32_t batchCount);
+
+        [[nodiscard]] bool layoutChanged(const std::vector<RenderableObject>& objects) const;
+        void rebuildLayout(const std::vector<RenderableObject>& objects);
+        void uploadBatches(FrameResources& frame);
+        void uploadObjects(FrameResources& frame, const std::vector<RenderableObject>& objects);
+
+        // Everything batching a submesh depends on
+        [[nodiscard]] static uint64_t hashSubmesh(const Submesh& submesh);
+
+    private:
+        VkDevice _device { VK_NULL_HANDLE };
+        VmaAllocator* _allocator { nullptr };
+
+        VkDescriptorSetLayout _cullSetLayout { VK_NULL_HANDLE };
+        VkPipelineLayout _cullPipelineLayout { VK_NULL_HANDLE };
+        VkPipeline _cullPipeline { VK_NULL_HANDLE };
+        VkDescriptorPool _descriptorPool { VK_NULL_HANDLE };
+
+        std::vector<FrameResources> _frames {};
+        uint32_t _currentFrame { 0 };
+
+        std::vector<Batch> _batches {};
+        std::vector<bool> _batched {};
+
+        std::vector<ObjectSlots> _objects {};
+        std::vector<uint32_t> _instanceBatches {};
+
+        // Every distinct submesh seen, batched or not, with the hash it was sorted with
+        std::vector<std::pair<const Submesh*, uint64_t>> _submeshKeys {};
+
+        // Bumped whenever the batches are rebuilt
+        uint64_t _layout { 0 };
+
+        // Non-zero once this frame's cull is recorded
+        uint32_t _instanceCount { 0 };
+    };
+}
@@ -0,0 +1,459 @@
+#include "vulkan_occlusion_culler.h"
+#include "vulkan_deletion_queue.h"
+#include "vulkan_sampler_cache.h"
+#include "vulkan_utilities.h"
+
+#include <algorithm>
+#include <bit>
+#include <iostream>
+
+namespace OZZ {
+    constexpr uint32_t CULL_GROUP_SIZE = 64;
+    constexpr uint32_t REDUCE_GROUP_SIZE = 8;
+    constexpr uint32_t CULL_MIN_CAPACITY = 256;
+
+    void VulkanOcclusionCuller::Init(VkDevice device, VmaAllocator* allocator, VkPipelineCache pipelineCache,
+                                     VulkanSamplerCache* samplerCache, uint32_t framesInFlight) {
+        _device = device;
+        _allocator = allocator;
+        _samplerCache = samplerCache;
+
+        // texelFetch ignores filtering, but the pyramid is still read through a combined image sampler
+        _sampler = _samplerCache->GetSampler(SamplerSettings {
+                .MagFilter = TextureFilter::Nearest,
+                .MinFilter = TextureFilter::Nearest,
+                .MipmapFilter = TextureFilter::Nearest,
+                .AddressMode = TextureAddressMode::ClampToEdge,
+                .MaxAnisotropy = 1.f
+        });
+
+        _frames.resize(framesInFlight);
+        createPipelines(pipelineCache);
+    }
+
+    void VulkanOcclusionCuller::Shutdown() {
+        if (_device == VK_NULL_HANDLE) return;
+
+        DestroyTargets();
+        _frames.clear();
+
+        vkDestroyPipeline(_device, _cullPipeline, nullptr);
+        _cullPipeline = VK_NULL_HANDLE;
+        vkDestroyPipelineLayout(_device, _cullPipelineLayout, nullptr);
+        _cullPipelineLayout = VK_NULL_HANDLE;
+        vkDestroyDescriptorSetLayout(_device, _cullSetLayout, nullptr);
+        _cullSetLayout = VK_NULL_HANDLE;
+
+        vkDestroyPipeline(_device, _reducePipeline, nullptr);
+        _reducePipeline = VK_NULL_HANDLE;
+        vkDestroyPipelineLayout(_device, _reducePipelineLayout, nullptr);
+        _reducePipelineLayout = VK_NULL_HANDLE;
+        vkDestroyDescriptorSetLayout(_device, _reduceSetLayout, nullptr);
+        _reduceSetLayout = VK_NULL_HANDLE;
+
+        // Owned by the sampler cache
+        _sampler = VK_NULL_HANDLE;
+        _device = VK_NULL_HANDLE;
+    }
+
+    void VulkanOcclusionCuller::CreateTargets(VkImageView depthView, VkExtent2D depthExtent) {
+        if (_cullPipeline == VK_NULL_HANDLE || _reducePipeline == VK_NULL_HANDLE) return;
+
+        _depthView = depthView;
+        _depthExtent = depthExtent;
+
+        // The first level already halves the depth buffer
+        VkExtent2D extent { std::max(depthExtent.width / 2, 1u), std::max(depthExtent.height / 2, 1u) };
+        auto mipCount = static_cast<uint32_t>(std::bit_width(std::max(extent.width, extent.height)));
+
+        _mipExtents.clear();
+        for (uint32_t mip = 0; mip < mipCount; mip++) {
+            _mipExtents.push_back(extent);
+            extent = { std::max(extent.width / 2, 1u), std::max(extent.height / 2, 1u) };
+        }
+
+        VkImageCreateInfo imageCreateInfo {
+                .sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+                .imageType = VK_IMAGE_TYPE_2D,
+                .format = VK_FORMAT_R32_SFLOAT,
+                .extent = { _mipExtents[0].width, _mipExtents[0].height, 1 },
+                .mipLevels = mipCount,
+                .arrayLayers = 1,
+                .samples = VK_SAMPLE_COUNT_1_BIT,
+                .tiling = VK_IMAGE_TILING_OPTIMAL,
+                .usage = VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT
+        };
+
+        VmaAllocationCreateInfo allocationCreateInfo {
+                .usage = VMA_MEMORY_USAGE_GPU_ONLY
+        };
+
+        VK_CHECK("VulkanOcclusionCuller::CreateTargets()::vmaCreateImage",
+                 vmaCreateImage(*_allocator, &imageCreateInfo, &allocationCreateInfo, &_pyramid, &_pyramidAllocation, nullptr));
+
+        VkImageViewCreateInfo viewCreateInfo {
+                .sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+                .image = _pyramid,
+                .viewType = VK_IMAGE_VIEW_TYPE_2D,
+                .format = VK_FORMAT_R32_SFLOAT,
+                .subresourceRange = {
+                        .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+                        .baseMipLevel = 0,
+                        .levelCount = mipCount,
+                        .baseArrayLayer = 0,
+                        .layerCount = 1
+                }
+        };
+
+        VK_CHECK("VulkanOcclusionCuller::CreateTargets()::vkCreateImageView", vkCreateImageView(_device, &viewCreateInfo, nullptr, &_pyramidView));
+
+        _mipViews.resize(mipCount);
+        for (uint32_t mip = 0; mip < mipCount; mip++) {
+            viewCreateInfo.subresourceRange.baseMipLevel = mip;
+            viewCreateInfo.subresourceRange.levelCount = 1;
+            VK_CHECK("VulkanOcclusionCuller::CreateTargets()::vkCreateImageView", vkCreateImageView(_device, &viewCreateInfo, nullptr, &_mipViews[mip]));
+        }
+
+        auto frameCount = static_cast<uint32_t>(_frames.size());
+        VkDescriptorPoolSize poolSizes[] {
+                { VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, mipCount + frameCount },
+                { VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, mipCount },
+                { VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 3 * frameCount }
+        };
+
+        VkDescriptorPoolCreateInfo poolCreateInfo { VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO };
+        poolCreateInfo.maxSets = mipCount + frameCount;
+        poolCreateInfo.poolSizeCount = static_cast<uint32_t>(std::size(poolSizes));
+        poolCreateInfo.pPoolSizes = poolSizes;
+
+        VK_CHECK("VulkanOcclusionCuller::CreateTargets()::vkCreateDescriptorPool", vkCreateDescriptorPool(_device, &poolCreateInfo, nullptr, &_descriptorPool));
+
+        std::vector<VkDescriptorSetLayout> reduceLayouts(mipCount, _reduceSetLayout);
+        _reduceSets.resize(mipCount);
+
+        VkDescriptorSetAllocateInfo allocateInfo { VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO };
+        allocateInfo.descriptorPool = _descriptorPool;
+        allocateInfo.descriptorSetCount = mipCount;
+        allocateInfo.pSetLayouts = reduceLayouts.data();
+        VK_CHECK("VulkanOcclusionCuller::CreateTargets()::vkAllocateDescriptorSets", vkAllocateDescriptorSets(_device, &allocateInfo, _reduceSets.data()));
+
+        for (auto& frame : _frames) {
+            allocateInfo.descriptorSetCount = 1;
+            allocateInfo.pSetLayouts = &_cullSetLayout;
+            VK_CHECK("VulkanOcclusionCuller::CreateTargets()::vkAllocateDescriptorSets", vkAllocateDescriptorSets(_device, &allocateInfo, &frame.DescriptorSet));
+        }
+
+        // Each level reads the one above it, the first reads the depth buffer itself
+        for (uint32_t mip = 0; mip < mipCount; mip++) {
+            VkDescriptorImageInfo sourceInfo {
+                    .sampler = _sampler,
+                    .imageView = mip == 0 ? _depthView : _mipViews[mip - 1],
+                    .imageLayout = mip == 0 ? VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_GENERAL
+            };
+
+            VkDescriptorImageInfo destinationInfo {
+                    .imageView = _mipViews[mip],
+                    .imageLayout = VK_IMAGE_LAYOUT_GENERAL
+            };
+
+            VkWriteDescriptorSet writes[] {
+                    VulkanUtilities::WriteDescriptorSetTexture(_reduceSets[mip], 0, &sourceInfo),
+                    VulkanUtilities::WriteDescriptorSetTexture(_reduceSets[mip], 1, &destinationInfo)
+            };
+            writes[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+
+            vkUpdateDescriptorSets(_device, 2, writes, 0, nullptr);
+        }
+
+        _pyramidValid = false;
+    }
+
+    void VulkanOcclusionCuller::DestroyTargets(VulkanDeletionQueue* deletionQueue) {
+        if (_device == VK_NULL_HANDLE) return;
+
+        auto destroy = [device = _device, allocator = *_allocator, descriptorPool = _descriptorPool, mipViews = _mipViews,
+                        pyramidView = _pyramidView, pyramid = _pyramid, pyramidAllocation = _pyramidAllocation]() {
+            if (descriptorPool != VK_NULL_HANDLE) {
+                vkDestroyDescriptorPool(device, descriptorPool, nullptr);
+            }
+
+            for (auto view : mipViews) {
+                vkDestroyImageView(device, view, nullptr);
+            }
+
+            if (pyramidView != VK_NULL_HANDLE) {
+                vkDestroyImageView(device, pyramidView, nullptr);
+            }
+
+            if (pyramid != VK_NULL_HANDLE) {
+                vmaDestroyImage(allocator, pyramid, pyramidAllocation);
+            }
+        };
+
+        if (deletionQueue) {
+            deletionQueue->Retire(std::move(destroy));
+        } else {
+            destroy();
+        }
+
+        _descriptorPool = VK_NULL_HANDLE;
+        _reduceSets.clear();
+        for (auto& frame : _frames) {
+            frame.DescriptorSet = VK_NULL_HANDLE;
+        }
+
+        _mipViews.clear();
+        _mipExtents.clear();
+        _pyramidView = VK_NULL_HANDLE;
+        _pyramid = VK_NULL_HANDLE;
+        _pyramidAllocation = VK_NULL_HANDLE;
+
+        _depthView = VK_NULL_HANDLE;
+        _pyramidValid = false;
+    }
+
+    VulkanOcclusionCuller::Results VulkanOcclusionCuller::BeginFrame(uint32_t frameIndex) {
+        _currentFrame = frameIndex;
+        _culledThisFrame = false;
+
+        auto& frame = _frames[_currentFrame];
+        if (!frame.Pending) {
+            return {};
+        }
+
+        frame.Pending = false;
+
+        void* data;
+        vmaInvalidateAllocation(*_allocator, frame.Visibility->Allocation, 0, sizeof(uint32_t));
+        vmaMapMemory(*_allocator, frame.Visibility->Allocation, &data);
+        auto visible = *static_cast<uint32_t*>(data);
+        vmaUnmapMemory(*_allocator, frame.Visibility->Allocation);
+
+        return { .Candidates = frame.Candidates, .Visible = std::min(visible, frame.Candidates) };
+    }
+
+    void VulkanOcclusionCuller::Cull(VkCommandBuffer commandBuffer, const glm::mat4& viewProjection, const std::vector<RenderableObject>& objects) {
+        if (!IsAvailable()) return;
+
+        auto& frame = _frames[_currentFrame];
+
+        std::vector<CullInstance> instances {};
+        for (auto& object : objects) {
+            auto mesh = object.Mesh.lock();
+            if (!mesh) continue;
+
+            for (auto& submesh : mesh->GetSubmeshes()) {
+                const auto& bounds = submesh.GetBounds();
+
+                // Transforming the box's extent by the absolute matrix gives the tightest world aligned box around it
+                glm::vec3 center = (bounds.Min + bounds.Max) * 0.5f;
+                glm::vec3 extent = (bounds.Max - bounds.Min) * 0.5f;
+
+                glm::mat3 absolute { object.Transform };
+                for (int column = 0; column < 3; column++) {
+                    absolute[column] = glm::abs(absolute[column]);
+                }
+
+                glm::vec3 worldCenter = glm::vec3(object.Transform * glm::vec4(center, 1.f));
+                glm::vec3 worldExtent = absolute * extent;
+
+                instances.push_back(CullInstance {
+                        .BoundsMin = glm::vec4(worldCenter - worldExtent, 1.f),
+                        .BoundsMax = glm::vec4(worldCenter + worldExtent, 1.f),
+                        .IndexCount = submesh._indexBuffer ? submesh._indexBuffer->GetCount() : 0
+                });
+            }
+        }
+
+        if (instances.empty()) return;
+
+        auto count = static_cast<uint32_t>(instances.size());
+        ensureCapacity(frame, count);
+        frame.Instances->UploadData(reinterpret_cast<int*>(instances.data()), sizeof(CullInstance) * count);
+
+        VkDescriptorBufferInfo instanceInfo { frame.Instances->Buffer, 0, sizeof(CullInstance) * count };
+        VkDescriptorBufferInfo drawInfo { frame.Draws->Buffer, 0, sizeof(VkDrawIndexedIndirectCommand) * count };
+        VkDescriptorBufferInfo visibilityInfo { frame.Visibility->Buffer, 0, sizeof(uint32_t) };
+        VkDescriptorImageInfo pyramidInfo { _sampler, _pyramidView, VK_IMAGE_LAYOUT_GENERAL };
+
+        VkWriteDescriptorSet writes[] {
+                VulkanUtilities::WriteDescriptorSetUniformBuffer(frame.DescriptorSet, 0, &instanceInfo),
+                VulkanUtilities::WriteDescriptorSetUniformBuffer(frame.DescriptorSet, 1, &drawInfo),
+                VulkanUtilities::WriteDescriptorSetUniformBuffer(frame.DescriptorSet, 2, &visibilityInfo),
+                VulkanUtilities::WriteDescriptorSetTexture(frame.DescriptorSet, 3, &pyramidInfo)
+        };
+        for (int i = 0; i < 3; i++) {
+            writes[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        }
+        vkUpdateDescriptorSets(_device, static_cast<uint32_t>(std::size(writes)), writes, 0, nullptr);
+
+        vkCmdFillBuffer(commandBuffer, frame.Visibility->Buffer, 0, sizeof(uint32_t), 0);
+
+        VkMemoryBarrier clearBarrier { VK_STRUCTURE_TYPE_MEMORY_BARRIER };
+        clearBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        clearBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0,
+                             1, &clearBarrier, 0, nullptr, 0, nullptr);
+
+        CullParams params {
+                .ViewProjection = _pyramidViewProjection,
+                .PyramidSize = { static_cast<float>(_mipExtents[0].width), static_cast<float>(_mipExtents[0].height) },
+                .InstanceCount = count,
+                .MipCount = static_cast<uint32_t>(_mipExtents.size()),
+                .PyramidValid = _pyramidValid ? 1u : 0u
+        };
+
+        vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, _cullPipeline);
+        vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, _cullPipelineLayout, 0, 1, &frame.DescriptorSet, 0, nullptr);
+        vkCmdPushConstants(commandBuffer, _cullPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(CullParams), &params);
+        vkCmdDispatch(commandBuffer, (count + CULL_GROUP_SIZE - 1) / CULL_GROUP_SIZE, 1, 1);
+
+        // The draws read the commands, and the visible count is read back once the frame has been waited on
+        VkMemoryBarrier cullBarrier { VK_STRUCTURE_TYPE_MEMORY_BARRIER };
+        cullBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+        cullBarrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_HOST_READ_BIT;
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                             VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_HOST_BIT, 0,
+                             1, &cullBarrier, 0, nullptr, 0, nullptr);
+
+        frame.Candidates = count;
+        frame.Pending = true;
+
+        _frameViewProjection = viewProjection;
+        _culledThisFrame = true;
+    }
+
+    VkBuffer VulkanOcclusionCuller::GetDrawBuffer() const {
+        if (!_culledThisFrame) return VK_NULL_HANDLE;
+        return _frames[_currentFrame].Draws->Buffer;
+    }
+
+    void VulkanOcclusionCuller::BuildPyramid(VkCommandBuffer commandBuffer, VkImage depthImage) {
+        if (!IsAvailable()) return;
+
+        auto mipCount = static_cast<uint32_t>(_mipExtents.size());
+
+        VkImageMemoryBarrier depthBarrier { VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER };
+        depthBarrier.srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+        depthBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        depthBarrier.oldLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+        depthBarrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        depthBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        depthBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        depthBarrier.image = depthImage;
+        depthBarrier.subresourceRange = { VK_IMAGE_ASPECT_DEPTH_BIT, 0, 1, 0, 1 };
+
+        // Last frame's cull may still be reading the pyramid
+        VkImageMemoryBarrier pyramidBarrier { VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER };
+        pyramidBarrier.srcAccessMask = 0;
+        pyramidBarrier.dstAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+        pyramidBarrier.oldLayout = _pyramidValid ? VK_IMAGE_LAYOUT_GENERAL : VK_IMAGE_LAYOUT_UNDEFINED;
+        pyramidBarrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+        pyramidBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        pyramidBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        pyramidBarrier.image = _pyramid;
+        pyramidBarrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, mipCount, 0, 1 };
+
+        VkImageMemoryBarrier barriers[] { depthBarrier, pyramidBarrier };
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                             VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 2, barriers);
+
+        vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, _reducePipeline);
+
+        VkExtent2D sourceExtent = _depthExtent;
+        for (uint32_t mip = 0; mip < mipCount; mip++) {
+            auto destinationExtent = _mipExtents[mip];
+
+            ReduceParams params {
+                    .SourceSize = { static_cast<int>(sourceExtent.width), static_cast<int>(sourceExtent.height) },
+                    .DestinationSize = { static_cast<int>(destinationExtent.width), static_cast<int>(destinationExtent.height) }
+            };
+
+            vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, _reducePipelineLayout, 0, 1, &_reduceSets[mip], 0, nullptr);
+            vkCmdPushConstants(commandBuffer, _reducePipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(ReduceParams), &params);
+            vkCmdDispatch(commandBuffer,
+                          (destinationExtent.width + REDUCE_GROUP_SIZE - 1) / REDUCE_GROUP_SIZE,
+                          (destinationExtent.height + REDUCE_GROUP_SIZE - 1) / REDUCE_GROUP_SIZE, 1);
+
+            VkImageMemoryBarrier mipBarrier = pyramidBarrier;
+            mipBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+            mipBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+            mipBarrier.oldLayout = VK_IMAGE_LAYOUT_GENERAL;
+            mipBarrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, mip, 1, 0, 1 };
+
+            vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0,
+                                 0, nullptr, 0, nullptr, 1, &mipBarrier);
+
+            sourceExtent = destinationExtent;
+        }
+
+        // Next frame's render pass clears the depth buffer these dispatches read
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                             VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT, 0,
+                             0, nullptr, 0, nullptr, 0, nullptr);
+
+        _pyramidViewProjection = _frameViewProjection;
+        _pyramidValid = true;
+    }
+
+    void VulkanOcclusionCuller::createPipelines(VkPipelineCache pipelineCache) {
+        VkDescriptorSetLayoutBinding cullBindings[] {
+                { 0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr },
+                { 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr },
+                { 2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr },
+                { 3, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr }
+        };
+
+        VkDescriptorSetLayoutBinding reduceBindings[] {
+                { 0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr },
+                { 1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr }
+        };
+
+        VkDescriptorSetLayoutCreateInfo setLayoutCreateInfo { VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO };
+        setLayoutCreateInfo.bindingCount = static_cast<uint32_t>(std::size(cullBindings));
+        setLayoutCreateInfo.pBindings = cullBindings;
+        VK_CHECK("VulkanOcclusionCuller::createPipelines()::vkCreateDescriptorSetLayout", vkCreateDescriptorSetLayout(_device, &setLayoutCreateInfo, nullptr, &_cullSetLayout));
+
+        setLayoutCreateInfo.bindingCount = static_cast<uint32_t>(std::size(reduceBindings));
+        setLayoutCreateInfo.pBindings = reduceBindings;
+        VK_CHECK("VulkanOcclusionCuller::createPipelines()::vkCreateDescriptorSetLayout", vkCreateDescriptorSetLayout(_device, &setLayoutCreateInfo, nullptr, &_reduceSetLayout));
+
+        VkPushConstantRange pushConstants { VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(CullParams) };
+
+        VkPipelineLayoutCreateInfo layoutCreateInfo { VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO };
+        layoutCreateInfo.setLayoutCount = 1;
+        layoutCreateInfo.pSetLayouts = &_cullSetLayout;
+        layoutCreateInfo.pushConstantRangeCount = 1;
+        layoutCreateInfo.pPushConstantRanges = &pushConstants;
+        VK_CHECK("VulkanOcclusionCuller::createPipelines()::vkCreatePipelineLayout", vkCreatePipelineLayout(_device, &layoutCreateInfo, nullptr, &_cullPipelineLayout));
+
+        pushConstants.size = sizeof(ReduceParams);
+        layoutCreateInfo.pSetLayouts = &_reduceSetLayout;
+        VK_CHECK("VulkanOcclusionCuller::createPipelines()::vkCreatePipelineLayout", vkCreatePipelineLayout(_device, &layoutCreateInfo, nullptr, &_reducePipelineLayout));
+
+        _cullPipeline = VulkanUtilities::CreateComputePipeline(_device, "occlusion_cull", _cullPipelineLayout, pipelineCache);
+        _reducePipeline = VulkanUtilities::CreateComputePipeline(_device, "hiz_reduce", _reducePipelineLayout, pipelineCache);
+
+        if (_cullPipeline == VK_NULL_HANDLE || _reducePipeline == VK_NULL_HANDLE) {
+            std::cout << "Occlusion culling shaders failed to load, culling is disabled." << std::endl;
+        }
+    }
+
+    void VulkanOcclusionCuller::ensureCapacity(FrameResources& frame, uint32_t count) {
+        if (!frame.Visibility) {
+            frame.Visibility = std::make_unique<VulkanBuffer>(_allocator, sizeof(uint32_t),
+                                                              VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                                              VMA_MEMORY_USAGE_GPU_TO_CPU);
+        }
+
+        if (count <= frame.Capacity) return;
+
+        // The frame has been waited on, so nothing on the GPU still reads the old buffers
+        frame.Capacity = std::max(std::bit_ceil(count), CULL_MIN_CAPACITY);
+        frame.Instances = std::make_unique<VulkanBuffer>(_allocator, sizeof(CullInstance) * frame.Capacity,
+                                                         VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU);
+        frame.Draws = std::make_unique<VulkanBuffer>(_allocator, sizeof(VkDrawIndexedIndirectCommand) * frame.Capacity,
+                                                     VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+                                                     VMA_MEMORY_USAGE_GPU_ONLY);
+    }
+}
@@ -0,0 +1,132 @@
+#pragma once
+#include <youtube_engine/rendering/renderables.h>
+
+#include <memory>
+#include <vector>
+
+#include "vulkan_includes.h"
+#include "vulkan_buffer.h"
+
+namespace OZZ {
+    class VulkanDeletionQueue;
+    class VulkanSamplerCache;
+
+    /*
+     * GPU occlusion culling against a hierarchical depth pyramid. At the end of a frame the depth buffer is reduced into
+     * a mip chain where every texel holds the farthest depth beneath it; the next frame a compute pass tests each
+     * submesh's bounds against it and writes one indirect draw per submesh, with zero instances when it's hidden.
+     *
+     * Draws are numbered by walking objects and their submeshes in order, so the draw loops have to count the same way
+     * (every submesh of every live mesh, drawn or not).
+     *
+     * Objects that moved since the pyramid was built are tested at their new position against old depth, so they can
+     * pop in a frame late.
+     */
+    class VulkanOcclusionCuller {
+    public:
+        struct Results {
+            uint32_t Candidates { 0 };
+            uint32_t Visible { 0 };
+        };
+
+        void Init(VkDevice device, VmaAllocator* allocator, VkPipelineCache pipelineCache, VulkanSamplerCache* samplerCache,
+                  uint32_t framesInFlight);
+        void Shutdown();
+
+        // The pyramid matches the depth buffer, so these follow the swapchain. With a deletion queue the old targets are
+        // retired, for when frames in flight may still be culling against them.
+        void CreateTargets(VkImageView depthView, VkExtent2D depthExtent);
+        void DestroyTargets(VulkanDeletionQueue* deletionQueue = nullptr);
+
+        [[nodiscard]] bool IsAvailable() const { return _cullPipeline != VK_NULL_HANDLE && _pyramid != VK_NULL_HANDLE; }
+
+        // Call once the frame has been waited on. Returns what the GPU found the last time this frame slot ran.
+        Results BeginFrame(uint32_t frameIndex);
+
+        // Records the cull dispatch. Has to be outside of a render pass.
+        void Cull(VkCommandBuffer commandBuffer, const glm::mat4& viewProjection, const std::vector<RenderableObject>& objects);
+
+        // Null unless Cull ran this frame
+        [[nodiscard]] VkBuffer GetDrawBuffer() const;
+
+        // Reduces the frame's depth into the pyramid, after the render pass has ended
+        void BuildPyramid(VkCommandBuffer commandBuffer, VkImage depthImage);
+
+    private:
+        // Matches occlusion_cull.comp
+        struct CullInstance {
+            glm::vec4 BoundsMin;
+            glm::vec4 BoundsMax;
+            uint32_t IndexCount;
+            uint32_t Padding[3];
+        };
+
+        struct CullParams {
+            glm::mat4 ViewProjection;
+            glm::vec2 PyramidSize;
+            uint32_t InstanceCount;
+            uint32_t MipCount;
+            uint32_t PyramidValid;
+        };
+
+        struct ReduceParams {
+            glm::ivec2 SourceSize;
+            glm::ivec2 DestinationSize;
+        };
+
+        struct FrameResources {
+            std::unique_ptr<VulkanBuffer> Instances { nullptr };
+            std::unique_ptr<VulkanBuffer> Draws { nullptr };
+            std::unique_ptr<VulkanBuffer> Visibility { nullptr };
+            uint32_t Capacity { 0 };
+
+            VkDescriptorSet DescriptorSet { VK_NULL_HANDLE };
+
+            uint32_t Candidates { 0 };
+            bool Pending { false };
+        };
+
+        void createPipelines(VkPipelineCache pipelineCache);
+        void ensureCapacity(FrameResources& frame, uint32_t count);
+
+    private:
+        VkDevice _device { VK_NULL_HANDLE };
+        VmaAllocator* _allocator { nullptr };
+        VulkanSamplerCache* _samplerCache { nullptr };
+
+        VkDescriptorSetLayout _cullSetLayout { VK_NULL_HANDLE };
+        VkPipelineLayout _cullPipelineLayout { VK_NULL_HANDLE };
+        VkPipeline _cullPipeline { VK_NULL_HANDLE };
+
+        VkDescriptorSetLayout _reduceSetLayout { VK_NULL_HANDLE };
+        VkPipelineLayout _reducePipelineLayout { VK_NULL_HANDLE };
+        VkPipeline _reducePipeline { VK_NULL_HANDLE };
+
+        VkSampler _sampler { VK_NULL_HANDLE };
+
+        std::vector<FrameResources> _frames {};
+        uint32_t _currentFrame { 0 };
+        bool _culledThisFrame { false };
+
+        /*
+         * PYRAMID
+         */
+        VkImage _pyramid { VK_NULL_HANDLE };
+        VmaAllocation _pyramidAllocation { VK_NULL_HANDLE };
+        VkImageView _pyramidView { VK_NULL_HANDLE };
+        std::vector<VkImageView> _mipViews {};
+        std::vector<VkExtent2D> _mipExtents {};
+
+        VkImageView _depthView { VK_NULL_HANDLE };
+        VkExtent2D _depthExtent {};
+
+        // One set per reduction step, and one per frame for the cull pass
+        VkDescriptorPool _descriptorPool { VK_NULL_HANDLE };
+        std::vector<VkDescriptorSet> _reduceSets {};
+
+        // Camera of the depth in the pyramid, and of the frame being recorded
+        glm::mat4 _pyramidViewProjection { 1.f };
+        glm::mat4 _frameViewProjection { 1.f };
+        bool _pyramidValid { false };
+    };
+}
@@ -4,9 +4,10 @@
 
 #include <iostream>
 #include "vulkan_pipeline_builder.h"
+#include "vulkan_pipeline_cache.h"
 
 namespace OZZ {
-    VkPipeline VulkanPipelineBuilder::BuildPipeline(VkDevice device, VkRenderPass pass) {
+    VkPipeline VulkanPipelineBuilder::BuildPipeline(VkDevice device, VkRenderPass pass, VulkanPipelineCache* pipelineCache) {
         VkPipelineViewportStateCreateInfo viewportState { VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO };
         viewportState.viewportCount = 1;
         viewportState.pViewports = &_viewport;
@@ -16,7 +17,7 @@ namespace OZZ {
         VkPipelineColorBlendStateCreateInfo colorBlendStateCreateInfo { VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO };
         colorBlendStateCreateInfo.logicOpEnable = VK_FALSE;
         colorBlendStateCreateInfo.logicOp = VK_LOGIC_OP_COPY;
-        colorBlendStateCreateInfo.attachmentCount = 1;
+        colorBlendStateCreateInfo.attachmentCount = _colorAttachmentCount;
         colorBlendStateCreateInfo.pAttachments = &_colorBlendAttachment;
 
         VkDynamicState dynamicStates[] = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
@@ -35,11 +36,15 @@ namespace OZZ {
         pipelineCreateInfo.pColorBlendState = &colorBlendStateCreateInfo;
         pipelineCreateInfo.layout = _pipelineLayout;
         pipelineCreateInfo.renderPass = pass;
-        pipelineCreateInfo.subpass = 0;
+        pipelineCreateInfo.subpass = _subpass;
         pipelineCreateInfo.basePipelineHandle = VK_NULL_HANDLE;
         pipelineCreateInfo.pDepthStencilState = &_depthStencil;
         pipelineCreateInfo.pDynamicState = &dynamicStateCreateInfo;
 
+        if (pipelineCache) {
+            return pipelineCache->CreateGraphicsPipeline(pipelineCreateInfo);
+        }
+
         VkPipeline newPipeline;
 
         if (vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineCreateInfo, nullptr, &newPipeline) != VK_SUCCESS) {
@@ -7,6 +7,8 @@
 #include <vector>
 
 namespace OZZ {
+    class VulkanPipelineCache;
+
     class VulkanPipelineBuilder {
     public:
         std::vector<VkPipelineShaderStageCreateInfo> _shaderStages;
@@ -21,7 +23,10 @@ namespace OZZ {
         VkPipelineLayout _pipelineLayout;
         VkPipelineDepthStencilStateCreateInfo _depthStencil;
 
-        VkPipeline BuildPipeline(VkDevice device, VkRenderPass pass);
+        uint32_t _subpass { 0 };
+        uint32_t _colorAttachmentCount { 1 };
+
+        VkPipeline BuildPipeline(VkDevice device, VkRenderPass pass, VulkanPipelineCache* pipelineCache = nullptr);
     };
 }
 
@@ -0,0 +1,209 @@
+#include "vulkan_pipeline_cache.h"
+#include "vulkan_utilities.h"
+
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+namespace OZZ {
+    void VulkanPipelineCache::Init(VkPhysicalDevice physicalDevice, VkDevice device, bool creationFeedbackEnabled) {
+        _device = device;
+        _creationFeedbackEnabled = creationFeedbackEnabled;
+        vkGetPhysicalDeviceProperties(physicalDevice, &_deviceProperties);
+
+        _pipelinesCreated = 0;
+        _cacheHits = 0;
+        _hitMicroseconds = 0;
+        _missMicroseconds = 0;
+
+        auto initialData = readCacheFile();
+
+        if (!initialData.empty() && !isCacheDataCompatible(initialData)) {
+            std::cout << "Pipeline cache on disk does not match this device, starting with an empty cache." << std::endl;
+            initialData.clear();
+        }
+
+        _loadedSize = initialData.size();
+
+        VkPipelineCacheCreateInfo createInfo { VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO };
+        createInfo.initialDataSize = initialData.size();
+        createInfo.pInitialData = initialData.empty() ? nullptr : initialData.data();
+
+        if (vkCreatePipelineCache(_device, &createInfo, nullptr, &_cache) != VK_SUCCESS) {
+            // A driver may still refuse data that passed the header check; an empty cache is always acceptable
+            std::cout << "Failed to create pipeline cache from disk data, starting with an empty cache." << std::endl;
+            createInfo.initialDataSize = 0;
+            createInfo.pInitialData = nullptr;
+            _loadedSize = 0;
+            VK_CHECK("VulkanPipelineCache::Init::vkCreatePipelineCache", vkCreatePipelineCache(_device, &createInfo, nullptr, &_cache));
+        }
+
+        std::cout << "Pipeline cache loaded " << _loadedSize << " bytes from " << getCacheFilePath() << std::endl;
+    }
+
+    void VulkanPipelineCache::Shutdown() {
+        if (_cache == VK_NULL_HANDLE) return;
+
+        logStatistics();
+        writeCacheFile();
+
+        vkDestroyPipelineCache(_device, _cache, nullptr);
+        _cache = VK_NULL_HANDLE;
+        _device = VK_NULL_HANDLE;
+    }
+
+    VkPipeline VulkanPipelineCache::CreateGraphicsPipeline(const VkGraphicsPipelineCreateInfo &createInfo) {
+        VkGraphicsPipelineCreateInfo pipelineCreateInfo = createInfo;
+
+        VkPipelineCreationFeedbackEXT pipelineFeedback {};
+        VkPipelineCreationFeedbackCreateInfoEXT feedbackCreateInfo { VK_STRUCTURE_TYPE_PIPELINE_CREATION_FEEDBACK_CREATE_INFO_EXT };
+        feedbackCreateInfo.pPipelineCreationFeedback = &pipelineFeedback;
+
+        if (_creationFeedbackEnabled) {
+            feedbackCreateInfo.pNext = pipelineCreateInfo.pNext;
+            pipelineCreateInfo.pNext = &feedbackCreateInfo;
+        }
+
+        auto startTime { std::chrono::high_resolution_clock::now() };
+
+        VkPipeline pipeline { VK_NULL_HANDLE };
+        if (vkCreateGraphicsPipelines(_device, _cache, 1, &pipelineCreateInfo, nullptr, &pipeline) != VK_SUCCESS) {
+            std::cout << "Failed to create pipeline\n";
+            return VK_NULL_HANDLE;
+        }
+
+        auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - startTime).count();
+
+        _pipelinesCreated++;
+
+        bool cacheHit = _creationFeedbackEnabled &&
+                (pipelineFeedback.flags & VK_PIPELINE_CREATION_FEEDBACK_VALID_BIT_EXT) &&
+                (pipelineFeedback.flags & VK_PIPELINE_CREATION_FEEDBACK_APPLICATION_PIPELINE_CACHE_HIT_BIT_EXT);
+
+        if (cacheHit) {
+            _cacheHits++;
+            _hitMicroseconds += static_cast<uint64_t>(elapsed);
+        } else {
+            _missMicroseconds += static_cast<uint64_t>(elapsed);
+        }
+
+        return pipeline;
+    }
+
+    Path VulkanPipelineCache::getCacheFilePath() const {
+        std::stringstream filename;
+        filename << "pipeline_" << std::hex << std::setfill('0')
+                 << std::setw(4) << _deviceProperties.vendorID << "_"
+                 << std::setw(4) << _deviceProperties.deviceID << "_"
+                 << std::setw(8) << _deviceProperties.driverVersion << "_";
+
+        for (auto byte : _deviceProperties.pipelineCacheUUID) {
+            filename << std::setw(2) << static_cast<uint32_t>(byte);
+        }
+
+        filename << ".cache";
+
+        return Filesystem::GetAppUserDataDirectory() / "cache" / filename.str();
+    }
+
+    bool VulkanPipelineCache::isCacheDataCompatible(const std::vector<char>& data) const {
+        if (data.size() < sizeof(VkPipelineCacheHeaderVersionOne)) return false;
+
+        VkPipelineCacheHeaderVersionOne header {};
+        std::memcpy(&header, data.data(), sizeof(header));
+
+        return header.headerSize >= sizeof(VkPipelineCacheHeaderVersionOne) &&
+               header.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+               header.vendorID == _deviceProperties.vendorID &&
+               header.deviceID == _deviceProperties.deviceID &&
+               std::memcmp(header.pipelineCacheUUID, _deviceProperties.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+    }
+
+    std::vector<char> VulkanPipelineCache::readCacheFile() const {
+        auto cachePath = getCacheFilePath();
+
+        if (!Filesystem::DoesFileExist(cachePath)) return {};
+
+        std::ifstream file(cachePath, std::ios::ate | std::ios::binary);
+
+        if (!file.is_open()) return {};
+
+        auto fileSize = static_cast<size_t>(file.tellg());
+        std::vector<char> data(fileSize);
+
+        file.seekg(0);
+        file.read(data.data(), static_cast<std::streamsize>(fileSize));
+
+        if (!file) return {};
+
+        return data;
+    }
+
+    void VulkanPipelineCache::writeCacheFile() const {
+        size_t dataSize { 0 };
+        if (vkGetPipelineCacheData(_device, _cache, &dataSize, nullptr) != VK_SUCCESS || dataSize == 0) return;
+
+        std::vector<char> data(dataSize);
+        if (vkGetPipelineCacheData(_device, _cache, &dataSize, data.data()) != VK_SUCCESS) return;
+
+        auto cachePath = getCacheFilePath();
+
+        std::error_code ec;
+        std::filesystem::create_directories(cachePath.parent_path(), ec);
+
+        // Write to a temporary file first so a crash mid-write never leaves a truncated cache behind
+        auto tempPath = cachePath;
+        tempPath += ".tmp";
+
+        {
+            std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+
+            if (!file.is_open()) {
+                std::cout << "Failed to open pipeline cache for writing: " << tempPath << std::endl;
+                return;
+            }
+
+            file.write(data.data(), static_cast<std::streamsize>(dataSize));
+        }
+
+        std::filesystem::rename(tempPath, cachePath, ec);
+
+        if (ec) {
+            std::cout << "Failed to write pipeline cache: " << ec.message() << std::endl;
+            return;
+        }
+
+        std::cout << "Pipeline cache saved " << dataSize << " bytes to " << cachePath << std::endl;
+    }
+
+    void VulkanPipelineCache::logStatistics() const {
+        uint32_t created = _pipelinesCreated;
+        if (created == 0) return;
+
+        uint32_t hits = _cacheHits;
+        uint32_t misses = created - hits;
+
+        double hitMs = static_cast<double>(_hitMicroseconds) / 1000.0;
+        double missMs = static_cast<double>(_missMicroseconds) / 1000.0;
+
+        std::cout << "Pipeline cache: " << created << " pipelines created in " << (hitMs + missMs) << "ms";
+
+        if (!_creationFeedbackEnabled) {
+            std::cout << " (hit rate unavailable without VK_EXT_pipeline_creation_feedback)" << std::endl;
+            return;
+        }
+
+        std::cout << ", " << hits << " cache hits (" << (100.0 * hits / created) << "%)";
+
+        // Estimate what the hits would have cost if they had compiled at the average miss cost
+        if (hits > 0 && misses > 0) {
+            double averageMissMs = missMs / misses;
+            double savedMs = averageMissMs * hits - hitMs;
+            std::cout << ", ~" << savedMs << "ms saved";
+        }
+
+        std::cout << std::endl;
+    }
+}
@@ -0,0 +1,47 @@
+#pragma once
+#include <youtube_engine/platform/filesystem.h>
+
+#include <atomic>
+#include <vector>
+
+#include "vulkan_includes.h"
+
+namespace OZZ {
+    /*
+     * Wraps a VkPipelineCache that persists between runs. The cache file lives in the user data directory and is keyed
+     * by the device's pipeline cache UUID and driver version so a driver update never gets fed stale data.
+     */
+    class VulkanPipelineCache {
+    public:
+        VulkanPipelineCache() = default;
+
+        void Init(VkPhysicalDevice physicalDevice, VkDevice device, bool creationFeedbackEnabled);
+        void Shutdown();
+
+        VkPipeline CreateGraphicsPipeline(const VkGraphicsPipelineCreateInfo& createInfo);
+
+        [[nodiscard]] VkPipelineCache GetHandle() const { return _cache; }
+
+    private:
+        [[nodiscard]] Path getCacheFilePath() const;
+        [[nodiscard]] bool isCacheDataCompatible(const std::vector<char>& data) const;
+
+        std::vector<char> readCacheFile() const;
+        void writeCacheFile() const;
+        void logStatistics() const;
+
+    private:
+        VkDevice _device { VK_NULL_HANDLE };
+        VkPipelineCache _cache { VK_NULL_HANDLE };
+        VkPhysicalDeviceProperties _deviceProperties {};
+
+        bool _creationFeedbackEnabled { false };
+        size_t _loadedSize { 0 };
+
+        // Pipelines may be compiled from multiple threads, so the statistics are atomic
+        std::atomic<uint32_t> _pipelinesCreated { 0 };
+        std::atomic<uint32_t> _cacheHits { 0 };
+        std::atomic<uint64_t> _hitMicroseconds { 0 };
+        std::atomic<uint64_t> _missMicroseconds { 0 };
+    };
+}
@@ -5,10 +5,14 @@
 
 #include "vulkan_renderer.h"
 
+#include <algorithm>
 #include <cmath>
 #include <map>
+#include <tuple>
 #include <VkBootstrap.h>
 
+#include <youtube_engine/core/profiler.h>
+#include <youtube_engine/platform/filesystem.h>
 #include <youtube_engine/service_locator.h>
 #include <vr/openxr/open_xr_subsystem.h>
 
@@ -20,8 +24,31 @@
 
 
 namespace OZZ {
+    // Below this many draws handing out the work costs more than recording it
+    constexpr size_t PARALLEL_RECORDING_MIN_DRAWS = 512;
+    constexpr size_t DRAWS_PER_RECORDING_JOB = 128;
+
+    // Texture slots a material can have, each written per draw when it isn't bindless
+    constexpr size_t MAX_DRAW_TEXTURES = static_cast<size_t>(ResourceName::EndTextures) - static_cast<size_t>(ResourceName::Diffuse0);
+
+    // Neighbouring draws mostly share a pipeline and material, so a recording's binds stay coherent. Bindless draws all
+    // bind the same sets, so only their pipeline and mesh matter.
+    static void sortDrawPackets(std::vector<DrawPacket>& packets) {
+        std::sort(packets.begin(), packets.end(), [](const DrawPacket& a, const DrawPacket& b) {
+            auto* materialA = a.Bindless ? nullptr : a.SourceMaterial;
+            auto* materialB = b.Bindless ? nullptr : b.SourceMaterial;
+            return std::tie(a.Pipeline, materialA, a.Geometry, a.DrawIndex) < std::tie(b.Pipeline, materialB, b.Geometry, b.DrawIndex);
+        });
+    }
+
     void VulkanRenderer::Init() {
+        std::lock_guard<std::recursive_mutex> lock(_resourceMutex);
+
         if (_initialized) return;
+
+        _framesInFlight = std::clamp(_rendererSettings.FramesInFlight, 1u, MAX_FRAMES_IN_FLIGHT);
+        _frames.resize(_framesInFlight);
+
         initCore() ;
 
         if (_rendererSettings.VR) {
@@ -52,6 +79,8 @@ namespace OZZ {
     }
 
     void VulkanRenderer::Shutdown() {
+        std::lock_guard<std::recursive_mutex> lock(_resourceMutex);
+
         if (!_initialized) return;
         WaitForIdle();
 
@@ -64,6 +93,15 @@ namespace OZZ {
         }
 
         cleanResources();
+        _frames.clear();
+
+        _shaderRegistry.Shutdown();
+        _samplerCache.Shutdown();
+        _pipelineCache.Shutdown();
+
+        // Pipelines retired by the registry
+        _deletionQueue.Flush();
+        _timeline.Shutdown();
 
         vkDestroyDevice(_device, nullptr);
         _device = VK_NULL_HANDLE;
@@ -76,13 +114,22 @@ namespace OZZ {
         _frameNumber = 0;
     }
 
-    void VulkanRenderer::Reset() {
-        Reset(_rendererSettings);
-    }
+    void VulkanRenderer::Reset(RendererResetCause cause) {
+        if (_initialized && cause == RendererResetCause::PresentModeChange) {
+            // Nothing outside of the swapchain depends on its present mode
+            std::lock_guard<std::recursive_mutex> lock(_resourceMutex);
+            recreateSwapchain();
+            return;
+        }
+
+        // VR ignores these settings, and its swapchains belong to the runtime, so it doesn't get the partial rebuild
+        if (_initialized && cause == RendererResetCause::SettingsChange && !_rendererSettings.VR) {
+            std::lock_guard<std::recursive_mutex> lock(_resourceMutex);
+            recreateFrameResources();
+            return;
+        }
 
-    void VulkanRenderer::Reset(RendererSettings settings) {
         _resetting = true;
-        _rendererSettings = settings;
 
         Shutdown();
         Init();
@@ -94,7 +141,26 @@ namespace OZZ {
         _resetting = false;
     }
 
+    void VulkanRenderer::Reset(RendererSettings settings, RendererResetCause cause) {
+        cause = std::max(cause, getResetCause(settings));
+
+        _rendererSettings = std::move(settings);
+        Reset(cause);
+    }
+
     void VulkanRenderer::RenderFrame(SceneParams &sceneParams, const vector<RenderableObject> &objects) {
+        OZZ_PROFILE_SCOPE("VulkanRenderer::RenderFrame");
+
+        if (!_rendererSettings.VR) {
+            // The wait doesn't touch anything shared, so uploads from the game thread can go ahead meanwhile
+            waitForCurrentFrame();
+        }
+
+        std::lock_guard<std::recursive_mutex> lock(_resourceMutex);
+
+        // Picked up by the streamer when the frame begins
+        requestTextureMips(sceneParams.TextureMipRequests);
+
         if (_rendererSettings.VR) {
             auto* vr = ServiceLocator::GetVRSubsystem();
             if (!vr || !vr->IsInitialized()) {
@@ -115,8 +181,11 @@ namespace OZZ {
                 if (!_initialized || _resetting) return;
                 renderFrameWindow(sceneParams, objects);
             endFrameWindow();
+            getCurrentFrame().InputTime = sceneParams.InputTime;
             _frameNumber++;
         }
+
+        finishFrameStats();
     }
 
     void VulkanRenderer::WaitForIdle() {
@@ -144,6 +213,63 @@ namespace OZZ {
         return std::make_shared<VulkanTexture>(this);
     }
 
+    void VulkanRenderer::finishFrameStats() {
+        std::lock_guard<std::mutex> lock(_statsMutex);
+
+        _lastFrameStats = _frameStats;
+        _lastGpuTimings = _gpuProfiler.GetLatestTimings();
+        _frameStats = { .FrameNumber = _lastFrameStats.FrameNumber + 1 };
+    }
+
+    void VulkanRenderer::recordDescriptorPoolStats() {
+        auto stats = _descriptorSetManager.GetStats();
+        _frameStats.DescriptorPools = stats.Pools;
+        _frameStats.DescriptorSetsPerPool = stats.SetsPerPool;
+        _frameStats.DescriptorSetsHighWater = stats.PeakSetsPerFrame;
+    }
+
+    FrameStats VulkanRenderer::GetFrameStats() const {
+        std::lock_guard<std::mutex> lock(_statsMutex);
+        return _lastFrameStats;
+    }
+
+    void VulkanRenderer::SetGpuProfilingSettings(const GpuProfilingSettings& settings) {
+        std::lock_guard<std::recursive_mutex> lock(_resourceMutex);
+        _gpuProfiler.SetSettings(settings);
+    }
+
+    GpuFrameTimings VulkanRenderer::GetGpuFrameTimings() const {
+        std::lock_guard<std::mutex> lock(_statsMutex);
+        return _lastGpuTimings;
+    }
+
+    void VulkanRenderer::waitForCurrentFrame() {
+        OZZ_PROFILE_SCOPE("VulkanRenderer::waitForCurrentFrame");
+
+        if (!_initialized) return;
+
+        // Oldest first, so the newest frame that has finished is the one reported
+        auto completedValue = _timeline.GetCompletedValue();
+        for (uint32_t i = 0; i < _framesInFlight; i++) {
+            auto& frame = _frames[(getCurrentFrameNumber() + i) % _framesInFlight];
+
+            if (frame.TimelineValue <= completedValue) {
+                sampleInputLatency(frame);
+            }
+        }
+
+        VK_CHECK("VulkanRenderer::waitForCurrentFrame()::vkWaitSemaphores", _timeline.Wait(getCurrentFrame().TimelineValue, 1000000000));
+        sampleInputLatency(getCurrentFrame());
+    }
+
+    void VulkanRenderer::sampleInputLatency(FrameData& frame) {
+        if (frame.InputTime == std::chrono::steady_clock::time_point {}) return;
+
+        auto latency = std::chrono::steady_clock::now() - frame.InputTime;
+        _inputToPresentMs = std::chrono::duration<float, std::milli> { latency }.count();
+        frame.InputTime = {};
+    }
+
     /*
      * PRIVATE
      */
@@ -166,8 +292,9 @@ namespace OZZ {
                     instanceExtensions.insert(extension);
                 }
 
+                // Frames are tracked with timeline semaphores, which are core from 1.2
                 auto graphicsRequirements = xr->GetVulkanGraphicsRequirements();
-                vulkanVersion = static_cast<uint32_t>(graphicsRequirements.minApiVersionSupported);
+                vulkanVersion = std::max(vulkanVersion, static_cast<uint32_t>(graphicsRequirements.minApiVersionSupported));
             }
         }
 
@@ -226,13 +353,81 @@ namespace OZZ {
 
         deviceExtensions.insert("VK_KHR_push_descriptor");
 
+        // Lets the pipeline cache report whether each pipeline came out of the cache
+        bool pipelineCreationFeedback = VulkanUtilities::IsDeviceExtensionSupported(_physicalDevice, VK_EXT_PIPELINE_CREATION_FEEDBACK_EXTENSION_NAME);
+        if (pipelineCreationFeedback) {
+            deviceExtensions.insert(VK_EXT_PIPELINE_CREATION_FEEDBACK_EXTENSION_NAME);
+        }
+
 #if __APPLE__
     #if TARGET_OS_MAC
         deviceExtensions.emplace_back("VK_KHR_portability_subset");
     #endif
 #endif
 
-        auto [device, queueIndices] = createLogicalDevice(_physicalDevice, deviceExtensions);
+        vkGetPhysicalDeviceProperties(_physicalDevice, &_physicalDeviceProperties);
+
+        // Only turn on the optional features we use and the device has
+        VkPhysicalDeviceFeatures supportedFeatures {};
+        vkGetPhysicalDeviceFeatures(_physicalDevice, &supportedFeatures);
+
+        _enabledFeatures = {};
+        _enabledFeatures.samplerAnisotropy = supportedFeatures.samplerAnisotropy;
+        _enabledFeatures.textureCompressionBC = supportedFeatures.textureCompressionBC;
+        _enabledFeatures.pipelineStatisticsQuery = supportedFeatures.pipelineStatisticsQuery;
+        _enabledFeatures.drawIndirectFirstInstance = supportedFeatures.drawIndirectFirstInstance;
+
+        // Bindless textures need a runtime sized, partially bound array that can be written while frames are in flight.
+        // Turned on whenever the device has it, so switching bindless textures on later doesn't need a new device.
+        VkPhysicalDeviceDescriptorIndexingFeaturesEXT descriptorIndexing { VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES_EXT };
+        VkPhysicalDeviceDescriptorIndexingPropertiesEXT descriptorIndexingProperties { VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES_EXT };
+        bool bindlessTextures { false };
+
+        if (!_rendererSettings.VR && VulkanUtilities::IsDeviceExtensionSupported(_physicalDevice, VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME)) {
+            VkPhysicalDeviceFeatures2 features2 { VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2 };
+            features2.pNext = &descriptorIndexing;
+            vkGetPhysicalDeviceFeatures2(_physicalDevice, &features2);
+
+            VkPhysicalDeviceProperties2 properties2 { VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2 };
+            properties2.pNext = &descriptorIndexingProperties;
+            vkGetPhysicalDeviceProperties2(_physicalDevice, &properties2);
+
+            bindlessTextures = descriptorIndexing.runtimeDescriptorArray
+                               && descriptorIndexing.descriptorBindingPartiallyBound
+                               && descriptorIndexing.descriptorBindingSampledImageUpdateAfterBind
+                               && descriptorIndexing.shaderSampledImageArrayNonUniformIndexing;
+        }
+
+        if (bindlessTextures) {
+            deviceExtensions.insert(VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME);
+
+            // Only what the bindless set uses
+            descriptorIndexing = { VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES_EXT };
+            descriptorIndexing.runtimeDescriptorArray = VK_TRUE;
+            descriptorIndexing.descriptorBindingPartiallyBound = VK_TRUE;
+            descriptorIndexing.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+            descriptorIndexing.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+        }
+
+        _maxBindlessTextures = bindlessTextures ? std::min(descriptorIndexingProperties.maxPerStageDescriptorUpdateAfterBindSamplers,
+                                                           descriptorIndexingProperties.maxPerStageDescriptorUpdateAfterBindSampledImages) : 0;
+
+        // Frames, uploads and VR eyes all signal the one timeline
+        VkPhysicalDeviceTimelineSemaphoreFeatures timelineSemaphore { VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES };
+        {
+            VkPhysicalDeviceFeatures2 features2 { VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2 };
+            features2.pNext = &timelineSemaphore;
+            vkGetPhysicalDeviceFeatures2(_physicalDevice, &features2);
+        }
+
+        if (!timelineSemaphore.timelineSemaphore) {
+            std::cerr << "Vulkan device doesn't support timeline semaphores!" << std::endl;
+            return;
+        }
+
+        timelineSemaphore.pNext = bindlessTextures ? &descriptorIndexing : nullptr;
+
+        auto [device, queueIndices] = createLogicalDevice(_physicalDevice, deviceExtensions, _enabledFeatures, &timelineSemaphore);
 
         if (device == VK_NULL_HANDLE) {
             std::cerr << "Failed to acquire Vulkan logical device" << std::endl;
@@ -249,14 +444,57 @@ namespace OZZ {
         allocatorCreateInfo.instance = _instance;
         vmaCreateAllocator(&allocatorCreateInfo, &_allocator);
 
+        _pipelineCache.Init(_physicalDevice, _device, pipelineCreationFeedback);
+        _timeline.Init(_device);
+        _deletionQueue.Init(&_timeline);
+        _shaderRegistry.Init(_device, &_pipelineCache, &_deletionQueue);
+        _samplerCache.Init(_device, _physicalDeviceProperties, _enabledFeatures);
+        _textureStreamer.Init(this, static_cast<uint64_t>(_rendererSettings.TextureBudgetMB) * 1024 * 1024);
+
+        initFrameResources();
+
+        auto [width, height] = ServiceLocator::GetWindow()->GetWindowExtents();
+        _framebufferWidth = width;
+        _framebufferHeight = height;
+
+        // Runs on the game thread as it pumps the window
         ServiceLocator::GetWindow()->RegisterWindowResizedCallback([this](){
+            auto [width, height] = ServiceLocator::GetWindow()->GetWindowExtents();
+            _framebufferWidth = width;
+            _framebufferHeight = height;
             _recreateFrameBuffer = true;
         });
+    }
+
+    void VulkanRenderer::initFrameResources() {
+        _gpuProfiler.Init(_physicalDevice, _device, _graphicsQueueFamily, _enabledFeatures, _framesInFlight);
 
-        _descriptorSetManager = VulkanDescriptorSetManager { &_device };
+        if (_rendererSettings.BindlessTextures && !_rendererSettings.VR) {
+            if (_maxBindlessTextures > 0) {
+                _bindlessTextures.Init(_device, &_allocator, _framesInFlight, _maxBindlessTextures);
+            } else {
+                std::cout << "Bindless textures need descriptor indexing, writing texture descriptors per draw instead." << std::endl;
+            }
+        }
+        _shaderRegistry.SetBindlessLayout(_bindlessTextures.GetSetLayout());
+
+        if (usesOcclusionCulling()) {
+            _occlusionCuller.Init(_device, &_allocator, _pipelineCache.GetHandle(), &_samplerCache, _framesInFlight);
+        }
+
+        if (usesGpuDrivenRendering()) {
+            _indirectRenderer.Init(_device, &_allocator, _pipelineCache.GetHandle(), _framesInFlight);
+        } else if (_rendererSettings.GpuDrivenRendering && !_rendererSettings.VR) {
+            std::cout << "GPU driven rendering needs drawIndirectFirstInstance and no depth pre-pass, drawing per object instead." << std::endl;
+        }
+
+        _descriptorSetManager = VulkanDescriptorSetManager { &_device, _framesInFlight };
     }
 
     void VulkanRenderer::cleanupSwapchain() {
+        // Pipelines still compiling in the background reference the render passes destroyed below
+        _shaderRegistry.WaitForCompilation();
+
         // Clean VR swapchain
         for (auto& eyeFrames : _vrFrames) {
             for (auto& eyeFrame: eyeFrames) {
@@ -317,6 +555,8 @@ namespace OZZ {
             imageView = VK_NULL_HANDLE;
         }
 
+        _occlusionCuller.DestroyTargets();
+
         vkDestroyImageView(_device, _depthImageView, nullptr);
         _depthImageView = VK_NULL_HANDLE;
         vmaDestroyImage(_allocator, _depthImage, _depthImageAllocation);
@@ -326,8 +566,6 @@ namespace OZZ {
     void VulkanRenderer::cleanResources() {
         cleanupSwapchain();
 
-        _descriptorSetManager.Shutdown();
-
         vkDestroySwapchainKHR(_device, _swapchain, nullptr);
         _swapchain = VK_NULL_HANDLE;
 
@@ -339,19 +577,9 @@ namespace OZZ {
             }
         }
 
-        for (auto& frame : _frames) {
-            frame.CameraData.reset();
-            vkDestroySemaphore(_device, frame.PresentSemaphore, nullptr);
-            frame.PresentSemaphore = VK_NULL_HANDLE;
-            vkDestroySemaphore(_device, frame.RenderSemaphore, nullptr);
-            frame.RenderSemaphore = VK_NULL_HANDLE;
-            vkDestroyFence(_device, frame.RenderFence, nullptr);
-            frame.RenderFence = VK_NULL_HANDLE;
-            vkDestroyCommandPool(_device, frame.CommandPool, nullptr);
-            frame.CommandPool = VK_NULL_HANDLE;
-        }
+        cleanFrameResources();
 
-        if (_bufferCommandPool == VK_NULL_HANDLE) {
+        if (_bufferCommandPool != VK_NULL_HANDLE) {
             vkDestroyCommandPool(_device, _bufferCommandPool, nullptr);
             _bufferCommandPool = VK_NULL_HANDLE;
         }
@@ -362,12 +590,103 @@ namespace OZZ {
             resourceManager->ClearGPUResourcesForReset();
         }
 
+        _textureStreamer.Shutdown();
+
+        // Everything retired so far, down to the last staging buffer, has to go before the allocator
+        _deletionQueue.Flush();
+
         vmaDestroyAllocator(_allocator);
         _allocator = VK_NULL_HANDLE;
     }
 
+    void VulkanRenderer::cleanFrameResources() {
+        _descriptorSetManager.Shutdown();
+
+        for (auto& frame : _frames) {
+            frame.CameraData.reset();
+            vkDestroySemaphore(_device, frame.PresentSemaphore, nullptr);
+            frame.PresentSemaphore = VK_NULL_HANDLE;
+            vkDestroySemaphore(_device, frame.RenderSemaphore, nullptr);
+            frame.RenderSemaphore = VK_NULL_HANDLE;
+            frame.TimelineValue = 0;
+            vkDestroyCommandPool(_device, frame.CommandPool, nullptr);
+            frame.CommandPool = VK_NULL_HANDLE;
+
+            // Destroying the pools frees their secondary buffers
+            for (auto pool : frame.RecordingPools) {
+                vkDestroyCommandPool(_device, pool, nullptr);
+            }
+            frame.RecordingPools.clear();
+            frame.SecondaryCommandBuffers.clear();
+
+            if (frame.StaticDraws.CommandPool != VK_NULL_HANDLE) {
+                vkDestroyCommandPool(_device, frame.StaticDraws.CommandPool, nullptr);
+                frame.StaticDraws.Descriptors.Shutdown();
+            }
+            frame.StaticDraws = {};
+        }
+
+        // Owns layouts and a pipeline on this device
+        _depthPrepassProgram.reset();
+        _occlusionCuller.Shutdown();
+        _indirectRenderer.Shutdown();
+        _bindlessTextures.Shutdown();
+        _gpuProfiler.Shutdown();
+    }
+
+    void VulkanRenderer::recreateFrameResources() {
+        // Every frame in flight uses the pools, sets and render pass that are about to go
+        WaitForIdle();
+        cleanupSwapchain();
+        cleanFrameResources();
+
+        // Programs are keyed on the render pass and built against the bindless layout. Sources stay cached.
+        _shaderRegistry.Shutdown();
+        _shaderRegistry.Init(_device, &_pipelineCache, &_deletionQueue);
+
+        _framesInFlight = std::clamp(_rendererSettings.FramesInFlight, 1u, MAX_FRAMES_IN_FLIGHT);
+        _frames.clear();
+        _frames.resize(_framesInFlight);
+        _frameNumber = 0;
+
+        initFrameResources();
+
+        // The swapchain is kept and handed over to the new one
+        createSwapchain();
+        createCommands();
+        createRenderPass();
+        createFramebuffers();
+        createSyncStructures();
+        _frameStats.SwapchainRecreations++;
+        _swapchainGeneration++;
+
+        // Materials pick up pipelines for the new pass, and their instanced and bindless variants if those are now on
+        if (auto* resourceManager = ServiceLocator::GetResourceManager()) {
+            resourceManager->ReloadShaders();
+        }
+    }
+
+    RendererResetCause VulkanRenderer::getResetCause(const RendererSettings& settings) const {
+        if (settings.VR != _rendererSettings.VR) return RendererResetCause::VRToggle;
+
+        // Anything left different once the settings the frame resources cover are matched needs a new device
+        auto deviceSettings = settings;
+        deviceSettings.DepthPrepass = _rendererSettings.DepthPrepass;
+        deviceSettings.OcclusionCulling = _rendererSettings.OcclusionCulling;
+        deviceSettings.GpuDrivenRendering = _rendererSettings.GpuDrivenRendering;
+        deviceSettings.BindlessTextures = _rendererSettings.BindlessTextures;
+        deviceSettings.FramesInFlight = _rendererSettings.FramesInFlight;
+        deviceSettings.Present = _rendererSettings.Present;
+        if (deviceSettings != _rendererSettings) return RendererResetCause::DeviceLost;
+
+        auto presentOnly = _rendererSettings;
+        presentOnly.Present = settings.Present;
+        return settings == presentOnly ? RendererResetCause::PresentModeChange : RendererResetCause::SettingsChange;
+    }
+
     void VulkanRenderer::recreateSwapchain() {
-        auto [width, height] = ServiceLocator::GetWindow()->GetWindowExtents();
+        int width = _framebufferWidth;
+        int height = _framebufferHeight;
 
         if (width == 0 || height == 0) {
             // if the framebuffer size is zero, the window is minimized and we should pause the renderer.
@@ -375,13 +694,72 @@ namespace OZZ {
             return;
         }
 
-        vkDeviceWaitIdle(_device);
-        cleanupSwapchain();
+        // The runtime owns the VR swapchains, so those are still rebuilt with the device idle
+        if (_rendererSettings.VR) {
+            vkDeviceWaitIdle(_device);
+            cleanupSwapchain();
+
+            createSwapchain();
+            _frameStats.SwapchainRecreations++;
+            createCommands();
+            createRenderPass();
+            createFramebuffers();
+            return;
+        }
+
+        // Frames in flight keep rendering into the old targets while the new ones are made. The render pass, command
+        // buffers and pipelines don't depend on the size and carry over.
+        retireWindowTargets();
+
+        auto imageFormat = _swapchainImageFormat;
+        createWindowSwapchain();
+        _frameStats.SwapchainRecreations++;
+
+        if (_swapchainImageFormat != imageFormat) {
+            // Queued compiles are still building against the old pass
+            _shaderRegistry.WaitForCompilation();
+
+            _deletionQueue.Retire([device = _device, renderPass = _renderPass]() {
+                vkDestroyRenderPass(device, renderPass, nullptr);
+            });
+            _renderPass = VK_NULL_HANDLE;
+            createRenderPass();
+
+            // Programs are keyed on the attachment formats, so the shaders pick up pipelines for the new ones
+            _depthPrepassProgram.reset();
+            if (auto* resourceManager = ServiceLocator::GetResourceManager()) {
+                resourceManager->ReloadShaders();
+            }
+        }
 
-        createSwapchain();
-        createCommands();
-        createRenderPass();
         createFramebuffers();
+        _swapchainGeneration++;
+    }
+
+    void VulkanRenderer::retireWindowTargets() {
+        _deletionQueue.Retire([device = _device, allocator = _allocator,
+                               framebuffers = std::move(_framebuffers), imageViews = std::move(_swapchainImageViews),
+                               depthImage = _depthImage, depthAllocation = _depthImageAllocation, depthImageView = _depthImageView]() {
+            for (auto framebuffer : framebuffers) {
+                vkDestroyFramebuffer(device, framebuffer, nullptr);
+            }
+
+            for (auto imageView : imageViews) {
+                vkDestroyImageView(device, imageView, nullptr);
+            }
+
+            vkDestroyImageView(device, depthImageView, nullptr);
+            vmaDestroyImage(allocator, depthImage, depthAllocation);
+        });
+
+        _framebuffers.clear();
+        _swapchainImageViews.clear();
+        _depthImage = VK_NULL_HANDLE;
+        _depthImageAllocation = VK_NULL_HANDLE;
+        _depthImageView = VK_NULL_HANDLE;
+
+        // The pyramid is sized to the depth buffer
+        _occlusionCuller.DestroyTargets(&_deletionQueue);
     }
 
 
@@ -444,6 +822,13 @@ namespace OZZ {
                 .pDepthStencilAttachment = &depthAttachmentRef
         };
 
+        // The pre-pass only writes depth, the material subpass then tests against it
+        VkSubpassDescription depthSubpass{
+                .pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS,
+                .colorAttachmentCount = 0,
+                .pDepthStencilAttachment = &depthAttachmentRef
+        };
+
         VkSubpassDependency depth_dependency = {};
         depth_dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
         depth_dependency.dstSubpass = 0;
@@ -452,15 +837,32 @@ namespace OZZ {
         depth_dependency.dstStageMask = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
         depth_dependency.dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
 
-        VkSubpassDependency dependencies[] { depth_dependency };
+        VkSubpassDependency prepass_dependency = {};
+        prepass_dependency.srcSubpass = 0;
+        prepass_dependency.dstSubpass = 1;
+        prepass_dependency.srcStageMask = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+        prepass_dependency.srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+        prepass_dependency.dstStageMask = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+        prepass_dependency.dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT;
+        prepass_dependency.dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT;
+
+        VkSubpassDependency dependencies[] { depth_dependency, prepass_dependency };
+        VkSubpassDescription subpasses[] { depthSubpass, subpass };
 
         VkAttachmentDescription attachments[] {colorAttachment, depthAttachment};
         VkRenderPassCreateInfo renderPassCreateInfo{VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO};
         renderPassCreateInfo.attachmentCount = 2;
         renderPassCreateInfo.pAttachments = attachments;
-        renderPassCreateInfo.subpassCount = 1;
-        renderPassCreateInfo.pSubpasses = &subpass;
-        renderPassCreateInfo.dependencyCount = 1;
+
+        if (usesDepthPrepass()) {
+            renderPassCreateInfo.subpassCount = 2;
+            renderPassCreateInfo.pSubpasses = subpasses;
+            renderPassCreateInfo.dependencyCount = 2;
+        } else {
+            renderPassCreateInfo.subpassCount = 1;
+            renderPassCreateInfo.pSubpasses = &subpass;
+            renderPassCreateInfo.dependencyCount = 1;
+        }
         renderPassCreateInfo.pDependencies = dependencies;
 
         VK_CHECK("VulkanRenderer::createWindowRenderPass()::vkCreateRenderPass", vkCreateRenderPass(_device, &renderPassCreateInfo, nullptr, &_renderPass));
@@ -522,14 +924,10 @@ namespace OZZ {
     }
 
     void VulkanRenderer::createSyncStructures() {
-        VkFenceCreateInfo fenceCreateInfo{VK_STRUCTURE_TYPE_FENCE_CREATE_INFO};
-        fenceCreateInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
-
+        // Frames themselves are tracked on the timeline, these only order acquire, rendering and present
         VkSemaphoreCreateInfo semaphoreCreateInfo{VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO};
 
         for (auto& frame : _frames) {
-            VK_CHECK("VulkanRenderer::createSyncStructures()::vkCreateFence", vkCreateFence(_device, &fenceCreateInfo, nullptr, &frame.RenderFence));
-
             VK_CHECK("VulkanRenderer::createSyncStructures()::vkCreateSemaphore1", vkCreateSemaphore(_device, &semaphoreCreateInfo, nullptr, &frame.PresentSemaphore));
             VK_CHECK("VulkanRenderer::createSyncStructures()::vkCreateSemaphore2", vkCreateSemaphore(_device, &semaphoreCreateInfo, nullptr, &frame.RenderSemaphore));
         }
@@ -539,7 +937,8 @@ namespace OZZ {
 
         VkSwapchainKHR oldSwapchain = _swapchain;
 
-        auto[width, height] = ServiceLocator::GetWindow()->GetWindowExtents();
+        int width = _framebufferWidth;
+        int height = _framebufferHeight;
         _windowExtent.width = width;
         _windowExtent.height = height;
 
@@ -550,7 +949,7 @@ namespace OZZ {
                                             .format = VK_FORMAT_R8G8B8A8_SRGB,
                                             .colorSpace = VK_COLOR_SPACE_SRGB_NONLINEAR_KHR
                                     })
-                .set_desired_present_mode(VK_PRESENT_MODE_FIFO_RELAXED_KHR)     // Hard VSync
+                .set_desired_present_mode(choosePresentMode())
                 .set_desired_extent(width, height)
                 .set_old_swapchain(oldSwapchain)
                 .build()
@@ -563,7 +962,11 @@ namespace OZZ {
         _swapchainImageFormat = vkbSwapchain.image_format;
 
         if (oldSwapchain) {
-            vkDestroySwapchainKHR(_device, oldSwapchain, nullptr);
+            // Presents aren't on the timeline. Every frame submitted from here on uses the new swapchain, so once
+            // a full set of frames in flight is through, the old one's last presents are too.
+            _deletionQueue.Retire(_timeline.GetSubmittedValue() + _framesInFlight, [device = _device, oldSwapchain]() {
+                vkDestroySwapchainKHR(device, oldSwapchain, nullptr);
+            });
         }
 
         // Create depth image
@@ -587,6 +990,11 @@ namespace OZZ {
                 .usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT
         };
 
+        // The occlusion culler reduces it into its depth pyramid
+        if (usesOcclusionCulling()) {
+            depthCreateInfo.usage |= VK_IMAGE_USAGE_SAMPLED_BIT;
+        }
+
         VmaAllocationCreateInfo depthImageCreateInfo {
                 .usage = VMA_MEMORY_USAGE_GPU_ONLY,
                 .requiredFlags = VkMemoryPropertyFlags {VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT}
@@ -610,6 +1018,38 @@ namespace OZZ {
         };
 
         VK_CHECK("VulkanRenderer::createSwapchain()::vkCreateImageView", vkCreateImageView(_device, &depthImageViewCreateInfo, nullptr, &_depthImageView));
+
+        if (usesOcclusionCulling()) {
+            _occlusionCuller.CreateTargets(_depthImageView, _windowExtent);
+        }
+    }
+
+    VkPresentModeKHR VulkanRenderer::choosePresentMode() {
+        VkPresentModeKHR desired { VK_PRESENT_MODE_FIFO_KHR };
+
+        switch (_rendererSettings.Present) {
+            case PresentMode::Fifo:
+                return VK_PRESENT_MODE_FIFO_KHR;
+            case PresentMode::Mailbox:
+                desired = VK_PRESENT_MODE_MAILBOX_KHR;
+                break;
+            case PresentMode::Immediate:
+                desired = VK_PRESENT_MODE_IMMEDIATE_KHR;
+                break;
+        }
+
+        uint32_t modeCount { 0 };
+        vkGetPhysicalDeviceSurfacePresentModesKHR(_physicalDevice, _surface, &modeCount, nullptr);
+        std::vector<VkPresentModeKHR> modes(modeCount);
+        vkGetPhysicalDeviceSurfacePresentModesKHR(_physicalDevice, _surface, &modeCount, modes.data());
+
+        if (std::find(modes.begin(), modes.end(), desired) != modes.end()) {
+            return desired;
+        }
+
+        // Every surface has to support FIFO
+        std::cout << "Present mode not supported by the surface, presenting with FIFO instead." << std::endl;
+        return VK_PRESENT_MODE_FIFO_KHR;
     }
 
     void VulkanRenderer::createVRSwapchain() {
@@ -828,10 +1268,29 @@ namespace OZZ {
     }
 
     void VulkanRenderer::beginFrameWindow() {
-        VK_CHECK("VulkanRenderer::BeginFrame()::vkWaitForFences", vkWaitForFences(_device, 1, &getCurrentFrame().RenderFence, true, 1000000000)); // 1
-        VK_CHECK("VulkanRenderer::BeginFrame()::vkResetFences", vkResetFences(_device, 1, &getCurrentFrame().RenderFence));                     // 0
+        // Waited on in waitForCurrentFrame, outside of the resource lock
+        _frameStats.FenceWaits++;
+        _frameStats.InputToPresentMs = _inputToPresentMs;
 
         _descriptorSetManager.NextDescriptorFrame();
+        recordDescriptorPoolStats();
+        _deletionQueue.Collect();
+        _textureStreamer.Update();
+        _gpuProfiler.BeginFrame();
+
+        if (usesOcclusionCulling()) {
+            auto occlusion = _occlusionCuller.BeginFrame(getCurrentFrameNumber());
+            _frameStats.OcclusionCandidates = occlusion.Candidates;
+            _frameStats.OcclusionCulled = occlusion.Candidates - occlusion.Visible;
+        }
+
+        if (usesGpuDrivenRendering()) {
+            _indirectRenderer.BeginFrame(getCurrentFrameNumber());
+        }
+
+        if (usesBindlessTextures()) {
+            _bindlessTextures.BeginFrame(getCurrentFrameNumber());
+        }
 
         VkResult result = vkAcquireNextImageKHR(_device, _swapchain, 1000000000, getCurrentFrame().PresentSemaphore,
                                                 VK_NULL_HANDLE, &getCurrentFrame().SwapchainImageIndex);
@@ -850,6 +1309,11 @@ namespace OZZ {
 
         VK_CHECK("VulkanRenderer::BeginFrame()::vkBeginCommandBuffer", vkBeginCommandBuffer(cmd, &beginInfo));
 
+        _gpuProfiler.ResetQueries(cmd);
+        _gpuProfiler.BeginScope(cmd, "Main Pass", true);
+    }
+
+    void VulkanRenderer::beginWindowRenderPass(VkCommandBuffer cmd, VkSubpassContents contents) {
         float flashColour = abs(sin((float) _frameNumber / 120.f));
 
         VkClearValue clearValue{
@@ -878,7 +1342,7 @@ namespace OZZ {
         renderPassBeginInfo.clearValueCount = 2;
         renderPassBeginInfo.pClearValues = clearValues;
 
-        vkCmdBeginRenderPass(cmd, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
+        vkCmdBeginRenderPass(cmd, &renderPassBeginInfo, contents);
     }
 
     std::vector<EyePoseInfo> VulkanRenderer::beginFrameVR() {
@@ -890,6 +1354,10 @@ namespace OZZ {
                 return {};
             } else if (vr->GetBackendType() == VRBackend::OpenXR) {
                 _descriptorSetManager.NextDescriptorFrame();
+                recordDescriptorPoolStats();
+                _deletionQueue.Collect();
+                _textureStreamer.Update();
+                _gpuProfiler.BeginFrame();
 
                 auto *xr = dynamic_cast<OpenXRSubsystem *>(vr);
 
@@ -917,7 +1385,74 @@ namespace OZZ {
         // Usually I would avoid casting away the const -- but I did it here to save effort in making overloads
         currentFrame.CameraData->UploadData(const_cast<int*>(reinterpret_cast<const int*>(&sceneParams.Camera)), sizeof(sceneParams.Camera));
 
-        renderObjects(currentFrame.CommandPool, currentFrame.MainCommandBuffer, currentFrame.CameraData, objects);
+        // Culling is a compute dispatch, so it has to be recorded before the render pass begins
+        if (usesOcclusionCulling()) {
+            if (_gpuProfiler.IsEnabled()) {
+                _gpuProfiler.BeginScope(currentFrame.MainCommandBuffer, "Occlusion Cull");
+            }
+
+            _occlusionCuller.Cull(currentFrame.MainCommandBuffer, sceneParams.Camera.Projection * sceneParams.Camera.View, objects);
+
+            if (_gpuProfiler.IsEnabled()) {
+                _gpuProfiler.EndScope(currentFrame.MainCommandBuffer);
+            }
+        }
+
+        if (usesGpuDrivenRendering()) {
+            if (_gpuProfiler.IsEnabled()) {
+                _gpuProfiler.BeginScope(currentFrame.MainCommandBuffer, "Instance Cull");
+            }
+
+            _indirectRenderer.Prepare(currentFrame.MainCommandBuffer, sceneParams.Camera.Projection * sceneParams.Camera.View, objects);
+
+            if (_gpuProfiler.IsEnabled()) {
+                _gpuProfiler.EndScope(currentFrame.MainCommandBuffer);
+            }
+        }
+
+        auto *buffer = dynamic_cast<VulkanUniformBuffer *>(currentFrame.CameraData.get());
+        VkDescriptorBufferInfo cameraInfo { buffer->_buffer->Buffer, 0, buffer->_bufferSize };
+
+        // Static objects are replayed from a recording of their own, leaving only the dynamic ones to record
+        bool reuseStatic = usesStaticRecording() && std::any_of(objects.begin(), objects.end(), [](const RenderableObject& object) {
+            return object.Static;
+        });
+
+        std::vector<RenderableObject> staticObjects {};
+        std::vector<RenderableObject> dynamicObjects {};
+        if (reuseStatic) {
+            for (auto& object : objects) {
+                (object.Static ? staticObjects : dynamicObjects).push_back(object);
+            }
+        }
+
+        auto packets = buildDrawPackets(cameraInfo, reuseStatic ? dynamicObjects : objects, _descriptorSetManager);
+
+        // A subpass is either recorded inline or made up entirely of secondary command buffers
+        bool parallel = reuseStatic || usesParallelRecording(packets.size());
+        auto materialContents = parallel ? VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS : VK_SUBPASS_CONTENTS_INLINE;
+
+        beginWindowRenderPass(currentFrame.MainCommandBuffer, usesDepthPrepass() ? VK_SUBPASS_CONTENTS_INLINE : materialContents);
+
+        if (usesDepthPrepass()) {
+            renderDepthPrepass(currentFrame.MainCommandBuffer, currentFrame.CameraData, objects);
+            vkCmdNextSubpass(currentFrame.MainCommandBuffer, materialContents);
+        }
+
+        if (reuseStatic) {
+            renderStaticObjects(currentFrame, cameraInfo, staticObjects, usesDepthPrepass() ? 1 : 0);
+        }
+
+        if (parallel) {
+            renderObjectsParallel(currentFrame, std::move(packets), usesDepthPrepass() ? 1 : 0);
+            return;
+        }
+
+        recordDrawPackets(currentFrame.MainCommandBuffer, packets, cameraInfo, _windowExtent, _frameStats, true);
+
+        if (usesGpuDrivenRendering()) {
+            renderBatches(currentFrame.MainCommandBuffer, currentFrame.CameraData);
+        }
     }
 
     void VulkanRenderer::renderFrameVR(const std::vector<EyePoseInfo>& eyeInfo, SceneParams& sceneParams, const std::vector<RenderableObject>& objects) {
@@ -965,6 +1500,19 @@ namespace OZZ {
 
                 auto& vrFrame = _vrFrames[eyeIndex][imageIndex];
 
+                // The command buffer and camera data may still be in use from the last time this image came around
+                if (!_timeline.IsComplete(vrFrame.TimelineValue)) {
+                    _frameStats.FenceWaits++;
+
+                    auto waitResult = _timeline.Wait(vrFrame.TimelineValue, 1000000000);
+                    if (waitResult != VK_SUCCESS) {
+                        // Nothing of this image's can be touched yet, so the eye sits this frame out
+                        std::cerr << "Eye " << eyeIndex << " skipped a frame waiting on the GPU: " << waitResult << std::endl;
+                        xr->ReleaseVulkanSwapchainImage(static_cast<int>(eyeIndex));
+                        return;
+                    }
+                }
+
                 // Ensure there's a uniform buffer to hold camera data
                 if (!vrFrame.CameraData) {
                     vrFrame.CameraData = CreateUniformBuffer();
@@ -985,6 +1533,10 @@ namespace OZZ {
                     return;
                 }
 
+                // The first eye's command buffer is submitted first, so it resets the frame's queries for both
+                _gpuProfiler.ResetQueries(vrFrame.MainCommandBuffer);
+                _gpuProfiler.BeginScope(vrFrame.MainCommandBuffer, eyeIndex == 0 ? "Left Eye" : "Right Eye", true);
+
                 VkClearValue clearValue{};
                 clearValue.color = { { 0.2f, 0.2f, 0.2f, 1.0f } };
 
@@ -1002,9 +1554,10 @@ namespace OZZ {
 
                 vkCmdBeginRenderPass(vrFrame.MainCommandBuffer, &beginRenderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
 
-                renderObjects(vrFrame.CommandPool, vrFrame.MainCommandBuffer, vrFrame.CameraData, objects);
+                renderObjects(vrFrame.MainCommandBuffer, vrFrame.CameraData, { (uint32_t)swapchain.Width, (uint32_t)swapchain.Height }, objects);
 
                 vkCmdEndRenderPass(vrFrame.MainCommandBuffer);
+                _gpuProfiler.EndScope(vrFrame.MainCommandBuffer);
 
                 vkResult = vkEndCommandBuffer(vrFrame.MainCommandBuffer);
 
@@ -1023,7 +1576,8 @@ namespace OZZ {
                 submitInfo.pCommandBuffers = &vrFrame.MainCommandBuffer;
 
 
-                vkResult = vkQueueSubmit(_graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE);
+                vkResult = _timeline.Submit(_graphicsQueue, submitInfo, vrFrame.TimelineValue);
+                _frameStats.QueueSubmits++;
 
                 if (vkResult != VK_SUCCESS)
                 {
@@ -1038,6 +1592,21 @@ namespace OZZ {
     void VulkanRenderer::endFrameWindow() {
         auto cmd = getCurrentFrame().MainCommandBuffer;
         vkCmdEndRenderPass(cmd);
+
+        // This frame's depth becomes next frame's occluders
+        if (usesOcclusionCulling()) {
+            if (_gpuProfiler.IsEnabled()) {
+                _gpuProfiler.BeginScope(cmd, "Hi-Z Pyramid");
+            }
+
+            _occlusionCuller.BuildPyramid(cmd, _depthImage);
+
+            if (_gpuProfiler.IsEnabled()) {
+                _gpuProfiler.EndScope(cmd);
+            }
+        }
+
+        _gpuProfiler.EndScope(cmd);
         VK_CHECK("VulkanRenderer::EndFrame()::vkEndCommandBuffer", vkEndCommandBuffer(cmd));
 
         VkSubmitInfo submit{VK_STRUCTURE_TYPE_SUBMIT_INFO};
@@ -1054,7 +1623,8 @@ namespace OZZ {
         submit.commandBufferCount = 1;
         submit.pCommandBuffers = &getCurrentFrame().MainCommandBuffer;
 
-        vkQueueSubmit(_graphicsQueue, 1, &submit, getCurrentFrame().RenderFence);
+        VK_CHECK("VulkanRenderer::EndFrame()::vkQueueSubmit", _timeline.Submit(_graphicsQueue, submit, getCurrentFrame().TimelineValue));
+        _frameStats.QueueSubmits++;
 
         VkPresentInfoKHR presentInfoKhr{VK_STRUCTURE_TYPE_PRESENT_INFO_KHR};
         presentInfoKhr.swapchainCount = 1;
@@ -1090,110 +1660,818 @@ namespace OZZ {
     }
 
 
-    void VulkanRenderer::renderObjects(VkCommandPool commandPool, VkCommandBuffer commandBuffer, std::shared_ptr<UniformBuffer> cameraBuffer, const std::vector<RenderableObject>& objects) {
-// Render all the objects
+    void VulkanRenderer::renderObjects(VkCommandBuffer commandBuffer, std::shared_ptr<UniformBuffer> cameraBuffer, VkExtent2D viewportExtent,
+                                       const std::vector<RenderableObject>& objects) {
+        OZZ_PROFILE_SCOPE("VulkanRenderer::renderObjects");
+
+        auto *buffer = dynamic_cast<VulkanUniformBuffer *>(cameraBuffer.get());
+        VkDescriptorBufferInfo cameraInfo { buffer->_buffer->Buffer, 0, buffer->_bufferSize };
+
+        auto packets = buildDrawPackets(cameraInfo, objects, _descriptorSetManager);
+
+        recordDrawPackets(commandBuffer, packets, cameraInfo, viewportExtent, _frameStats, true);
+    }
+
+    void VulkanRenderer::renderObjectsParallel(FrameData& frame, std::vector<DrawPacket> packets, uint32_t subpass) {
+        OZZ_PROFILE_SCOPE("VulkanRenderer::renderObjectsParallel");
+
+        // Sorted so each job's slice stays coherent
+        sortDrawPackets(packets);
+
+        auto* jobSystem = ServiceLocator::GetJobSystem();
+
+        auto jobCount = static_cast<uint32_t>(std::min<size_t>(jobSystem->GetWorkerCount() + 1,
+                                                                (packets.size() + DRAWS_PER_RECORDING_JOB - 1) / DRAWS_PER_RECORDING_JOB));
+
+        // GPU driven batches get a secondary of their own, recorded alongside the slices
+        bool recordBatches = usesGpuDrivenRendering() && _indirectRenderer.GetDrawBuffer() != VK_NULL_HANDLE;
+        auto bufferCount = jobCount + (recordBatches ? 1 : 0);
+
+        // Everything may have been replayed from the static recording
+        if (bufferCount == 0) return;
+
+        while (frame.RecordingPools.size() < bufferCount) {
+            VkCommandPool pool { VK_NULL_HANDLE };
+            VkCommandPoolCreateInfo commandPoolCreateInfo = VulkanInitializers::CommandPoolCreateInfo(_graphicsQueueFamily, 0);
+            VK_CHECK("VulkanRenderer::renderObjectsParallel()::vkCreateCommandPool", vkCreateCommandPool(_device, &commandPoolCreateInfo, nullptr, &pool));
+
+            VkCommandBuffer secondary { VK_NULL_HANDLE };
+            VkCommandBufferAllocateInfo commandBufferAllocateInfo = VulkanInitializers::CommandBufferAllocateInfo(pool, 1, VK_COMMAND_BUFFER_LEVEL_SECONDARY);
+            VK_CHECK("VulkanRenderer::renderObjectsParallel()::vkAllocateCommandBuffers", vkAllocateCommandBuffers(_device, &commandBufferAllocateInfo, &secondary));
+
+            frame.RecordingPools.push_back(pool);
+            frame.SecondaryCommandBuffers.push_back(secondary);
+        }
+
+        VkCommandBufferInheritanceInfo inheritanceInfo { VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO };
+        inheritanceInfo.renderPass = _renderPass;
+        inheritanceInfo.subpass = subpass;
+        inheritanceInfo.framebuffer = _framebuffers[frame.SwapchainImageIndex];
+
+        // The frame has been waited on, so last time's recordings are done with
+        auto beginSecondary = [&](uint32_t index) {
+            VK_CHECK("VulkanRenderer::renderObjectsParallel()::vkResetCommandPool", vkResetCommandPool(_device, frame.RecordingPools[index], 0));
+
+            VkCommandBufferBeginInfo beginInfo { VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO };
+            beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+            beginInfo.pInheritanceInfo = &inheritanceInfo;
+
+            auto commandBuffer = frame.SecondaryCommandBuffers[index];
+            VK_CHECK("VulkanRenderer::renderObjectsParallel()::vkBeginCommandBuffer", vkBeginCommandBuffer(commandBuffer, &beginInfo));
+            return commandBuffer;
+        };
+
+        auto *buffer = dynamic_cast<VulkanUniformBuffer *>(frame.CameraData.get());
+        VkDescriptorBufferInfo cameraInfo { buffer->_buffer->Buffer, 0, buffer->_bufferSize };
+
+        // Each job keeps its own counters and its own slice of the sorted list, so neither needs a lock. The batches
+        // keep their sets with the indirect renderer, which only the job recording them touches.
+        std::vector<FrameStats> jobStats(jobCount);
+        std::span<const DrawPacket> allPackets { packets };
+
+        jobSystem->ParallelFor(bufferCount, 1, [&](uint32_t begin, uint32_t end) {
+            for (uint32_t index = begin; index < end; index++) {
+                OZZ_PROFILE_SCOPE("VulkanRenderer::recordSecondary");
+
+                auto commandBuffer = beginSecondary(index);
+
+                if (index < jobCount) {
+                    auto first = packets.size() * index / jobCount;
+                    auto last = packets.size() * (index + 1) / jobCount;
+                    recordDrawPackets(commandBuffer, allPackets.subspan(first, last - first), cameraInfo, _windowExtent, jobStats[index], false);
+                } else {
+                    renderBatches(commandBuffer, frame.CameraData);
+                }
+
+                VK_CHECK("VulkanRenderer::renderObjectsParallel()::vkEndCommandBuffer", vkEndCommandBuffer(commandBuffer));
+            }
+        });
+
+        for (const auto& stats : jobStats) {
+            _frameStats.DrawCalls += stats.DrawCalls;
+            _frameStats.Triangles += stats.Triangles;
+            _frameStats.PipelineBinds += stats.PipelineBinds;
+            _frameStats.DescriptorWrites += stats.DescriptorWrites;
+            _frameStats.CommandsElided += stats.CommandsElided;
+        }
+
+        vkCmdExecuteCommands(frame.MainCommandBuffer, bufferCount, frame.SecondaryCommandBuffers.data());
+    }
+
+    void VulkanRenderer::renderStaticObjects(FrameData& frame, const VkDescriptorBufferInfo& cameraInfo, const std::vector<RenderableObject>& objects,
+                                             uint32_t subpass) {
+        OZZ_PROFILE_SCOPE("VulkanRenderer::renderStaticObjects");
+
+        auto& recording = frame.StaticDraws;
+        auto key = hashStaticObjects(cameraInfo, objects, subpass);
+        bool reused = key == recording.Key;
+
+        if (!reused) {
+            OZZ_PROFILE_SCOPE("VulkanRenderer::recordStatic");
+
+            if (recording.CommandPool == VK_NULL_HANDLE) {
+                VkCommandPoolCreateInfo commandPoolCreateInfo = VulkanInitializers::CommandPoolCreateInfo(_graphicsQueueFamily, 0);
+                VK_CHECK("VulkanRenderer::renderStaticObjects()::vkCreateCommandPool", vkCreateCommandPool(_device, &commandPoolCreateInfo, nullptr, &recording.CommandPool));
+
+                VkCommandBufferAllocateInfo commandBufferAllocateInfo = VulkanInitializers::CommandBufferAllocateInfo(recording.CommandPool, 1, VK_COMMAND_BUFFER_LEVEL_SECONDARY);
+                VK_CHECK("VulkanRenderer::renderStaticObjects()::vkAllocateCommandBuffers", vkAllocateCommandBuffers(_device, &commandBufferAllocateInfo, &recording.CommandBuffer));
+
+                // A single frame of pools, reset whenever the recording is redone
+                recording.Descriptors = VulkanDescriptorSetManager { &_device, 0 };
+            } else {
+                // The frame has been waited on, so the last replay is done with the buffer and its sets
+                VK_CHECK("VulkanRenderer::renderStaticObjects()::vkResetCommandPool", vkResetCommandPool(_device, recording.CommandPool, 0));
+                recording.Descriptors.NextDescriptorFrame();
+            }
+
+            auto packets = buildDrawPackets(cameraInfo, objects, recording.Descriptors);
+            sortDrawPackets(packets);
+
+            // Left without a framebuffer, since it's replayed into whichever swapchain image the frame acquires
+            VkCommandBufferInheritanceInfo inheritanceInfo { VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO };
+            inheritanceInfo.renderPass = _renderPass;
+            inheritanceInfo.subpass = subpass;
+
+            VkCommandBufferBeginInfo beginInfo { VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO };
+            beginInfo.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+            beginInfo.pInheritanceInfo = &inheritanceInfo;
+            VK_CHECK("VulkanRenderer::renderStaticObjects()::vkBeginCommandBuffer", vkBeginCommandBuffer(recording.CommandBuffer, &beginInfo));
+
+            FrameStats stats {};
+            recordDrawPackets(recording.CommandBuffer, packets, cameraInfo, _windowExtent, stats, false);
+
+            VK_CHECK("VulkanRenderer::renderStaticObjects()::vkEndCommandBuffer", vkEndCommandBuffer(recording.CommandBuffer));
+
+            recording.Meshes.clear();
+            for (auto& packet : packets) {
+                if (recording.Meshes.empty() || recording.Meshes.back() != packet.Owner) {
+                    recording.Meshes.push_back(packet.Owner);
+                }
+            }
+
+            recording.Key = key;
+            recording.DrawCalls = stats.DrawCalls;
+            recording.Triangles = stats.Triangles;
+
+            _frameStats.StaticRecordings++;
+            _frameStats.PipelineBinds += stats.PipelineBinds;
+            _frameStats.DescriptorWrites += stats.DescriptorWrites;
+            _frameStats.CommandsElided += stats.CommandsElided;
+        }
+
+        if (recording.DrawCalls == 0) return;
+
+        if (reused) {
+            _frameStats.StaticDrawsReused += recording.DrawCalls;
+        }
+
+        _frameStats.DrawCalls += recording.DrawCalls;
+        _frameStats.Triangles += recording.Triangles;
+
+        vkCmdExecuteCommands(frame.MainCommandBuffer, 1, &recording.CommandBuffer);
+    }
+
+    uint64_t VulkanRenderer::hashStaticObjects(const VkDescriptorBufferInfo& cameraInfo, const std::vector<RenderableObject>& objects,
+                                               uint32_t subpass) const {
+        OZZ_PROFILE_SCOPE("VulkanRenderer::hashStaticObjects");
+
+        // Everything a recording captures, from the pass it continues down to each texture it wrote into a set. Much
+        // cheaper than recording, but it still has to look at every object each frame.
+        uint64_t key = VulkanUtilities::HashCombine(_swapchainGeneration, _textureGeneration);
+        key = VulkanUtilities::HashCombine(key, reinterpret_cast<uint64_t>(_renderPass));
+        key = VulkanUtilities::HashCombine(key, subpass);
+        key = VulkanUtilities::HashCombine(key, (static_cast<uint64_t>(_windowExtent.width) << 32) | _windowExtent.height);
+        key = VulkanUtilities::HashCombine(key, reinterpret_cast<uint64_t>(cameraInfo.buffer));
+        key = VulkanUtilities::HashCombine(key, usesBindlessTextures() ? 1 : 0);
+
         for (auto& object : objects) {
             auto mesh = object.Mesh.lock();
+            if (!mesh) continue;
 
-            if (mesh) {
-                for (auto &submesh: mesh->GetSubmeshes()) {
-                    auto material = submesh.GetMaterial().lock();
-                    if (!material) {
-                        std::cout << "Submesh doesn't have a material assigned!" << std::endl;
-                        continue;
-                    }
+            key = VulkanUtilities::HashCombine(key, reinterpret_cast<uint64_t>(mesh.get()));
+            key = VulkanUtilities::HashCombine(key, VulkanUtilities::HashBytes(&object.Transform, sizeof(object.Transform)));
 
-                    auto shader = material->GetShader().lock();
-                    if (!shader) {
-                        std::cout << "Material doesn't have a shader assigned!" << std::endl;
-                        continue;
-                    }
+            for (auto& submesh : mesh->GetSubmeshes()) {
+                auto material = submesh.GetMaterial().lock();
+                auto shader = material ? material->GetShader().lock() : nullptr;
+                auto* vulkanShader = dynamic_cast<VulkanShader*>(shader.get());
 
-                    std::vector<VkWriteDescriptorSet> writeSets {};
+                key = VulkanUtilities::HashCombine(key, reinterpret_cast<uint64_t>(material.get()));
+                key = VulkanUtilities::HashCombine(key, reinterpret_cast<uint64_t>(submesh._indexBuffer.get()));
+                key = VulkanUtilities::HashCombine(key, reinterpret_cast<uint64_t>(submesh._vertexBuffer.get()));
 
-                    std::map<int, VkDescriptorSet> descriptorSets {};
-                    auto shaderData = shader->GetShaderData();
+                // Pipelines are swapped when a shader is reloaded or its compile finishes
+                if (vulkanShader) {
+                    auto program = vulkanShader->GetDrawProgram();
+                    key = VulkanUtilities::HashCombine(key, reinterpret_cast<uint64_t>(program ? program->Pipeline.load() : VK_NULL_HANDLE));
 
-                    for (auto& [resourceName, resource] : shaderData.Resources) {
-                        if (!descriptorSets.contains(resource.Set)) {
-                            auto descriptorSetLayout = dynamic_cast<VulkanShader *>(shader.get())->GetDescriptorSetLayout(resource.Set);
-                            auto descriptorSet = _descriptorSetManager.GetDescriptorSet(descriptorSetLayout);
+                    const auto& bindlessProgram = vulkanShader->GetBindlessProgram();
+                    key = VulkanUtilities::HashCombine(key, reinterpret_cast<uint64_t>(bindlessProgram ? bindlessProgram->Pipeline.load() : VK_NULL_HANDLE));
+                }
 
-                            descriptorSets[resource.Set] = descriptorSet;
-                        }
-                    }
+                for (int i = (int)ResourceName::Diffuse0; i < (int)ResourceName::EndTextures; i++) {
+                    auto texture = submesh.GetTexture((ResourceName)i).lock();
+                    auto vulkanTexture = texture ? texture->GetTexture().lock() : nullptr;
+                    auto* renderTexture = dynamic_cast<VulkanTexture*>(vulkanTexture.get());
+                    if (!renderTexture) continue;
 
+                    key = VulkanUtilities::HashCombine(key, reinterpret_cast<uint64_t>(renderTexture->_imageView));
+                    key = VulkanUtilities::HashCombine(key, reinterpret_cast<uint64_t>(renderTexture->_sampler));
+                    key = VulkanUtilities::HashCombine(key, renderTexture->_bindlessIndex);
+                }
+            }
+        }
 
-                    if (shaderData.Resources.contains(ResourceName::CameraData)) {
-                        auto cameraData = shaderData.Resources[ResourceName::CameraData];
-                        auto *buffer = dynamic_cast<VulkanUniformBuffer *>(cameraBuffer.get());
+        // 0 is kept for nothing recorded yet
+        return key == 0 ? 1 : key;
+    }
 
-                        VkDescriptorBufferInfo descriptorBufferInfo{};
-                        descriptorBufferInfo.buffer = buffer->_buffer->Buffer;
-                        descriptorBufferInfo.offset = 0;
-                        descriptorBufferInfo.range = buffer->_bufferSize;
+    std::vector<DrawPacket> VulkanRenderer::buildDrawPackets(const VkDescriptorBufferInfo& cameraInfo, const std::vector<RenderableObject>& objects,
+                                                             VulkanDescriptorSetManager& descriptors) {
+        OZZ_PROFILE_SCOPE("VulkanRenderer::buildDrawPackets");
 
-                        auto writeSet = VulkanUtilities::WriteDescriptorSetUniformBuffer(descriptorSets[cameraData.Set],
-                                                                                         cameraData.Binding,
-                                                                                         &descriptorBufferInfo);
-                        writeSets.push_back(writeSet);
-                    }
+        // Bindless draws only differ by their push constants, so the camera sets are shared per layout
+        std::unordered_map<VkDescriptorSetLayout, VkDescriptorSet> bindlessSets {};
 
-                    // Bind all textures
-                    for (int i = (int)ResourceName::Diffuse0; i < (int)ResourceName::EndTextures; i++) {
-                        if (shader->GetShaderData().Resources.contains((ResourceName)i)) {
-                            auto textureData = shader->GetShaderData().Resources.at((ResourceName)i);
+        std::vector<DrawPacket> packets {};
 
-                            // Get texture
-                            auto texture = submesh.GetTexture((ResourceName)i).lock();
-                            if (!texture) {
-                                continue;
-                            }
+        // Culled draws come out of the occlusion culler's indirect buffer, numbered the way it walked the objects
+        uint32_t cullIndex { 0 };
 
-                            auto vulkanTexture = texture->GetTexture().lock();
-                            if (!vulkanTexture) {
-                                continue;
-                            }
+        for (auto& object : objects) {
+            auto mesh = object.Mesh.lock();
+            if (!mesh) continue;
+
+            for (auto &submesh: mesh->GetSubmeshes()) {
+                auto drawIndex = cullIndex++;
+
+                // Drawn as part of an instanced batch instead
+                if (_indirectRenderer.IsBatched(drawIndex)) {
+                    continue;
+                }
+
+                auto material = submesh.GetMaterial().lock();
+                if (!material) {
+                    std::cout << "Submesh doesn't have a material assigned!" << std::endl;
+                    continue;
+                }
+
+                auto shader = material->GetShader().lock();
+                if (!shader) {
+                    std::cout << "Material doesn't have a shader assigned!" << std::endl;
+                    continue;
+                }
+
+                // Nothing to draw with until the material's pipeline (or the pass's flat fallback) has compiled
+                auto* vulkanShader = dynamic_cast<VulkanShader *>(shader.get());
+                auto program = vulkanShader->GetDrawProgram();
+                if (!program) {
+                    continue;
+                }
+
+                DrawPacket packet {
+                        .Owner = mesh,
+                        .Geometry = &submesh,
+                        .Object = &object,
+                        .SourceMaterial = material.get(),
+                        .MaterialShader = vulkanShader,
+                        .Program = program,
+                        .Pipeline = program->Pipeline.load(),
+                        .PipelineLayout = program->PipelineLayout,
+                        .DrawIndex = drawIndex
+                };
 
-                            auto renderTexture = dynamic_cast<VulkanTexture*>(vulkanTexture.get());
-                            VkDescriptorImageInfo imageBufferInfo {
-                                    .sampler = renderTexture->_sampler,
-                                    .imageView = renderTexture->_imageView,
-                                    .imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
-                            };
+                if (!resolveBindlessPacket(packet, cameraInfo, descriptors, bindlessSets)) {
+                    // The descriptor set manager isn't thread safe, so sets are handed out here and only written while recording
+                    for (auto& [resourceName, resource] : program->Data.Resources) {
+                        if (resource.Type == ResourceType::PushConstant || resource.Set >= MAX_DRAW_DESCRIPTOR_SETS) continue;
 
-                            writeSets.push_back(VulkanUtilities::WriteDescriptorSetTexture(
-                                    descriptorSets[textureData.Set], textureData.Binding, &imageBufferInfo));
+                        if (packet.DescriptorSets[resource.Set] == VK_NULL_HANDLE) {
+                            packet.DescriptorSets[resource.Set] = descriptors.GetDescriptorSet(program->SetLayouts[resource.Set]->Layout);
+                            _frameStats.DescriptorSetsAllocated++;
                         }
                     }
+                }
 
-                    if (!writeSets.empty()) {
-                        vkUpdateDescriptorSets(_device, static_cast<uint32_t>(writeSets.size()), writeSets.data(), 0,
-                                               nullptr);
-                    }
+                packets.push_back(std::move(packet));
+            }
+        }
 
-                    // Bind and draw the things
-                    shader->Bind(commandBuffer);
+        // Textures loaded or freed since this frame's set was last used, and any that claimed a slot just now
+        if (usesBindlessTextures()) {
+            _bindlessTextures.Flush();
+        }
 
-                    for (auto& [set, descriptorSetCollection] : descriptorSets) {
-                        vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
-                                                dynamic_cast<VulkanShader *>(shader.get())->GetPipelineLayout(),
-                                                set, 1,
-                                                &descriptorSetCollection, 0,
-                                                nullptr);
-                    }
+        return packets;
+    }
+
+    bool VulkanRenderer::resolveBindlessPacket(DrawPacket& packet, const VkDescriptorBufferInfo& cameraInfo, VulkanDescriptorSetManager& descriptors,
+                                               std::unordered_map<VkDescriptorSetLayout, VkDescriptorSet>& sharedSets) {
+        if (!usesBindlessTextures()) return false;
+
+        const auto& program = packet.MaterialShader->GetBindlessProgram();
+        if (!program || !program->IsReady()) return false;
+
+        // Textures that haven't been uploaded yet keep the invalid index; the shader draws those as a placeholder
+        VulkanBindlessTextures::MaterialTextures textures {};
+        textures.fill(VulkanBindlessTextures::INVALID_INDEX);
+
+        for (int i = (int)ResourceName::Diffuse0; i < (int)ResourceName::EndTextures; i++) {
+            auto slot = static_cast<uint32_t>(i - (int)ResourceName::Diffuse0);
+            if (slot >= VulkanBindlessTextures::TEXTURES_PER_MATERIAL) break;
+
+            auto texture = packet.Geometry->GetTexture((ResourceName)i).lock();
+            auto vulkanTexture = texture ? texture->GetTexture().lock() : nullptr;
+            if (!vulkanTexture) continue;
+
+            textures[slot] = dynamic_cast<VulkanTexture*>(vulkanTexture.get())->getBindlessIndex();
+        }
+
+        // A full material table sends the draw down the descriptor path instead
+        auto materialIndex = _bindlessTextures.GetMaterial(textures);
+        if (materialIndex == VulkanBindlessTextures::INVALID_INDEX) return false;
+
+        packet.Program = program;
+        packet.Pipeline = program->Pipeline.load();
+        packet.PipelineLayout = program->PipelineLayout;
+        packet.Bindless = true;
+        packet.MaterialIndex = materialIndex;
+
+        auto cameraBufferInfo = cameraInfo;
+
+        for (auto& [resourceName, resource] : program->Data.Resources) {
+            if (resource.Type == ResourceType::PushConstant || resource.Set >= MAX_DRAW_DESCRIPTOR_SETS) continue;
+            if (packet.DescriptorSets[resource.Set] != VK_NULL_HANDLE) continue;
+
+            if (resourceName == ResourceName::BindlessTextures || resourceName == ResourceName::MaterialData) {
+                packet.DescriptorSets[resource.Set] = _bindlessTextures.GetDescriptorSet();
+                continue;
+            }
+
+            auto layout = program->SetLayouts[resource.Set]->Layout;
+            auto [it, inserted] = sharedSets.try_emplace(layout, VK_NULL_HANDLE);
+
+            if (inserted) {
+                it->second = descriptors.GetDescriptorSet(layout);
+                _frameStats.DescriptorSetsAllocated++;
+
+                if (auto cameraData = program->Data.Resources.find(ResourceName::CameraData);
+                    cameraData != program->Data.Resources.end() && cameraData->second.Set == resource.Set) {
+                    auto write = VulkanUtilities::WriteDescriptorSetUniformBuffer(it->second, cameraData->second.Binding, &cameraBufferInfo);
+                    vkUpdateDescriptorSets(_device, 1, &write, 0, nullptr);
+                    _frameStats.DescriptorWrites++;
+                }
+            }
+
+            packet.DescriptorSets[resource.Set] = it->second;
+        }
+
+        return true;
+    }
+
+    void VulkanRenderer::requestTextureMips(const std::vector<TextureMipRequest>& requests) {
+        if (!_textureStreamer.IsEnabled()) return;
+
+        for (const auto& request : requests) {
+            auto texture = request.Texture.lock();
+            if (!texture) continue;
+
+            _textureStreamer.RequestMip(*dynamic_cast<VulkanTexture*>(texture.get()), request.Mip);
+        }
+    }
+
+    void VulkanRenderer::recordDrawPackets(VkCommandBuffer commandBuffer, std::span<const DrawPacket> packets, const VkDescriptorBufferInfo& cameraInfo,
+                                           VkExtent2D viewportExtent, FrameStats& stats, bool profileScopes) {
+        if (packets.empty()) return;
+
+        auto cameraBufferInfo = cameraInfo;
+        VulkanCommandRecorder recorder { commandBuffer };
+
+        // Dynamic state outlives pipeline binds, so once covers every draw
+        VkViewport viewport {
+                .x = 0.f,
+                .y = 0.f,
+                .width = static_cast<float>(viewportExtent.width),
+                .height = static_cast<float>(viewportExtent.height),
+                .minDepth = 0.f,
+                .maxDepth = 1.f
+        };
+        recorder.SetViewport(viewport);
+
+        VkRect2D scissor { .offset = {0, 0}, .extent = viewportExtent };
+        recorder.SetScissor(scissor);
+
+        // Open profiler scopes, closed whenever the object scope or material changes
+        std::string_view objectScope {};
+        const Material* materialScope { nullptr };
+
+        auto cullDrawBuffer = _occlusionCuller.GetDrawBuffer();
+
+        // Reused by every packet; the camera buffer and each texture slot is at most one write
+        std::array<VkWriteDescriptorSet, MAX_DRAW_TEXTURES + 1> writeSets {};
+        std::array<VkDescriptorImageInfo, MAX_DRAW_TEXTURES> imageInfos {};
+
+        for (const auto& packet : packets) {
+            if (profileScopes && _gpuProfiler.IsEnabled() && packet.Object->ProfileScope != objectScope) {
+                if (materialScope) {
+                    _gpuProfiler.EndScope(commandBuffer);
+                    materialScope = nullptr;
+                }
+
+                if (!objectScope.empty()) {
+                    _gpuProfiler.EndScope(commandBuffer);
+                }
+
+                objectScope = packet.Object->ProfileScope;
+
+                if (!objectScope.empty()) {
+                    _gpuProfiler.BeginScope(commandBuffer, objectScope);
+                }
+            }
+
+            if (profileScopes && _gpuProfiler.IsMaterialScopesEnabled() && packet.SourceMaterial != materialScope) {
+                if (materialScope) {
+                    _gpuProfiler.EndScope(commandBuffer);
+                }
+
+                materialScope = packet.SourceMaterial;
+                _gpuProfiler.BeginScope(commandBuffer, packet.SourceMaterial->GetID());
+            }
+
+            const auto& shaderData = packet.Program->Data;
+            auto* submesh = packet.Geometry;
+
+            uint32_t writeCount { 0 };
+            uint32_t imageCount { 0 };
+
+            // Bindless sets were written once in buildDrawPackets
+            if (!packet.Bindless) {
+                if (auto cameraData = shaderData.Resources.find(ResourceName::CameraData); cameraData != shaderData.Resources.end()) {
+                    auto descriptorSet = packet.DescriptorSets[cameraData->second.Set];
+                    writeSets[writeCount++] = VulkanUtilities::WriteDescriptorSetUniformBuffer(descriptorSet, cameraData->second.Binding, &cameraBufferInfo);
+                }
 
-                    submesh._indexBuffer->Bind(commandBuffer);
-                    submesh._vertexBuffer->Bind(commandBuffer);
+                // Bind all textures
+                for (int i = (int)ResourceName::Diffuse0; i < (int)ResourceName::EndTextures; i++) {
+                    auto textureData = shaderData.Resources.find((ResourceName)i);
+                    if (textureData == shaderData.Resources.end()) continue;
+
+                    auto texture = submesh->GetTexture((ResourceName)i).lock();
+                    auto vulkanTexture = texture ? texture->GetTexture().lock() : nullptr;
+                    if (!vulkanTexture) continue;
+
+                    auto renderTexture = dynamic_cast<VulkanTexture*>(vulkanTexture.get());
+                    auto& imageInfo = imageInfos[imageCount++];
+                    imageInfo = VkDescriptorImageInfo {
+                            .sampler = renderTexture->_sampler,
+                            .imageView = renderTexture->_imageView,
+                            .imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
+                    };
+
+                    auto descriptorSet = packet.DescriptorSets[textureData->second.Set];
+                    writeSets[writeCount++] = VulkanUtilities::WriteDescriptorSetTexture(descriptorSet, textureData->second.Binding, &imageInfo);
+                }
+            }
+
+            if (writeCount > 0) {
+                vkUpdateDescriptorSets(_device, writeCount, writeSets.data(), 0, nullptr);
+                stats.DescriptorWrites += writeCount;
+            }
+
+            // Bind and draw the things. Packets are sorted, so neighbours often share most of this.
+            if (recorder.BindPipeline(packet.Pipeline)) {
+                stats.PipelineBinds++;
+            }
+
+            auto pipelineLayout = packet.PipelineLayout;
+            for (uint32_t set = 0; set < MAX_DRAW_DESCRIPTOR_SETS; set++) {
+                if (packet.DescriptorSets[set] == VK_NULL_HANDLE) continue;
+
+                recorder.BindDescriptorSet(pipelineLayout, set, packet.DescriptorSets[set]);
+            }
+
+            // Every buffer was made by this renderer
+            static_cast<VulkanIndexBuffer*>(submesh->_indexBuffer.get())->Bind(recorder);
+            static_cast<VulkanVertexBuffer*>(submesh->_vertexBuffer.get())->Bind(recorder);
+
+            if (packet.Bindless) {
+                BindlessDrawConstants constants { .Model = packet.Object->Transform, .MaterialIndex = packet.MaterialIndex };
+                recorder.PushConstants(pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(BindlessDrawConstants), &constants);
+            } else {
+                recorder.PushConstants(pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(ModelObject), &packet.Object->Transform);
+            }
 
-                    vkCmdPushConstants(commandBuffer,
-                                       dynamic_cast<VulkanShader *>(shader.get())->GetPipelineLayout(),
-                                       VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(ModelObject), &object.Transform);
+            if (cullDrawBuffer != VK_NULL_HANDLE) {
+                vkCmdDrawIndexedIndirect(commandBuffer, cullDrawBuffer, packet.DrawIndex * sizeof(VkDrawIndexedIndirectCommand), 1,
+                                         sizeof(VkDrawIndexedIndirectCommand));
+            } else {
+                vkCmdDrawIndexed(commandBuffer, submesh->_indexBuffer->GetCount(), 1, 0, 0, 0);
+            }
+            stats.DrawCalls++;
+            stats.Triangles += submesh->_indexBuffer->GetCount() / 3;
+        }
+
+        if (materialScope) {
+            _gpuProfiler.EndScope(commandBuffer);
+        }
+
+        stats.CommandsElided += recorder.GetElidedCount();
+
+        if (!objectScope.empty()) {
+            _gpuProfiler.EndScope(commandBuffer);
+        }
+    }
+
+    void VulkanRenderer::renderDepthPrepass(VkCommandBuffer commandBuffer, std::shared_ptr<UniformBuffer> cameraBuffer,
+                                            const std::vector<RenderableObject>& objects) {
+        OZZ_PROFILE_SCOPE("VulkanRenderer::renderDepthPrepass");
+
+        if (!_depthPrepassProgram) {
+            _depthPrepassProgram = _shaderRegistry.GetDepthOnlyProgram((Filesystem::GetShaderPath() / "depth_prepass.vert.spv").string(),
+                                                                       VulkanPassDescription{ .ColorFormat = _swapchainImageFormat,
+                                                                                              .DepthFormat = _depthFormat,
+                                                                                              .Subpass = 0,
+                                                                                              .RenderPass = _renderPass });
+        }
+
+        if (!_depthPrepassProgram) {
+            return;
+        }
+
+        // Material pipelines test depth with EQUAL, so without the pre-pass nothing would be drawn at all. It's a
+        // single tiny pipeline; wait for it the first time rather than render black frames.
+        if (!_depthPrepassProgram->IsReady() && _depthPrepassProgram->Compilation.valid()) {
+            _depthPrepassProgram->Compilation.wait();
+        }
+
+        auto pipeline = _depthPrepassProgram->Pipeline.load();
+        if (pipeline == VK_NULL_HANDLE || _depthPrepassProgram->SetLayouts.empty()) {
+            return;
+        }
 
+        if (_gpuProfiler.IsEnabled()) {
+            _gpuProfiler.BeginScope(commandBuffer, "Depth Prepass");
+        }
+
+        // Every draw shares the camera, so one descriptor set covers the pass
+        auto descriptorSet = _descriptorSetManager.GetDescriptorSet(_depthPrepassProgram->SetLayouts[0]->Layout);
+        _frameStats.DescriptorSetsAllocated++;
+
+        auto *buffer = dynamic_cast<VulkanUniformBuffer *>(cameraBuffer.get());
+        VkDescriptorBufferInfo descriptorBufferInfo{};
+        descriptorBufferInfo.buffer = buffer->_buffer->Buffer;
+        descriptorBufferInfo.offset = 0;
+        descriptorBufferInfo.range = buffer->_bufferSize;
+
+        auto writeSet = VulkanUtilities::WriteDescriptorSetUniformBuffer(descriptorSet, 0, &descriptorBufferInfo);
+        vkUpdateDescriptorSets(_device, 1, &writeSet, 0, nullptr);
+        _frameStats.DescriptorWrites++;
+
+        VulkanCommandRecorder recorder { commandBuffer };
+
+        recorder.BindPipeline(pipeline);
+        _frameStats.PipelineBinds++;
+
+        VkViewport viewport {
+                .x = 0.f,
+                .y = 0.f,
+                .width = static_cast<float>(_windowExtent.width),
+                .height = static_cast<float>(_windowExtent.height),
+                .minDepth = 0.f,
+                .maxDepth = 1.f
+        };
+        recorder.SetViewport(viewport);
+
+        VkRect2D scissor { .offset = {0, 0}, .extent = _windowExtent };
+        recorder.SetScissor(scissor);
+
+        recorder.BindDescriptorSet(_depthPrepassProgram->PipelineLayout, 0, descriptorSet);
+
+        auto cullDrawBuffer = _occlusionCuller.GetDrawBuffer();
+        uint32_t cullIndex { 0 };
+
+        for (auto& object : objects) {
+            auto mesh = object.Mesh.lock();
+            if (!mesh) continue;
+
+            for (auto &submesh: mesh->GetSubmeshes()) {
+                auto drawIndex = cullIndex++;
+
+                // Only lay down depth for geometry the material pass will actually shade, anything else would leave
+                // holes where its EQUAL test can never pass
+                auto material = submesh.GetMaterial().lock();
+                auto shader = material ? material->GetShader().lock() : nullptr;
+                if (!shader || !dynamic_cast<VulkanShader *>(shader.get())->GetDrawProgram()) {
+                    continue;
+                }
+
+                const auto& positionBuffer = submesh.GetPositionBuffer();
+                if (!positionBuffer || !submesh._indexBuffer) {
+                    continue;
+                }
+
+                static_cast<VulkanIndexBuffer*>(submesh._indexBuffer.get())->Bind(recorder);
+                static_cast<VulkanVertexBuffer*>(positionBuffer.get())->Bind(recorder);
+
+                // Submeshes of one object share the transform
+                recorder.PushConstants(_depthPrepassProgram->PipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(ModelObject), &object.Transform);
+
+                if (cullDrawBuffer != VK_NULL_HANDLE) {
+                    vkCmdDrawIndexedIndirect(commandBuffer, cullDrawBuffer, drawIndex * sizeof(VkDrawIndexedIndirectCommand), 1,
+                                             sizeof(VkDrawIndexedIndirectCommand));
+                } else {
                     vkCmdDrawIndexed(commandBuffer, submesh._indexBuffer->GetCount(), 1, 0, 0, 0);
                 }
+                _frameStats.DrawCalls++;
+                _frameStats.Triangles += submesh._indexBuffer->GetCount() / 3;
+            }
+        }
+
+        _frameStats.CommandsElided += recorder.GetElidedCount();
+
+        if (_gpuProfiler.IsEnabled()) {
+            _gpuProfiler.EndScope(commandBuffer);
+        }
+    }
+
+    void VulkanRenderer::renderBatches(VkCommandBuffer commandBuffer, std::shared_ptr<UniformBuffer> cameraBuffer) {
+        OZZ_PROFILE_SCOPE("VulkanRenderer::renderBatches");
+
+        auto drawBuffer = _indirectRenderer.GetDrawBuffer();
+        if (drawBuffer == VK_NULL_HANDLE) {
+            return;
+        }
+
+        if (_gpuProfiler.IsEnabled()) {
+            _gpuProfiler.BeginScope(commandBuffer, "GPU Driven Batches");
+        }
+
+        auto *buffer = dynamic_cast<VulkanUniformBuffer *>(cameraBuffer.get());
+        VkDescriptorBufferInfo cameraInfo { buffer->_buffer->Buffer, 0, buffer->_bufferSize };
+        auto objectInfo = _indirectRenderer.GetObjectBufferInfo();
+        auto visibleInfo = _indirectRenderer.GetVisibleBufferInfo();
+
+        VulkanCommandRecorder recorder { commandBuffer };
+
+        VkViewport viewport {
+                .x = 0.f,
+                .y = 0.f,
+                .width = static_cast<float>(_windowExtent.width),
+                .height = static_cast<float>(_windowExtent.height),
+                .minDepth = 0.f,
+                .maxDepth = 1.f
+        };
+        recorder.SetViewport(viewport);
+
+        VkRect2D scissor { .offset = {0, 0}, .extent = _windowExtent };
+        recorder.SetScissor(scissor);
+
+        const auto& batches = _indirectRenderer.GetBatches();
+
+        for (uint32_t batchIndex = 0; batchIndex < batches.size(); batchIndex++) {
+            const auto& batch = batches[batchIndex];
+            const auto& program = dynamic_cast<VulkanShader *>(batch.MaterialShader.get())->GetInstancedProgram();
+
+            // The image infos have to outlive the update below
+            std::array<VkDescriptorImageInfo, (int)ResourceName::EndTextures - (int)ResourceName::Diffuse0> imageInfos {};
+            uint64_t key = VulkanUtilities::HashCombine(reinterpret_cast<uint64_t>(cameraInfo.buffer), reinterpret_cast<uint64_t>(objectInfo.buffer));
+            key = VulkanUtilities::HashCombine(key, reinterpret_cast<uint64_t>(visibleInfo.buffer));
+
+            // Handles can come back for new buffers and views, the generations tell them apart
+            key = VulkanUtilities::HashCombine(key, _indirectRenderer.GetBufferGeneration());
+            key = VulkanUtilities::HashCombine(key, _textureGeneration);
+
+            for (int i = (int)ResourceName::Diffuse0; i < (int)ResourceName::EndTextures; i++) {
+                if (!program->Data.Resources.contains((ResourceName)i)) continue;
+
+                auto texture = batch.Geometry->GetTexture((ResourceName)i).lock();
+                auto vulkanTexture = texture ? texture->GetTexture().lock() : nullptr;
+                if (!vulkanTexture) continue;
+
+                auto renderTexture = dynamic_cast<VulkanTexture*>(vulkanTexture.get());
+
+                imageInfos[i - (int)ResourceName::Diffuse0] = VkDescriptorImageInfo {
+                        .sampler = renderTexture->_sampler,
+                        .imageView = renderTexture->_imageView,
+                        .imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
+                };
+
+                key = VulkanUtilities::HashCombine(key, reinterpret_cast<uint64_t>(renderTexture->_sampler));
+                key = VulkanUtilities::HashCombine(key, reinterpret_cast<uint64_t>(renderTexture->_imageView));
+            }
+
+            // The sets are kept from frame to frame, and only written again when a buffer or texture behind them changes
+            auto& descriptors = _indirectRenderer.GetBatchDescriptors(batchIndex);
+
+            if (descriptors.Key != key) {
+                std::vector<VkWriteDescriptorSet> writeSets {};
+
+                for (auto& [resourceName, resource] : program->Data.Resources) {
+                    if (!descriptors.Sets.contains(resource.Set) && resource.Set < program->SetLayouts.size()) {
+                        descriptors.Sets[resource.Set] = _indirectRenderer.GetDescriptorSetManager().GetDescriptorSet(program->SetLayouts[resource.Set]->Layout);
+                        _frameStats.DescriptorSetsAllocated++;
+                    }
+
+                    switch (resourceName) {
+                        case ResourceName::CameraData:
+                            writeSets.push_back(VulkanUtilities::WriteDescriptorSetUniformBuffer(descriptors.Sets[resource.Set], resource.Binding, &cameraInfo));
+                            break;
+                        case ResourceName::ObjectData:
+                            writeSets.push_back(VulkanUtilities::WriteDescriptorSetUniformBuffer(descriptors.Sets[resource.Set], resource.Binding, &objectInfo));
+                            writeSets.back().descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+                            break;
+                        case ResourceName::VisibleInstances:
+                            writeSets.push_back(VulkanUtilities::WriteDescriptorSetUniformBuffer(descriptors.Sets[resource.Set], resource.Binding, &visibleInfo));
+                            writeSets.back().descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+                            break;
+                        default:
+                            if (resourceName >= ResourceName::Diffuse0 && resourceName < ResourceName::EndTextures) {
+                                const auto& imageInfo = imageInfos[(int)resourceName - (int)ResourceName::Diffuse0];
+                                if (imageInfo.imageView != VK_NULL_HANDLE) {
+                                    writeSets.push_back(VulkanUtilities::WriteDescriptorSetTexture(descriptors.Sets[resource.Set], resource.Binding, &imageInfo));
+                                }
+                            }
+                            break;
+                    }
+                }
+
+                if (!writeSets.empty()) {
+                    vkUpdateDescriptorSets(_device, static_cast<uint32_t>(writeSets.size()), writeSets.data(), 0, nullptr);
+                    _frameStats.DescriptorWrites += static_cast<uint32_t>(writeSets.size());
+                }
+
+                descriptors.Key = key;
             }
+
+            if (recorder.BindPipeline(program->Pipeline.load())) {
+                _frameStats.PipelineBinds++;
+            }
+
+            for (auto& [set, descriptorSet] : descriptors.Sets) {
+                recorder.BindDescriptorSet(program->PipelineLayout, set, descriptorSet);
+            }
+
+            static_cast<VulkanIndexBuffer*>(batch.Geometry->_indexBuffer.get())->Bind(recorder);
+            static_cast<VulkanVertexBuffer*>(batch.Geometry->_vertexBuffer.get())->Bind(recorder);
+
+            vkCmdDrawIndexedIndirect(commandBuffer, drawBuffer, batchIndex * sizeof(VkDrawIndexedIndirectCommand), 1,
+                                     sizeof(VkDrawIndexedIndirectCommand));
+
+            // Instance counts are only known on the GPU, so this counts everything the batch could draw
+            _frameStats.DrawCalls++;
+            _frameStats.Triangles += static_cast<uint64_t>(batch.Geometry->_indexBuffer->GetCount() / 3) * batch.InstanceCount;
+        }
+
+        _frameStats.CommandsElided += recorder.GetElidedCount();
+
+        if (_gpuProfiler.IsEnabled()) {
+            _gpuProfiler.EndScope(commandBuffer);
+        }
+    }
+
+    bool VulkanRenderer::usesDepthPrepass() const {
+        return _rendererSettings.DepthPrepass && !_rendererSettings.VR;
+    }
+
+    bool VulkanRenderer::usesOcclusionCulling() const {
+        return _rendererSettings.OcclusionCulling && !_rendererSettings.VR;
+    }
+
+    bool VulkanRenderer::usesGpuDrivenRendering() const {
+        // Batches point gl_InstanceIndex at their stretch of the visible list through firstInstance. They also have no
+        // depth-only variant, so the pre-pass would leave them failing its EQUAL test.
+        return _rendererSettings.GpuDrivenRendering && !_rendererSettings.VR && !usesDepthPrepass()
+               && _enabledFeatures.drawIndirectFirstInstance;
+    }
+
+    bool VulkanRenderer::usesBindlessTextures() const {
+        return _bindlessTextures.IsEnabled() && !_rendererSettings.VR;
+    }
+
+    bool VulkanRenderer::usesParallelRecording(size_t drawCount) const {
+        // GPU profiler scopes follow the object order and can't be written from a secondary's slice of it
+        auto* jobSystem = ServiceLocator::GetJobSystem();
+        return jobSystem && jobSystem->GetWorkerCount() > 0 && !_rendererSettings.VR && !_gpuProfiler.IsEnabled()
+               && drawCount >= PARALLEL_RECORDING_MIN_DRAWS;
+    }
+
+    bool VulkanRenderer::usesStaticRecording() const {
+        // Culled and batched draws are numbered against the whole frame's objects, and profiler scopes are written into
+        // each frame's queries, so neither can be replayed. Dynamic objects still need the job system's secondaries.
+        return ServiceLocator::GetJobSystem() && !_rendererSettings.VR && !usesOcclusionCulling() && !usesGpuDrivenRendering()
+               && !_gpuProfiler.IsEnabled();
+    }
+
+    VulkanPassDescription VulkanRenderer::getMaterialPass() const {
+        if (_rendererSettings.VR) {
+            return { .ColorFormat = VK_FORMAT_R8G8B8A8_SRGB, .RenderPass = _vrRenderPass };
         }
+
+        if (usesDepthPrepass()) {
+            return { .ColorFormat = _swapchainImageFormat, .DepthFormat = _depthFormat, .Subpass = 1, .DepthPrepassed = true, .RenderPass = _renderPass };
+        }
+
+        return { .ColorFormat = _swapchainImageFormat, .DepthFormat = _depthFormat, .RenderPass = _renderPass };
     }
 
     VkPhysicalDevice VulkanRenderer::getPhysicalDevice() {
@@ -1226,6 +2504,9 @@ namespace OZZ {
                 vkGetPhysicalDeviceProperties(device, &deviceProperties);
                 vkGetPhysicalDeviceFeatures(device, &deviceFeatures);
 
+                // Timeline semaphores are core from 1.2
+                if (deviceProperties.apiVersion < VK_API_VERSION_1_2) return false;
+
                 auto queueFamilies = getQueueFamilyIndices(device);
                 return queueFamilies.IsComplete();
             };
@@ -1244,7 +2525,8 @@ namespace OZZ {
         return physicalDevice;
     }
 
-    std::tuple<VkDevice, VulkanQueueFamilyIndices> VulkanRenderer::createLogicalDevice(VkPhysicalDevice device, const std::set<std::string>& deviceExtensions) {
+    std::tuple<VkDevice, VulkanQueueFamilyIndices> VulkanRenderer::createLogicalDevice(VkPhysicalDevice device, const std::set<std::string>& deviceExtensions,
+                                                                                       const VkPhysicalDeviceFeatures& features, const void* featureChain) {
         VkDevice logicalDevice { VK_NULL_HANDLE };
         auto queueFamilies = getQueueFamilyIndices(device);
 
@@ -1255,6 +2537,7 @@ namespace OZZ {
         queueCreateInfo.pQueuePriorities = &queuePriority;
 
         VkDeviceCreateInfo createInfo { VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO };
+        createInfo.pNext = featureChain;
         createInfo.pQueueCreateInfos = &queueCreateInfo;
         createInfo.queueCreateInfoCount = 1;
 
@@ -1267,6 +2550,7 @@ namespace OZZ {
         createInfo.ppEnabledExtensionNames = dExtensions.data();
 
         createInfo.enabledLayerCount = 0;
+        createInfo.pEnabledFeatures = &features;
 
         if (vkCreateDevice(device, &createInfo, nullptr, &logicalDevice) != VK_SUCCESS) {
             std::cerr << "Failed to create vulkan logical device!" << std::endl;
@@ -1302,7 +2586,7 @@ namespace OZZ {
     }
 
     uint32_t VulkanRenderer::getCurrentFrameNumber() const {
-        return _frameNumber % MAX_FRAMES_IN_FLIGHT;
+        return _frameNumber % _framesInFlight;
     }
 
 
@@ -8,14 +8,34 @@
 #include <youtube_engine/rendering/renderer.h>
 #include <vector>
 #include <array>
+#include <atomic>
+#include <chrono>
+#include <mutex>
 #include <set>
+#include <span>
+#include <unordered_map>
 #include <youtube_engine/vr/vr_subsystem.h>
 
 #include "vulkan_includes.h"
+#include "vulkan_bindless_textures.h"
+#include "vulkan_command_recorder.h"
+#include "vulkan_deletion_queue.h"
 #include "vulkan_descriptor_set_manager.h"
+#include "vulkan_gpu_profiler.h"
+#include "vulkan_indirect_renderer.h"
+#include "vulkan_occlusion_culler.h"
+#include "vulkan_pipeline_cache.h"
+#include "vulkan_sampler_cache.h"
+#include "vulkan_shader_registry.h"
+#include "vulkan_texture_streamer.h"
+#include "vulkan_timeline.h"
 
 namespace OZZ {
-    constexpr uint32_t MAX_FRAMES_IN_FLIGHT = 2;
+    class VulkanShader;
+
+    // The most RendererSettings::FramesInFlight can ask for
+    constexpr uint32_t MAX_FRAMES_IN_FLIGHT = 3;
+    constexpr uint32_t MAX_DRAW_DESCRIPTOR_SETS = 4;
 
     struct VRFrameData {
         VkCommandPool CommandPool { VK_NULL_HANDLE };
@@ -30,6 +50,28 @@ namespace OZZ {
         VkFormat DepthFormat { VK_FORMAT_D32_SFLOAT };
 
         std::shared_ptr<UniformBuffer> CameraData { nullptr };
+
+        // Reached once the GPU is done with the eye's last submission from this image
+        uint64_t TimelineValue { 0 };
+    };
+
+    /*
+     * Static objects' draws, recorded once into a secondary and replayed every frame until the key made from everything
+     * they were recorded with changes. Its descriptor sets come from a manager of its own, so they outlive the per frame
+     * pool resets.
+     */
+    struct StaticRecording {
+        VkCommandPool CommandPool { VK_NULL_HANDLE };
+        VkCommandBuffer CommandBuffer { VK_NULL_HANDLE };
+        VulkanDescriptorSetManager Descriptors {};
+
+        // Keeps the buffers it draws from alive, so a new mesh can't turn up at an address the key still matches
+        std::vector<std::shared_ptr<Mesh>> Meshes {};
+
+        // 0 until something has been recorded
+        uint64_t Key { 0 };
+        uint32_t DrawCalls { 0 };
+        uint64_t Triangles { 0 };
     };
 
     struct FrameData {
@@ -39,10 +81,49 @@ namespace OZZ {
         VkCommandPool CommandPool { VK_NULL_HANDLE };
         VkCommandBuffer MainCommandBuffer { VK_NULL_HANDLE };
 
-        VkFence RenderFence { VK_NULL_HANDLE };
+        // Reached once the GPU is done with this frame's last submission
+        uint64_t TimelineValue { 0 };
         uint32_t SwapchainImageIndex { 0 };
 
+        // Input time of the scene last submitted with this frame, cleared once it has been seen complete
+        std::chrono::steady_clock::time_point InputTime {};
+
         std::shared_ptr<UniformBuffer> CameraData { nullptr };
+
+        // One pool per recording job so workers never share one, each with a single secondary buffer reused every frame
+        std::vector<VkCommandPool> RecordingPools {};
+        std::vector<VkCommandBuffer> SecondaryCommandBuffers {};
+
+        // Only replayed by this frame, so it's never pending when it has to be recorded again
+        StaticRecording StaticDraws {};
+    };
+
+    /*
+     * One submesh of one object with its pipeline and descriptor sets resolved up front, so recording it never touches
+     * state shared with other threads.
+     */
+    struct DrawPacket {
+        // Keeps the submesh, its material and shader alive until the frame is recorded
+        std::shared_ptr<Mesh> Owner { nullptr };
+        Submesh* Geometry { nullptr };
+        const RenderableObject* Object { nullptr };
+        const Material* SourceMaterial { nullptr };
+        VulkanShader* MaterialShader { nullptr };
+
+        // What's actually drawn with: the material's program, its bindless variant or its fallback. Held so a reload
+        // can't release the pipeline before the packet is recorded.
+        std::shared_ptr<VulkanShaderProgram> Program { nullptr };
+        VkPipeline Pipeline { VK_NULL_HANDLE };
+        VkPipelineLayout PipelineLayout { VK_NULL_HANDLE };
+
+        std::array<VkDescriptorSet, MAX_DRAW_DESCRIPTOR_SETS> DescriptorSets {};
+
+        // Bindless draws have every set written up front and push their material index alongside the transform
+        bool Bindless { false };
+        uint32_t MaterialIndex { 0 };
+
+        // Numbered like the occlusion culler numbers draws
+        uint32_t DrawIndex { 0 };
     };
 
     struct VulkanQueueFamilyIndices {
@@ -61,10 +142,11 @@ namespace OZZ {
     friend class VulkanUniformBuffer;
     friend class VulkanShader;
     friend class VulkanTexture;
+    friend class VulkanTextureStreamer;
 
     public:
-        void Reset() override;
-        void Reset(RendererSettings) override;
+        void Reset(RendererResetCause cause) override;
+        void Reset(RendererSettings settings, RendererResetCause cause) override;
 
         void RenderFrame(SceneParams& sceneParams, const std::vector<RenderableObject>& objects) override;
 
@@ -76,16 +158,37 @@ namespace OZZ {
         std::shared_ptr<UniformBuffer> CreateUniformBuffer() override;
         std::shared_ptr<Texture> CreateTexture() override;
 
+        [[nodiscard]] FrameStats GetFrameStats() const override;
+
+        void SetGpuProfilingSettings(const GpuProfilingSettings& settings) override;
+        [[nodiscard]] GpuFrameTimings GetGpuFrameTimings() const override;
+
+        [[nodiscard]] bool IsTextureStreamingEnabled() const override { return _textureStreamer.IsEnabled(); }
+
+        [[nodiscard]] const RendererSettings& GetSettings() const override { return _rendererSettings; }
+
     private:
         void Init() override;
         void Shutdown() override;
 
         void initCore();
+        // The feature passes, GPU profiler queries and descriptor pools, all sized to the frames in flight
+        void initFrameResources();
         void cleanupSwapchain();
+        void cleanFrameResources();
         void cleanResources();
 
+        // Rebuilds the render pass, pipelines and per-frame resources for new settings, keeping the device and its resources
+        void recreateFrameResources();
+
+        // The least a reset to these settings has to rebuild
+        [[nodiscard]] RendererResetCause getResetCause(const RendererSettings& settings) const;
+
         void recreateSwapchain();
 
+        // Hands the window's framebuffers, image views and depth buffer to the deletion queue
+        void retireWindowTargets();
+
         void createSwapchain();
         void createCommands();
         void createFramebuffers();
@@ -101,12 +204,16 @@ namespace OZZ {
         void createWindowSwapchain();
         void createVRSwapchain();
 
+        // The configured present mode, or FIFO when the surface doesn't support it
+        VkPresentModeKHR choosePresentMode();
+
         void createWindowFramebuffers();
         void createVRFramebuffers();
 
         void createVRFrameData();
 
         void beginFrameWindow();
+        void beginWindowRenderPass(VkCommandBuffer commandBuffer, VkSubpassContents contents);
         std::vector<EyePoseInfo> beginFrameVR();
 
         void renderFrameWindow(const SceneParams& sceneParams, const std::vector<RenderableObject>& objects);
@@ -116,10 +223,48 @@ namespace OZZ {
         void endFrameWindow();
         void endFrameVR(const std::vector<EyePoseInfo>& eyePoses);
 
-        void renderObjects(VkCommandPool commandPool, VkCommandBuffer commandBuffer, std::shared_ptr<UniformBuffer> cameraBuffer, const std::vector<RenderableObject>& objects);
+        void renderObjects(VkCommandBuffer commandBuffer, std::shared_ptr<UniformBuffer> cameraBuffer, VkExtent2D viewportExtent,
+                           const std::vector<RenderableObject>& objects);
+        void renderObjectsParallel(FrameData& frame, std::vector<DrawPacket> packets, uint32_t subpass);
+        // Replays the frame's static recording, recording it again first if anything it drew with has changed
+        void renderStaticObjects(FrameData& frame, const VkDescriptorBufferInfo& cameraInfo, const std::vector<RenderableObject>& objects,
+                                 uint32_t subpass);
+        [[nodiscard]] uint64_t hashStaticObjects(const VkDescriptorBufferInfo& cameraInfo, const std::vector<RenderableObject>& objects,
+                                                 uint32_t subpass) const;
+        // Sets come from the given manager, so they last as long as its current frame does
+        std::vector<DrawPacket> buildDrawPackets(const VkDescriptorBufferInfo& cameraInfo, const std::vector<RenderableObject>& objects,
+                                                 VulkanDescriptorSetManager& descriptors);
+        // Points the packet at the material's bindless program and shared sets. False if it has to bind its own textures.
+        bool resolveBindlessPacket(DrawPacket& packet, const VkDescriptorBufferInfo& cameraInfo, VulkanDescriptorSetManager& descriptors,
+                                   std::unordered_map<VkDescriptorSetLayout, VkDescriptorSet>& sharedSets);
+        void requestTextureMips(const std::vector<TextureMipRequest>& requests);
+        void recordDrawPackets(VkCommandBuffer commandBuffer, std::span<const DrawPacket> packets, const VkDescriptorBufferInfo& cameraInfo,
+                               VkExtent2D viewportExtent, FrameStats& stats, bool profileScopes);
+        void renderDepthPrepass(VkCommandBuffer commandBuffer, std::shared_ptr<UniformBuffer> cameraBuffer,
+                                const std::vector<RenderableObject>& objects);
+        void renderBatches(VkCommandBuffer commandBuffer, std::shared_ptr<UniformBuffer> cameraBuffer);
+
+        // The render pass and subpass material pipelines are built against
+        [[nodiscard]] VulkanPassDescription getMaterialPass() const;
+        [[nodiscard]] bool usesDepthPrepass() const;
+        [[nodiscard]] bool usesOcclusionCulling() const;
+        [[nodiscard]] bool usesGpuDrivenRendering() const;
+        [[nodiscard]] bool usesBindlessTextures() const;
+        [[nodiscard]] bool usesParallelRecording(size_t drawCount) const;
+        [[nodiscard]] bool usesStaticRecording() const;
 
         VkPhysicalDevice getPhysicalDevice();
-        std::tuple<VkDevice, VulkanQueueFamilyIndices> createLogicalDevice(VkPhysicalDevice device, const std::set<std::string>& deviceExtensions);
+        std::tuple<VkDevice, VulkanQueueFamilyIndices> createLogicalDevice(VkPhysicalDevice device, const std::set<std::string>& deviceExtensions,
+                                                                           const VkPhysicalDeviceFeatures& features, const void* featureChain = nullptr);
+
+        void finishFrameStats();
+        void recordDescriptorPoolStats();
+
+        // Blocks until the GPU is done with the current frame's resources
+        void waitForCurrentFrame();
+
+        // Measures input to present for a frame that was just seen complete
+        void sampleInputLatency(FrameData& frame);
 
         FrameData& getCurrentFrame();
         uint32_t getCurrentFrameNumber() const;
@@ -133,11 +278,46 @@ namespace OZZ {
 
         //TODO: TEMPORARY FRAME NUMBER
         uint64_t _frameNumber {0};
-        bool _recreateFrameBuffer { false };
+        uint32_t _framesInFlight { 2 };
+        std::atomic<bool> _recreateFrameBuffer { false };
+
+        // Bumped whenever swapchain targets or texture images are replaced, so static recordings that used them are redone
+        uint64_t _swapchainGeneration { 0 };
+        uint64_t _textureGeneration { 0 };
+
+        // Kept up to date by the window's resize callback, so a render thread never has to ask the window itself
+        std::atomic<int> _framebufferWidth { 0 };
+        std::atomic<int> _framebufferHeight { 0 };
+
+        /*
+         * THREADING
+         * Frames may be drawn on a render thread while the game thread uploads buffers and textures or loads shaders.
+         * Those take this lock, and so does a frame for everything but its timeline wait. Recursive because resources can
+         * be released from inside a frame.
+         */
+        std::recursive_mutex _resourceMutex;
 
         RendererSettings _rendererSettings {};
 
+        FrameStats _frameStats {};
+        FrameStats _lastFrameStats {};
+        GpuFrameTimings _lastGpuTimings {};
+        mutable std::mutex _statsMutex;
+
+        // Latest measurement, taken during the timeline wait and outside the resource lock
+        float _inputToPresentMs { 0.f };
+
         VulkanDescriptorSetManager _descriptorSetManager;
+        VulkanPipelineCache _pipelineCache;
+        VulkanShaderRegistry _shaderRegistry;
+        VulkanSamplerCache _samplerCache;
+        VulkanTextureStreamer _textureStreamer;
+        VulkanGpuProfiler _gpuProfiler;
+        VulkanOcclusionCuller _occlusionCuller;
+        VulkanIndirectRenderer _indirectRenderer;
+        VulkanBindlessTextures _bindlessTextures;
+        VulkanTimeline _timeline;
+        VulkanDeletionQueue _deletionQueue;
 
         /*
          * CORE VULKAN
@@ -145,6 +325,10 @@ namespace OZZ {
         VkInstance _instance;
         VkDebugUtilsMessengerEXT _debug_messenger;
         VkPhysicalDevice _physicalDevice;   // physical device
+        VkPhysicalDeviceProperties _physicalDeviceProperties {};
+        VkPhysicalDeviceFeatures _enabledFeatures {};
+        // 0 if the device can't do bindless textures
+        uint32_t _maxBindlessTextures { 0 };
         VkDevice _device;                   // logical device
         VkSurfaceKHR _surface;
         VmaAllocator _allocator;
@@ -179,11 +363,13 @@ namespace OZZ {
         VkRenderPass _vrRenderPass { VK_NULL_HANDLE };
         std::vector<VkFramebuffer> _framebuffers {3};
 
+        std::shared_ptr<VulkanShaderProgram> _depthPrepassProgram { nullptr };
+
         /*
          * SYNCHRONIZATION OBJECTS
          */
 
-        FrameData _frames[MAX_FRAMES_IN_FLIGHT];
+        std::vector<FrameData> _frames {};
         std::vector<std::vector<VRFrameData>> _vrFrames;
 
     };
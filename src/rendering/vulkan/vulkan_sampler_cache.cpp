@@ -0,0 +1,113 @@
+#include "vulkan_sampler_cache.h"
+#include "vulkan_utilities.h"
+
+#include <algorithm>
+#include <bit>
+#include <iostream>
+
+namespace OZZ {
+    void VulkanSamplerCache::Init(VkDevice device, const VkPhysicalDeviceProperties& properties, const VkPhysicalDeviceFeatures& enabledFeatures) {
+        _device = device;
+        _limits = properties.limits;
+        _anisotropySupported = enabledFeatures.samplerAnisotropy;
+    }
+
+    void VulkanSamplerCache::Shutdown() {
+        std::lock_guard<std::mutex> lock(_mutex);
+
+        for (auto& [settings, sampler] : _samplers) {
+            vkDestroySampler(_device, sampler, nullptr);
+        }
+
+        _samplers.clear();
+        _device = VK_NULL_HANDLE;
+    }
+
+    VkSampler VulkanSamplerCache::GetSampler(const SamplerSettings& requested) {
+        auto settings = normalize(requested);
+
+        std::lock_guard<std::mutex> lock(_mutex);
+
+        if (auto it = _samplers.find(settings); it != _samplers.end()) {
+            return it->second;
+        }
+
+        auto toFilter = [](TextureFilter filter) {
+            return filter == TextureFilter::Nearest ? VK_FILTER_NEAREST : VK_FILTER_LINEAR;
+        };
+
+        VkSamplerAddressMode samplerAddressMode;
+        switch (settings.AddressMode) {
+            case TextureAddressMode::MirroredRepeat:
+                samplerAddressMode = VK_SAMPLER_ADDRESS_MODE_MIRRORED_REPEAT;
+                break;
+            case TextureAddressMode::ClampToEdge:
+                samplerAddressMode = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+                break;
+            case TextureAddressMode::ClampToBorder:
+                samplerAddressMode = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_BORDER;
+                break;
+            default:
+                samplerAddressMode = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+                break;
+        }
+
+        bool anisotropyEnabled = settings.MaxAnisotropy > 1.f;
+
+        // The image view limits which mips exist, so one sampler works for any mip count
+        VkSamplerCreateInfo samplerCreateInfo{
+                .sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO,
+                .magFilter = toFilter(settings.MagFilter),
+                .minFilter = toFilter(settings.MinFilter),
+                .mipmapMode = settings.MipmapFilter == TextureFilter::Nearest ? VK_SAMPLER_MIPMAP_MODE_NEAREST : VK_SAMPLER_MIPMAP_MODE_LINEAR,
+                .addressModeU = samplerAddressMode,
+                .addressModeV = samplerAddressMode,
+                .addressModeW = samplerAddressMode,
+                .mipLodBias = settings.MipLodBias,
+                .anisotropyEnable = anisotropyEnabled ? VK_TRUE : VK_FALSE,
+                .maxAnisotropy = settings.MaxAnisotropy,
+                .minLod = 0.f,
+                .maxLod = VK_LOD_CLAMP_NONE,
+                .borderColor = VK_BORDER_COLOR_INT_OPAQUE_BLACK
+        };
+
+        VkSampler sampler { VK_NULL_HANDLE };
+        VK_CHECK("VulkanSamplerCache::GetSampler", vkCreateSampler(_device, &samplerCreateInfo, nullptr, &sampler));
+
+        _samplers[settings] = sampler;
+
+        // Samplers are only ever added, so each threshold is crossed exactly once per device
+        if (_samplers.size() == _limits.maxSamplerAllocationCount / 2 + 1 || _samplers.size() == _limits.maxSamplerAllocationCount) {
+            std::cout << "Warning: " << _samplers.size() << " unique samplers in use, device limit is "
+                      << _limits.maxSamplerAllocationCount << std::endl;
+        }
+
+        return sampler;
+    }
+
+    size_t VulkanSamplerCache::GetSamplerCount() const {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return _samplers.size();
+    }
+
+    size_t VulkanSamplerCache::SamplerSettingsHash::operator()(const SamplerSettings& settings) const {
+        uint64_t hash = static_cast<uint64_t>(settings.MagFilter);
+        hash = VulkanUtilities::HashCombine(hash, static_cast<uint64_t>(settings.MinFilter));
+        hash = VulkanUtilities::HashCombine(hash, static_cast<uint64_t>(settings.MipmapFilter));
+        hash = VulkanUtilities::HashCombine(hash, static_cast<uint64_t>(settings.AddressMode));
+        hash = VulkanUtilities::HashCombine(hash, std::bit_cast<uint32_t>(settings.MaxAnisotropy));
+        hash = VulkanUtilities::HashCombine(hash, std::bit_cast<uint32_t>(settings.MipLodBias));
+        return static_cast<size_t>(hash);
+    }
+
+    SamplerSettings VulkanSamplerCache::normalize(const SamplerSettings& settings) const {
+        auto normalized = settings;
+
+        normalized.MaxAnisotropy = _anisotropySupported
+                ? std::clamp(settings.MaxAnisotropy, 1.f, _limits.maxSamplerAnisotropy)
+                : 1.f;
+        normalized.MipLodBias = std::clamp(settings.MipLodBias, -_limits.maxSamplerLodBias, _limits.maxSamplerLodBias);
+
+        return normalized;
+    }
+}
@@ -0,0 +1,41 @@
+#pragma once
+#include <youtube_engine/rendering/texture.h>
+
+#include <mutex>
+#include <unordered_map>
+
+#include "vulkan_includes.h"
+
+namespace OZZ {
+    /*
+     * Renderer-wide VkSamplers keyed by their settings. Textures only hold handles into the cache, so a sampler is
+     * created once per distinct settings and lives until the device goes away.
+     *
+     * Textures ask for samplers from whichever thread uploads them, so lookups take the cache's own lock.
+     */
+    class VulkanSamplerCache {
+    public:
+        void Init(VkDevice device, const VkPhysicalDeviceProperties& properties, const VkPhysicalDeviceFeatures& enabledFeatures);
+        void Shutdown();
+
+        VkSampler GetSampler(const SamplerSettings& settings);
+
+        [[nodiscard]] size_t GetSamplerCount() const;
+
+    private:
+        struct SamplerSettingsHash {
+            size_t operator()(const SamplerSettings& settings) const;
+        };
+
+        // Clamps the settings to what the device supports so equivalent requests share a sampler
+        [[nodiscard]] SamplerSettings normalize(const SamplerSettings& settings) const;
+
+    private:
+        VkDevice _device { VK_NULL_HANDLE };
+        VkPhysicalDeviceLimits _limits {};
+        bool _anisotropySupported { false };
+
+        mutable std::mutex _mutex;
+        std::unordered_map<SamplerSettings, VkSampler, SamplerSettingsHash> _samplers {};
+    };
+}
@@ -2,16 +2,11 @@
 // Created by ozzadar on 2022-02-01.
 //
 
-#include <youtube_engine/service_locator.h>
-#include <map>
 #include "vulkan_shader.h"
 #include "vulkan_utilities.h"
-#include "vulkan_initializers.h"
-#include "vulkan_pipeline_builder.h"
-#include "vulkan_types.h"
 #include "vulkan_renderer.h"
-#include "vulkan_buffer.h"
-#include "vulkan_texture.h"
+
+#include <filesystem>
 
 namespace OZZ {
     VulkanShader::VulkanShader(VulkanRenderer* renderer) :
@@ -37,183 +32,65 @@ namespace OZZ {
         RecreateResources();
     }
 
-    void VulkanShader::Bind(void* handle) {
-        vkCmdBindPipeline(reinterpret_cast<VkCommandBuffer>(handle), VK_PIPELINE_BIND_POINT_GRAPHICS, _pipeline);
-
-        int width, height;
-        if (_renderer->_rendererSettings.VR) {
-            std::tie(width, height) = ServiceLocator::GetVRSubsystem()->GetSwapchainImageRectDimensions();
-        } else {
-            std::tie(width, height) = ServiceLocator::GetWindow()->GetWindowExtents();
-        }
-
-        VkViewport viewport = {0.0, 0.0, static_cast<float>(width), static_cast<float>(height), 0.0, 1.0};
-        vkCmdSetViewport(reinterpret_cast<VkCommandBuffer>(handle), 0, 1, &viewport);
-
-        VkRect2D scissor {
-            .offset = {0, 0},
-            .extent = { static_cast<uint32_t>(width), static_cast<uint32_t>(height) },
-        };
-
-        vkCmdSetScissor(reinterpret_cast<VkCommandBuffer>(handle), 0, 1, &scissor);
-    }
-
     void VulkanShader::Load(const std::string&& vertexShader, const std::string&& fragmentShader) {
+        // A frame being recorded on the render thread may be reading the programs
+        std::lock_guard<std::recursive_mutex> lock(_renderer->_resourceMutex);
+
         _vertexShader = vertexShader;
         _fragmentShader = fragmentShader;
 
-        VkShaderModule fragmentShaderModule;
-        ShaderData fragmentShaderData;
-        if (!VulkanUtilities::LoadShaderModule(fragmentShader, _renderer->_device, fragmentShaderModule, fragmentShaderData)) {
-            std::cout << "Failed to load fragment shader module at: " << _fragmentShader << "\n";
-        }
-
-        VkShaderModule vertexShaderModule;
-        ShaderData vertexShaderData;
-        if (!VulkanUtilities::LoadShaderModule(vertexShader, _renderer->_device, vertexShaderModule, vertexShaderData)) {
-            std::cout << "Failed to load vertex shader module at: " << _vertexShader << "\n";
-        }
-
-        _data = ShaderData::Merge(fragmentShaderData, vertexShaderData);
-
-        buildDescriptorSets();
-
-        auto pipelineLayoutInfo = VulkanInitializers::PipelineLayoutCreateInfo();
-
-        pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(_descriptorSetLayouts.size());
-        pipelineLayoutInfo.pSetLayouts = _descriptorSetLayouts.data();
-        pipelineLayoutInfo.pPushConstantRanges = &_pushConstants;
-        pipelineLayoutInfo.pushConstantRangeCount = 1;
-
-        // descriptor set layout goes here
-        // therefore they probably belong to the shader
-
-        VK_CHECK("VulkanShader::Load", vkCreatePipelineLayout(_renderer->_device, &pipelineLayoutInfo, nullptr, &_pipelineLayout));
-
-        /*
-         * TEMPORARY PIPELINE BUILDING
-         */
-
-        VertexInputDescription vertexInputDescription = GetVertexDescription();
-
-        VulkanPipelineBuilder pipelineBuilder;
-
-        pipelineBuilder._shaderStages.push_back(
-                VulkanInitializers::PipelineShaderStageCreateInfo(VK_SHADER_STAGE_VERTEX_BIT, vertexShaderModule));
-        pipelineBuilder._shaderStages.push_back(
-                VulkanInitializers::PipelineShaderStageCreateInfo(VK_SHADER_STAGE_FRAGMENT_BIT, fragmentShaderModule));
-
-
-        // Specify vertex attributes
-        pipelineBuilder._vertexInputInfo = VulkanInitializers::PipelineVertexInputStateCreateInfo();
-        pipelineBuilder._vertexInputInfo.pVertexAttributeDescriptions = vertexInputDescription.attributes.data();
-        pipelineBuilder._vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(vertexInputDescription.attributes.size());
-
-        pipelineBuilder._vertexInputInfo.pVertexBindingDescriptions = vertexInputDescription.bindings.data();
-        pipelineBuilder._vertexInputInfo.vertexBindingDescriptionCount = static_cast<uint32_t>(vertexInputDescription.bindings.size());
-
-        pipelineBuilder._inputAssembly = VulkanInitializers::PipelineInputAssemblyStateCreateInfo(VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST);
+        // The registry hands back the existing program if these shaders have been loaded before
+        _program = _renderer->_shaderRegistry.GetMaterialProgram(_vertexShader, _fragmentShader, _renderer->getMaterialPass());
 
-        // build the viewport
-        pipelineBuilder._viewport = {
-                .x = 0.f,
-                .y = 0.f,
-                .width = static_cast<float>(_renderer->_windowExtent.width),
-                .height = static_cast<float>(_renderer->_windowExtent.height),
-                .minDepth = 0.f,
-                .maxDepth = 1.f
-        };
+        // Materials opt into GPU driven batches by shipping "<name>_instanced.vert" next to their vertex shader
+        _instancedProgram.reset();
+        if (_program && _renderer->usesGpuDrivenRendering()) {
+            auto instancedShader = getVariantPath(_vertexShader, ".vert.spv", "_instanced");
 
-        pipelineBuilder._scissor = {
-                .offset = {0 , 0},
-                .extent = _renderer->_windowExtent
-        };
-
-        pipelineBuilder._rasterizer = VulkanInitializers::PipelineRasterizationStateCreateInfo(VK_POLYGON_MODE_FILL);
-        pipelineBuilder._multisampling = VulkanInitializers::PipelineMultisampleStateCreateInfo();
-        pipelineBuilder._colorBlendAttachment = VulkanInitializers::PipelineColorBlendAttachmentState();
-        pipelineBuilder._pipelineLayout = _pipelineLayout;
-        pipelineBuilder._depthStencil = VulkanInitializers::DepthStencilCreateInfo(true, true, VK_COMPARE_OP_LESS_OR_EQUAL);
-
-        _pipeline = pipelineBuilder.BuildPipeline(_renderer->_device, _renderer->_rendererSettings.VR ? _renderer->_vrRenderPass : _renderer->_renderPass);
-
-        vkDestroyShaderModule(_renderer->_device, fragmentShaderModule, nullptr);
-        vkDestroyShaderModule(_renderer->_device, vertexShaderModule, nullptr);
-    }
-
-    VkDescriptorSetLayout VulkanShader::GetDescriptorSetLayout(uint32_t index) {
-        if (index < _descriptorSetLayouts.size()) {
-            return _descriptorSetLayouts[index];
-        }
-
-        return VK_NULL_HANDLE;
-    }
-
-    void VulkanShader::cleanPipeline() {
-        if (_pipeline) {
-            vkDestroyPipeline(_renderer->_device, _pipeline, nullptr);
+            if (!instancedShader.empty()) {
+                _instancedProgram = _renderer->_shaderRegistry.GetProgram(instancedShader, _fragmentShader, _renderer->getMaterialPass());
+            }
         }
 
-        if (_pipelineLayout) {
-            vkDestroyPipelineLayout(_renderer->_device, _pipelineLayout, nullptr);
-        }
+        // ...and into bindless textures with a "_bindless" pair of both stages
+        _bindlessProgram.reset();
+        if (_program && _renderer->usesBindlessTextures()) {
+            auto bindlessVertex = getVariantPath(_vertexShader, ".vert.spv", "_bindless");
+            auto bindlessFragment = getVariantPath(_fragmentShader, ".frag.spv", "_bindless");
 
-        for (auto descriptorSetLayout : _descriptorSetLayouts) {
-            vkDestroyDescriptorSetLayout(_renderer->_device, descriptorSetLayout, nullptr);
+            if (!bindlessVertex.empty() && !bindlessFragment.empty()) {
+                _bindlessProgram = _renderer->_shaderRegistry.GetProgram(bindlessVertex, bindlessFragment, _renderer->getMaterialPass());
+            }
         }
-
-        _descriptorSetLayouts.clear();
     }
 
-    void VulkanShader::buildDescriptorSets() {
-        // First step is to collect the descriptors
-        std::map<uint32_t, std::vector<VkDescriptorSetLayoutBinding>> _descriptorSetDescriptions {};
-        bool pushConstantAdded { false };
-
-        for (const auto& [k, resource] : _data.Resources) {
+    const ShaderData& VulkanShader::GetShaderData() {
+        return _program && _program->IsReady() ? _program->Data : _data;
+    }
 
-            if (!_descriptorSetDescriptions.contains(resource.Set)) {
-                _descriptorSetDescriptions[resource.Set] = {};
-            }
+    std::shared_ptr<VulkanShaderProgram> VulkanShader::GetDrawProgram() const {
+        if (!_program) return nullptr;
+        if (_program->IsReady()) return _program;
 
-            switch (resource.Type) {
-                case ResourceType::PushConstant:
-                    // TODO: Push constants can be more dynamic than this and can support multiple shader stages
-                    if (pushConstantAdded) {
-                        std::cout << "WARNING: Two sets of push constants in ShaderData!" << std::endl;
-                        continue;
-                    }
-                    std::cout << "Push constants present!" << std::endl;
-                    _pushConstants.offset = 0;
-                    _pushConstants.size = static_cast<uint32_t>(resource.Size);
-                    _pushConstants.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
-                    pushConstantAdded = true;
-                    break;
-                case ResourceType::Uniform:
-                    _descriptorSetDescriptions[resource.Set].push_back(GetUniformBufferLayoutBinding(resource.Binding));
-                    break;
-                case ResourceType::Sampler:
-                    _descriptorSetDescriptions[resource.Set].push_back(GetTextureLayoutBinding(resource.Binding));
-                    break;
-                default:
-                    break;
-            }
+        if (_program->Fallback && _program->Fallback->IsReady()) {
+            return _program->Fallback;
         }
 
+        return nullptr;
+    }
 
-        for (const auto& [key, bindings] : _descriptorSetDescriptions) {
-            auto createDescriptorSetLayout = BuildDescriptorSetLayout(bindings);
-
-
-            VkDescriptorSetLayout currentLayout { VK_NULL_HANDLE };
-
-            VK_CHECK("VulkanShader::buildDescriptorSets", vkCreateDescriptorSetLayout(_renderer->_device, &createDescriptorSetLayout, nullptr,
-                                                 &currentLayout));
+    void VulkanShader::cleanPipeline() {
+        std::lock_guard<std::recursive_mutex> lock(_renderer->_resourceMutex);
 
-            _descriptorSetLayouts.push_back(currentLayout);
-        }
+        _program.reset();
+        _instancedProgram.reset();
+        _bindlessProgram.reset();
     }
 
+    std::string VulkanShader::getVariantPath(const std::string& path, std::string_view extension, std::string_view variant) {
+        if (!path.ends_with(extension)) return {};
 
-
+        auto variantPath = path.substr(0, path.size() - extension.size()) + std::string(variant) + std::string(extension);
+        return std::filesystem::exists(variantPath) ? variantPath : std::string {};
+    }
 }
@@ -6,7 +6,9 @@
 #include <youtube_engine/rendering/shader.h>
 #include <youtube_engine/rendering/buffer.h>
 #include <youtube_engine/rendering/texture.h>
+#include <string_view>
 #include "vulkan_includes.h"
+#include "vulkan_shader_registry.h"
 
 namespace OZZ {
     class VulkanRenderer;
@@ -20,27 +22,37 @@ namespace OZZ {
 
         void Rebuild();
 
-        void Bind(void*) override;
         void Load(const std::string&& vertexShader, const std::string&& fragmentShader) override;
 
-        [[nodiscard]] VkPipelineLayout GetPipelineLayout() { return _pipelineLayout; }
-        [[nodiscard]] VkDescriptorSetLayout GetDescriptorSetLayout(uint32_t index);
+        // Empty until the program has compiled
+        const ShaderData& GetShaderData() override;
+
+        // The program itself once compiled, otherwise its flat shaded fallback. Null if neither is ready. Hold on to
+        // it for as long as its pipeline is in use.
+        [[nodiscard]] std::shared_ptr<VulkanShaderProgram> GetDrawProgram() const;
+
+        // The "_instanced" variant of the vertex shader for GPU driven batches. Null if the material doesn't have one.
+        [[nodiscard]] const std::shared_ptr<VulkanShaderProgram>& GetInstancedProgram() const { return _instancedProgram; }
+
+        // The "_bindless" variant reading textures out of the renderer's bindless array. Null if the material doesn't have one.
+        [[nodiscard]] const std::shared_ptr<VulkanShaderProgram>& GetBindlessProgram() const { return _bindlessProgram; }
 
         ~VulkanShader() override;
     private:
         void cleanPipeline();
-        void buildDescriptorSets();
+
+        // "<name><variant><extension>" if that file exists next to the shader, otherwise empty
+        static std::string getVariantPath(const std::string& path, std::string_view extension, std::string_view variant);
 
     private:
         VulkanRenderer* _renderer;
         /*
          * PIPELINES
+         * Shared with every other shader loaded from the same SPIR-V.
          */
-        std::vector<VkDescriptorSetLayout> _descriptorSetLayouts {};
-        VkPushConstantRange _pushConstants {};
-
-        VkPipelineLayout _pipelineLayout{ VK_NULL_HANDLE };
-        VkPipeline _pipeline { VK_NULL_HANDLE };
+        std::shared_ptr<VulkanShaderProgram> _program { nullptr };
+        std::shared_ptr<VulkanShaderProgram> _instancedProgram { nullptr };
+        std::shared_ptr<VulkanShaderProgram> _bindlessProgram { nullptr };
 
         /*
          * FILE LOCATIONS FOR REBUILDING
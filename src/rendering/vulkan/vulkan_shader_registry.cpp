@@ -0,0 +1,415 @@
+#include "vulkan_shader_registry.h"
+#include "vulkan_deletion_queue.h"
+#include "vulkan_initializers.h"
+#include "vulkan_pipeline_builder.h"
+#include "vulkan_types.h"
+#include "vulkan_utilities.h"
+
+#include <youtube_engine/platform/filesystem.h>
+#include <youtube_engine/service_locator.h>
+#include <map>
+#include <set>
+
+namespace OZZ {
+    /*
+     * SHADER MODULE
+     */
+    VulkanShaderModule::VulkanShaderModule(VkDevice device, const VulkanShaderSource& source) : Device(device) {
+        VkShaderModuleCreateInfo shaderModuleCreateInfo { VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO };
+        shaderModuleCreateInfo.codeSize = source.Code.size() * sizeof(uint32_t);
+        shaderModuleCreateInfo.pCode = source.Code.data();
+
+        VK_CHECK("VulkanShaderModule::Constructor", vkCreateShaderModule(Device, &shaderModuleCreateInfo, nullptr, &Module));
+    }
+
+    VulkanShaderModule::~VulkanShaderModule() {
+        vkDestroyShaderModule(Device, Module, nullptr);
+    }
+
+    /*
+     * DESCRIPTOR SET LAYOUT
+     */
+    VulkanDescriptorSetLayout::VulkanDescriptorSetLayout(VkDevice device, const std::vector<VkDescriptorSetLayoutBinding>& bindings) : Device(device) {
+        for (const auto& binding : bindings) {
+            Bindings.push_back(Binding { binding.binding, binding.descriptorType, binding.descriptorCount, binding.stageFlags });
+        }
+
+        auto createDescriptorSetLayout = BuildDescriptorSetLayout(bindings);
+        VK_CHECK("VulkanDescriptorSetLayout::Constructor", vkCreateDescriptorSetLayout(Device, &createDescriptorSetLayout, nullptr, &Layout));
+    }
+
+    VulkanDescriptorSetLayout::VulkanDescriptorSetLayout(VkDescriptorSetLayout layout) : Layout(layout) {}
+
+    VulkanDescriptorSetLayout::~VulkanDescriptorSetLayout() {
+        if (Device == VK_NULL_HANDLE) return;
+        vkDestroyDescriptorSetLayout(Device, Layout, nullptr);
+    }
+
+    /*
+     * SHADER PROGRAM
+     */
+    VulkanShaderProgram::~VulkanShaderProgram() {
+        // The compile job only holds a raw pointer to us, make sure it's done before tearing down
+        if (Compilation.valid()) {
+            Compilation.wait();
+        }
+
+        auto destroy = [device = Device, pipeline = Pipeline.load(), pipelineLayout = PipelineLayout]() {
+            if (pipeline) {
+                vkDestroyPipeline(device, pipeline, nullptr);
+            }
+
+            if (pipelineLayout) {
+                vkDestroyPipelineLayout(device, pipelineLayout, nullptr);
+            }
+        };
+
+        if (DeletionQueue) {
+            DeletionQueue->Retire(std::move(destroy));
+        } else {
+            destroy();
+        }
+
+        // Set layouts and modules are shared and release themselves
+        SetLayouts.clear();
+    }
+
+    /*
+     * REGISTRY
+     */
+    void VulkanShaderRegistry::Init(VkDevice device, VulkanPipelineCache* pipelineCache, VulkanDeletionQueue* deletionQueue) {
+        std::lock_guard<std::mutex> lock(_mutex);
+
+        _device = device;
+        _pipelineCache = pipelineCache;
+        _deletionQueue = deletionQueue;
+    }
+
+    void VulkanShaderRegistry::Shutdown() {
+        WaitForCompilation();
+
+        std::lock_guard<std::mutex> lock(_mutex);
+
+        // Anything still alive here is owned by a shader; the registry only forgets about it. Sources are device
+        // independent and stay cached so a reset doesn't go back to disk.
+        _programs.clear();
+        _setLayouts.clear();
+        _modules.clear();
+        _bindlessLayout = nullptr;
+
+        _device = VK_NULL_HANDLE;
+        _pipelineCache = nullptr;
+        _deletionQueue = nullptr;
+    }
+
+    void VulkanShaderRegistry::SetBindlessLayout(VkDescriptorSetLayout layout) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _bindlessLayout = layout != VK_NULL_HANDLE ? std::make_shared<VulkanDescriptorSetLayout>(layout) : nullptr;
+    }
+
+    std::shared_ptr<VulkanShaderProgram> VulkanShaderRegistry::GetProgram(const std::string& vertexShader, const std::string& fragmentShader,
+                                                                          const VulkanPassDescription& pass) {
+        return createProgram(vertexShader, fragmentShader, pass, nullptr);
+    }
+
+    std::shared_ptr<VulkanShaderProgram> VulkanShaderRegistry::GetDepthOnlyProgram(const std::string& vertexShader, const VulkanPassDescription& pass) {
+        return createProgram(vertexShader, {}, pass, nullptr);
+    }
+
+    std::shared_ptr<VulkanShaderProgram> VulkanShaderRegistry::GetMaterialProgram(const std::string& vertexShader, const std::string& fragmentShader,
+                                                                                  const VulkanPassDescription& pass) {
+        // Drawing another material's shaders in the meantime would flash the wrong shading, this just shows the vertex colours
+        auto fallback = createProgram((Filesystem::GetShaderPath() / "fallback.vert.spv").string(),
+                                      (Filesystem::GetShaderPath() / "fallback.frag.spv").string(), pass, nullptr);
+
+        return createProgram(vertexShader, fragmentShader, pass, std::move(fallback));
+    }
+
+    std::shared_ptr<VulkanShaderProgram> VulkanShaderRegistry::createProgram(const std::string& vertexShader, const std::string& fragmentShader,
+                                                                             const VulkanPassDescription& pass, std::shared_ptr<VulkanShaderProgram> fallback) {
+        std::shared_ptr<VulkanShaderProgram> program { nullptr };
+
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+
+            auto& cached = _programs[ProgramKey { .Vertex = vertexShader, .Fragment = fragmentShader, .Pass = pass }];
+            if (auto existing = cached.lock()) {
+                return existing;
+            }
+
+            program = std::make_shared<VulkanShaderProgram>();
+            program->Device = _device;
+            program->DeletionQueue = _deletionQueue;
+            program->Pass = pass;
+            program->DepthOnly = fragmentShader.empty();
+            program->Fallback = std::move(fallback);
+            cached = program;
+
+            if (auto* jobSystem = ServiceLocator::GetJobSystem()) {
+                // The program waits for this in its destructor, so the raw pointer outlives the job
+                program->Compilation = jobSystem->Submit([this, target = program.get(), vertexShader, fragmentShader]() {
+                    compileProgram(*target, vertexShader, fragmentShader);
+                }).share();
+
+                // Drop the compiles that have already landed while we're here
+                std::erase_if(_pendingCompilations, [](const std::shared_future<void>& compilation) {
+                    return compilation.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+                });
+                _pendingCompilations.push_back(program->Compilation);
+                return program;
+            }
+        }
+
+        // Without a job system compile right here, outside the lock the compile takes for itself
+        compileProgram(*program, vertexShader, fragmentShader);
+        return program;
+    }
+
+    void VulkanShaderRegistry::compileProgram(VulkanShaderProgram& program, const std::string& vertexShader, const std::string& fragmentShader) {
+        auto vertexSource = getSource(vertexShader);
+        if (!vertexSource) {
+            std::cout << "Failed to load vertex shader module at: " << vertexShader << "\n";
+            return;
+        }
+
+        std::shared_ptr<const VulkanShaderSource> fragmentSource { nullptr };
+        if (!program.DepthOnly) {
+            fragmentSource = getSource(fragmentShader);
+            if (!fragmentSource) {
+                std::cout << "Failed to load fragment shader module at: " << fragmentShader << "\n";
+                return;
+            }
+        }
+
+        program.Data = fragmentSource ? ShaderData::Merge(fragmentSource->Data, vertexSource->Data) : vertexSource->Data;
+
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+
+            program.VertexModule = getModule(vertexSource);
+            program.FragmentModule = fragmentSource ? getModule(fragmentSource) : nullptr;
+            buildLayouts(program);
+        }
+
+        auto pipeline = buildPipeline(program.Device, _pipelineCache, program);
+
+        if (pipeline == VK_NULL_HANDLE) {
+            std::cout << "Pipeline compilation failed, objects using this material will not be drawn." << std::endl;
+        }
+
+        // Publishes everything above to whoever sees the program ready
+        program.Pipeline.store(pipeline);
+    }
+
+    void VulkanShaderRegistry::WaitForCompilation() {
+        std::vector<std::shared_future<void>> pending;
+
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            pending.swap(_pendingCompilations);
+        }
+
+        for (auto& compilation : pending) {
+            compilation.wait();
+        }
+    }
+
+    size_t VulkanShaderRegistry::ProgramKeyHash::operator()(const ProgramKey& key) const {
+        auto hash = VulkanUtilities::HashCombine(std::hash<std::string>{}(key.Vertex), std::hash<std::string>{}(key.Fragment));
+        hash = VulkanUtilities::HashCombine(hash, static_cast<uint64_t>(key.Pass.ColorFormat));
+        hash = VulkanUtilities::HashCombine(hash, static_cast<uint64_t>(key.Pass.DepthFormat));
+        hash = VulkanUtilities::HashCombine(hash, static_cast<uint64_t>(key.Pass.Samples));
+        hash = VulkanUtilities::HashCombine(hash, key.Pass.Subpass);
+        return static_cast<size_t>(VulkanUtilities::HashCombine(hash, key.Pass.DepthPrepassed ? 1 : 0));
+    }
+
+    size_t VulkanShaderRegistry::SetLayoutKeyHash::operator()(const std::vector<VulkanDescriptorSetLayout::Binding>& bindings) const {
+        uint64_t hash = VulkanUtilities::HashBytes(nullptr, 0);
+        for (const auto& binding : bindings) {
+            hash = VulkanUtilities::HashCombine(hash, binding.Slot);
+            hash = VulkanUtilities::HashCombine(hash, static_cast<uint64_t>(binding.Type));
+            hash = VulkanUtilities::HashCombine(hash, binding.Count);
+            hash = VulkanUtilities::HashCombine(hash, binding.Stages);
+        }
+        return static_cast<size_t>(hash);
+    }
+
+    std::shared_ptr<const VulkanShaderSource> VulkanShaderRegistry::getSource(const std::string& path) {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            if (auto it = _sources.find(path); it != _sources.end()) {
+                return it->second;
+            }
+        }
+
+        // Disk and reflection are the slow part, keep them out of the lock
+        auto source = std::make_shared<VulkanShaderSource>();
+
+        if (!VulkanUtilities::LoadShaderCode(path, source->Code)) {
+            return nullptr;
+        }
+
+        source->Hash = VulkanUtilities::HashBytes(source->Code.data(), source->Code.size() * sizeof(uint32_t));
+
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+
+            // Identical SPIR-V at another path shares the reflection we've already done
+            for (const auto& [otherPath, otherSource] : _sources) {
+                if (otherSource->Hash == source->Hash && otherSource->Code == source->Code) {
+                    return _sources.try_emplace(path, otherSource).first->second;
+                }
+            }
+        }
+
+        spirv_cross::CompilerGLSL glsl(source->Code);
+        source->Data = VulkanUtilities::LoadShaderData(glsl);
+
+        // Another compile may have loaded the same path meanwhile, everyone sticks with the first
+        std::lock_guard<std::mutex> lock(_mutex);
+        return _sources.try_emplace(path, std::move(source)).first->second;
+    }
+
+    std::shared_ptr<VulkanShaderModule> VulkanShaderRegistry::getModule(const std::shared_ptr<const VulkanShaderSource>& source) {
+        if (auto existing = _modules[source.get()].lock()) {
+            return existing;
+        }
+
+        auto module = std::make_shared<VulkanShaderModule>(_device, *source);
+        _modules[source.get()] = module;
+        return module;
+    }
+
+    std::shared_ptr<VulkanDescriptorSetLayout> VulkanShaderRegistry::getSetLayout(const std::vector<VkDescriptorSetLayoutBinding>& bindings) {
+        std::vector<VulkanDescriptorSetLayout::Binding> key {};
+        for (const auto& binding : bindings) {
+            key.push_back(VulkanDescriptorSetLayout::Binding { binding.binding, binding.descriptorType, binding.descriptorCount, binding.stageFlags });
+        }
+
+        auto& cached = _setLayouts[key];
+        if (auto existing = cached.lock()) {
+            return existing;
+        }
+
+        auto setLayout = std::make_shared<VulkanDescriptorSetLayout>(_device, bindings);
+        cached = setLayout;
+        return setLayout;
+    }
+
+    void VulkanShaderRegistry::buildLayouts(VulkanShaderProgram& program) {
+        // First step is to collect the descriptors
+        std::map<uint32_t, std::vector<VkDescriptorSetLayoutBinding>> descriptorSetDescriptions {};
+        std::set<uint32_t> bindlessSets {};
+        bool pushConstantAdded { false };
+
+        for (const auto& [k, resource] : program.Data.Resources) {
+
+            if (!descriptorSetDescriptions.contains(resource.Set)) {
+                descriptorSetDescriptions[resource.Set] = {};
+            }
+
+            if (k == ResourceName::BindlessTextures || k == ResourceName::MaterialData) {
+                bindlessSets.insert(resource.Set);
+            }
+
+            switch (resource.Type) {
+                case ResourceType::PushConstant:
+                    // TODO: Push constants can be more dynamic than this and can support multiple shader stages
+                    if (pushConstantAdded) {
+                        std::cout << "WARNING: Two sets of push constants in ShaderData!" << std::endl;
+                        continue;
+                    }
+                    program.PushConstants.offset = 0;
+                    program.PushConstants.size = static_cast<uint32_t>(resource.Size);
+                    program.PushConstants.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+                    pushConstantAdded = true;
+                    break;
+                case ResourceType::Uniform:
+                    descriptorSetDescriptions[resource.Set].push_back(GetUniformBufferLayoutBinding(resource.Binding));
+                    break;
+                case ResourceType::StorageBuffer:
+                    descriptorSetDescriptions[resource.Set].push_back(GetStorageBufferLayoutBinding(resource.Binding));
+                    break;
+                case ResourceType::Sampler:
+                    descriptorSetDescriptions[resource.Set].push_back(GetTextureLayoutBinding(resource.Binding));
+                    break;
+                default:
+                    break;
+            }
+        }
+
+        std::vector<VkDescriptorSetLayout> layouts {};
+
+        for (const auto& [key, bindings] : descriptorSetDescriptions) {
+            auto setLayout = _bindlessLayout && bindlessSets.contains(key) ? _bindlessLayout : getSetLayout(bindings);
+            program.SetLayouts.push_back(setLayout);
+            layouts.push_back(setLayout->Layout);
+        }
+
+        auto pipelineLayoutInfo = VulkanInitializers::PipelineLayoutCreateInfo();
+
+        pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(layouts.size());
+        pipelineLayoutInfo.pSetLayouts = layouts.data();
+        pipelineLayoutInfo.pPushConstantRanges = &program.PushConstants;
+        pipelineLayoutInfo.pushConstantRangeCount = pushConstantAdded ? 1 : 0;
+
+        VK_CHECK("VulkanShaderRegistry::buildLayouts", vkCreatePipelineLayout(program.Device, &pipelineLayoutInfo, nullptr, &program.PipelineLayout));
+    }
+
+    VkPipeline VulkanShaderRegistry::buildPipeline(VkDevice device, VulkanPipelineCache* pipelineCache, const VulkanShaderProgram& program) {
+        VertexInputDescription vertexInputDescription = program.DepthOnly ? GetPositionVertexDescription() : GetVertexDescription();
+
+        VulkanPipelineBuilder pipelineBuilder;
+
+        pipelineBuilder._shaderStages.push_back(
+                VulkanInitializers::PipelineShaderStageCreateInfo(VK_SHADER_STAGE_VERTEX_BIT, program.VertexModule->Module));
+
+        if (program.FragmentModule) {
+            pipelineBuilder._shaderStages.push_back(
+                    VulkanInitializers::PipelineShaderStageCreateInfo(VK_SHADER_STAGE_FRAGMENT_BIT, program.FragmentModule->Module));
+        }
+
+        // Specify vertex attributes
+        pipelineBuilder._vertexInputInfo = VulkanInitializers::PipelineVertexInputStateCreateInfo();
+        pipelineBuilder._vertexInputInfo.pVertexAttributeDescriptions = vertexInputDescription.attributes.data();
+        pipelineBuilder._vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(vertexInputDescription.attributes.size());
+
+        pipelineBuilder._vertexInputInfo.pVertexBindingDescriptions = vertexInputDescription.bindings.data();
+        pipelineBuilder._vertexInputInfo.vertexBindingDescriptionCount = static_cast<uint32_t>(vertexInputDescription.bindings.size());
+
+        pipelineBuilder._inputAssembly = VulkanInitializers::PipelineInputAssemblyStateCreateInfo(VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST);
+
+        // Viewport and scissor are dynamic state, so these only need to be valid
+        pipelineBuilder._viewport = {
+                .x = 0.f,
+                .y = 0.f,
+                .width = 1.f,
+                .height = 1.f,
+                .minDepth = 0.f,
+                .maxDepth = 1.f
+        };
+
+        pipelineBuilder._scissor = {
+                .offset = {0 , 0},
+                .extent = {1, 1}
+        };
+
+        pipelineBuilder._rasterizer = VulkanInitializers::PipelineRasterizationStateCreateInfo(VK_POLYGON_MODE_FILL);
+        pipelineBuilder._multisampling = VulkanInitializers::PipelineMultisampleStateCreateInfo();
+        pipelineBuilder._colorBlendAttachment = VulkanInitializers::PipelineColorBlendAttachmentState();
+        pipelineBuilder._pipelineLayout = program.PipelineLayout;
+        pipelineBuilder._subpass = program.Pass.Subpass;
+
+        if (program.DepthOnly) {
+            pipelineBuilder._colorAttachmentCount = 0;
+            pipelineBuilder._depthStencil = VulkanInitializers::DepthStencilCreateInfo(true, true, VK_COMPARE_OP_LESS_OR_EQUAL);
+        } else if (program.Pass.DepthPrepassed) {
+            // Depth is already final, only shade the surviving fragments
+            pipelineBuilder._depthStencil = VulkanInitializers::DepthStencilCreateInfo(true, false, VK_COMPARE_OP_EQUAL);
+        } else {
+            pipelineBuilder._depthStencil = VulkanInitializers::DepthStencilCreateInfo(true, true, VK_COMPARE_OP_LESS_OR_EQUAL);
+        }
+
+        return pipelineBuilder.BuildPipeline(device, program.Pass.RenderPass, pipelineCache);
+    }
+}
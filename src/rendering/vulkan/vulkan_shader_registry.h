@@ -0,0 +1,192 @@
+#pragma once
+#include <youtube_engine/rendering/shader.h>
+
+#include <atomic>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "vulkan_includes.h"
+
+namespace OZZ {
+    class VulkanDeletionQueue;
+    class VulkanPipelineCache;
+
+    /*
+     * SPIR-V loaded from disk along with its content hash and reflection data. Device independent, so it survives resets.
+     */
+    struct VulkanShaderSource {
+        uint64_t Hash { 0 };
+        std::vector<uint32_t> Code {};
+        ShaderData Data {};
+    };
+
+    struct VulkanShaderModule {
+        VulkanShaderModule(VkDevice device, const VulkanShaderSource& source);
+        ~VulkanShaderModule();
+
+        VkDevice Device { VK_NULL_HANDLE };
+        VkShaderModule Module { VK_NULL_HANDLE };
+    };
+
+    /*
+     * Where a program's pipeline will be used. With a depth pre-pass the material pipelines live in the second subpass
+     * and only shade fragments whose depth matches what the pre-pass wrote.
+     *
+     * Programs are identified by the attachments rather than the render pass object. Pipelines work with any compatible
+     * render pass, so one recreated with the same formats keeps using them.
+     */
+    struct VulkanPassDescription {
+        VkFormat ColorFormat { VK_FORMAT_UNDEFINED };
+        VkFormat DepthFormat { VK_FORMAT_UNDEFINED };
+        VkSampleCountFlagBits Samples { VK_SAMPLE_COUNT_1_BIT };
+        uint32_t Subpass { 0 };
+        bool DepthPrepassed { false };
+
+        // A render pass matching the above to build against. Not part of the identity.
+        VkRenderPass RenderPass { VK_NULL_HANDLE };
+
+        bool operator==(const VulkanPassDescription& other) const {
+            return ColorFormat == other.ColorFormat && DepthFormat == other.DepthFormat && Samples == other.Samples &&
+                   Subpass == other.Subpass && DepthPrepassed == other.DepthPrepassed;
+        }
+    };
+
+    struct VulkanDescriptorSetLayout {
+        struct Binding {
+            uint32_t Slot { 0 };
+            VkDescriptorType Type { VK_DESCRIPTOR_TYPE_MAX_ENUM };
+            uint32_t Count { 0 };
+            VkShaderStageFlags Stages { 0 };
+
+            bool operator==(const Binding& other) const = default;
+        };
+
+        VulkanDescriptorSetLayout(VkDevice device, const std::vector<VkDescriptorSetLayoutBinding>& bindings);
+
+        // Wraps a layout owned by someone else; it isn't destroyed with this
+        explicit VulkanDescriptorSetLayout(VkDescriptorSetLayout layout);
+        ~VulkanDescriptorSetLayout();
+
+        VkDevice Device { VK_NULL_HANDLE };
+        VkDescriptorSetLayout Layout { VK_NULL_HANDLE };
+
+        // What the layout was built from, compared on a cache hit. Empty for a wrapped layout.
+        std::vector<Binding> Bindings {};
+    };
+
+    /*
+     * Everything the GPU needs to draw with a vertex + fragment shader pair. Shared between every material that uses
+     * the same shaders against the same render pass.
+     *
+     * Loading, reflection, layouts and the pipeline all happen on the job system. Everything but the immutable fields
+     * below is only valid once IsReady() returns true. Until then material draws use their fallback, a flat shaded
+     * program for the same pass, or are skipped.
+     *
+     * Depth only programs have no fragment stage and read just the packed position stream.
+     */
+    struct VulkanShaderProgram {
+        ~VulkanShaderProgram();
+
+        [[nodiscard]] bool IsReady() const { return Pipeline.load() != VK_NULL_HANDLE; }
+
+        VkDevice Device { VK_NULL_HANDLE };
+        VulkanDeletionQueue* DeletionQueue { nullptr };
+        VulkanPassDescription Pass {};
+        bool DepthOnly { false };
+        ShaderData Data {};
+
+        // Held for as long as the program, so another material with the same shaders doesn't recreate them
+        std::shared_ptr<VulkanShaderModule> VertexModule { nullptr };
+        std::shared_ptr<VulkanShaderModule> FragmentModule { nullptr };
+
+        std::vector<std::shared_ptr<VulkanDescriptorSetLayout>> SetLayouts {};
+        VkPushConstantRange PushConstants {};
+
+        VkPipelineLayout PipelineLayout { VK_NULL_HANDLE };
+        std::atomic<VkPipeline> Pipeline { VK_NULL_HANDLE };
+
+        std::shared_future<void> Compilation {};
+
+        // Owned, so whoever holds this program can always draw with it
+        std::shared_ptr<VulkanShaderProgram> Fallback { nullptr };
+    };
+
+    class VulkanShaderRegistry {
+    public:
+        // Programs retire their pipelines through the deletion queue, since the last material can go while a frame still draws with it
+        void Init(VkDevice device, VulkanPipelineCache* pipelineCache, VulkanDeletionQueue* deletionQueue);
+        void Shutdown();
+
+        // Sets reading the bindless texture array or material table are built against this layout instead of their own
+        void SetBindlessLayout(VkDescriptorSetLayout layout);
+
+        // Files that fail to load leave the program never becoming ready
+        std::shared_ptr<VulkanShaderProgram> GetProgram(const std::string& vertexShader, const std::string& fragmentShader, const VulkanPassDescription& pass);
+        std::shared_ptr<VulkanShaderProgram> GetDepthOnlyProgram(const std::string& vertexShader, const VulkanPassDescription& pass);
+
+        // A program reading the standard vertex layout, falling back to the pass's flat shaded program while it compiles
+        std::shared_ptr<VulkanShaderProgram> GetMaterialProgram(const std::string& vertexShader, const std::string& fragmentShader,
+                                                                const VulkanPassDescription& pass);
+
+        // Blocks until every queued pipeline compile has finished
+        void WaitForCompilation();
+
+    private:
+        // Sources load on the job system, so programs are found by path. Identical SPIR-V at two paths still shares
+        // modules and layouts.
+        struct ProgramKey {
+            std::string Vertex {};
+            std::string Fragment {};
+            VulkanPassDescription Pass {};
+
+            bool operator==(const ProgramKey& other) const = default;
+        };
+
+        struct ProgramKeyHash {
+            size_t operator()(const ProgramKey& key) const;
+        };
+
+        struct SetLayoutKeyHash {
+            size_t operator()(const std::vector<VulkanDescriptorSetLayout::Binding>& bindings) const;
+        };
+
+        std::shared_ptr<const VulkanShaderSource> getSource(const std::string& path);
+        std::shared_ptr<VulkanShaderModule> getModule(const std::shared_ptr<const VulkanShaderSource>& source);
+        std::shared_ptr<VulkanDescriptorSetLayout> getSetLayout(const std::vector<VkDescriptorSetLayoutBinding>& bindings);
+
+        // An empty fragment shader makes a depth only program
+        std::shared_ptr<VulkanShaderProgram> createProgram(const std::string& vertexShader, const std::string& fragmentShader,
+                                                           const VulkanPassDescription& pass, std::shared_ptr<VulkanShaderProgram> fallback);
+
+        // Runs on the job system
+        void compileProgram(VulkanShaderProgram& program, const std::string& vertexShader, const std::string& fragmentShader);
+
+        void buildLayouts(VulkanShaderProgram& program);
+
+        // A null fragment module builds a depth only pipeline
+        static VkPipeline buildPipeline(VkDevice device, VulkanPipelineCache* pipelineCache, const VulkanShaderProgram& program);
+
+    private:
+        std::mutex _mutex;
+
+        VkDevice _device { VK_NULL_HANDLE };
+        VulkanPipelineCache* _pipelineCache { nullptr };
+        VulkanDeletionQueue* _deletionQueue { nullptr };
+
+        // CPU side, keyed by path. Read and reflected outside the lock.
+        std::unordered_map<std::string, std::shared_ptr<const VulkanShaderSource>> _sources {};
+
+        // GPU side, keyed by content. Weak so the objects die with the last shader using them.
+        std::unordered_map<const VulkanShaderSource*, std::weak_ptr<VulkanShaderModule>> _modules {};
+        std::unordered_map<std::vector<VulkanDescriptorSetLayout::Binding>, std::weak_ptr<VulkanDescriptorSetLayout>, SetLayoutKeyHash> _setLayouts {};
+        std::unordered_map<ProgramKey, std::weak_ptr<VulkanShaderProgram>, ProgramKeyHash> _programs {};
+
+        std::shared_ptr<VulkanDescriptorSetLayout> _bindlessLayout { nullptr };
+
+        std::vector<std::shared_future<void>> _pendingCompilations {};
+    };
+}
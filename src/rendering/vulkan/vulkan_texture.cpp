@@ -4,19 +4,33 @@
 
 #include "vulkan_texture.h"
 #include "vulkan_buffer.h"
+#include "vulkan_texture_streamer.h"
 #include "vulkan_types.h"
 #include "vulkan_utilities.h"
 
+#include <youtube_engine/rendering/texture_cooker.h>
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstring>
 #include <iostream>
+#include <vector>
 
 namespace OZZ {
 
     VulkanTexture::VulkanTexture(VulkanRenderer *renderer) : _renderer(renderer) {}
 
     VulkanTexture::~VulkanTexture() {
-        vkDestroySampler(_renderer->_device, _sampler, nullptr);
-        vmaDestroyImage(_renderer->_allocator, _image, _allocation);
-        vkDestroyImageView(_renderer->_device, _imageView, nullptr);
+        std::lock_guard<std::recursive_mutex> lock(_renderer->_resourceMutex);
+
+        if (_streamSource) {
+            _renderer->_textureStreamer.Unregister(this);
+        }
+
+        if (_bindlessGeneration == _renderer->_bindlessTextures.GetGeneration()) {
+            _renderer->_bindlessTextures.RemoveTexture(_bindlessIndex);
+        }
+        releaseImage();
     }
 
 
@@ -45,89 +59,118 @@ namespace OZZ {
 
     void VulkanTexture::ResetDescriptorSet() {}
 
-    void VulkanTexture::BindSamplerSettings() {}
+    void VulkanTexture::BindSamplerSettings() {
+        std::lock_guard<std::recursive_mutex> lock(_renderer->_resourceMutex);
 
-    void VulkanTexture::UploadData(const ImageData &data) {
-        auto [width, height] = data.GetSize();
-        VkExtent3D imageExtent {
-                .width = width,
-                .height = height,
-                .depth = 1
-        };
-        if (width != _width || height != _height) {
-            // TODO: Clean up old data + trigger a shader rebuild
-            VkFilter filters = VK_FILTER_NEAREST;
-            VkSamplerAddressMode samplerAddressMode = VK_SAMPLER_ADDRESS_MODE_REPEAT;
-
-            VkSamplerCreateInfo samplerCreateInfo{
-                    .sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO,
-                    .magFilter = filters,
-                    .minFilter = filters,
-                    .addressModeU = samplerAddressMode,
-                    .addressModeV = samplerAddressMode,
-                    .addressModeW = samplerAddressMode
-            };
+        // Nothing to rebuild until there's an image; UploadData picks up the settings
+        if (!_image) return;
 
-            // Create the sampler
-            vkCreateSampler(_renderer->_device, &samplerCreateInfo, nullptr, &_sampler);
-
-            // if size has changed, re-create the texture with appropriate size
-            VkFormat format = ColorTypeToVulkanFormatType(data.GetColorType());
-            VkImageCreateInfo img_info {
-                    .sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
-                    .imageType = VK_IMAGE_TYPE_2D,
-                    .format = format,
-                    .extent = imageExtent,
-                    .mipLevels = 1,
-                    .arrayLayers = 1,
-                    .samples = VK_SAMPLE_COUNT_1_BIT,
-                    .tiling = VK_IMAGE_TILING_OPTIMAL,
-                    .usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT
-            };
+        _sampler = _renderer->_samplerCache.GetSampler(_samplerSettings);
+        updateBindlessSlot();
+    }
 
-            VmaAllocationCreateInfo img_allocinfo {
-                .usage = VMA_MEMORY_USAGE_GPU_ONLY
-            };
+    void VulkanTexture::UploadData(const ImageData &data) {
+        std::lock_guard<std::recursive_mutex> lock(_renderer->_resourceMutex);
+
+        if (data.GetMipLevels().empty()) {
+            std::cout << "Tried to upload an empty image" << std::endl;
+            return;
+        }
 
-            if (vmaCreateImage(_renderer->_allocator, &img_info, &img_allocinfo, &_image, &_allocation, nullptr) != VK_SUCCESS) {
-                std::cout << "Error allocating image" << std::endl;
+        // Streamed textures need every level on the CPU. Without the caller's copy to share, they keep one of their own,
+        // and source images get their mips built here instead of on the GPU.
+        if (_renderer->_textureStreamer.IsEnabled()) {
+            if (data.GetMipLevels().size() > 1) {
+                if (beginStreaming(std::make_shared<const ImageData>(data))) return;
+            } else if (data.GetColorType() == ColorType::UNSIGNED_CHAR4) {
+                if (beginStreaming(std::make_shared<const ImageData>(TextureCooker::Encode(data, { .Format = ColorType::UNSIGNED_CHAR4 })))) return;
             }
+        }
 
-            _width = width;
-            _height = height;
-
-            // We then create the image view
-            VkImageViewCreateInfo info = {
-                    .sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
-                    .image = _image,
-                    .viewType = VK_IMAGE_VIEW_TYPE_2D,
-                    .format = format,
-                    .subresourceRange = {
-                            .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
-                            .baseMipLevel = 0,
-                            .levelCount = 1,
-                            .baseArrayLayer = 0,
-                            .layerCount = 1,
-                    }
-            };
+        if (_streamSource) {
+            _renderer->_textureStreamer.Unregister(this);
+            _streamSource.reset();
+            _streamed = false;
+            _residentMip = 0;
+        }
+
+        uploadLevels(data, 0);
+    }
+
+    void VulkanTexture::UploadData(const std::shared_ptr<const ImageData>& data) {
+        std::lock_guard<std::recursive_mutex> lock(_renderer->_resourceMutex);
+
+        if (_renderer->_textureStreamer.IsEnabled() && data->GetMipLevels().size() > 1 && beginStreaming(data)) return;
+
+        UploadData(*data);
+    }
+
+    bool VulkanTexture::beginStreaming(std::shared_ptr<const ImageData> source) {
+        if (source->GetMipLevels().size() < 2 || !isFormatSupported(ColorTypeToVulkanFormatType(source->GetColorType()))) return false;
+
+        _streamSource = std::move(source);
+        _streamed = true;
+        _residentMip = VulkanTextureStreamer::GetInitialMip(*_streamSource);
+        _requestedMip = UINT32_MAX;
+
+        _renderer->_textureStreamer.Register(this);
+        uploadLevels(*_streamSource, _residentMip);
+        return true;
+    }
 
-            vkCreateImageView(_renderer->_device, &info, nullptr, &_imageView);
+    void VulkanTexture::uploadLevels(const ImageData& data, uint32_t firstLevel) {
+        VkFormat format = ColorTypeToVulkanFormatType(data.GetColorType());
+
+        if (!isFormatSupported(format)) {
+            std::cout << "Texture format " << format << " is not supported on this device, using a placeholder." << std::endl;
+            UploadData(ImageData(1,1, {1.f, 0.f, 1.f, 1.f}));
+            return;
+        }
+
+        const auto& allLevels = data.GetMipLevels();
+        std::vector<ImageMipLevel> sourceLevels(allLevels.begin() + firstLevel, allLevels.end());
+
+        auto width = sourceLevels[0].Width;
+        auto height = sourceLevels[0].Height;
+
+        // Images that bring their own mips (KTX2) are uploaded as-is, otherwise build the full chain on the GPU
+        auto providedLevels = static_cast<uint32_t>(sourceLevels.size());
+        bool generateMips = providedLevels == 1 && canGenerateMipmaps(format);
+        uint32_t mipLevels = generateMips ? static_cast<uint32_t>(std::bit_width(std::max(width, height))) : providedLevels;
+
+        if (width != _width || height != _height || format != _format || mipLevels != _mipLevels) {
+            releaseImage();
+            createImage(format, width, height, mipLevels);
         }
 
-        // upload the pixels to the correct spot
-        auto size = data.GetDataSize();
+        if (!_sampler) {
+            _sampler = _renderer->_samplerCache.GetSampler(_samplerSettings);
+        }
+
+        // upload the pixels to the correct spot. Levels are stored largest first, so the ones we want are contiguous.
+        auto baseOffset = sourceLevels.front().Offset;
+        auto size = sourceLevels.back().Offset + sourceLevels.back().Size - baseOffset;
 
         auto stagingBuffer = std::make_shared<VulkanBuffer>(
                 &_renderer->_allocator, size,
                 VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
                 VMA_MEMORY_USAGE_CPU_ONLY);
 
-        stagingBuffer->UploadData((int*)data.GetData(), size);
+        stagingBuffer->UploadData((int*)(data.GetData() + baseOffset), size);
+
+        std::vector<VkBufferImageCopy> copyRegions {};
+        for (uint32_t level = 0; level < providedLevels; level++) {
+            copyRegions.push_back({
+                .bufferOffset = sourceLevels[level].Offset - baseOffset,
+                .imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, level, 0, 1 },
+                .imageExtent = { sourceLevels[level].Width, sourceLevels[level].Height, 1 }
+            });
+        }
 
         VkImageSubresourceRange range {
             .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
             .baseMipLevel = 0,
-            .levelCount = 1,
+            .levelCount = _mipLevels,
             .baseArrayLayer = 0,
             .layerCount = 1
         };
@@ -155,22 +198,28 @@ namespace OZZ {
         commandBufferBeginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
         vkBeginCommandBuffer(commandBuffer, &commandBufferBeginInfo);
 
-        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+        // Frames submitted earlier may still be sampling an image that's being refilled
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
                              VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0,
                              nullptr, 0, nullptr, 1, &imageMemoryBarrier);
 
-        VulkanBuffer::CopyBufferToImage(commandBuffer, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-                                        stagingBuffer.get(), &_image, imageExtent);
+        vkCmdCopyBufferToImage(commandBuffer, stagingBuffer->Buffer, _image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                               static_cast<uint32_t>(copyRegions.size()), copyRegions.data());
 
-        imageMemoryBarrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
-        imageMemoryBarrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        if (generateMips && _mipLevels > 1) {
+            // Leaves every level in SHADER_READ_ONLY_OPTIMAL
+            generateMipmaps(commandBuffer);
+        } else {
+            imageMemoryBarrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+            imageMemoryBarrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
 
-        imageMemoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-        imageMemoryBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+            imageMemoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            imageMemoryBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
 
-        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
-                             VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0,
-                             nullptr, 0, nullptr, 1, &imageMemoryBarrier);
+            vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                                 VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0,
+                                 nullptr, 0, nullptr, 1, &imageMemoryBarrier);
+        }
 
         vkEndCommandBuffer(commandBuffer);
 
@@ -178,18 +227,353 @@ namespace OZZ {
         submitInfo.commandBufferCount = 1;
         submitInfo.pCommandBuffers = &commandBuffer;
 
-        vkQueueSubmit(_renderer->_graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE);
-        vkQueueWaitIdle(_renderer->_graphicsQueue);
+        // Frames are submitted after this on the same queue, and the barriers above order their reads after it
+        uint64_t uploadValue { 0 };
+        VK_CHECK("VulkanTexture::uploadLevels()::vkQueueSubmit", _renderer->_timeline.Submit(_renderer->_graphicsQueue, submitInfo, uploadValue));
+
+        _renderer->_deletionQueue.Retire(uploadValue, [device = _renderer->_device, commandPool = _renderer->_bufferCommandPool,
+                                                       commandBuffer, stagingBuffer = std::move(stagingBuffer)]() mutable {
+            vkFreeCommandBuffers(device, commandPool, 1, &commandBuffer);
+            stagingBuffer.reset();
+        });
+        _renderer->_deletionQueue.Collect();
+
+        _renderer->_frameStats.TextureUploadBytes += size;
+        _renderer->_frameStats.QueueSubmits++;
 
-        vkFreeCommandBuffers(_renderer->_device, _renderer->_bufferCommandPool, 1, &commandBuffer);
+        updateBindlessSlot();
     }
 
     std::pair<uint32_t, uint32_t> VulkanTexture::GetSize() const {
+        // The full size, even if only smaller mips are resident
+        if (_streamSource) {
+            return _streamSource->GetSize();
+        }
+
         return {_width, _height};
     }
 
+    void VulkanTexture::updateBindlessSlot() {
+        auto& bindless = _renderer->_bindlessTextures;
+        if (!bindless.IsEnabled()) return;
+
+        // A slot from before the array was rebuilt means nothing in the new one
+        if (_bindlessGeneration != bindless.GetGeneration()) {
+            _bindlessIndex = VulkanBindlessTextures::INVALID_INDEX;
+            _bindlessGeneration = bindless.GetGeneration();
+        }
+
+        if (_bindlessIndex == VulkanBindlessTextures::INVALID_INDEX) {
+            _bindlessIndex = bindless.AddTexture(_imageView, _sampler);
+        } else {
+            bindless.UpdateTexture(_bindlessIndex, _imageView, _sampler);
+        }
+    }
+
+    uint32_t VulkanTexture::getBindlessIndex() {
+        if (_bindlessGeneration != _renderer->_bindlessTextures.GetGeneration() && _imageView != VK_NULL_HANDLE) {
+            updateBindlessSlot();
+        }
+
+        return _bindlessGeneration == _renderer->_bindlessTextures.GetGeneration() ? _bindlessIndex : VulkanBindlessTextures::INVALID_INDEX;
+    }
+
+    void VulkanTexture::recordResidentLevels(VkCommandBuffer commandBuffer, uint32_t previousMip, VkBuffer stagingBuffer,
+                                             uint8_t* stagingData, uint64_t& stagingOffset) {
+        const auto& levels = _streamSource->GetMipLevels();
+        auto levelCount = static_cast<uint32_t>(levels.size());
+
+        // The old image stays alive until this submission is done copying out of it
+        auto previousImage = _image;
+        auto previousAllocation = _allocation;
+        auto previousView = _imageView;
+        auto previousLevels = _mipLevels;
+
+        _image = VK_NULL_HANDLE;
+        _allocation = VK_NULL_HANDLE;
+        _imageView = VK_NULL_HANDLE;
+        createImage(_format, levels[_residentMip].Width, levels[_residentMip].Height, levelCount - _residentMip);
+
+        std::array<VkImageMemoryBarrier, 2> barriers {
+            VkImageMemoryBarrier {
+                .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+                .srcAccessMask = 0,
+                .dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+                .oldLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+                .newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+                .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+                .image = _image,
+                .subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, _mipLevels, 0, 1 }
+            },
+            // Frames submitted earlier may still be sampling it
+            VkImageMemoryBarrier {
+                .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+                .srcAccessMask = 0,
+                .dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT,
+                .oldLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                .newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+                .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+                .image = previousImage,
+                .subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, previousLevels, 0, 1 }
+            }
+        };
+
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                             VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0,
+                             nullptr, 0, nullptr, static_cast<uint32_t>(barriers.size()), barriers.data());
+
+        std::vector<VkImageCopy> imageCopies {};
+        std::vector<VkBufferImageCopy> bufferCopies {};
+
+        for (auto level = _residentMip; level < levelCount; level++) {
+            VkExtent3D extent { levels[level].Width, levels[level].Height, 1 };
+            auto dstLevel = level - _residentMip;
+
+            if (level >= previousMip) {
+                imageCopies.push_back({
+                    .srcSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, level - previousMip, 0, 1 },
+                    .dstSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, dstLevel, 0, 1 },
+                    .extent = extent
+                });
+            } else {
+                std::memcpy(stagingData + stagingOffset, _streamSource->GetData() + levels[level].Offset, levels[level].Size);
+
+                bufferCopies.push_back({
+                    .bufferOffset = stagingOffset,
+                    .imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, dstLevel, 0, 1 },
+                    .imageExtent = extent
+                });
+
+                stagingOffset += AlignStagingSize(levels[level].Size);
+            }
+        }
+
+        if (!imageCopies.empty()) {
+            vkCmdCopyImage(commandBuffer, previousImage, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, _image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                           static_cast<uint32_t>(imageCopies.size()), imageCopies.data());
+        }
+
+        if (!bufferCopies.empty()) {
+            vkCmdCopyBufferToImage(commandBuffer, stagingBuffer, _image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                                   static_cast<uint32_t>(bufferCopies.size()), bufferCopies.data());
+        }
+
+        barriers[0].oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barriers[0].newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        barriers[0].srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barriers[0].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                             VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0,
+                             nullptr, 0, nullptr, 1, &barriers[0]);
+
+        // The streamer submits straight after recording, which is the submission this waits for
+        retireImage(previousImage, previousAllocation, previousView);
+        _renderer->_textureGeneration++;
+
+        updateBindlessSlot();
+    }
+
+    uint64_t VulkanTexture::getResidentBytes(uint32_t firstLevel) const {
+        if (!_streamSource) return 0;
+
+        uint64_t bytes = 0;
+        const auto& levels = _streamSource->GetMipLevels();
+        for (auto level = firstLevel; level < levels.size(); level++) {
+            bytes += levels[level].Size;
+        }
+
+        return bytes;
+    }
+
+    uint64_t VulkanTexture::getStagingBytes(uint32_t previousMip) const {
+        if (!_streamSource) return 0;
+
+        uint64_t bytes = 0;
+        const auto& levels = _streamSource->GetMipLevels();
+        for (auto level = _residentMip; level < std::min<size_t>(previousMip, levels.size()); level++) {
+            bytes += AlignStagingSize(levels[level].Size);
+        }
+
+        return bytes;
+    }
+
     int *VulkanTexture::GetHandle() const {
         return nullptr;
     }
 
-}
\ No newline at end of file
+    void VulkanTexture::createImage(VkFormat format, uint32_t width, uint32_t height, uint32_t mipLevels) {
+        _format = format;
+        _width = width;
+        _height = height;
+        _mipLevels = mipLevels;
+
+        VkImageCreateInfo img_info {
+                .sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+                .imageType = VK_IMAGE_TYPE_2D,
+                .format = format,
+                .extent = { width, height, 1 },
+                .mipLevels = _mipLevels,
+                .arrayLayers = 1,
+                .samples = VK_SAMPLE_COUNT_1_BIT,
+                .tiling = VK_IMAGE_TILING_OPTIMAL,
+                .usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT
+        };
+
+        VmaAllocationCreateInfo img_allocinfo {
+            .usage = VMA_MEMORY_USAGE_GPU_ONLY
+        };
+
+        if (vmaCreateImage(_renderer->_allocator, &img_info, &img_allocinfo, &_image, &_allocation, nullptr) != VK_SUCCESS) {
+            std::cout << "Error allocating image" << std::endl;
+        }
+
+        // We then create the image view
+        VkImageViewCreateInfo info = {
+                .sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+                .image = _image,
+                .viewType = VK_IMAGE_VIEW_TYPE_2D,
+                .format = format,
+                .subresourceRange = {
+                        .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+                        .baseMipLevel = 0,
+                        .levelCount = _mipLevels,
+                        .baseArrayLayer = 0,
+                        .layerCount = 1,
+                }
+        };
+
+        vkCreateImageView(_renderer->_device, &info, nullptr, &_imageView);
+    }
+
+    void VulkanTexture::destroyImage() {
+        if (_imageView) {
+            vkDestroyImageView(_renderer->_device, _imageView, nullptr);
+            _imageView = VK_NULL_HANDLE;
+        }
+
+        if (_image) {
+            vmaDestroyImage(_renderer->_allocator, _image, _allocation);
+            _image = VK_NULL_HANDLE;
+            _allocation = VK_NULL_HANDLE;
+        }
+
+        _width = 0;
+        _height = 0;
+        _mipLevels = 1;
+        _format = VK_FORMAT_UNDEFINED;
+    }
+
+    void VulkanTexture::releaseImage() {
+        if (!_image) return;
+
+        retireImage(_image, _allocation, _imageView);
+
+        _image = VK_NULL_HANDLE;
+        _allocation = VK_NULL_HANDLE;
+        _imageView = VK_NULL_HANDLE;
+        destroyImage();
+
+        // Its view may be handed out again, and static recordings can't tell a new image behind the same handle
+        _renderer->_textureGeneration++;
+    }
+
+    void VulkanTexture::retireImage(VkImage image, VmaAllocation allocation, VkImageView imageView) {
+        // Frames in flight may still sample the old image
+        _renderer->_deletionQueue.Retire([device = _renderer->_device, allocator = _renderer->_allocator, image, allocation, imageView]() {
+            vkDestroyImageView(device, imageView, nullptr);
+            vmaDestroyImage(allocator, image, allocation);
+        });
+    }
+
+    void VulkanTexture::generateMipmaps(VkCommandBuffer commandBuffer) {
+        // Expects every level in TRANSFER_DST_OPTIMAL with level 0 filled in. Each level is blitted from the one above,
+        // which is then done being read from and can move to its final layout.
+        VkImageMemoryBarrier barrier {
+            .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+            .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .image = _image,
+            .subresourceRange = {
+                .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+                .levelCount = 1,
+                .baseArrayLayer = 0,
+                .layerCount = 1
+            }
+        };
+
+        auto mipWidth = static_cast<int32_t>(_width);
+        auto mipHeight = static_cast<int32_t>(_height);
+
+        for (uint32_t level = 1; level < _mipLevels; level++) {
+            barrier.subresourceRange.baseMipLevel = level - 1;
+            barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+            barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+            barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+
+            vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                                 VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0,
+                                 nullptr, 0, nullptr, 1, &barrier);
+
+            auto nextWidth = std::max(mipWidth / 2, 1);
+            auto nextHeight = std::max(mipHeight / 2, 1);
+
+            VkImageBlit blit {
+                .srcSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, level - 1, 0, 1 },
+                .srcOffsets = { { 0, 0, 0 }, { mipWidth, mipHeight, 1 } },
+                .dstSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, level, 0, 1 },
+                .dstOffsets = { { 0, 0, 0 }, { nextWidth, nextHeight, 1 } }
+            };
+
+            vkCmdBlitImage(commandBuffer,
+                           _image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                           _image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                           1, &blit, VK_FILTER_LINEAR);
+
+            barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+            barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+            barrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+            barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+            vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                                 VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0,
+                                 nullptr, 0, nullptr, 1, &barrier);
+
+            mipWidth = nextWidth;
+            mipHeight = nextHeight;
+        }
+
+        // The last level was only ever written to
+        barrier.subresourceRange.baseMipLevel = _mipLevels - 1;
+        barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                             VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0,
+                             nullptr, 0, nullptr, 1, &barrier);
+    }
+
+    bool VulkanTexture::isFormatSupported(VkFormat format) const {
+        VkFormatProperties formatProperties;
+        vkGetPhysicalDeviceFormatProperties(_renderer->_physicalDevice, format, &formatProperties);
+
+        // Block compressed formats also need the feature turned on at device creation
+        bool blockCompressed = format >= VK_FORMAT_BC1_RGB_UNORM_BLOCK && format <= VK_FORMAT_BC7_SRGB_BLOCK;
+        if (blockCompressed && !_renderer->_enabledFeatures.textureCompressionBC) return false;
+
+        return (formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT) != 0;
+    }
+
+    bool VulkanTexture::canGenerateMipmaps(VkFormat format) const {
+        VkFormatProperties formatProperties;
+        vkGetPhysicalDeviceFormatProperties(_renderer->_physicalDevice, format, &formatProperties);
+
+        auto required = VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+        return (formatProperties.optimalTilingFeatures & required) == required;
+    }
+}
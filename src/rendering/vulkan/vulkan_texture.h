@@ -5,11 +5,13 @@
 #pragma once
 
 #include <youtube_engine/rendering/texture.h>
+#include <atomic>
 #include "vulkan_renderer.h"
 
 namespace OZZ {
     class VulkanTexture : public Texture {
         friend class VulkanRenderer;
+        friend class VulkanTextureStreamer;
     public:
         explicit VulkanTexture(VulkanRenderer* renderer);
         ~VulkanTexture() override;
@@ -20,22 +22,73 @@ namespace OZZ {
         void BindSamplerSettings() override;
 
         void UploadData(const ImageData &data) override;
+        void UploadData(const std::shared_ptr<const ImageData>& data) override;
+
+        [[nodiscard]] bool IsStreamed() const override { return _streamed; }
 
         [[nodiscard]] std::pair<uint32_t, uint32_t> GetSize() const override;
 
         [[nodiscard]] int *GetHandle() const override;
 
+    private:
+        // False if the device can't sample the source's format
+        bool beginStreaming(std::shared_ptr<const ImageData> source);
+        void uploadLevels(const ImageData& data, uint32_t firstLevel);
+
+        // Moves the image over to the levels from _residentMip down. Levels it already had are copied on the GPU, only
+        // the finer ones come from the staging buffer, written at stagingOffset and onwards.
+        void recordResidentLevels(VkCommandBuffer commandBuffer, uint32_t previousMip, VkBuffer stagingBuffer,
+                                  uint8_t* stagingData, uint64_t& stagingOffset);
+        [[nodiscard]] uint64_t getResidentBytes(uint32_t firstLevel) const;
+        // What recordResidentLevels takes from the staging buffer, padding included
+        [[nodiscard]] uint64_t getStagingBytes(uint32_t previousMip) const;
+
+        // Points this texture's slot in the bindless array at the current view and sampler, claiming one if needed
+        void updateBindlessSlot();
+        // The slot for drawing with, claiming one first if this was uploaded before the bindless array was last rebuilt
+        uint32_t getBindlessIndex();
+
+        void createImage(VkFormat format, uint32_t width, uint32_t height, uint32_t mipLevels);
+        void destroyImage();
+
+        // Like destroy, but deferred until frames in flight are done with it
+        void releaseImage();
+        void retireImage(VkImage image, VmaAllocation allocation, VkImageView imageView);
+
+        void generateMipmaps(VkCommandBuffer commandBuffer);
+        [[nodiscard]] bool isFormatSupported(VkFormat format) const;
+        [[nodiscard]] bool canGenerateMipmaps(VkFormat format) const;
+
     private:
         VulkanRenderer* _renderer { nullptr };
 
         uint32_t _width { 0 };
         uint32_t _height { 0 };
+        uint32_t _mipLevels { 1 };
+        VkFormat _format { VK_FORMAT_UNDEFINED };
 
 
         VkImage _image { VK_NULL_HANDLE };
         VmaAllocation _allocation { VK_NULL_HANDLE };
         VkImageView _imageView { VK_NULL_HANDLE };
+
+        // Owned by the renderer's sampler cache
         VkSampler _sampler { VK_NULL_HANDLE };
+
+        // Slot in the renderer's bindless texture array, if it has one, and which build of the array it belongs to
+        uint32_t _bindlessIndex { VulkanBindlessTextures::INVALID_INDEX };
+        uint32_t _bindlessGeneration { 0 };
+
+        /*
+         * STREAMING
+         * Only set when the streamer manages this texture. The GPU image holds levels _residentMip and down. The source
+         * is shared with whoever uploaded it when they hand it over as a shared_ptr.
+         */
+        std::shared_ptr<const ImageData> _streamSource { nullptr };
+        std::atomic<bool> _streamed { false };
+        uint32_t _residentMip { 0 };
+        uint32_t _requestedMip { UINT32_MAX };
+        uint64_t _lastRequestedFrame { 0 };
     };
 }
 
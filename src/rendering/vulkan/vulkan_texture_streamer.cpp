@@ -0,0 +1,205 @@
+#include "vulkan_texture_streamer.h"
+#include "vulkan_buffer.h"
+#include "vulkan_renderer.h"
+#include "vulkan_texture.h"
+#include "vulkan_utilities.h"
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+namespace OZZ {
+    // Textures start with mips no bigger than this resident
+    constexpr uint32_t STREAMING_INITIAL_SIZE = 128;
+
+    // Cap how much goes up in one frame, the copies all land in front of it on the queue
+    constexpr uint64_t STREAMING_MAX_UPLOAD_BYTES_PER_FRAME = 32ull * 1024 * 1024;
+
+    void VulkanTextureStreamer::Init(VulkanRenderer* renderer, uint64_t budgetBytes) {
+        _renderer = renderer;
+        _budgetBytes = budgetBytes;
+        _frame = 0;
+    }
+
+    void VulkanTextureStreamer::Shutdown() {
+        _textures.clear();
+        _budgetBytes = 0;
+    }
+
+    void VulkanTextureStreamer::Register(VulkanTexture* texture) {
+        _textures.insert(texture);
+    }
+
+    void VulkanTextureStreamer::Unregister(VulkanTexture* texture) {
+        _textures.erase(texture);
+    }
+
+    uint32_t VulkanTextureStreamer::GetInitialMip(const ImageData& source) {
+        const auto& levels = source.GetMipLevels();
+
+        for (uint32_t level = 0; level < levels.size(); level++) {
+            if (std::max(levels[level].Width, levels[level].Height) <= STREAMING_INITIAL_SIZE) {
+                return level;
+            }
+        }
+
+        return static_cast<uint32_t>(levels.size()) - 1;
+    }
+
+    void VulkanTextureStreamer::RequestMip(VulkanTexture& texture, uint32_t mip) {
+        if (!texture._streamSource) return;
+
+        auto smallestMip = static_cast<uint32_t>(texture._streamSource->GetMipLevels().size()) - 1;
+        texture._requestedMip = std::min({ texture._requestedMip, mip, smallestMip });
+        texture._lastRequestedFrame = _frame;
+    }
+
+    void VulkanTextureStreamer::Update() {
+        if (IsEnabled()) {
+            uint64_t residentBytes = GetResidentBytes();
+            std::unordered_map<VulkanTexture*, uint32_t> previousMips {};
+
+            std::vector<VulkanTexture*> wanted {};
+            for (auto* texture : _textures) {
+                if (texture->_requestedMip < texture->_residentMip) {
+                    wanted.push_back(texture);
+                }
+            }
+
+            // The textures furthest from what's on screen go first
+            std::sort(wanted.begin(), wanted.end(), [](const VulkanTexture* a, const VulkanTexture* b) {
+                return a->_residentMip - a->_requestedMip > b->_residentMip - b->_requestedMip;
+            });
+
+            uint64_t uploadedBytes = 0;
+
+            for (auto* texture : wanted) {
+                auto currentBytes = texture->getResidentBytes(texture->_residentMip);
+                auto target = texture->_requestedMip;
+
+                auto extraBytes = [&]() { return texture->getResidentBytes(target) - currentBytes; };
+
+                while (residentBytes + extraBytes() > _budgetBytes && evictOne(texture, residentBytes, previousMips)) {}
+
+                // Settle for whatever fits if eviction couldn't make enough room
+                while (target < texture->_residentMip && residentBytes + extraBytes() > _budgetBytes) {
+                    target++;
+                }
+
+                if (target == texture->_residentMip) continue;
+                if (uploadedBytes > 0 && uploadedBytes + extraBytes() > STREAMING_MAX_UPLOAD_BYTES_PER_FRAME) break;
+
+                residentBytes += extraBytes();
+                uploadedBytes += extraBytes();
+
+                previousMips.try_emplace(texture, texture->_residentMip);
+                texture->_residentMip = target;
+            }
+
+            streamChanges(previousMips);
+
+            for (auto* texture : _textures) {
+                texture->_requestedMip = UINT32_MAX;
+            }
+        }
+
+        _frame++;
+    }
+
+    uint64_t VulkanTextureStreamer::GetResidentBytes() const {
+        uint64_t bytes = 0;
+
+        for (auto* texture : _textures) {
+            bytes += texture->getResidentBytes(texture->_residentMip);
+        }
+
+        return bytes;
+    }
+
+    bool VulkanTextureStreamer::evictOne(const VulkanTexture* exclude, uint64_t& residentBytes, std::unordered_map<VulkanTexture*, uint32_t>& previousMips) {
+        VulkanTexture* victim { nullptr };
+
+        for (auto* texture : _textures) {
+            if (texture == exclude) continue;
+
+            // Never evict below the starting mips, and never evict mips that were drawn this frame
+            if (texture->_residentMip >= VulkanTextureStreamer::GetInitialMip(*texture->_streamSource)) continue;
+            bool requestedThisFrame = texture->_requestedMip != UINT32_MAX;
+            if (requestedThisFrame && texture->_residentMip >= texture->_requestedMip) continue;
+
+            // Least recently drawn goes first
+            if (!victim || texture->_lastRequestedFrame < victim->_lastRequestedFrame) {
+                victim = texture;
+            }
+        }
+
+        if (!victim) return false;
+
+        auto before = victim->getResidentBytes(victim->_residentMip);
+        previousMips.try_emplace(victim, victim->_residentMip);
+        victim->_residentMip++;
+        residentBytes -= before - victim->getResidentBytes(victim->_residentMip);
+
+        return true;
+    }
+
+    void VulkanTextureStreamer::streamChanges(const std::unordered_map<VulkanTexture*, uint32_t>& previousMips) {
+        if (previousMips.empty()) return;
+
+        // Evictions only copy on the GPU and need no staging at all
+        uint64_t stagingSize = 0;
+        for (auto& [texture, previousMip] : previousMips) {
+            stagingSize += texture->getStagingBytes(previousMip);
+        }
+
+        std::shared_ptr<VulkanBuffer> stagingBuffer { nullptr };
+        uint8_t* stagingData { nullptr };
+
+        if (stagingSize > 0) {
+            stagingBuffer = std::make_shared<VulkanBuffer>(&_renderer->_allocator, stagingSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                                                           VMA_MEMORY_USAGE_CPU_ONLY);
+            vmaMapMemory(_renderer->_allocator, stagingBuffer->Allocation, reinterpret_cast<void**>(&stagingData));
+        }
+
+        VkCommandBufferAllocateInfo allocateInfo { VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO };
+        allocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        allocateInfo.commandPool = _renderer->_bufferCommandPool;
+        allocateInfo.commandBufferCount = 1;
+
+        VkCommandBuffer commandBuffer;
+        VK_CHECK("VulkanTextureStreamer::streamChanges()::vkAllocateCommandBuffers", vkAllocateCommandBuffers(_renderer->_device, &allocateInfo, &commandBuffer));
+
+        VkCommandBufferBeginInfo commandBufferBeginInfo { VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO };
+        commandBufferBeginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+        vkBeginCommandBuffer(commandBuffer, &commandBufferBeginInfo);
+
+        uint64_t stagingOffset = 0;
+        for (auto& [texture, previousMip] : previousMips) {
+            texture->recordResidentLevels(commandBuffer, previousMip, stagingBuffer ? stagingBuffer->Buffer : VK_NULL_HANDLE,
+                                          stagingData, stagingOffset);
+        }
+
+        vkEndCommandBuffer(commandBuffer);
+
+        if (stagingBuffer) {
+            vmaUnmapMemory(_renderer->_allocator, stagingBuffer->Allocation);
+        }
+
+        VkSubmitInfo submitInfo { VK_STRUCTURE_TYPE_SUBMIT_INFO };
+        submitInfo.commandBufferCount = 1;
+        submitInfo.pCommandBuffers = &commandBuffer;
+
+        // The frame about to be recorded goes on the same queue after this, and the barriers order its reads after the copies
+        uint64_t streamValue { 0 };
+        VK_CHECK("VulkanTextureStreamer::streamChanges()::vkQueueSubmit", _renderer->_timeline.Submit(_renderer->_graphicsQueue, submitInfo, streamValue));
+
+        _renderer->_deletionQueue.Retire(streamValue, [device = _renderer->_device, commandPool = _renderer->_bufferCommandPool,
+                                                       commandBuffer, stagingBuffer = std::move(stagingBuffer)]() mutable {
+            vkFreeCommandBuffers(device, commandPool, 1, &commandBuffer);
+            stagingBuffer.reset();
+        });
+
+        _renderer->_frameStats.TextureUploadBytes += stagingSize;
+        _renderer->_frameStats.QueueSubmits++;
+    }
+}
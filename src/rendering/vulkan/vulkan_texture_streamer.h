@@ -0,0 +1,63 @@
+#pragma once
+#include <youtube_engine/rendering/images.h>
+
+#include <cstdint>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace OZZ {
+    class VulkanRenderer;
+    class VulkanTexture;
+
+    // Every level in the staging buffer starts on a multiple of this, which covers any texel or block size
+    constexpr uint64_t STREAMING_STAGING_ALIGNMENT = 16;
+
+    constexpr uint64_t AlignStagingSize(uint64_t size) {
+        return (size + STREAMING_STAGING_ALIGNMENT - 1) & ~(STREAMING_STAGING_ALIGNMENT - 1);
+    }
+
+    /*
+     * Streamed textures keep their full mip chain on the CPU and start out with only the small mips on the GPU. The
+     * scene works out the mip each texture needs on screen while building the frame, and the renderer hands those
+     * requests over before the frame begins. The streamer then brings in finer mips, most needed first, and evicts
+     * mips from the textures that have gone unused longest whenever the VRAM budget would be exceeded.
+     *
+     * All of a frame's changes go out in one submission that nothing waits on. Levels a texture already had are copied
+     * over on the GPU, so only the new ones are uploaded. Replaced images go through the renderer's deletion queue.
+     */
+    class VulkanTextureStreamer {
+    public:
+        // A budget of 0 disables streaming; textures are then fully resident as before
+        void Init(VulkanRenderer* renderer, uint64_t budgetBytes);
+        void Shutdown();
+
+        [[nodiscard]] bool IsEnabled() const { return _budgetBytes > 0; }
+
+        void Register(VulkanTexture* texture);
+        void Unregister(VulkanTexture* texture);
+
+        // The finest mip a texture starts out with
+        [[nodiscard]] static uint32_t GetInitialMip(const ImageData& source);
+
+        // Asking for more mips than the texture has gets its smallest
+        void RequestMip(VulkanTexture& texture, uint32_t mip);
+
+        // Call at the start of each frame, before any draws are recorded
+        void Update();
+
+        [[nodiscard]] uint64_t GetResidentBytes() const;
+
+    private:
+        bool evictOne(const VulkanTexture* exclude, uint64_t& residentBytes, std::unordered_map<VulkanTexture*, uint32_t>& previousMips);
+
+        // Records and submits the changes, keyed on what each texture had resident before
+        void streamChanges(const std::unordered_map<VulkanTexture*, uint32_t>& previousMips);
+
+    private:
+        VulkanRenderer* _renderer { nullptr };
+        uint64_t _budgetBytes { 0 };
+        uint64_t _frame { 0 };
+
+        std::unordered_set<VulkanTexture*> _textures {};
+    };
+}
@@ -0,0 +1,77 @@
+#include "vulkan_timeline.h"
+#include "vulkan_utilities.h"
+
+#include <vector>
+
+namespace OZZ {
+    void VulkanTimeline::Init(VkDevice device) {
+        _device = device;
+        _submittedValue = 0;
+
+        VkSemaphoreTypeCreateInfo typeCreateInfo { VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO };
+        typeCreateInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+        typeCreateInfo.initialValue = 0;
+
+        VkSemaphoreCreateInfo createInfo { VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO };
+        createInfo.pNext = &typeCreateInfo;
+        VK_CHECK("VulkanTimeline::Init()::vkCreateSemaphore", vkCreateSemaphore(_device, &createInfo, nullptr, &_semaphore));
+    }
+
+    void VulkanTimeline::Shutdown() {
+        if (_device == VK_NULL_HANDLE) return;
+
+        vkDestroySemaphore(_device, _semaphore, nullptr);
+        _semaphore = VK_NULL_HANDLE;
+        _device = VK_NULL_HANDLE;
+    }
+
+    VkResult VulkanTimeline::Submit(VkQueue queue, const VkSubmitInfo& submitInfo, uint64_t& signalValue) {
+        std::lock_guard<std::mutex> lock(_submitMutex);
+
+        uint64_t value = _submittedValue + 1;
+
+        std::vector<VkSemaphore> signalSemaphores(submitInfo.pSignalSemaphores, submitInfo.pSignalSemaphores + submitInfo.signalSemaphoreCount);
+        signalSemaphores.push_back(_semaphore);
+
+        // Binary semaphores ignore their values, but every semaphore needs one
+        std::vector<uint64_t> signalValues(submitInfo.signalSemaphoreCount, 0);
+        signalValues.push_back(value);
+        std::vector<uint64_t> waitValues(submitInfo.waitSemaphoreCount, 0);
+
+        VkTimelineSemaphoreSubmitInfo timelineSubmitInfo { VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO };
+        timelineSubmitInfo.pNext = submitInfo.pNext;
+        timelineSubmitInfo.waitSemaphoreValueCount = static_cast<uint32_t>(waitValues.size());
+        timelineSubmitInfo.pWaitSemaphoreValues = waitValues.data();
+        timelineSubmitInfo.signalSemaphoreValueCount = static_cast<uint32_t>(signalValues.size());
+        timelineSubmitInfo.pSignalSemaphoreValues = signalValues.data();
+
+        VkSubmitInfo timelineSubmit = submitInfo;
+        timelineSubmit.pNext = &timelineSubmitInfo;
+        timelineSubmit.signalSemaphoreCount = static_cast<uint32_t>(signalSemaphores.size());
+        timelineSubmit.pSignalSemaphores = signalSemaphores.data();
+
+        auto result = vkQueueSubmit(queue, 1, &timelineSubmit, VK_NULL_HANDLE);
+
+        if (result == VK_SUCCESS) {
+            _submittedValue = value;
+            signalValue = value;
+        }
+
+        return result;
+    }
+
+    uint64_t VulkanTimeline::GetCompletedValue() const {
+        uint64_t value { 0 };
+        VK_CHECK("VulkanTimeline::GetCompletedValue()::vkGetSemaphoreCounterValue", vkGetSemaphoreCounterValue(_device, _semaphore, &value));
+        return value;
+    }
+
+    VkResult VulkanTimeline::Wait(uint64_t value, uint64_t timeout) const {
+        VkSemaphoreWaitInfo waitInfo { VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO };
+        waitInfo.semaphoreCount = 1;
+        waitInfo.pSemaphores = &_semaphore;
+        waitInfo.pValues = &value;
+
+        return vkWaitSemaphores(_device, &waitInfo, timeout);
+    }
+}
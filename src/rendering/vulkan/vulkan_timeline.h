@@ -0,0 +1,38 @@
+#pragma once
+#include <atomic>
+#include <mutex>
+
+#include "vulkan_includes.h"
+
+namespace OZZ {
+    /*
+     * One timeline semaphore every submission on the graphics queue signals, each with the next value in turn. The GPU
+     * finishes submissions in order, so a single value says how far it has got. Waiting on a frame, an upload or a VR
+     * eye is waiting for the value its submission was handed, and anything used by a submission is safe to touch again
+     * once the completed value reaches it.
+     */
+    class VulkanTimeline {
+    public:
+        void Init(VkDevice device);
+        void Shutdown();
+
+        // Signals the timeline after the batch's own semaphores. On success the value is the one the timeline reaches
+        // once the batch is done; on failure it's left alone.
+        VkResult Submit(VkQueue queue, const VkSubmitInfo& submitInfo, uint64_t& signalValue);
+
+        // The value of the most recent submission
+        [[nodiscard]] uint64_t GetSubmittedValue() const { return _submittedValue; }
+        [[nodiscard]] uint64_t GetCompletedValue() const;
+        [[nodiscard]] bool IsComplete(uint64_t value) const { return value <= GetCompletedValue(); }
+
+        VkResult Wait(uint64_t value, uint64_t timeout = UINT64_MAX) const;
+
+    private:
+        VkDevice _device { VK_NULL_HANDLE };
+        VkSemaphore _semaphore { VK_NULL_HANDLE };
+
+        // Values have to reach the queue in increasing order
+        std::mutex _submitMutex;
+        std::atomic<uint64_t> _submittedValue { 0 };
+    };
+}
@@ -63,6 +63,26 @@ namespace OZZ {
         return description;
     }
 
+    // The packed position stream used by depth only passes
+    inline VertexInputDescription GetPositionVertexDescription() {
+        VertexInputDescription description{};
+
+        description.bindings.push_back({
+            .binding = 0,
+            .stride = sizeof(glm::vec3),
+            .inputRate = VK_VERTEX_INPUT_RATE_VERTEX
+        });
+
+        description.attributes.push_back({
+            .location = 0,
+            .binding = 0,
+            .format = VK_FORMAT_R32G32B32_SFLOAT,
+            .offset = 0
+        });
+
+        return description;
+    }
+
 
     /*
      * UNIFORM BUFFER THINGS
@@ -79,6 +99,17 @@ namespace OZZ {
         return uboLayoutBinding;
     }
 
+    inline VkDescriptorSetLayoutBinding GetStorageBufferLayoutBinding(uint32_t binding) {
+        VkDescriptorSetLayoutBinding storageLayoutBinding {};
+        storageLayoutBinding.binding = binding;
+        storageLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        storageLayoutBinding.descriptorCount = 1;
+        storageLayoutBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+        storageLayoutBinding.pImmutableSamplers = nullptr;
+
+        return storageLayoutBinding;
+    }
+
     inline VkDescriptorSetLayoutBinding GetTextureLayoutBinding(uint32_t binding) {
         VkDescriptorSetLayoutBinding textureLayoutBinding {};
         textureLayoutBinding.binding = binding;
@@ -105,6 +136,20 @@ namespace OZZ {
                 return VK_FORMAT_R32G32B32_SFLOAT;
             case ColorType::UNSIGNED_CHAR4:
                 return VK_FORMAT_R8G8B8A8_SRGB;
+            case ColorType::BC1_UNORM:
+                return VK_FORMAT_BC1_RGBA_UNORM_BLOCK;
+            case ColorType::BC1_SRGB:
+                return VK_FORMAT_BC1_RGBA_SRGB_BLOCK;
+            case ColorType::BC3_UNORM:
+                return VK_FORMAT_BC3_UNORM_BLOCK;
+            case ColorType::BC3_SRGB:
+                return VK_FORMAT_BC3_SRGB_BLOCK;
+            case ColorType::BC5_UNORM:
+                return VK_FORMAT_BC5_UNORM_BLOCK;
+            case ColorType::BC7_UNORM:
+                return VK_FORMAT_BC7_UNORM_BLOCK;
+            case ColorType::BC7_SRGB:
+                return VK_FORMAT_BC7_SRGB_BLOCK;
             default:
                 return VK_FORMAT_R8G8B8_SRGB;
         }
@@ -10,7 +10,7 @@
 #include <vector>
 
 namespace OZZ {
-    bool VulkanUtilities::LoadShaderModule(const string &shaderPath, VkDevice device, VkShaderModule &outShaderModule, ShaderData& outShaderData) {
+    bool VulkanUtilities::LoadShaderCode(const string &shaderPath, std::vector<uint32_t>& outCode) {
         std::ifstream file(shaderPath, std::ios::ate | std::ios::binary);
 
         if (!file.is_open()) {
@@ -19,12 +19,21 @@ namespace OZZ {
         }
 
         size_t filesize = static_cast<size_t>(file.tellg());
-        std::vector<uint32_t> buffer(filesize / sizeof(uint32_t));
+        outCode.resize(filesize / sizeof(uint32_t));
 
         file.seekg(0);
-        file.read((char*)buffer.data(), static_cast<std::streamsize>(filesize));
+        file.read((char*)outCode.data(), static_cast<std::streamsize>(filesize));
         file.close();
 
+        return !outCode.empty();
+    }
+
+    bool VulkanUtilities::LoadShaderModule(const string &shaderPath, VkDevice device, VkShaderModule &outShaderModule, ShaderData& outShaderData) {
+        std::vector<uint32_t> buffer;
+        if (!LoadShaderCode(shaderPath, buffer)) {
+            return false;
+        }
+
         VkShaderModuleCreateInfo shaderModuleCreateInfo { VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO };
         shaderModuleCreateInfo.codeSize = buffer.size() * sizeof(uint32_t);
         shaderModuleCreateInfo.pCode = buffer.data();
@@ -61,6 +70,12 @@ namespace OZZ {
 
         }
 
+        // Storage buffers
+        for (const auto& res : resources.storage_buffers) {
+            auto resource = BuildShaderResource(ResourceType::StorageBuffer, res, shader);
+            data.Resources[ResourceNameFromString(resource.Name)] = resource;
+        }
+
         // Textures
         for (const auto& res : resources.sampled_images) {
             auto resource = BuildShaderResource(ResourceType::Sampler, res, shader);
@@ -165,4 +180,70 @@ namespace OZZ {
         descriptorSetWrite.pTexelBufferView = nullptr;
         return descriptorSetWrite;
     }
-}
\ No newline at end of file
+
+    bool VulkanUtilities::IsDeviceExtensionSupported(VkPhysicalDevice physicalDevice, const std::string& extensionName) {
+        uint32_t extensionCount { 0 };
+        vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, nullptr);
+
+        std::vector<VkExtensionProperties> extensions(extensionCount);
+        vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, extensions.data());
+
+        for (const auto& extension : extensions) {
+            if (extensionName == extension.extensionName) {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    uint64_t VulkanUtilities::HashBytes(const void* data, size_t size) {
+        uint64_t hash { 14695981039346656037ull };
+        auto* bytes = static_cast<const uint8_t*>(data);
+
+        for (size_t i = 0; i < size; i++) {
+            hash ^= bytes[i];
+            hash *= 1099511628211ull;
+        }
+
+        return hash;
+    }
+
+    uint64_t VulkanUtilities::HashCombine(uint64_t seed, uint64_t value) {
+        return HashBytes(&value, sizeof(value)) ^ (seed + 0x9e3779b97f4a7c15ull + (seed << 6) + (seed >> 2));
+    }
+
+    VkPipeline VulkanUtilities::CreateComputePipeline(VkDevice device, const std::string& shaderName, VkPipelineLayout layout, VkPipelineCache pipelineCache) {
+        auto path = (Filesystem::GetShaderPath() / (shaderName + ".comp.spv")).string();
+
+        std::vector<uint32_t> code;
+        if (!LoadShaderCode(path, code)) {
+            std::cout << "Failed to load compute shader at: " << path << std::endl;
+            return VK_NULL_HANDLE;
+        }
+
+        VkShaderModuleCreateInfo moduleCreateInfo { VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO };
+        moduleCreateInfo.codeSize = code.size() * sizeof(uint32_t);
+        moduleCreateInfo.pCode = code.data();
+
+        VkShaderModule module { VK_NULL_HANDLE };
+        if (vkCreateShaderModule(device, &moduleCreateInfo, nullptr, &module) != VK_SUCCESS) {
+            return VK_NULL_HANDLE;
+        }
+
+        VkComputePipelineCreateInfo pipelineCreateInfo { VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO };
+        pipelineCreateInfo.stage = { VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO };
+        pipelineCreateInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+        pipelineCreateInfo.stage.module = module;
+        pipelineCreateInfo.stage.pName = "main";
+        pipelineCreateInfo.layout = layout;
+
+        VkPipeline pipeline { VK_NULL_HANDLE };
+        if (vkCreateComputePipelines(device, pipelineCache, 1, &pipelineCreateInfo, nullptr, &pipeline) != VK_SUCCESS) {
+            pipeline = VK_NULL_HANDLE;
+        }
+
+        vkDestroyShaderModule(device, module, nullptr);
+        return pipeline;
+    }
+}
@@ -26,11 +26,19 @@ using namespace std;
 namespace OZZ {
     class VulkanUtilities {
     public:
+        static bool LoadShaderCode(const std::string& filePath, std::vector<uint32_t>& outCode);
         static bool LoadShaderModule(const std::string& filePath, VkDevice device, VkShaderModule &outShaderModule, ShaderData& outShaderData);
         static ShaderResource BuildShaderResource(ResourceType type, spirv_cross::Resource res, const spirv_cross::CompilerGLSL& shader);
         static ShaderData LoadShaderData(const spirv_cross::CompilerGLSL& shader);
         static VkWriteDescriptorSet WriteDescriptorSetTexture(VkDescriptorSet& descriptorSet, uint32_t binding, VkDescriptorImageInfo* texture);
         static VkWriteDescriptorSet WriteDescriptorSetUniformBuffer(VkDescriptorSet& descriptorSet, uint32_t binding, VkDescriptorBufferInfo* descriptorBufferInfo);
+        // Loads "<shaderName>.comp.spv" from the shader directory. Null on failure.
+        static VkPipeline CreateComputePipeline(VkDevice device, const std::string& shaderName, VkPipelineLayout layout, VkPipelineCache pipelineCache);
+        static bool IsDeviceExtensionSupported(VkPhysicalDevice physicalDevice, const std::string& extensionName);
+
+        // 64-bit FNV-1a, used to key caches by content
+        static uint64_t HashBytes(const void* data, size_t size);
+        static uint64_t HashCombine(uint64_t seed, uint64_t value);
     };
 }
 
@@ -20,4 +20,14 @@ namespace OZZ {
             }
         }
     }
-}
\ No newline at end of file
+
+    void ResourceManager::ReloadShaders() {
+        for (auto [guid, resource] : _resources) {
+            auto resPtr = resource.lock();
+            if (!resPtr || resPtr->_type != Resource::Type::SHADER) continue;
+
+            resPtr->ClearGPUResource();
+            resPtr->RecreateGPUResource();
+        }
+    }
+}
@@ -3,6 +3,7 @@
 //
 
 #include <youtube_engine/resources/types/image.h>
+#include <youtube_engine/core/profiler.h>
 #include <youtube_engine/service_locator.h>
 
 namespace OZZ {
@@ -12,9 +13,9 @@ namespace OZZ {
     }
 
     Image::Image(const Path &path, ImageData* data) : Resource(path, Resource::Type::IMAGE) {
+        _image = std::shared_ptr<const ImageData>(data);
         _texture = ServiceLocator::GetRenderer()->CreateTexture();
-        _texture->UploadData(*data);
-        _image = std::unique_ptr<ImageData>(data);
+        _texture->UploadData(_image);
     }
 
     Image::~Image() {
@@ -22,8 +23,17 @@ namespace OZZ {
     }
 
     void Image::load(const Path &path) {
+        OZZ_PROFILE_SCOPE("Image::load");
+
+        _image = std::make_shared<const ImageData>(path, true);
+
         _texture = ServiceLocator::GetRenderer()->CreateTexture();
-        _texture->UploadData(ImageData(path, true));
+        _texture->UploadData(_image);
+
+        // A streamed texture reads its mips out of the data as it goes. Otherwise the file is decoded again after a reset.
+        if (!_texture->IsStreamed()) {
+            _image.reset();
+        }
     }
 
     void Image::unload() {
@@ -37,7 +47,12 @@ namespace OZZ {
     void Image::RecreateGPUResource() {
         if (_image) {
             _texture = ServiceLocator::GetRenderer()->CreateTexture();
-            _texture->UploadData(*_image);
+            _texture->UploadData(_image);
+
+            // Streaming may have been turned off with the reset
+            if (!_path.empty() && !_texture->IsStreamed()) {
+                _image.reset();
+            }
             return;
         }
         if (!_path.empty()) {
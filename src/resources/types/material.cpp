@@ -2,6 +2,7 @@
 // Created by ozzadar on 2022-11-01.
 //
 
+#include <youtube_engine/core/profiler.h>
 #include <youtube_engine/platform/filesystem.h>
 #include <youtube_engine/resources/types/material.h>
 #include <youtube_engine/service_locator.h>
@@ -20,6 +21,8 @@ namespace OZZ {
     }
 
     void Material::load(const Path &path) {
+        OZZ_PROFILE_SCOPE("Material::load");
+
         std::cout << "Loading material: " << path.string() << std::endl;
 
         auto materialPath = Filesystem::GetAssetPath() / path;
@@ -3,6 +3,7 @@
 //
 
 #include <youtube_engine/resources/types/mesh.h>
+#include <youtube_engine/core/profiler.h>
 #include <youtube_engine/resources/types/image.h>
 
 #include <youtube_engine/service_locator.h>
@@ -12,6 +13,7 @@
 #include <assimp/scene.h>
 #include <assimp/postprocess.h>
 
+#include <cmath>
 #include <iostream>
 
 namespace OZZ {
@@ -21,6 +23,8 @@ namespace OZZ {
      */
 
     void Mesh::load(const Path& path) {
+        OZZ_PROFILE_SCOPE("Mesh::load");
+
         auto meshPath = Filesystem::GetAssetPath() / path;
 
         // Load all submeshes
@@ -148,6 +152,7 @@ namespace OZZ {
      */
 
     Submesh::Submesh(std::vector<Vertex> &&vertices, std::vector<uint32_t> &&indices) : _vertices{vertices}, _indices {indices} {
+        computeBounds();
         createResources();
     }
 
@@ -164,8 +169,11 @@ namespace OZZ {
         return _textures[textureSlot];
     }
 
-    std::weak_ptr<Image> Submesh::GetTexture(ResourceName textureSlot) {
-        return _textures[textureSlot];
+    std::weak_ptr<Image> Submesh::GetTexture(ResourceName textureSlot) const {
+        auto texture = _textures.find(textureSlot);
+        if (texture == _textures.end()) return {};
+
+        return texture->second;
     }
 
     std::weak_ptr<Material> Submesh::SetMaterial(std::shared_ptr<Material> &&material) {
@@ -185,9 +193,58 @@ namespace OZZ {
         _vertexBuffer->UploadData(_vertices);
     }
 
+    const std::shared_ptr<VertexBuffer>& Submesh::GetPositionBuffer() {
+        if (!_positionBuffer && _vertexBuffer) {
+            std::vector<glm::vec3> positions {};
+            positions.reserve(_vertices.size());
+            for (const auto& vertex : _vertices) {
+                positions.push_back(vertex.position);
+            }
+
+            _positionBuffer = ServiceLocator::GetRenderer()->CreateVertexBuffer();
+            _positionBuffer->UploadPositions(positions);
+        }
+
+        return _positionBuffer;
+    }
+
     void Submesh::freeResources() {
         _indexBuffer.reset();
         _vertexBuffer.reset();
+        _positionBuffer.reset();
+    }
+
+    void Submesh::computeBounds() {
+        if (_vertices.empty()) return;
+
+        _bounds.Min = _bounds.Max = _vertices[0].position;
+        for (const auto& vertex : _vertices) {
+            _bounds.Min = glm::min(_bounds.Min, vertex.position);
+            _bounds.Max = glm::max(_bounds.Max, vertex.position);
+        }
+
+        // Ratio of total triangle area in world space to total area in UV space
+        double worldArea = 0.0;
+        double uvArea = 0.0;
+
+        for (size_t i = 0; i + 2 < _indices.size(); i += 3) {
+            const auto& a = _vertices[_indices[i]];
+            const auto& b = _vertices[_indices[i + 1]];
+            const auto& c = _vertices[_indices[i + 2]];
+
+            worldArea += 0.5 * glm::length(glm::cross(b.position - a.position, c.position - a.position));
+
+            auto uvB = b.uv - a.uv;
+            auto uvC = c.uv - a.uv;
+            uvArea += 0.5 * std::abs(uvB.x * uvC.y - uvB.y * uvC.x);
+        }
+
+        if (worldArea > 0.0 && uvArea > 0.0) {
+            _bounds.WorldUnitsPerUV = static_cast<float>(std::sqrt(worldArea / uvArea));
+        } else {
+            // No usable UVs, assume the texture is stretched across the whole mesh
+            _bounds.WorldUnitsPerUV = glm::length(_bounds.Max - _bounds.Min);
+        }
     }
 
 }
\ No newline at end of file
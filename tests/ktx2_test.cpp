@@ -0,0 +1,140 @@
+#include <youtube_engine/rendering/images.h>
+#include <youtube_engine/rendering/texture_cooker.h>
+
+#include "test_checks.h"
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+using namespace OZZ;
+
+namespace {
+    // Odd dimensions so the edge blocks and the mip chain's rounding both get exercised
+    ImageData makeSourceImage(uint32_t width, uint32_t height) {
+        std::vector<unsigned char> texels(static_cast<size_t>(width) * height * 4);
+
+        for (uint32_t y = 0; y < height; y++) {
+            for (uint32_t x = 0; x < width; x++) {
+                auto* texel = &texels[(static_cast<size_t>(y) * width + x) * 4];
+                texel[0] = static_cast<unsigned char>(x * 255 / (width - 1));
+                texel[1] = static_cast<unsigned char>(y * 255 / (height - 1));
+                texel[2] = static_cast<unsigned char>((x + y) % 2 ? 200 : 40);
+                texel[3] = static_cast<unsigned char>(x < width / 2 ? 255 : 96);
+            }
+        }
+
+        auto size = static_cast<uint32_t>(texels.size());
+        return { width, height, ColorType::UNSIGNED_CHAR4, std::move(texels), {{ .Width = width, .Height = height, .Offset = 0, .Size = size }} };
+    }
+
+    std::vector<char> writeAndRead(const ImageData& image) {
+        auto path = std::filesystem::temp_directory_path() / "ozz_ktx2_test.ktx2";
+        if (!TextureCooker::WriteKTX2(image, path)) return {};
+
+        std::ifstream file(path, std::ios::ate | std::ios::binary);
+        std::vector<char> bytes(static_cast<size_t>(file.tellg()));
+        file.seekg(0);
+        file.read(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+        file.close();
+
+        std::filesystem::remove(path);
+        return bytes;
+    }
+
+    ImageData load(std::vector<char> bytes) {
+        return { bytes.data(), static_cast<uint32_t>(bytes.size()) };
+    }
+
+    template <typename T>
+    std::vector<char> patched(std::vector<char> bytes, size_t offset, T value) {
+        std::memcpy(bytes.data() + offset, &value, sizeof(T));
+        return bytes;
+    }
+
+    void testRoundTrip(ColorType format) {
+        auto source = makeSourceImage(13, 9);
+        auto encoded = TextureCooker::Encode(source, { .Format = format, .GenerateMipmaps = true });
+        CHECK(encoded.IsValid());
+
+        // 13x9 down to 1x1 is 4 levels
+        CHECK(encoded.GetMipLevels().size() == 4);
+
+        auto loaded = load(writeAndRead(encoded));
+        CHECK(loaded.IsValid());
+        CHECK(loaded.GetColorType() == format);
+        CHECK(loaded.GetSize() == encoded.GetSize());
+        CHECK(loaded.IsCompressed() == (format != ColorType::UNSIGNED_CHAR4));
+        CHECK(loaded.GetMipLevels().size() == encoded.GetMipLevels().size());
+        if (loaded.GetMipLevels().size() != encoded.GetMipLevels().size()) return;
+
+        for (size_t level = 0; level < encoded.GetMipLevels().size(); level++) {
+            const auto& expected = encoded.GetMipLevels()[level];
+            const auto& actual = loaded.GetMipLevels()[level];
+
+            CHECK(actual.Width == expected.Width);
+            CHECK(actual.Height == expected.Height);
+            CHECK(actual.Size == expected.Size);
+            CHECK(std::memcmp(loaded.GetData() + actual.Offset, encoded.GetData() + expected.Offset, expected.Size) == 0);
+        }
+    }
+
+    void testKnownBlock() {
+        // A solid block has equal endpoints and every index at 0: pure red is 0xF800 in RGB565
+        std::vector<unsigned char> red(4 * 4 * 4);
+        for (size_t i = 0; i < red.size(); i += 4) {
+            red[i] = 255; red[i + 1] = 0; red[i + 2] = 0; red[i + 3] = 255;
+        }
+
+        auto blocks = TextureCooker::EncodeBlocks(red.data(), 4, 4, ColorType::BC1_UNORM);
+        const std::vector<unsigned char> expected { 0x00, 0xF8, 0x00, 0xF8, 0x00, 0x00, 0x00, 0x00 };
+        CHECK(blocks == expected);
+
+        std::vector<unsigned char> data = blocks;
+        ImageData image { 4, 4, ColorType::BC1_UNORM, std::move(data), {{ .Width = 4, .Height = 4, .Offset = 0, .Size = 8 }} };
+
+        auto loaded = load(writeAndRead(image));
+        CHECK(loaded.IsValid());
+        CHECK(loaded.GetDataSize() == 8);
+        CHECK(loaded.GetDataSize() == 8 && std::memcmp(loaded.GetData(), expected.data(), 8) == 0);
+    }
+
+    void testRejectsMalformedFiles() {
+        auto source = makeSourceImage(13, 9);
+        auto file = writeAndRead(TextureCooker::Encode(source, { .Format = ColorType::BC1_SRGB, .GenerateMipmaps = true }));
+        CHECK(load(file).IsValid());
+
+        // Header fields sit after the 12 byte identifier, the level index after the 68 byte header
+        constexpr size_t pixelWidth = 12 + 8, pixelHeight = 12 + 12, levelCount = 12 + 28, firstLevelOffset = 12 + 68;
+
+        CHECK(!load(patched<uint32_t>(file, pixelWidth, 0)).IsValid());
+        CHECK(!load(patched<uint32_t>(file, pixelHeight, 0)).IsValid());
+
+        // 13x9 allows 4 levels; 40 would shift the width by 32 and more
+        CHECK(!load(patched<uint32_t>(file, levelCount, 5)).IsValid());
+        CHECK(!load(patched<uint32_t>(file, levelCount, 40)).IsValid());
+
+        // An offset that wraps when the level size is added to it
+        CHECK(!load(patched<uint64_t>(file, firstLevelOffset, UINT64_MAX - 4)).IsValid());
+
+        // (width + 3) / 4 used to wrap to 0 blocks here, leaving a level that needs no data at all
+        auto huge = patched<uint32_t>(patched<uint32_t>(file, pixelWidth, UINT32_MAX), levelCount, 1);
+        CHECK(!load(huge).IsValid());
+
+        file.resize(file.size() - 1);
+        CHECK(!load(file).IsValid());
+    }
+}
+
+int main() {
+    testRoundTrip(ColorType::UNSIGNED_CHAR4);
+    testRoundTrip(ColorType::BC1_SRGB);
+    testRoundTrip(ColorType::BC3_UNORM);
+    testRoundTrip(ColorType::BC5_UNORM);
+    testKnownBlock();
+    testRejectsMalformedFiles();
+
+    return Tests::Finish("ktx2_test");
+}
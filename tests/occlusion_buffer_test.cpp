@@ -0,0 +1,174 @@
+#include <youtube_engine/rendering/occlusion_buffer.h>
+#include <youtube_engine/core/job_system.h>
+#include <rendering/occlusion_coverage.h>
+
+#include "test_checks.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <vector>
+
+using namespace OZZ;
+
+namespace {
+    constexpr float NEAR_PLANE = 0.1f;
+
+    // Camera at the origin looking down -Z
+    glm::mat4 makeViewProjection() {
+        auto projection = glm::perspective(glm::radians(60.f), 2.f, NEAR_PLANE, 100.f);
+        auto view = glm::lookAt(glm::vec3 { 0.f }, glm::vec3 { 0.f, 0.f, -1.f }, glm::vec3 { 0.f, 1.f, 0.f });
+        return projection * view;
+    }
+
+    // A wall facing the camera at the given distance
+    void addWall(OcclusionBuffer& buffer, float distance, float minX, float maxX, float minY, float maxY) {
+        std::vector<glm::vec3> vertices {
+                { minX, minY, -distance },
+                { maxX, minY, -distance },
+                { maxX, maxY, -distance },
+                { minX, maxY, -distance }
+        };
+
+        buffer.AddOccluder(vertices, { 0, 1, 2, 0, 2, 3 }, glm::mat4 { 1.f });
+    }
+
+    bool isBoxOccluded(const OcclusionBuffer& buffer, float x, float y, float distance) {
+        return buffer.IsOccluded({ x - 0.5f, y - 0.5f, -distance - 0.5f }, { x + 0.5f, y + 0.5f, -distance + 0.5f });
+    }
+
+    void testFullScreenOccluder() {
+        OcclusionBuffer buffer {};
+        buffer.Begin(makeViewProjection());
+        addWall(buffer, 5.f, -100.f, 100.f, -100.f, 100.f);
+        buffer.Rasterize();
+
+        CHECK(isBoxOccluded(buffer, 0.f, 0.f, 10.f));
+        CHECK(isBoxOccluded(buffer, 3.f, 1.f, 20.f));
+        CHECK(!isBoxOccluded(buffer, 0.f, 0.f, 2.f));
+
+        // Straddles the wall
+        CHECK(!isBoxOccluded(buffer, 0.f, 0.f, 5.f));
+    }
+
+    // Only covers the left of the screen
+    void testPartialOccluder() {
+        OcclusionBuffer buffer {};
+        buffer.Begin(makeViewProjection());
+        addWall(buffer, 5.f, -100.f, -1.f, -100.f, 100.f);
+        buffer.Rasterize();
+
+        CHECK(isBoxOccluded(buffer, -4.f, 0.f, 10.f));
+        CHECK(!isBoxOccluded(buffer, 3.f, 0.f, 10.f));
+
+        // Half behind the wall isn't hidden
+        CHECK(!isBoxOccluded(buffer, -1.f, 0.f, 10.f));
+    }
+
+    // The GPU clips anything in front of the near plane, so it can't hide anything either
+    void testInFrontOfNearPlane() {
+        OcclusionBuffer buffer {};
+        buffer.Begin(makeViewProjection());
+        addWall(buffer, NEAR_PLANE * 0.5f, -100.f, 100.f, -100.f, 100.f);
+        buffer.Rasterize();
+
+        // Away from the quad's diagonal, where both of its triangles cover whole tiles
+        CHECK(!isBoxOccluded(buffer, 4.f, -1.f, 10.f));
+        CHECK(!isBoxOccluded(buffer, -4.f, 1.f, 10.f));
+    }
+
+    // Many overlapping triangles at random depths, including some crossing the screen edges and the near plane
+    void addRandomOccluders(OcclusionBuffer& buffer, uint32_t seed) {
+        std::mt19937 random { seed };
+        std::uniform_real_distribution<float> side { -30.f, 30.f };
+        std::uniform_real_distribution<float> distance { -1.f, 40.f };
+
+        std::vector<glm::vec3> vertices {};
+        std::vector<uint32_t> indices {};
+        for (uint32_t i = 0; i < 3000; i++) {
+            vertices.push_back({ side(random), side(random), -distance(random) });
+            indices.push_back(i);
+        }
+
+        buffer.AddOccluder(vertices, indices, glm::mat4 { 1.f });
+    }
+
+    void testThreadCountDoesNotMatter() {
+        OcclusionBuffer serial {};
+        serial.Begin(makeViewProjection());
+        addRandomOccluders(serial, 1234);
+        serial.Rasterize(nullptr);
+
+        JobSystem jobSystem { 4 };
+        OcclusionBuffer parallel {};
+        parallel.Begin(makeViewProjection());
+        addRandomOccluders(parallel, 1234);
+        parallel.Rasterize(&jobSystem);
+
+        CHECK(serial.GetTriangleCount() > 0);
+        CHECK(serial.GetTriangleCount() == parallel.GetTriangleCount());
+
+        bool identical = true;
+        for (uint32_t tileY = 0; tileY < serial.GetHeight() / OcclusionBuffer::TILE_HEIGHT; tileY++) {
+            for (uint32_t tileX = 0; tileX < serial.GetWidth() / OcclusionBuffer::TILE_WIDTH; tileX++) {
+                float serialDepth = serial.GetTileDepth(tileX, tileY);
+                float parallelDepth = parallel.GetTileDepth(tileX, tileY);
+                identical &= std::memcmp(&serialDepth, &parallelDepth, sizeof(float)) == 0;
+            }
+        }
+
+        CHECK(identical);
+    }
+
+    void testCoveragePathsAgree() {
+#ifdef OZZ_OCCLUSION_SSE
+        std::mt19937 random { 42 };
+        std::uniform_real_distribution<float> position { -16.f, 48.f };
+
+        uint32_t mismatches = 0;
+        uint32_t partialTiles = 0;
+
+        for (int i = 0; i < 100000; i++) {
+            glm::vec2 points[3] { { position(random), position(random) }, { position(random), position(random) }, { position(random), position(random) } };
+
+            // Same edge setup as the buffer: wound so the inside is positive
+            if ((points[1].x - points[0].x) * (points[2].y - points[0].y) - (points[1].y - points[0].y) * (points[2].x - points[0].x) < 0.f) {
+                std::swap(points[1], points[2]);
+            }
+
+            glm::vec3 edges[3];
+            for (int edge = 0; edge < 3; edge++) {
+                const auto& from = points[edge];
+                const auto& to = points[(edge + 1) % 3];
+                edges[edge] = { from.y - to.y, to.x - from.x, -((from.y - to.y) * from.x + (to.x - from.x) * from.y) };
+            }
+
+            float tileX = static_cast<float>(OcclusionBuffer::TILE_WIDTH * (random() % 4));
+            float tileY = static_cast<float>(OcclusionBuffer::TILE_HEIGHT * (random() % 8));
+
+            auto scalar = OcclusionCoverage::ComputeScalar(edges, tileX, tileY);
+            mismatches += scalar != OcclusionCoverage::ComputeSSE2(edges, tileX, tileY);
+            partialTiles += scalar != 0 && scalar != 0xFFFFFFFFu;
+        }
+
+        CHECK(mismatches == 0);
+
+        // Make sure the comparison covered edges actually crossing tiles
+        CHECK(partialTiles > 1000);
+#else
+        std::cout << "occlusion_buffer_test: no SSE2, only the scalar coverage path is built" << std::endl;
+#endif
+    }
+}
+
+int main() {
+    testFullScreenOccluder();
+    testPartialOccluder();
+    testInFrontOfNearPlane();
+    testThreadCountDoesNotMatter();
+    testCoveragePathsAgree();
+
+    return Tests::Finish("occlusion_buffer_test");
+}
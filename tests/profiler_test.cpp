@@ -0,0 +1,181 @@
+#include <youtube_engine/core/profiler.h>
+
+#include <nlohmann/json.hpp>
+
+#include "test_checks.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <thread>
+
+using namespace OZZ;
+
+namespace {
+    // Zones are only ever told apart by pointer, so these have to be the same literals every time
+    constexpr const char* OLDEST_ZONE = "Oldest";
+    constexpr const char* NEWEST_ZONE = "Newest";
+    constexpr const char* CONCURRENT_ZONE = "Concurrent";
+
+    nlohmann::json exportTrace() {
+        auto path = std::filesystem::temp_directory_path() / "ozz_profiler_test.json";
+        if (!Profiler::ExportChromeTrace(path)) return {};
+
+        std::ifstream file(path);
+        auto trace = nlohmann::json::parse(file);
+        file.close();
+
+        std::filesystem::remove(path);
+        return trace;
+    }
+
+    // Zone events recorded by the thread that named itself threadName
+    std::vector<nlohmann::json> threadZones(const nlohmann::json& trace, const std::string& threadName) {
+        int64_t threadId = -1;
+        for (const auto& event : trace["traceEvents"]) {
+            if (event["ph"] == "M" && event["args"]["name"] == threadName) {
+                threadId = event["tid"];
+            }
+        }
+
+        std::vector<nlohmann::json> zones {};
+        for (const auto& event : trace["traceEvents"]) {
+            if (event["ph"] == "X" && event["tid"] == threadId) {
+                zones.push_back(event);
+            }
+        }
+
+        return zones;
+    }
+
+    void testExport() {
+        std::thread([]() {
+            OZZ_PROFILE_THREAD("Export");
+            OZZ_PROFILE_SCOPE("Outer");
+            {
+                OZZ_PROFILE_SCOPE("Inner");
+            }
+        }).join();
+
+        auto zones = threadZones(exportTrace(), "Export");
+        CHECK(zones.size() == 2);
+
+        // Inner closes first
+        if (zones.size() == 2) {
+            CHECK(zones[0]["name"] == "Inner");
+            CHECK(zones[1]["name"] == "Outer");
+            CHECK(zones[1]["ts"].get<double>() <= zones[0]["ts"].get<double>());
+            CHECK(zones[1]["dur"].get<double>() >= zones[0]["dur"].get<double>());
+        }
+    }
+
+    void testWrapKeepsNewest() {
+        std::thread([]() {
+            OZZ_PROFILE_THREAD("Wrap");
+
+            auto now = Profiler::Now();
+            for (int i = 0; i < 20; i++) Profiler::Record(OLDEST_ZONE, now, now);
+            for (uint64_t i = 0; i < Profiler::RING_SIZE; i++) Profiler::Record(NEWEST_ZONE, now, now);
+        }).join();
+
+        auto zones = threadZones(exportTrace(), "Wrap");
+        auto oldest = std::count_if(zones.begin(), zones.end(), [](const auto& zone) { return zone["name"] == OLDEST_ZONE; });
+
+        CHECK(oldest == 0);
+        CHECK(zones.size() <= Profiler::RING_SIZE);
+
+        // Only the slot that could have been mid-write is given up
+        CHECK(zones.size() >= Profiler::RING_SIZE - 1);
+    }
+
+    // Every zone lasts exactly 1ns and starts 2ns after the last, so a record mixed from two zones stands out
+    void testExportWhileRecording() {
+        std::atomic<bool> done { false };
+
+        std::thread writer([&done]() {
+            OZZ_PROFILE_THREAD("Concurrent");
+
+            auto base = Profiler::Now();
+            for (uint64_t i = 0; !done.load(std::memory_order_relaxed); i++) {
+                Profiler::Record(CONCURRENT_ZONE, base + i * 2, base + i * 2 + 1);
+            }
+        });
+
+        for (int pass = 0; pass < 5; pass++) {
+            auto zones = threadZones(exportTrace(), "Concurrent");
+
+            bool wellFormed = true;
+            for (size_t i = 0; i < zones.size(); i++) {
+                wellFormed &= zones[i]["name"] == CONCURRENT_ZONE;
+                wellFormed &= std::abs(zones[i]["dur"].get<double>() - 0.001) < 1e-6;
+
+                if (i > 0) {
+                    wellFormed &= std::abs(zones[i]["ts"].get<double>() - zones[i - 1]["ts"].get<double>() - 0.002) < 1e-3;
+                }
+            }
+
+            CHECK(wellFormed);
+        }
+
+        done = true;
+        writer.join();
+    }
+
+    // Each zone reads the clock twice, and what that costs depends on the host (around 40ns each in some VMs), so the
+    // 50ns budget is for what the profiler adds on top. Only held to it in optimised builds, debug ones just report.
+    void benchmarkZoneCost() {
+        constexpr int zoneCount = 1'000'000;
+        double bestZone = std::numeric_limits<double>::max();
+        double bestClock = std::numeric_limits<double>::max();
+
+        auto nanosecondsPer = [](auto start, int count) {
+            return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / count;
+        };
+
+        std::thread([&]() {
+            // The first zone allocates the thread's buffer
+            { OZZ_PROFILE_SCOPE("Warmup"); }
+
+            for (int run = 0; run < 5; run++) {
+                auto start = std::chrono::steady_clock::now();
+                for (int i = 0; i < zoneCount; i++) {
+                    OZZ_PROFILE_SCOPE("Benchmark");
+                }
+                bestZone = std::min(bestZone, nanosecondsPer(start, zoneCount));
+
+                uint64_t sink = 0;
+                start = std::chrono::steady_clock::now();
+                for (int i = 0; i < zoneCount; i++) {
+                    sink += Profiler::Now();
+                }
+                bestClock = std::min(bestClock, nanosecondsPer(start, zoneCount));
+
+                // Keeps the clock loop from being optimised away
+                if (sink == 0) std::cout << "";
+            }
+        }).join();
+
+        auto overhead = std::max(bestZone - 2.0 * bestClock, 0.0);
+        std::cout << "profiler_test: " << bestZone << " ns per zone, " << bestClock << " ns per clock read, "
+                  << overhead << " ns recording overhead" << std::endl;
+
+#ifdef NDEBUG
+        CHECK(overhead < 50.0);
+#endif
+    }
+}
+
+int main() {
+    testExport();
+    testWrapKeepsNewest();
+    testExportWhileRecording();
+    benchmarkZoneCost();
+
+    return Tests::Finish("profiler_test");
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <iostream>
+
+// CHECK keeps going after a failure, so one run reports every check that failed
+#define CHECK(condition) \
+    do { if (!(condition)) { std::cerr << __FILE__ << ":" << __LINE__ << ": CHECK(" #condition ") failed" << std::endl; ::OZZ::Tests::Failures++; } } while (0)
+
+namespace OZZ::Tests {
+    inline int Failures = 0;
+
+    // What main returns once every test has run
+    inline int Finish(const char* testName) {
+        if (Failures == 0) {
+            std::cout << testName << ": all checks passed" << std::endl;
+        }
+
+        return Failures == 0 ? 0 : 1;
+    }
+}